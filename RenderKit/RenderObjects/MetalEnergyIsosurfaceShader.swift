@@ -51,6 +51,42 @@ class MetalEnergyIsosurfaceShader
   let cachedAdsorptionSurfaces: [Int: NSCache<AnyObject, AnyObject>] = [16: NSCache(), 32: NSCache(), 64: NSCache(), 128: NSCache(), 256: NSCache(), 512: NSCache()]
   let cachedPermanentAdsorptionSurfaces: [Int: NSCache<AnyObject, AnyObject>] = [16: NSCache(), 32: NSCache(), 64: NSCache(), 128: NSCache(), 256: NSCache(), 512: NSCache()]
   
+  // Large surfaces get a level-of-detail chain: level 0 is the surface of the GPU ('vertexBuffer'), the coarser levels are simplified on the
+  // CPU from the indexed mesh of the flying edges and cached with the surface. The level is chosen per frame from the projected size of the unit cell. The coarser
+  // levels are uploaded as indexed meshes (each vertex once, 32-bit indices) and drawn with 'drawIndexedPrimitives'.
+  // The chain is built on a background queue and swapped in on the main thread when ready; until then the full resolution is drawn. A new
+  // update cancels the pending builds and discards the results of the running one ('levelOfDetailGeneration').
+  static let numberOfLevelsOfDetail: Int = 4
+  static let minimumNumberOfTrianglesForLevelsOfDetail: Int = 250000
+  var levelOfDetailBuffers: [[[IndexedMeshBuffers]]] = []
+  let cachedLevelsOfDetail: NSCache<AnyObject, AnyObject> = NSCache()
+  let levelOfDetailQueue: DispatchQueue = DispatchQueue(label: "nl.darkwing.isosurface.levelofdetail", qos: .userInitiated)
+  var pendingLevelsOfDetail: [DispatchWorkItem] = []
+  var levelOfDetailGeneration: Int = 0
+  var levelsOfDetailDidChange: (() -> ())? = nil
+  
+  // the vertices (in the layout of the marching cubes: position, normal and texture coordinate) and the indices of the triangles
+  struct IndexedMeshBuffers
+  {
+    let vertices: MTLBuffer
+    let indices: MTLBuffer
+    let numberOfTriangles: Int
+  }
+  
+  final class LevelsOfDetail
+  {
+    let isoValue: Double
+    let dimensions: SIMD3<Int32>
+    let meshes: [SKIsoSurfaceMesh]
+    
+    init(isoValue: Double, dimensions: SIMD3<Int32>, meshes: [SKIsoSurfaceMesh])
+    {
+      self.isoValue = isoValue
+      self.dimensions = dimensions
+      self.meshes = meshes
+    }
+  }
+  
   public func buildPipeLine(device: MTLDevice, library: MTLLibrary, vertexDescriptor: MTLVertexDescriptor,  maximumNumberOfSamples: Int)
   {
     let depthStateDesc: MTLDepthStencilDescriptor = MTLDepthStencilDescriptor()
@@ -109,6 +145,8 @@ class MetalEnergyIsosurfaceShader
   public func buildVertexBuffers()
   {
     self.vertexBuffer = []
+    self.levelOfDetailBuffers = []
+    self.cancelLevelsOfDetail()
     if let _: RKRenderDataSource = renderDataSource
     {
       for i in 0..<self.renderStructures.count
@@ -120,10 +158,101 @@ class MetalEnergyIsosurfaceShader
           buffers.append(nil)
         }
         self.vertexBuffer.append(buffers)
+        self.levelOfDetailBuffers.append([[IndexedMeshBuffers]](repeating: [], count: structures.count))
       }
     }
   }
   
+  // the vertex buffer, the index buffer (nil for the triangle soup of the full resolution) and the number of triangles of the level of detail
+  // for the projected size of the unit cell
+  func levelOfDetail(_ structure: RKRenderVolumetricDataSource, sceneIndex: Int, movieIndex: Int, camera: RKCamera?, size: CGSize) -> (buffer: MTLBuffer?, indexBuffer: MTLBuffer?, numberOfTriangles: Int)
+  {
+    let fullResolution: (buffer: MTLBuffer?, indexBuffer: MTLBuffer?, numberOfTriangles: Int) = (self.metalBuffer(vertexBuffer, sceneIndex: sceneIndex, movieIndex: movieIndex), nil, structure.adsorptionSurfaceNumberOfTriangles)
+    guard let camera: RKCamera = camera,
+          sceneIndex < levelOfDetailBuffers.count,
+          movieIndex < levelOfDetailBuffers[sceneIndex].count else { return fullResolution }
+    let coarserLevels: [IndexedMeshBuffers] = levelOfDetailBuffers[sceneIndex][movieIndex]
+    guard !coarserLevels.isEmpty else { return fullResolution }
+    
+    // the extent in pixels of the corners of the unit cell (the full resolution when a corner is behind the camera)
+    let matrix: double4x4 = camera.projectionMatrix * camera.modelViewMatrix
+    var lower: SIMD2<Double> = SIMD2<Double>(repeating: Double.infinity)
+    var upper: SIMD2<Double> = SIMD2<Double>(repeating: -Double.infinity)
+    for corner in 0..<8
+    {
+      let fractional: SIMD3<Double> = SIMD3<Double>(Double(corner & 1), Double((corner >> 1) & 1), Double((corner >> 2) & 1))
+      let position: SIMD3<Double> = structure.origin + structure.cell.unitCell * fractional
+      let clip: SIMD4<Double> = matrix * SIMD4<Double>(position, 1.0)
+      guard clip.w > 0.0 else { return fullResolution }
+      let pixels: SIMD2<Double> = 0.5 * SIMD2<Double>(clip.x, clip.y) / clip.w * SIMD2<Double>(Double(size.width), Double(size.height))
+      lower = simd_min(lower, pixels)
+      upper = simd_max(upper, pixels)
+    }
+    
+    let dimensions: SIMD3<Int> = SIMD3<Int>(truncatingIfNeeded: structure.dimensions)
+    let level: Int = SKIsoSurfaceMesh.levelOfDetail(projectedSize: (upper - lower).max(), resolution: dimensions, numberOfLevels: coarserLevels.count + 1)
+    guard level > 0 else { return fullResolution }
+    let buffers: IndexedMeshBuffers = coarserLevels[level - 1]
+    return (buffers.vertices, buffers.indices, buffers.numberOfTriangles)
+  }
+  
+  func cancelLevelsOfDetail()
+  {
+    pendingLevelsOfDetail.forEach{$0.cancel()}
+    pendingLevelsOfDetail = []
+    levelOfDetailGeneration += 1
+  }
+  
+  static func levelOfDetailBuffers(device: MTLDevice, levelsOfDetail: LevelsOfDetail) -> [IndexedMeshBuffers]
+  {
+    return levelsOfDetail.meshes.filter{$0.numberOfTriangles > 0}.compactMap{mesh -> IndexedMeshBuffers? in
+      let vertices: [SIMD4<Float>] = mesh.renderVertices
+      guard let vertexBuffer: MTLBuffer = device.makeBuffer(bytes: vertices, length: MemoryLayout<SIMD4<Float>>.stride * vertices.count, options: .storageModeManaged),
+            let indexBuffer: MTLBuffer = device.makeBuffer(bytes: mesh.indices, length: MemoryLayout<UInt32>.stride * mesh.indices.count, options: .storageModeManaged) else { return nil }
+      return IndexedMeshBuffers(vertices: vertexBuffer, indices: indexBuffer, numberOfTriangles: mesh.numberOfTriangles)
+    }
+  }
+  
+  // simplifies the surface on the level-of-detail queue and swaps the buffers in on the main thread, unless a newer update has started since
+  func buildLevelsOfDetail(device: MTLDevice, structure: RKRenderVolumetricDataSource, data: [Float], dimensions: SIMD3<Int32>, sceneIndex: Int, movieIndex: Int)
+  {
+    let generation: Int = levelOfDetailGeneration
+    let isoValue: Double = structure.adsorptionSurfaceIsoValue
+    let unitCell: double3x3 = structure.cell.unitCell
+    
+    let workItem: DispatchWorkItem = DispatchWorkItem { [weak self] in
+      let flyingEdges: SKFlyingEdges = SKFlyingEdges(dimensions: dimensions)
+      let mesh: SKIsoSurfaceMesh = flyingEdges.isoSurfaces(data, isoValues: [Float(isoValue)])[0]
+      let levels: [SKIsoSurfaceMesh] = mesh.levelsOfDetail(resolution: SIMD3<Int>(truncatingIfNeeded: dimensions), numberOfLevels: MetalEnergyIsosurfaceShader.numberOfLevelsOfDetail, unitCell: unitCell)
+      let levelsOfDetail: LevelsOfDetail = LevelsOfDetail(isoValue: isoValue, dimensions: dimensions, meshes: Array(levels.dropFirst()))
+      let buffers: [IndexedMeshBuffers] = MetalEnergyIsosurfaceShader.levelOfDetailBuffers(device: device, levelsOfDetail: levelsOfDetail)
+      
+      DispatchQueue.main.async(execute: {
+        guard let self = self,
+              generation == self.levelOfDetailGeneration,
+              sceneIndex < self.levelOfDetailBuffers.count,
+              movieIndex < self.levelOfDetailBuffers[sceneIndex].count else { return }
+        self.cachedLevelsOfDetail.setObject(levelsOfDetail, forKey: structure)
+        self.levelOfDetailBuffers[sceneIndex][movieIndex] = buffers
+        self.levelsOfDetailDidChange?()
+      })
+    }
+    pendingLevelsOfDetail.append(workItem)
+    levelOfDetailQueue.async(execute: workItem)
+  }
+  
+  func drawIsosurface(_ commandEncoder: MTLRenderCommandEncoder, levelOfDetail: (buffer: MTLBuffer?, indexBuffer: MTLBuffer?, numberOfTriangles: Int), instanceCount: Int)
+  {
+    if let indexBuffer: MTLBuffer = levelOfDetail.indexBuffer
+    {
+      commandEncoder.drawIndexedPrimitives(type: .triangle, indexCount: 3 * levelOfDetail.numberOfTriangles, indexType: .uint32, indexBuffer: indexBuffer, indexBufferOffset: 0, instanceCount: instanceCount)
+    }
+    else
+    {
+      commandEncoder.drawPrimitives(type: .triangle, vertexStart: 0, vertexCount: 3 * levelOfDetail.numberOfTriangles, instanceCount: instanceCount)
+    }
+  }
+  
   public func buildInstanceBuffers(device: MTLDevice)
   {
     if let _: RKRenderDataSource = renderDataSource
@@ -152,7 +281,7 @@ class MetalEnergyIsosurfaceShader
     }
   }
   
-  public func renderOpaqueIsosurfaceWithEncoder(_ commandEncoder: MTLRenderCommandEncoder, renderPassDescriptor: MTLRenderPassDescriptor, frameUniformBuffer: MTLBuffer, structureUniformBuffers: MTLBuffer?, isosurfaceUniformBuffers: MTLBuffer?, lightUniformBuffers: MTLBuffer?, size: CGSize)
+  public func renderOpaqueIsosurfaceWithEncoder(_ commandEncoder: MTLRenderCommandEncoder, renderPassDescriptor: MTLRenderPassDescriptor, frameUniformBuffer: MTLBuffer, structureUniformBuffers: MTLBuffer?, isosurfaceUniformBuffers: MTLBuffer?, lightUniformBuffers: MTLBuffer?, size: CGSize, camera: RKCamera?)
   {
     commandEncoder.setDepthStencilState(depthState)
     commandEncoder.setRenderPipelineState(opaquePipeLine)
@@ -173,13 +302,14 @@ class MetalEnergyIsosurfaceShader
       for (j,structure) in structures.enumerated()
       {
         if let structure: RKRenderVolumetricDataSource = structure as? RKRenderVolumetricDataSource,
-           let isosurfaceVertexBuffer = self.metalBuffer(vertexBuffer, sceneIndex: i, movieIndex: j),
            let instanceIsosurfaceVertexBuffer = self.metalBuffer(instanceBuffer, sceneIndex: i, movieIndex: j),
            structure.drawAdsorptionSurface,
            structure.adsorptionSurfaceRenderingMethod == .isoSurface
         {
-          let vertexCount: Int = 3 * structure.adsorptionSurfaceNumberOfTriangles
-          if (structure.isVisible &&  structure.adsorptionSurfaceOpacity>0.99999 && vertexCount>0)
+          let levelOfDetail: (buffer: MTLBuffer?, indexBuffer: MTLBuffer?, numberOfTriangles: Int) = self.levelOfDetail(structure, sceneIndex: i, movieIndex: j, camera: camera, size: size)
+          let vertexCount: Int = 3 * levelOfDetail.numberOfTriangles
+          if let isosurfaceVertexBuffer: MTLBuffer = levelOfDetail.buffer,
+             (structure.isVisible &&  structure.adsorptionSurfaceOpacity>0.99999 && vertexCount>0)
           {
             commandEncoder.setVertexBuffer(isosurfaceVertexBuffer, offset: 0, index: 0)
             commandEncoder.setVertexBuffer(instanceIsosurfaceVertexBuffer, offset: 0, index: 1)
@@ -188,7 +318,7 @@ class MetalEnergyIsosurfaceShader
             commandEncoder.setFragmentBufferOffset(index*MemoryLayout<RKStructureUniforms>.stride, index: 1)
             commandEncoder.setFragmentBufferOffset(index*MemoryLayout<RKIsosurfaceUniforms>.stride, index: 2)
             
-            commandEncoder.drawPrimitives(type: .triangle, vertexStart: 0, vertexCount: vertexCount, instanceCount: instanceIsosurfaceVertexBuffer.length / MemoryLayout<SIMD4<Float>>.stride)
+            self.drawIsosurface(commandEncoder, levelOfDetail: levelOfDetail, instanceCount: instanceIsosurfaceVertexBuffer.length / MemoryLayout<SIMD4<Float>>.stride)
           }
         }
         index = index + 1
@@ -199,7 +329,7 @@ class MetalEnergyIsosurfaceShader
   
   
   
-  public func renderTransparentIsosurfacesWithEncoder(_ commandEncoder: MTLRenderCommandEncoder, renderPassDescriptor: MTLRenderPassDescriptor, frameUniformBuffer: MTLBuffer, structureUniformBuffers: MTLBuffer?, isosurfaceUniformBuffers: MTLBuffer?, lightUniformBuffers: MTLBuffer?, size: CGSize)
+  public func renderTransparentIsosurfacesWithEncoder(_ commandEncoder: MTLRenderCommandEncoder, renderPassDescriptor: MTLRenderPassDescriptor, frameUniformBuffer: MTLBuffer, structureUniformBuffers: MTLBuffer?, isosurfaceUniformBuffers: MTLBuffer?, lightUniformBuffers: MTLBuffer?, size: CGSize, camera: RKCamera?)
   {
     if let _: RKRenderDataSource = renderDataSource
     {
@@ -226,13 +356,14 @@ class MetalEnergyIsosurfaceShader
         for (j,structure) in structures.enumerated()
         {
           if let structure: RKRenderVolumetricDataSource = structure as? RKRenderVolumetricDataSource,
-             let isosurfaceVertexBuffer = self.metalBuffer(vertexBuffer, sceneIndex: i, movieIndex: j),
              let instanceIsosurfaceVertexBuffer = self.metalBuffer(instanceBuffer, sceneIndex: i, movieIndex: j),
              structure.drawAdsorptionSurface,
              structure.adsorptionSurfaceRenderingMethod == .isoSurface
           {
-            let vertexCount: Int = 3 * structure.adsorptionSurfaceNumberOfTriangles
-            if (structure.isVisible && structure.adsorptionSurfaceOpacity<=0.99999 && vertexCount>0)
+            let levelOfDetail: (buffer: MTLBuffer?, indexBuffer: MTLBuffer?, numberOfTriangles: Int) = self.levelOfDetail(structure, sceneIndex: i, movieIndex: j, camera: camera, size: size)
+            let vertexCount: Int = 3 * levelOfDetail.numberOfTriangles
+            if let isosurfaceVertexBuffer: MTLBuffer = levelOfDetail.buffer,
+               (structure.isVisible && structure.adsorptionSurfaceOpacity<=0.99999 && vertexCount>0)
             {
               commandEncoder.setVertexBuffer(isosurfaceVertexBuffer, offset: 0, index: 0)
               commandEncoder.setVertexBuffer(instanceIsosurfaceVertexBuffer, offset: 0, index: 1)
@@ -242,10 +373,10 @@ class MetalEnergyIsosurfaceShader
               commandEncoder.setFragmentBufferOffset(index*MemoryLayout<RKIsosurfaceUniforms>.stride, index: 2)
               
               commandEncoder.setCullMode(MTLCullMode.front)
-              commandEncoder.drawPrimitives(type: .triangle, vertexStart: 0, vertexCount: vertexCount, instanceCount: instanceIsosurfaceVertexBuffer.length / MemoryLayout<SIMD4<Float>>.stride)
+              self.drawIsosurface(commandEncoder, levelOfDetail: levelOfDetail, instanceCount: instanceIsosurfaceVertexBuffer.length / MemoryLayout<SIMD4<Float>>.stride)
               
               commandEncoder.setCullMode(MTLCullMode.back)
-              commandEncoder.drawPrimitives(type: .triangle, vertexStart: 0, vertexCount: vertexCount, instanceCount: instanceIsosurfaceVertexBuffer.length / MemoryLayout<SIMD4<Float>>.stride)
+              self.drawIsosurface(commandEncoder, levelOfDetail: levelOfDetail, instanceCount: instanceIsosurfaceVertexBuffer.length / MemoryLayout<SIMD4<Float>>.stride)
             }
           }
           index = index + 1
@@ -273,6 +404,8 @@ class MetalEnergyIsosurfaceShader
       var info: mach_timebase_info_data_t = mach_timebase_info_data_t()
       mach_timebase_info(&info)
       
+      self.cancelLevelsOfDetail()
+      
       for i in 0..<self.renderStructures.count
       {
         let structures: [RKRenderObject] = self.renderStructures[i]
@@ -345,6 +478,20 @@ class MetalEnergyIsosurfaceShader
               LogQueue.shared.error(destination: windowController, message: error.localizedDescription)
             }
             
+            levelOfDetailBuffers[i][j] = []
+            if structure.adsorptionSurfaceNumberOfTriangles >= MetalEnergyIsosurfaceShader.minimumNumberOfTrianglesForLevelsOfDetail
+            {
+              if let levelsOfDetail: LevelsOfDetail = cachedLevelsOfDetail.object(forKey: structure) as? LevelsOfDetail,
+                 levelsOfDetail.isoValue == structure.adsorptionSurfaceIsoValue && levelsOfDetail.dimensions == dimensions
+              {
+                levelOfDetailBuffers[i][j] = MetalEnergyIsosurfaceShader.levelOfDetailBuffers(device: device, levelsOfDetail: levelsOfDetail)
+              }
+              else
+              {
+                buildLevelsOfDetail(device: device, structure: structure, data: data, dimensions: dimensions, sceneIndex: i, movieIndex: j)
+              }
+            }
+            
             let endTime: UInt64  = mach_absolute_time()
             
             let time: Double = Double((endTime - startTime) * UInt64(info.numer)) / Double(info.denom) * 0.000001
@@ -152,6 +152,11 @@ public class RenderViewController: NSViewController, MTKViewDelegate
       
       self.renderer.backgroundShader.buildPermanentTextures(device: device)
     }
+    
+    // the coarser levels of detail of the isosurfaces are built in the background
+    self.renderer.isosurfaceShader.levelsOfDetailDidChange = { [weak self] in
+      self?.redraw()
+    }
   }
   
   public override func viewWillAppear()
@@ -440,6 +445,7 @@ public class RenderViewController: NSViewController, MTKViewDelegate
     self.renderer.isosurfaceShader.cachedAdsorptionSurfaces[128]?.removeAllObjects()
     self.renderer.isosurfaceShader.cachedAdsorptionSurfaces[256]?.removeAllObjects()
     self.renderer.isosurfaceShader.cachedAdsorptionSurfaces[512]?.removeAllObjects()
+    self.renderer.isosurfaceShader.cachedLevelsOfDetail.removeAllObjects()
     
     self.renderer.volumeRenderedSurfaceShader.cachedEnergyGrids[16]?.removeAllObjects()
     self.renderer.volumeRenderedSurfaceShader.cachedEnergyGrids[32]?.removeAllObjects()
@@ -459,6 +465,7 @@ public class RenderViewController: NSViewController, MTKViewDelegate
       self.renderer.isosurfaceShader.cachedAdsorptionSurfaces[128]?.removeObject(forKey: structure)
       self.renderer.isosurfaceShader.cachedAdsorptionSurfaces[256]?.removeObject(forKey: structure)
       self.renderer.isosurfaceShader.cachedAdsorptionSurfaces[512]?.removeObject(forKey: structure)
+      self.renderer.isosurfaceShader.cachedLevelsOfDetail.removeObject(forKey: structure)
       
       self.renderer.volumeRenderedSurfaceShader.cachedEnergyGrids[16]?.removeObject(forKey: structure)
       self.renderer.volumeRenderedSurfaceShader.cachedEnergyGrids[32]?.removeObject(forKey: structure)
@@ -82,3 +82,232 @@ kernel void ComputeEnergyGrid(constant int& numberOfAtoms [[ buffer(0) ]],
   output[ igrid ] += min(value,10000000.0f);
 }
 
+
+// Streaming version of 'ComputeEnergyGrid': the grid positions are computed from the thread index instead of read from memory. The kernel
+// computes a slab of z-slices starting at slice 'gridDimensions.w', the grid-spacing (in fractional coordinates of the replica-cell) is given by 'spacing'.
+kernel void ComputeEnergyGridSlab(constant int& numberOfAtoms [[ buffer(0) ]],
+                                  const device float4* atomPosition [[ buffer(1) ]],
+                                  constant int4& gridDimensions [[ buffer(2) ]],
+                                  const device float2* potparameters [[ buffer(3) ]],
+                                  constant float3x3& cell [[ buffer(4) ]],
+                                  constant int& numberOfReplicas [[ buffer(5) ]],
+                                  constant float4* replicas [[ buffer(6) ]],
+                                  device float *output [[ buffer(7) ]],
+                                  constant float4& spacing [[ buffer(8) ]],
+                                  constant int& numberOfGridPoints [[ buffer(9) ]],
+                                  uint igrid [[thread_position_in_grid]])
+{
+  if (int(igrid) >= numberOfGridPoints) return;
+  
+  float value = 0.0f;
+  float3 t,dr,pos;
+  
+  int ix = int(igrid) % gridDimensions.x;
+  int iy = (int(igrid) / gridDimensions.x) % gridDimensions.y;
+  int iz = gridDimensions.w + int(igrid) / (gridDimensions.x * gridDimensions.y);
+  float3 gridpos = float3(float(ix), float(iy), float(iz)) * spacing.xyz;
+  
+  for(int j=0;j<numberOfReplicas;j++)
+  {
+    float3 replica = replicas[j].xyz;
+    for(int iatom = 0; iatom < numberOfAtoms; iatom++ )
+    {
+      pos = atomPosition[iatom].xyz;
+      float eps = potparameters[iatom].x;
+      float size = potparameters[iatom].y;
+    
+      dr = (gridpos - pos) - replica;
+      
+      t = dr - rint(dr);
+      
+      dr = cell * t;
+      
+      float rr = dot(dr,dr);
+      
+      if (rr<12.0*12.0)
+      {
+        float temp = size*size/rr;
+        float rri3 = temp * temp * temp;
+        
+        value += eps*(rri3*(rri3-1.0f));
+      }
+    }
+  }
+  
+  output[ igrid ] += min(value,10000000.0f);
+}
+
+
+// Multi-probe version of 'ComputeEnergyGrid': the distance to each atom is computed once and reused for every probe.
+// The parameters are stored per atom for all probes (numberOfProbes consecutive entries), the output-grid of probe 'p'
+// starts at 'p * numberOfGridPoints'.
+#define MAXIMUM_NUMBER_OF_PROBES 8
+
+kernel void ComputeEnergyGrids(constant int& numberOfAtoms [[ buffer(0) ]],
+                               const device float4* atomPosition [[ buffer(1) ]],
+                               const device float4* gridPosition [[ buffer(2) ]],
+                               const device float2* potparameters [[ buffer(3) ]],
+                               constant float3x3& cell [[ buffer(4) ]],
+                               constant int& numberOfReplicas [[ buffer(5) ]],
+                               constant float4* replicas [[ buffer(6) ]],
+                               device float *output [[ buffer(7) ]],
+                               constant int& numberOfProbes [[ buffer(8) ]],
+                               constant int& numberOfGridPoints [[ buffer(9) ]],
+                               uint igrid [[thread_position_in_grid]])
+{
+  float value[MAXIMUM_NUMBER_OF_PROBES];
+  float3 t,dr,pos;
+  
+  for(int p=0;p<numberOfProbes;p++)
+  {
+    value[p] = 0.0f;
+  }
+
+  float3 gridpos =  gridPosition[igrid].xyz;
+  
+  for(int j=0;j<numberOfReplicas;j++)
+  {
+    float3 replica = replicas[j].xyz;
+    for(int iatom = 0; iatom < numberOfAtoms; iatom++ )
+    {
+      pos = atomPosition[iatom].xyz;
+    
+      dr = (gridpos - pos) - replica;
+      
+      t = dr - rint(dr);
+      
+      dr = cell * t;
+      
+      float rr = dot(dr,dr);
+      
+      if (rr<12.0*12.0)
+      {
+        for(int p=0;p<numberOfProbes;p++)
+        {
+          float eps = potparameters[iatom * numberOfProbes + p].x;
+          float size = potparameters[iatom * numberOfProbes + p].y;
+          
+          float temp = size*size/rr;
+          float rri3 = temp * temp * temp;
+        
+          value[p] += eps*(rri3*(rri3-1.0f));
+        }
+      }
+    }
+  }
+  
+  for(int p=0;p<numberOfProbes;p++)
+  {
+    output[ p * numberOfGridPoints + igrid ] += min(value[p],10000000.0f);
+  }
+}
+
+// Tabulated version of 'ComputeEnergyGrid': the type of the atom is stored in the w-component of its position, and the
+// energy is evaluated from the cubic spline in r^2 of that type (see 'SKPairPotentialTable').
+kernel void ComputeEnergyGridTabulated(constant int& numberOfAtoms [[ buffer(0) ]],
+                                       const device float4* atomPosition [[ buffer(1) ]],
+                                       const device float4* gridPosition [[ buffer(2) ]],
+                                       const device float2* rangeParameters [[ buffer(3) ]],
+                                       constant float3x3& cell [[ buffer(4) ]],
+                                       constant int& numberOfReplicas [[ buffer(5) ]],
+                                       constant float4* replicas [[ buffer(6) ]],
+                                       device float *output [[ buffer(7) ]],
+                                       const device float4* coefficients [[ buffer(8) ]],
+                                       constant int& numberOfIntervals [[ buffer(9) ]],
+                                       uint igrid [[thread_position_in_grid]])
+{
+  float value = 0.0f;
+  float3 t,dr;
+
+  float3 gridpos =  gridPosition[igrid].xyz;
+  
+  for(int j=0;j<numberOfReplicas;j++)
+  {
+    float3 replica = replicas[j].xyz;
+    for(int iatom = 0; iatom < numberOfAtoms; iatom++ )
+    {
+      float4 pos = atomPosition[iatom];
+    
+      dr = (gridpos - pos.xyz) - replica;
+      
+      t = dr - rint(dr);
+      
+      dr = cell * t;
+      
+      float rr = dot(dr,dr);
+      
+      if (rr<12.0*12.0)
+      {
+        int type = int(pos.w);
+        float2 range = rangeParameters[type];
+        float x = max(0.0f, (rr - range.x) * range.y);
+        int index = min(int(x), numberOfIntervals - 1);
+        float s = x - float(index);
+        float4 c = coefficients[type * numberOfIntervals + index];
+        
+        value += c.x + s * (c.y + s * (c.z + s * c.w));
+      }
+    }
+  }
+  
+  output[ igrid ] += min(value,10000000.0f);
+}
+
+// Version of 'ComputeEnergyGrid' that also computes the analytic gradient with respect to the fractional position in the
+// replica-cell (yzw). A work-batch that is clamped contributes the maximum energy and no gradient.
+kernel void ComputeEnergyGridWithGradient(constant int& numberOfAtoms [[ buffer(0) ]],
+                                          const device float4* atomPosition [[ buffer(1) ]],
+                                          const device float4* gridPosition [[ buffer(2) ]],
+                                          const device float2* potparameters [[ buffer(3) ]],
+                                          constant float3x3& cell [[ buffer(4) ]],
+                                          constant int& numberOfReplicas [[ buffer(5) ]],
+                                          constant float4* replicas [[ buffer(6) ]],
+                                          device float4 *output [[ buffer(7) ]],
+                                          uint igrid [[thread_position_in_grid]])
+{
+  float value = 0.0f;
+  float3 gradient = float3(0.0f);
+  float3 t,dr,pos;
+
+  float3 gridpos =  gridPosition[igrid].xyz;
+  
+  for(int j=0;j<numberOfReplicas;j++)
+  {
+    float3 replica = replicas[j].xyz;
+    for(int iatom = 0; iatom < numberOfAtoms; iatom++ )
+    {
+      pos = atomPosition[iatom].xyz;
+      float eps = potparameters[iatom].x;
+      float size = potparameters[iatom].y;
+    
+      dr = (gridpos - pos) - replica;
+      
+      t = dr - rint(dr);
+      
+      dr = cell * t;
+      
+      float rr = dot(dr,dr);
+      
+      if (rr<12.0*12.0)
+      {
+        float temp = size*size/rr;
+        float rri3 = temp * temp * temp;
+        
+        value += eps*(rri3*(rri3-1.0f));
+        
+        // 2 dU/dr^2, times the derivative of dr with respect to the fractional position
+        float force = -6.0f*eps*rri3*(2.0f*rri3-1.0f)/rr;
+        gradient += force * (transpose(cell) * dr);
+      }
+    }
+  }
+  
+  if (value < 10000000.0f)
+  {
+    output[ igrid ] += float4(value, gradient);
+  }
+  else
+  {
+    output[ igrid ] += float4(10000000.0f, 0.0f, 0.0f, 0.0f);
+  }
+}
@@ -459,22 +459,22 @@ kernel void traverseHP(texture3d<float,access::read> rawData [[ texture(0) ]],
     uint3 point0 = uint3(cubePosition.x + offsets3[edge*6], cubePosition.y + offsets3[edge*6+1], cubePosition.z + offsets3[edge*6+2]);
     uint3 point1 = uint3(cubePosition.x + offsets3[edge*6+3], cubePosition.y + offsets3[edge*6+4], cubePosition.z + offsets3[edge*6+5]);
     
-    // compute normal
+    // compute normal (the backward neighbour is offset by the dimensions, so that the modulo wraps correctly for non-power-of-two sizes)
     const float3 forwardDifference0 = float3(
                                              -rawData.read(uint3(point0.x+1, point0.y,   point0.z)   % dimensions).x+
-                                              rawData.read(uint3(point0.x-1, point0.y,   point0.z)   % dimensions).x,
+                                              rawData.read(uint3(point0.x+dimensions.x-1, point0.y,   point0.z)   % dimensions).x,
                                              -rawData.read(uint3(point0.x,   point0.y+1, point0.z)   % dimensions).x+
-                                              rawData.read(uint3(point0.x,   point0.y-1, point0.z)   % dimensions).x,
+                                              rawData.read(uint3(point0.x,   point0.y+dimensions.y-1, point0.z)   % dimensions).x,
                                              -rawData.read(uint3(point0.x,   point0.y,   point0.z+1) % dimensions).x+
-                                              rawData.read(uint3(point0.x,   point0.y,   point0.z-1) % dimensions).x);
+                                              rawData.read(uint3(point0.x,   point0.y,   point0.z+dimensions.z-1) % dimensions).x);
     
     const float3 forwardDifference1 = float3(
                                              -rawData.read(uint3(point1.x+1, point1.y,   point1.z)   % dimensions).x+
-                                              rawData.read(uint3(point1.x-1, point1.y,   point1.z)   % dimensions).x,
+                                              rawData.read(uint3(point1.x+dimensions.x-1, point1.y,   point1.z)   % dimensions).x,
                                              -rawData.read(uint3(point1.x,   point1.y+1, point1.z)   % dimensions).x+
-                                              rawData.read(uint3(point1.x,   point1.y-1, point1.z)   % dimensions).x,
+                                              rawData.read(uint3(point1.x,   point1.y+dimensions.y-1, point1.z)   % dimensions).x,
                                              -rawData.read(uint3(point1.x,   point1.y,   point1.z+1) % dimensions).x+
-                                              rawData.read(uint3(point1.x,   point1.y,   point1.z-1) % dimensions).x);
+                                              rawData.read(uint3(point1.x,   point1.y,   point1.z+dimensions.z-1) % dimensions).x);
     
     const float value0 = rawData.read(point0 % dimensions).x;
     const float diff =  (isolevel-value0)/(rawData.read(point1 % dimensions).x - value0);
@@ -522,3 +522,67 @@ kernel void classifyCubes(texture3d<float,access::read> rawData [[ texture(0) ]]
   uint4 writeValue = uint4(numberOfTriangles[cubeindex], cubeindex, 0, 0);
   writeHistoPyramid.write(writeValue, gid);
 }
+
+
+// Area-only marching cubes: each thread handles a line of cubes along x and accumulates the Cartesian area of the triangles that would be
+// generated for these cubes (using the same vertices as 'traverseHP'), without storing them. The partial sums per line are reduced afterwards.
+kernel void computeSurfaceArea(device const float* voxels [[ buffer(0) ]],
+                               device float* lineAreas [[ buffer(1) ]],
+                               device const float& isolevel [[ buffer(2) ]],
+                               device const uint3& dimensions [[ buffer(3) ]],
+                               device const float3x3& unitCell [[ buffer(4) ]],
+                               uint2 gid [[ thread_position_in_grid ]])
+{
+  if(any(gid >= dimensions.yz))
+    return;
+  
+  float area = 0.0;
+  for(uint x = 0; x < dimensions.x; x++)
+  {
+    const uint3 cubePosition = uint3(x, gid.x, gid.y);
+    
+    float values[8];
+    for(int corner = 0; corner < 8; corner++)
+    {
+      const uint3 position = (cubePosition + cubeOffsets[corner]) % dimensions;
+      values[corner] = voxels[position.x + dimensions.x * (position.y + dimensions.y * position.z)];
+    }
+    
+    const uchar cubeindex = (values[0] > isolevel) |
+    ((values[1] > isolevel) << 1) |
+    ((values[3] > isolevel) << 2) |
+    ((values[2] > isolevel) << 3) |
+    ((values[4] > isolevel) << 4) |
+    ((values[5] > isolevel) << 5) |
+    ((values[7] > isolevel) << 6) |
+    ((values[6] > isolevel) << 7);
+    
+    for(uint triangle = 0; triangle < numberOfTriangles[cubeindex]; triangle++)
+    {
+      float3 vertices[3];
+      for(uint i = 0; i < 3; i++)
+      {
+        const uchar edge = triTable[cubeindex*16 + triangle*3 + i];
+        const uint3 point0 = cubePosition + uint3(offsets3[edge*6], offsets3[edge*6+1], offsets3[edge*6+2]);
+        const uint3 point1 = cubePosition + uint3(offsets3[edge*6+3], offsets3[edge*6+4], offsets3[edge*6+5]);
+        const uint3 wrapped0 = point0 % dimensions;
+        const uint3 wrapped1 = point1 % dimensions;
+        
+        const float value0 = voxels[wrapped0.x + dimensions.x * (wrapped0.y + dimensions.y * wrapped0.z)];
+        const float value1 = voxels[wrapped1.x + dimensions.x * (wrapped1.y + dimensions.y * wrapped1.z)];
+        const float diff = (isolevel-value0)/(value1 - value0);
+        
+        const float3 vertex = float3(point0) + (float3(point1) - float3(point0)) * diff;
+        vertices[i] = unitCell * (vertex / float3(dimensions));
+      }
+      
+      // the same filter as applied to the triangles read back from 'traverseHP'
+      const float triangleArea = 0.5 * length(cross(vertices[1] - vertices[0], vertices[2] - vertices[0]));
+      if(isfinite(triangleArea) && triangleArea < 1.0)
+      {
+        area += triangleArea;
+      }
+    }
+  }
+  lineAreas[gid.x + dimensions.y * gid.y] = area;
+}
@@ -0,0 +1,104 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+import SymmetryKit
+
+// Geometric accessible surface area (as in RASPA): points are sampled uniformly on the spheres around the atoms, inflated by the probe (the
+// radius is the mixed Lennard-Jones size 0.5 (sigma_i + sigma_probe)), and the fraction of points that does not overlap with any other
+// sphere gives the accessible area of that sphere. The overlaps are found with a periodic cell list, the atoms are processed in parallel and
+// each atom has its own random number stream (the result only depends on the seed).
+public class SKAccessibleSurfaceArea
+{
+  public var numberOfSamplesPerAtom: Int = 500
+  public var seed: UInt64 = 0x5DEECE66D
+  
+  let cell: SKCell
+  let positions: [SIMD3<Double>]
+  let potentialParameters: [SIMD2<Double>]
+  let structureMass: Double
+  
+  // the positions are fractional positions in the unit cell, the mass of the unit cell is in g/mol
+  public init(cell: SKCell, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], structureMass: Double)
+  {
+    self.cell = cell
+    self.positions = positions
+    self.potentialParameters = potentialParameters
+    self.structureMass = structureMass
+  }
+  
+  // the total accessible area in Angstrom^2 (per unit cell), and in m^2/g and m^2/cm^3
+  public func compute(probeDiameter: Double) -> (area: Double, gravimetric: Double, volumetric: Double)
+  {
+    let numberOfAtoms: Int = positions.count
+    guard numberOfAtoms > 0, cell.volume > 0.0 else { return (0.0, 0.0, 0.0) }
+    
+    let radii: [Double] = potentialParameters.map{0.5 * ($0.y + probeDiameter)}
+    guard (radii.max() ?? 0.0) > 0.0 else { return (0.0, 0.0, 0.0) }
+    
+    let cellList: SKPeriodicCellList = SKPeriodicCellList(cell: cell, positions: positions, radii: radii)
+    
+    let numberOfSamples: Int = max(1, numberOfSamplesPerAtom)
+    let seed: UInt64 = self.seed
+    
+    var areas: [Double] = [Double](repeating: 0.0, count: numberOfAtoms)
+    areas.withUnsafeMutableBufferPointer { areasPtr in
+      let area: UnsafeMutablePointer<Double> = areasPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: numberOfAtoms) { atom in
+        var generator: SKRandomNumberGenerator = SKRandomNumberGenerator(seed: seed, stream: atom)
+        let center: SIMD3<Double> = cellList.positions[atom]
+        let radius: Double = cellList.radii[atom]
+        
+        var numberOfAccessiblePoints: Int = 0
+        for _ in 0..<numberOfSamples
+        {
+          // uniform on the unit sphere
+          let z: Double = 2.0 * generator.uniform() - 1.0
+          let phi: Double = 2.0 * Double.pi * generator.uniform()
+          let rho: Double = sqrt(max(0.0, 1.0 - z * z))
+          let point: SIMD3<Double> = center + cellList.inverseSuperCell * (radius * SIMD3<Double>(rho * cos(phi), rho * sin(phi), z))
+          
+          if !cellList.overlaps(point, excluding: atom)
+          {
+            numberOfAccessiblePoints += 1
+          }
+        }
+        area[atom] = 4.0 * Double.pi * radius * radius * Double(numberOfAccessiblePoints) / Double(numberOfSamples)
+      }
+    }
+    
+    let totalArea: Double = areas.reduce(0.0, +)
+    let gravimetric: Double = structureMass > 0.0 ? totalArea * SKConstant.AvogadroConstantPerAngstromSquared / structureMass : 0.0
+    let volumetric: Double = totalArea * 1e4 / cell.volume
+    return (totalArea, gravimetric, volumetric)
+  }
+}
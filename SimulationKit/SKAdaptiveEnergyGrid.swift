@@ -0,0 +1,239 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+
+// Adaptive (octree) version of an energy grid. A coarse grid is evaluated first, and only the cells whose corner values straddle the iso-value
+// or reach into the Boltzmann-relevant window (below 'refinementThreshold') are subdivided, level by level, down to single grid spacings. The
+// other cells are represented by their corners only and are trilinearly interpolated when the grid is resampled to a dense grid. The grid uses
+// the convention of 'ComputeEnergyGrid' (x varying the fastest, point i located at fractional position i/(size-1)). Features smaller than a
+// coarse cell that do not touch a corner are not detected, so the coarse stride should be smaller than the size of the smallest pore.
+public struct SKAdaptiveEnergyGrid
+{
+  public struct Cell
+  {
+    // the grid indices of the lower and upper corner (inclusive)
+    public var lower: SIMD3<Int>
+    public var upper: SIMD3<Int>
+    
+    var isUnitCell: Bool
+    {
+      return (upper.x - lower.x) <= 1 && (upper.y - lower.y) <= 1 && (upper.z - lower.z) <= 1
+    }
+    
+    var corners: [SIMD3<Int>]
+    {
+      return [SIMD3<Int>(lower.x, lower.y, lower.z), SIMD3<Int>(upper.x, lower.y, lower.z),
+              SIMD3<Int>(lower.x, upper.y, lower.z), SIMD3<Int>(upper.x, upper.y, lower.z),
+              SIMD3<Int>(lower.x, lower.y, upper.z), SIMD3<Int>(upper.x, lower.y, upper.z),
+              SIMD3<Int>(lower.x, upper.y, upper.z), SIMD3<Int>(upper.x, upper.y, upper.z)]
+    }
+    
+    // splits the cell in half along every axis that spans more than one grid spacing
+    var children: [Cell]
+    {
+      let middle: SIMD3<Int> = (lower &+ upper) / 2
+      let x: [(Int, Int)] = (upper.x - lower.x) > 1 ? [(lower.x, middle.x), (middle.x, upper.x)] : [(lower.x, upper.x)]
+      let y: [(Int, Int)] = (upper.y - lower.y) > 1 ? [(lower.y, middle.y), (middle.y, upper.y)] : [(lower.y, upper.y)]
+      let z: [(Int, Int)] = (upper.z - lower.z) > 1 ? [(lower.z, middle.z), (middle.z, upper.z)] : [(lower.z, upper.z)]
+      
+      var children: [Cell] = []
+      for rz in z
+      {
+        for ry in y
+        {
+          for rx in x
+          {
+            children.append(Cell(lower: SIMD3<Int>(rx.0, ry.0, rz.0), upper: SIMD3<Int>(rx.1, ry.1, rz.1)))
+          }
+        }
+      }
+      return children
+    }
+  }
+  
+  public let dimensions: SIMD3<Int>
+  public let coarseStride: Int
+  public let isoValue: Float
+  public let refinementThreshold: Float?
+  
+  // the evaluated grid points (keyed by the index in the dense grid)
+  public private(set) var values: [Int: Float] = [:]
+  
+  // the cells that were not subdivided any further
+  public private(set) var leaves: [Cell] = []
+  
+  public var numberOfEvaluations: Int
+  {
+    return values.count
+  }
+  
+  // 'evaluate' computes the energies of a batch of grid points (given as grid indices), e.g. in parallel or on the GPU
+  public init(dimensions: SIMD3<Int>, coarseStride: Int = 8, isoValue: Float, refinementThreshold: Float? = nil, evaluate: ([SIMD3<Int>]) -> [Float])
+  {
+    self.dimensions = dimensions
+    self.coarseStride = max(1, coarseStride)
+    self.isoValue = isoValue
+    self.refinementThreshold = refinementThreshold
+    
+    guard dimensions.x > 0, dimensions.y > 0, dimensions.z > 0 else { return }
+    
+    let coarseStride: Int = self.coarseStride
+    func coarseRanges(_ size: Int) -> [(Int, Int)]
+    {
+      guard size > 1 else { return [(0, 0)] }
+      return stride(from: 0, to: size - 1, by: coarseStride).map{($0, min($0 + coarseStride, size - 1))}
+    }
+    
+    var active: [Cell] = []
+    for rz in coarseRanges(dimensions.z)
+    {
+      for ry in coarseRanges(dimensions.y)
+      {
+        for rx in coarseRanges(dimensions.x)
+        {
+          active.append(Cell(lower: SIMD3<Int>(rx.0, ry.0, rz.0), upper: SIMD3<Int>(rx.1, ry.1, rz.1)))
+        }
+      }
+    }
+    
+    // level by level: evaluate the missing corners of the active cells (as one batch), then decide which cells to subdivide
+    while !active.isEmpty
+    {
+      var missing: Set<Int> = []
+      for cell in active
+      {
+        for corner in cell.corners where values[index(corner)] == nil
+        {
+          missing.insert(index(corner))
+        }
+      }
+      let points: [Int] = missing.sorted()
+      let energies: [Float] = evaluate(points.map{gridIndex($0)})
+      guard energies.count == points.count else { self.values = [:]; self.leaves = []; return }
+      for (point, energy) in zip(points, energies)
+      {
+        values[point] = energy
+      }
+      
+      var next: [Cell] = []
+      for cell in active
+      {
+        if !cell.isUnitCell && needsRefinement(cell)
+        {
+          next.append(contentsOf: cell.children)
+        }
+        else
+        {
+          leaves.append(cell)
+        }
+      }
+      active = next
+    }
+  }
+  
+  @inline(__always)
+  func index(_ point: SIMD3<Int>) -> Int
+  {
+    return point.x + dimensions.x * (point.y + dimensions.y * point.z)
+  }
+  
+  @inline(__always)
+  func gridIndex(_ index: Int) -> SIMD3<Int>
+  {
+    return SIMD3<Int>(index % dimensions.x, (index / dimensions.x) % dimensions.y, index / (dimensions.x * dimensions.y))
+  }
+  
+  func needsRefinement(_ cell: Cell) -> Bool
+  {
+    let cornerValues: [Float] = cell.corners.map{values[index($0)] ?? 0.0}
+    let minimum: Float = cornerValues.min() ?? 0.0
+    let maximum: Float = cornerValues.max() ?? 0.0
+    
+    if minimum <= isoValue && maximum >= isoValue
+    {
+      return true
+    }
+    if let refinementThreshold = refinementThreshold, minimum < refinementThreshold
+    {
+      return true
+    }
+    return false
+  }
+  
+  // Resamples to the dense grid: the points inside the leaves are trilinearly interpolated from the corners of the leaf, the evaluated points keep
+  // their value. The leaves are filled from large to small, so the faces shared with smaller (more accurate) neighbours use the finest leaf.
+  public func denseGrid() -> [Float]
+  {
+    let numberOfPoints: Int = dimensions.x * dimensions.y * dimensions.z
+    var output: [Float] = [Float](repeating: 0.0, count: numberOfPoints)
+    guard numberOfPoints > 0, !leaves.isEmpty else { return output }
+    
+    let sortedLeaves: [Cell] = leaves.filter{!$0.isUnitCell}.sorted{
+      let a: SIMD3<Int> = $0.upper &- $0.lower
+      let b: SIMD3<Int> = $1.upper &- $1.lower
+      return a.x * a.y * a.z > b.x * b.y * b.z
+    }
+    
+    output.withUnsafeMutableBufferPointer { outputPtr in
+      let out: UnsafeMutablePointer<Float> = outputPtr.baseAddress!
+      for cell in sortedLeaves
+      {
+        let c: [Float] = cell.corners.map{values[index($0)] ?? 0.0}
+        let extent: SIMD3<Float> = SIMD3<Float>(SIMD3<Int>(max(1, cell.upper.x - cell.lower.x), max(1, cell.upper.y - cell.lower.y), max(1, cell.upper.z - cell.lower.z)))
+        
+        for k in cell.lower.z...cell.upper.z
+        {
+          let tz: Float = Float(k - cell.lower.z) / extent.z
+          for j in cell.lower.y...cell.upper.y
+          {
+            let ty: Float = Float(j - cell.lower.y) / extent.y
+            let c0: Float = (c[0] * (1.0 - ty) + c[2] * ty) * (1.0 - tz) + (c[4] * (1.0 - ty) + c[6] * ty) * tz
+            let c1: Float = (c[1] * (1.0 - ty) + c[3] * ty) * (1.0 - tz) + (c[5] * (1.0 - ty) + c[7] * ty) * tz
+            let row: UnsafeMutablePointer<Float> = out + dimensions.x * (j + dimensions.y * k)
+            for i in cell.lower.x...cell.upper.x
+            {
+              let tx: Float = Float(i - cell.lower.x) / extent.x
+              row[i] = c0 * (1.0 - tx) + c1 * tx
+            }
+          }
+        }
+      }
+      
+      for (index, value) in values
+      {
+        out[index] = value
+      }
+    }
+    return output
+  }
+}
@@ -0,0 +1,201 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+import Metal
+import SymmetryKit
+
+// Blocking spheres for the inaccessible pockets of an energy grid, in the format of the '.block'-files of RASPA: the number of spheres followed
+// by one line per sphere with the fractional position of the center and the radius in Angstrom.
+// The pockets are labelled with SKPoreConnectivity. For each pocket point the distance to the nearest channel point (an accessible point outside
+// any pocket) follows from the periodic distance transform of SKPoreGeometry, so a sphere may extend into the framework but never into a channel.
+// Each pocket is then covered greedily: the uncovered point with the largest distance becomes the center of a sphere with that distance minus
+// one grid spacing as radius (the margin keeps the sphere off the channel points in between the grid points), which covers all pocket points
+// inside it. The pockets are covered in parallel.
+// The distance transform uses the axis spacings, which is exact for orthogonal cells and an approximation for strongly
+// non-orthogonal cells.
+public struct SKBlockingPockets
+{
+  // the centers in fractional coordinates of the unit cell, the radii in Angstrom
+  public let spheres: [(position: SIMD3<Double>, radius: Double)]
+  public let connectivity: SKPoreConnectivity
+  
+  // the grid points are located at i/(N-1) of the unit cell along each axis, the last point being the periodic image of the first
+  public init(values: [Float], dimensions: SIMD3<Int>, cell: SKCell, threshold: Float = 0.0)
+  {
+    let connectivity: SKPoreConnectivity = SKPoreConnectivity(values: values, dimensions: dimensions, threshold: threshold)
+    self.connectivity = connectivity
+    
+    let pockets: [Int] = connectivity.components.indices.filter{!connectivity.components[$0].isChannel}
+    guard !pockets.isEmpty else
+    {
+      self.spheres = []
+      return
+    }
+    
+    // the periodic points
+    let n: SIMD3<Int> = SIMD3<Int>(max(1, dimensions.x - 1), max(1, dimensions.y - 1), max(1, dimensions.z - 1))
+    let numberOfPoints: Int = n.x * n.y * n.z
+    let lengths: (a: Double, b: Double, c: Double) = cell.lengths
+    let h: SIMD3<Double> = SIMD3<Double>(lengths.a / Double(n.x), lengths.b / Double(n.y), lengths.c / Double(n.z))
+    let maximumRadius: Double = 0.5 * min(lengths.a, lengths.b, lengths.c)
+    
+    // the pocket index of each point (-1 outside the pockets), the points of each pocket, and the channel points
+    var pocketOfComponent: [Int] = [Int](repeating: -1, count: connectivity.components.count)
+    for (index, component) in pockets.enumerated()
+    {
+      pocketOfComponent[component] = index
+    }
+    var pocketOfPoint: [Int] = [Int](repeating: -1, count: numberOfPoints)
+    var points: [[Int]] = [[Int]](repeating: [], count: pockets.count)
+    var isChannelPoint: [Bool] = [Bool](repeating: false, count: numberOfPoints)
+    for k in 0..<n.z
+    {
+      for j in 0..<n.y
+      {
+        for i in 0..<n.x
+        {
+          let label: Int32 = connectivity.labels[i + dimensions.x * (j + dimensions.y * k)]
+          let point: Int = i + n.x * (j + n.y * k)
+          if label >= 0 && pocketOfComponent[Int(label)] >= 0
+          {
+            pocketOfPoint[point] = pocketOfComponent[Int(label)]
+            points[pocketOfComponent[Int(label)]].append(point)
+          }
+          else if label >= 0
+          {
+            isChannelPoint[point] = true
+          }
+        }
+      }
+    }
+    
+    // the distances to the nearest channel point, infinite without channels (the pockets are then only limited by the cell)
+    var distances: [Double] = isChannelPoint.map{$0 ? 0.0 : Double.infinity}
+    SKPoreGeometry.distanceTransform(&distances, dimensions: n, spacing: h)
+    let margin: Double = h.max()
+    
+    var pocketSpheres: [[(position: SIMD3<Double>, radius: Double)]] = [[(position: SIMD3<Double>, radius: Double)]](repeating: [], count: pockets.count)
+    pocketSpheres.withUnsafeMutableBufferPointer { spheresPtr in
+      let spheres: UnsafeMutablePointer<[(position: SIMD3<Double>, radius: Double)]> = spheresPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: pockets.count) { pocket in
+        spheres[pocket] = SKBlockingPockets.cover(points[pocket], pocket: pocket, pocketOfPoint: pocketOfPoint, distances: distances, dimensions: n, spacing: h, margin: margin, maximumRadius: maximumRadius)
+      }
+    }
+    self.spheres = Array(pocketSpheres.joined())
+  }
+  
+  // the contents of a RASPA '.block'-file
+  public var string: String
+  {
+    var dataString: String = String(spheres.count) + "\n"
+    for sphere in spheres
+    {
+      dataString += String(format: "%.8f %.8f %.8f %.8f\n", sphere.position.x, sphere.position.y, sphere.position.z, sphere.radius)
+    }
+    return dataString
+  }
+  
+  // writes the spheres as a RASPA '.block'-file
+  public func write(to url: URL) throws
+  {
+    try string.write(to: url, atomically: true, encoding: String.Encoding.utf8)
+  }
+  
+  // Greedy covering of a single pocket, the points are visited in order of decreasing distance (ties by index, for reproducible output).
+  static func cover(_ points: [Int], pocket: Int, pocketOfPoint: [Int], distances: [Double], dimensions n: SIMD3<Int>, spacing h: SIMD3<Double>, margin: Double, maximumRadius: Double) -> [(position: SIMD3<Double>, radius: Double)]
+  {
+    var spheres: [(position: SIMD3<Double>, radius: Double)] = []
+    var covered: Set<Int> = []
+    covered.reserveCapacity(points.count)
+    
+    let sortedPoints: [Int] = points.sorted{distances[$0] != distances[$1] ? distances[$0] > distances[$1] : $0 < $1}
+    for center in sortedPoints where !covered.contains(center)
+    {
+      let radius: Double = min(max(distances[center].squareRoot() - margin, 0.0), maximumRadius)
+      let i: Int = center % n.x
+      let j: Int = (center / n.x) % n.y
+      let k: Int = center / (n.x * n.y)
+      spheres.append((SIMD3<Double>(Double(i) / Double(n.x), Double(j) / Double(n.y), Double(k) / Double(n.z)), radius))
+      
+      // the pocket points inside the sphere (the center itself always has a nonzero distance), the extent is at most half the grid
+      covered.insert(center)
+      let extent: SIMD3<Int> = SIMD3<Int>(Int(radius / h.x), Int(radius / h.y), Int(radius / h.z))
+      for dk in -extent.z...extent.z
+      {
+        for dj in -extent.y...extent.y
+        {
+          for di in -extent.x...extent.x
+          {
+            let dr: SIMD3<Double> = h * SIMD3<Double>(Double(di), Double(dj), Double(dk))
+            guard simd_length_squared(dr) < radius * radius else { continue }
+            let point: Int = (i + di + n.x) % n.x + n.x * ((j + dj + n.y) % n.y + n.y * ((k + dk + n.z) % n.z))
+            if pocketOfPoint[point] == pocket
+            {
+              covered.insert(point)
+            }
+          }
+        }
+      }
+    }
+    return spheres
+  }
+  
+  // The blocking spheres of the pockets of the probe molecule of each structure.
+  public static func compute(structures: [(cell: SKCell, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], probeParameters: SIMD2<Double>)], threshold: Float = 0.0) -> [SKBlockingPockets]
+  {
+    var results: [SKBlockingPockets] = []
+    
+    // fall back to the CPU-implementation when no Metal-device is available
+    let device: MTLDevice? = MTLCreateSystemDefaultDevice()
+    let commandQueue: MTLCommandQueue? = device?.makeCommandQueue()
+    
+    for structure in structures
+    {
+      let data: [Float]
+      let numberOfReplicas: SIMD3<Int32> = structure.cell.numberOfReplicas(forCutoff: 12.0)
+      if let device = device,
+         let commandQueue = commandQueue
+      {
+        let framework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
+        data = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: structure.probeParameters)
+      }
+      else
+      {
+        let framework: SKCPUFramework = SKCPUFramework(positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
+        data = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: structure.probeParameters)
+      }
+      results.append(SKBlockingPockets(values: data, dimensions: SIMD3<Int>(128,128,128), cell: structure.cell, threshold: threshold))
+    }
+    return results
+  }
+}
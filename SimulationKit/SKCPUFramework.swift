@@ -0,0 +1,1137 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+import SymmetryKit
+
+// CPU-version of the 'ComputeEnergyGrid' Metal-kernel. The same conventions are used (fractional positions in the replica-cell, loop over replicas,
+// 12 Angstrom cutoff, clamp per work-batch of 8192 atoms), but the atoms are evaluated 8 at a time using SIMD-vectors and the grid-lines are
+// distributed over all cores. Optionally a cell-list is used, so that each grid point only visits the atoms within the neighbouring cells.
+public class SKCPUFramework
+{
+  var positions: [SIMD3<Double>] = []
+  var potentialParameters: [SIMD2<Double>] = []
+  var unitCell: double3x3 = double3x3()
+  var replicaCell: double3x3 = double3x3()
+  var inverseCell: double3x3 = double3x3()
+  var numberOfReplicas: SIMD3<Int32> = SIMD3<Int32>(1,1,1)
+  var totalNumberOfReplicas: Int = 1
+  var totalNumberOfAtoms: Int = 0
+  
+  public enum Method: Int
+  {
+    case allPairs = 0        // every grid point visits every atom in every replica (like the Metal-kernel)
+    case cellList = 1        // every grid point only visits the atoms of the periodic images in the cells within the cutoff
+  }
+  
+  // The cell-list clamps the total energy of a grid point instead of every work-batch of 8192 atoms, so grid points that overlap
+  // with atoms can get different (large) values than on the GPU. It is therefore only used on request.
+  public var method: Method = .allPairs
+  
+  static let cutoffSquared: Float = 12.0 * 12.0
+  static let maximumEnergyValue: Float = 10000000.0
+  
+  // must be identical to the size of the work-batch in 'SKMetalFramework' to get the same clamping of overlapping atoms
+  static let sizeOfWorkBatch: Int = 8192
+  
+  // structure-of-arrays of the atoms, 8 atoms per SIMD-vector, each work-batch starts on a new vector
+  struct PackedAtoms
+  {
+    var x: [SIMD8<Float>] = []
+    var y: [SIMD8<Float>] = []
+    var z: [SIMD8<Float>] = []
+    var epsilon: [SIMD8<Float>] = []
+    var sigmaSquared: [SIMD8<Float>] = []
+    var types: [SIMD8<Int32>] = []         // only used for tabulated potentials
+    var batches: [Range<Int>] = []
+    
+    init()
+    {
+    }
+    
+    init(positions: [SIMD3<Float>], epsilon: [Float], sigmaSquared: [Float], types: [Int32] = [], sizeOfBatch: Int)
+    {
+      var unitsOfWorkDone: Int = 0
+      while(unitsOfWorkDone < positions.count)
+      {
+        let numberOfAtomsInBatch: Int = min(sizeOfBatch, positions.count - unitsOfWorkDone)
+        let numberOfVectors: Int = (numberOfAtomsInBatch + 7) / 8
+        let start: Int = self.x.count
+        
+        for v in 0..<numberOfVectors
+        {
+          // unused lanes get a NaN position: the cutoff-test fails and their contribution is masked out
+          var x: SIMD8<Float> = SIMD8<Float>(repeating: Float.nan)
+          var y: SIMD8<Float> = SIMD8<Float>(repeating: Float.nan)
+          var z: SIMD8<Float> = SIMD8<Float>(repeating: Float.nan)
+          var currentEpsilon: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+          var currentSigmaSquared: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+          var currentTypes: SIMD8<Int32> = SIMD8<Int32>(repeating: 0)
+          
+          for lane in 0..<min(8, numberOfAtomsInBatch - v * 8)
+          {
+            let index: Int = unitsOfWorkDone + v * 8 + lane
+            x[lane] = positions[index].x
+            y[lane] = positions[index].y
+            z[lane] = positions[index].z
+            currentEpsilon[lane] = epsilon[index]
+            currentSigmaSquared[lane] = sigmaSquared[index]
+            if !types.isEmpty
+            {
+              currentTypes[lane] = types[index]
+            }
+          }
+          self.x.append(x)
+          self.y.append(y)
+          self.z.append(z)
+          self.epsilon.append(currentEpsilon)
+          self.sigmaSquared.append(currentSigmaSquared)
+          if !types.isEmpty
+          {
+            self.types.append(currentTypes)
+          }
+        }
+        self.batches.append(start..<self.x.count)
+        
+        unitsOfWorkDone += sizeOfBatch
+      }
+    }
+  }
+  
+  public init(positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], unitCell: double3x3, numberOfReplicas: SIMD3<Int32>)
+  {
+    self.numberOfReplicas = numberOfReplicas
+    self.totalNumberOfReplicas = Int(numberOfReplicas.x * numberOfReplicas.y * numberOfReplicas.z)
+    self.positions = positions
+    self.potentialParameters = potentialParameters
+    self.unitCell = unitCell
+    self.replicaCell = double3x3([Double(numberOfReplicas.x) * unitCell[0], Double(numberOfReplicas.y) * unitCell[1],Double(numberOfReplicas.z) * unitCell[2]])
+    self.inverseCell = replicaCell.inverse
+    self.totalNumberOfAtoms = positions.count
+  }
+  
+  var replicaVectors: [SIMD3<Float>]
+  {
+    var replicas: [SIMD3<Float>] = []
+    replicas.reserveCapacity(totalNumberOfReplicas)
+    for i in 0..<numberOfReplicas.x
+    {
+      for j in 0..<numberOfReplicas.y
+      {
+        for k in 0..<numberOfReplicas.z
+        {
+          replicas.append(SIMD3<Float>(Float(Double(i)/Double(numberOfReplicas.x)), Float(Double(j)/Double(numberOfReplicas.y)), Float(Double(k)/Double(numberOfReplicas.z))))
+        }
+      }
+    }
+    return replicas
+  }
+  
+  var correction: SIMD3<Double>
+  {
+    return SIMD3<Double>(1.0/Double(numberOfReplicas.x), 1.0/Double(numberOfReplicas.y), 1.0/Double(numberOfReplicas.z))
+  }
+  
+  // the fractional positions in the replica-cell (i.e. scaled into the first replica)
+  var scaledPositions: [SIMD3<Float>]
+  {
+    let correction: SIMD3<Double> = self.correction
+    return positions.map{(fractionalPosition: SIMD3<Double>) -> SIMD3<Float> in
+      let position: SIMD3<Double> = fractionalPosition * correction
+      return SIMD3<Float>(Float(position.x), Float(position.y), Float(position.z))
+    }
+  }
+  
+  func mixedParameters(probeParameter: SIMD2<Double>) -> (epsilon: [Float], sigmaSquared: [Float])
+  {
+    return SKCPUFramework.mixedParameters(potentialParameters, probeParameter: probeParameter)
+  }
+  
+  static func mixedParameters(_ potentialParameters: [SIMD2<Double>], probeParameter: SIMD2<Double>) -> (epsilon: [Float], sigmaSquared: [Float])
+  {
+    // use 4 x epsilon for a probe epsilon of unity
+    let epsilon: [Float] = potentialParameters.map{Float(4.0*sqrt($0.x * probeParameter.x))}
+    let sigmaSquared: [Float] = potentialParameters.map{(parameter: SIMD2<Double>) -> Float in
+      let size: Float = Float(0.5 * (parameter.y + probeParameter.y))
+      return size * size
+    }
+    return (epsilon, sigmaSquared)
+  }
+  
+  func packedAtoms(probeParameter: SIMD2<Double>) -> PackedAtoms
+  {
+    let parameters: (epsilon: [Float], sigmaSquared: [Float]) = mixedParameters(probeParameter: probeParameter)
+    return PackedAtoms(positions: scaledPositions, epsilon: parameters.epsilon, sigmaSquared: parameters.sigmaSquared, sizeOfBatch: SKCPUFramework.sizeOfWorkBatch)
+  }
+  
+  // the fractional grid-coordinates along each axis, x varies the fastest in the output (contiguous in x)
+  func gridCoordinates(_ sizeX: Int, sizeY: Int, sizeZ: Int) -> (x: [Float], y: [Float], z: [Float])
+  {
+    let correction: SIMD3<Double> = self.correction
+    
+    let x: [Float] = (0..<sizeX).map{Float(correction.x * (Double($0)/Double(sizeX-1)))}
+    let y: [Float] = (0..<sizeY).map{Float(correction.y * (Double($0)/Double(sizeY-1)))}
+    let z: [Float] = (0..<sizeZ).map{Float(correction.z * (Double($0)/Double(sizeZ-1)))}
+    return (x, y, z)
+  }
+  
+  @inline(__always)
+  static func energy(gridPosition: SIMD3<Float>, atoms: PackedAtoms, replicas: [SIMD3<Float>], cell: float3x3, maximumValue: Float = SKCPUFramework.maximumEnergyValue) -> Float
+  {
+    let gx: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.x)
+    let gy: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.y)
+    let gz: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.z)
+    
+    var output: Float = 0.0
+    for batch in atoms.batches
+    {
+      var value: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+      for replica in replicas
+      {
+        for v in batch
+        {
+          var tx: SIMD8<Float> = (gx - atoms.x[v]) - replica.x
+          var ty: SIMD8<Float> = (gy - atoms.y[v]) - replica.y
+          var tz: SIMD8<Float> = (gz - atoms.z[v]) - replica.z
+          
+          tx -= tx.rounded(.toNearestOrEven)
+          ty -= ty.rounded(.toNearestOrEven)
+          tz -= tz.rounded(.toNearestOrEven)
+          
+          let drx: SIMD8<Float> = cell[0].x * tx + cell[1].x * ty + cell[2].x * tz
+          let dry: SIMD8<Float> = cell[0].y * tx + cell[1].y * ty + cell[2].y * tz
+          let drz: SIMD8<Float> = cell[0].z * tx + cell[1].z * ty + cell[2].z * tz
+          
+          let rr: SIMD8<Float> = drx * drx + dry * dry + drz * drz
+          
+          let temp: SIMD8<Float> = atoms.sigmaSquared[v] / rr
+          let rri3: SIMD8<Float> = temp * temp * temp
+          let energy: SIMD8<Float> = atoms.epsilon[v] * (rri3 * (rri3 - 1.0))
+          
+          value += energy.replacing(with: 0.0, where: .!(rr .< SKCPUFramework.cutoffSquared))
+        }
+      }
+      output += min(value.sum(), maximumValue)
+    }
+    return output
+  }
+  
+  // returns the function that computes the energy at a fractional position within the first replica (where all grid points are located)
+  func energyFunction(probeParameter: SIMD2<Double>) -> (SIMD3<Float>) -> Float
+  {
+    let cell: float3x3 = float3x3(Double3x3: replicaCell)
+    
+    switch(method)
+    {
+    case .allPairs:
+      let atoms: PackedAtoms = packedAtoms(probeParameter: probeParameter)
+      let replicas: [SIMD3<Float>] = self.replicaVectors
+      return { gridPosition in
+        SKCPUFramework.energy(gridPosition: gridPosition, atoms: atoms, replicas: replicas, cell: cell)
+      }
+    case .cellList:
+      let cellList: CellList = self.cellList(probeParameters: [probeParameter])
+      
+      // the periodic images are explicitly included in the cell-list
+      let replicas: [SIMD3<Float>] = [SIMD3<Float>(0.0, 0.0, 0.0)]
+      return { gridPosition in
+        SKCPUFramework.energy(gridPosition: gridPosition * cellList.scaling, atoms: cellList.atoms[cellList.cellIndex(gridPosition)][0], replicas: replicas, cell: cellList.cell)
+      }
+    }
+  }
+  
+  public func ComputeEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>) -> [Float]
+  {
+    guard (totalNumberOfAtoms > 0) else { return [] }
+    
+    let energy: (SIMD3<Float>) -> Float = energyFunction(probeParameter: probeParameter)
+    let gridCoordinates: (x: [Float], y: [Float], z: [Float]) = self.gridCoordinates(sizeX, sizeY: sizeY, sizeZ: sizeZ)
+    
+    var outputData: [Float] = [Float](repeating: 0.0, count: sizeX * sizeY * sizeZ)
+    outputData.withUnsafeMutableBufferPointer { outputPtr in
+      let output: UnsafeMutablePointer<Float> = outputPtr.baseAddress!
+      
+      // each iteration computes a single grid-line along x
+      DispatchQueue.concurrentPerform(iterations: sizeY * sizeZ) { line in
+        let j: Int = line % sizeY
+        let k: Int = line / sizeY
+        for i in 0..<sizeX
+        {
+          output[i + line * sizeX] = energy(SIMD3<Float>(gridCoordinates.x[i], gridCoordinates.y[j], gridCoordinates.z[k]))
+        }
+      }
+    }
+    
+    return outputData
+  }
+  
+  // Only the symmetry-unique grid points are computed, the rest of the grid is filled in by mapping (see 'SKEnergyGridSymmetry').
+  // Operations that do not map the atoms onto themselves are not used, so a space group that does not match the positions only costs
+  // speed. Use 'SKEnergyGridSymmetry.symmetricGridSize' for the sizes, otherwise most of the operations do not map the grid onto itself.
+  public func ComputeEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>, spaceGroup: SKSpacegroup) -> [Float]
+  {
+    guard (totalNumberOfAtoms > 0) else { return [] }
+    
+    let symmetry: SKEnergyGridSymmetry = SKEnergyGridSymmetry(dimensions: SIMD3<Int>(sizeX, sizeY, sizeZ), spaceGroup: spaceGroup, unitCell: unitCell, positions: positions, potentialParameters: potentialParameters)
+    let uniqueGridPoints: [Int] = symmetry.uniqueGridPoints
+    
+    let energy: (SIMD3<Float>) -> Float = energyFunction(probeParameter: probeParameter)
+    let gridCoordinates: (x: [Float], y: [Float], z: [Float]) = self.gridCoordinates(sizeX, sizeY: sizeY, sizeZ: sizeZ)
+    
+    var values: [Float] = [Float](repeating: 0.0, count: uniqueGridPoints.count)
+    values.withUnsafeMutableBufferPointer { valuesPtr in
+      let output: UnsafeMutablePointer<Float> = valuesPtr.baseAddress!
+      
+      let sizeOfChunk: Int = 256
+      let numberOfChunks: Int = (uniqueGridPoints.count + sizeOfChunk - 1) / sizeOfChunk
+      DispatchQueue.concurrentPerform(iterations: numberOfChunks) { chunk in
+        for n in (chunk * sizeOfChunk)..<min((chunk + 1) * sizeOfChunk, uniqueGridPoints.count)
+        {
+          let index: Int = uniqueGridPoints[n]
+          let i: Int = index % sizeX
+          let j: Int = (index / sizeX) % sizeY
+          let k: Int = index / (sizeX * sizeY)
+          output[n] = energy(SIMD3<Float>(gridCoordinates.x[i], gridCoordinates.y[j], gridCoordinates.z[k]))
+        }
+      }
+    }
+    
+    return symmetry.expand(values)
+  }
+  
+  // MARK: Streaming
+  // =====================================================================
+  
+  // The grid is computed in slabs of 'slabSize' z-slices that are handed to 'consumer' (with the index of their first slice) in order, so the
+  // memory stays proportional to a slab instead of the full grid. The slab-buffer is reused, the consumer must copy what it needs to keep.
+  public func ComputeEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>, slabSize: Int, consumer: (_ firstSlice: Int, _ slab: UnsafeBufferPointer<Float>) -> Void)
+  {
+    guard (totalNumberOfAtoms > 0), sizeX > 0, sizeY > 0, sizeZ > 0 else { return }
+    
+    let energy: (SIMD3<Float>) -> Float = energyFunction(probeParameter: probeParameter)
+    let gridCoordinates: (x: [Float], y: [Float], z: [Float]) = self.gridCoordinates(sizeX, sizeY: sizeY, sizeZ: sizeZ)
+    let numberOfSlices: Int = max(1, min(slabSize, sizeZ))
+    
+    let slab: UnsafeMutablePointer<Float> = UnsafeMutablePointer<Float>.allocate(capacity: sizeX * sizeY * numberOfSlices)
+    defer { slab.deallocate() }
+    
+    for firstSlice in stride(from: 0, to: sizeZ, by: numberOfSlices)
+    {
+      let slices: Int = min(numberOfSlices, sizeZ - firstSlice)
+      
+      // each iteration computes a single grid-line along x
+      DispatchQueue.concurrentPerform(iterations: sizeY * slices) { line in
+        let j: Int = line % sizeY
+        let k: Int = firstSlice + line / sizeY
+        for i in 0..<sizeX
+        {
+          slab[i + line * sizeX] = energy(SIMD3<Float>(gridCoordinates.x[i], gridCoordinates.y[j], gridCoordinates.z[k]))
+        }
+      }
+      
+      consumer(firstSlice, UnsafeBufferPointer<Float>(start: slab, count: sizeX * sizeY * slices))
+    }
+  }
+  
+  // The reductions are computed while the grid is evaluated (per grid-line and in parallel), the grid itself is not stored.
+  public func ComputeEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>, reduction: SKEnergyGridReduction) -> SKEnergyGridReduction
+  {
+    var result: SKEnergyGridReduction = reduction.empty
+    guard (totalNumberOfAtoms > 0), sizeX > 0, sizeY > 0, sizeZ > 0 else { return result }
+    
+    let energy: (SIMD3<Float>) -> Float = energyFunction(probeParameter: probeParameter)
+    let gridCoordinates: (x: [Float], y: [Float], z: [Float]) = self.gridCoordinates(sizeX, sizeY: sizeY, sizeZ: sizeZ)
+    
+    result.accumulate(count: sizeY * sizeZ) { lines, partial in
+      var values: [Float] = [Float](repeating: 0.0, count: sizeX)
+      values.withUnsafeMutableBufferPointer { valuesPtr in
+        for line in lines
+        {
+          let j: Int = line % sizeY
+          let k: Int = line / sizeY
+          for i in 0..<sizeX
+          {
+            valuesPtr[i] = energy(SIMD3<Float>(gridCoordinates.x[i], gridCoordinates.y[j], gridCoordinates.z[k]))
+          }
+          partial.accumulate(UnsafeBufferPointer(valuesPtr))
+        }
+      }
+    }
+    return result
+  }
+  
+  // MARK: Analytic gradients
+  // =====================================================================
+  
+  // The energy (x) and its gradient with respect to the fractional position in the replica-cell (yzw). The gradient of a work-batch
+  // that is clamped is zero (the clamped energy is constant).
+  @inline(__always)
+  static func energyAndGradient(gridPosition: SIMD3<Float>, atoms: PackedAtoms, replicas: [SIMD3<Float>], cell: float3x3) -> SIMD4<Float>
+  {
+    let gx: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.x)
+    let gy: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.y)
+    let gz: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.z)
+    
+    var output: SIMD4<Float> = SIMD4<Float>(0.0, 0.0, 0.0, 0.0)
+    for batch in atoms.batches
+    {
+      var value: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+      var gradientX: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+      var gradientY: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+      var gradientZ: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+      for replica in replicas
+      {
+        for v in batch
+        {
+          var tx: SIMD8<Float> = (gx - atoms.x[v]) - replica.x
+          var ty: SIMD8<Float> = (gy - atoms.y[v]) - replica.y
+          var tz: SIMD8<Float> = (gz - atoms.z[v]) - replica.z
+          
+          tx -= tx.rounded(.toNearestOrEven)
+          ty -= ty.rounded(.toNearestOrEven)
+          tz -= tz.rounded(.toNearestOrEven)
+          
+          let drx: SIMD8<Float> = cell[0].x * tx + cell[1].x * ty + cell[2].x * tz
+          let dry: SIMD8<Float> = cell[0].y * tx + cell[1].y * ty + cell[2].y * tz
+          let drz: SIMD8<Float> = cell[0].z * tx + cell[1].z * ty + cell[2].z * tz
+          
+          let rr: SIMD8<Float> = drx * drx + dry * dry + drz * drz
+          let outside: SIMDMask<SIMD8<Float.SIMDMaskScalar>> = .!(rr .< SKCPUFramework.cutoffSquared)
+          
+          let temp: SIMD8<Float> = atoms.sigmaSquared[v] / rr
+          let rri3: SIMD8<Float> = temp * temp * temp
+          let energy: SIMD8<Float> = atoms.epsilon[v] * (rri3 * (rri3 - 1.0))
+          
+          // dU/dr^2 times 2, the derivative of r^2 with respect to the fractional position is 2 (dr . cell[i])
+          let force: SIMD8<Float> = (-6.0 * atoms.epsilon[v] * rri3 * (2.0 * rri3 - 1.0) / rr).replacing(with: 0.0, where: outside)
+          
+          value += energy.replacing(with: 0.0, where: outside)
+          gradientX += force * (drx * cell[0].x + dry * cell[0].y + drz * cell[0].z)
+          gradientY += force * (drx * cell[1].x + dry * cell[1].y + drz * cell[1].z)
+          gradientZ += force * (drx * cell[2].x + dry * cell[2].y + drz * cell[2].z)
+        }
+      }
+      let sum: Float = value.sum()
+      if sum < SKCPUFramework.maximumEnergyValue
+      {
+        output += SIMD4<Float>(sum, gradientX.sum(), gradientY.sum(), gradientZ.sum())
+      }
+      else
+      {
+        output.x += SKCPUFramework.maximumEnergyValue
+      }
+    }
+    return output
+  }
+  
+  func energyAndGradientFunction(probeParameter: SIMD2<Double>) -> (SIMD3<Float>) -> SIMD4<Float>
+  {
+    let cell: float3x3 = float3x3(Double3x3: replicaCell)
+    
+    switch(method)
+    {
+    case .allPairs:
+      let atoms: PackedAtoms = packedAtoms(probeParameter: probeParameter)
+      let replicas: [SIMD3<Float>] = self.replicaVectors
+      return { gridPosition in
+        SKCPUFramework.energyAndGradient(gridPosition: gridPosition, atoms: atoms, replicas: replicas, cell: cell)
+      }
+    case .cellList:
+      let cellList: CellList = self.cellList(probeParameters: [probeParameter])
+      
+      // the periodic images are explicitly included in the cell-list, the gradient is transformed back to the replica-cell
+      let replicas: [SIMD3<Float>] = [SIMD3<Float>(0.0, 0.0, 0.0)]
+      let gradientScaling: SIMD4<Float> = SIMD4<Float>(1.0, cellList.scaling.x, cellList.scaling.y, cellList.scaling.z)
+      return { gridPosition in
+        gradientScaling * SKCPUFramework.energyAndGradient(gridPosition: gridPosition * cellList.scaling, atoms: cellList.atoms[cellList.cellIndex(gridPosition)][0], replicas: replicas, cell: cellList.cell)
+      }
+    }
+  }
+  
+  // The energies (x) and their analytic gradients with respect to the grid-index (yzw), i.e. per grid-spacing like the finite differences
+  // of 'SKGridGradient'. The gradients are not invariant under the symmetry-operations, so the full grid is computed.
+  public func ComputeEnergyGridWithGradient(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>) -> [SIMD4<Float>]
+  {
+    guard (totalNumberOfAtoms > 0) else { return [] }
+    
+    let energyAndGradient: (SIMD3<Float>) -> SIMD4<Float> = energyAndGradientFunction(probeParameter: probeParameter)
+    let gridCoordinates: (x: [Float], y: [Float], z: [Float]) = self.gridCoordinates(sizeX, sizeY: sizeY, sizeZ: sizeZ)
+    
+    // from the fractional position in the replica-cell to the grid-index
+    let correction: SIMD3<Double> = self.correction
+    let scaling: SIMD4<Float> = SIMD4<Float>(1.0, Float(correction.x / Double(max(1, sizeX - 1))), Float(correction.y / Double(max(1, sizeY - 1))), Float(correction.z / Double(max(1, sizeZ - 1))))
+    
+    var outputData: [SIMD4<Float>] = [SIMD4<Float>](repeating: SIMD4<Float>(0.0, 0.0, 0.0, 0.0), count: sizeX * sizeY * sizeZ)
+    outputData.withUnsafeMutableBufferPointer { outputPtr in
+      let output: UnsafeMutablePointer<SIMD4<Float>> = outputPtr.baseAddress!
+      
+      // each iteration computes a single grid-line along x
+      DispatchQueue.concurrentPerform(iterations: sizeY * sizeZ) { line in
+        let j: Int = line % sizeY
+        let k: Int = line / sizeY
+        for i in 0..<sizeX
+        {
+          output[i + line * sizeX] = scaling * energyAndGradient(SIMD3<Float>(gridCoordinates.x[i], gridCoordinates.y[j], gridCoordinates.z[k]))
+        }
+      }
+    }
+    
+    return outputData
+  }
+  
+  // MARK: Adaptive grids
+  // =====================================================================
+  
+  // Only the cells near the iso-value (or below 'refinementThreshold') are refined down to the grid spacing (see 'SKAdaptiveEnergyGrid').
+  public func ComputeAdaptiveEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>, isoValue: Float, refinementThreshold: Float? = nil, coarseStride: Int = 8) -> SKAdaptiveEnergyGrid
+  {
+    let energy: (SIMD3<Float>) -> Float = energyFunction(probeParameter: probeParameter)
+    let gridCoordinates: (x: [Float], y: [Float], z: [Float]) = self.gridCoordinates(sizeX, sizeY: sizeY, sizeZ: sizeZ)
+    
+    return SKAdaptiveEnergyGrid(dimensions: SIMD3<Int>(sizeX, sizeY, sizeZ), coarseStride: coarseStride, isoValue: isoValue, refinementThreshold: refinementThreshold) { points in
+      guard (totalNumberOfAtoms > 0) else { return [Float](repeating: 0.0, count: points.count) }
+      
+      var outputData: [Float] = [Float](repeating: 0.0, count: points.count)
+      outputData.withUnsafeMutableBufferPointer { outputPtr in
+        let output: UnsafeMutablePointer<Float> = outputPtr.baseAddress!
+        
+        // the points are evaluated in chunks to amortize the dispatch overhead
+        let chunkSize: Int = 256
+        DispatchQueue.concurrentPerform(iterations: (points.count + chunkSize - 1) / chunkSize) { chunk in
+          for n in (chunk * chunkSize)..<min((chunk + 1) * chunkSize, points.count)
+          {
+            let point: SIMD3<Int> = points[n]
+            output[n] = energy(SIMD3<Float>(gridCoordinates.x[point.x], gridCoordinates.y[point.y], gridCoordinates.z[point.z]))
+          }
+        }
+      }
+      return outputData
+    }
+  }
+  
+  // MARK: Multiple probes
+  // =====================================================================
+  
+  // Multi-probe version of 'energy': the atoms of all probes have the same positions and ordering (only the mixed parameters differ),
+  // so the distances are computed once and reused for every probe. The energy of probe 'p' is stored in 'output[p * stride]', 'values'
+  // is scratch-space for one accumulator per probe.
+  @inline(__always)
+  static func energies(gridPosition: SIMD3<Float>, atoms: [PackedAtoms], replicas: [SIMD3<Float>], cell: float3x3, values: UnsafeMutablePointer<SIMD8<Float>>, output: UnsafeMutablePointer<Float>, stride: Int)
+  {
+    let gx: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.x)
+    let gy: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.y)
+    let gz: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.z)
+    
+    let numberOfProbes: Int = atoms.count
+    for p in 0..<numberOfProbes
+    {
+      output[p * stride] = 0.0
+    }
+    
+    let positions: PackedAtoms = atoms[0]
+    for batch in positions.batches
+    {
+      for p in 0..<numberOfProbes
+      {
+        values[p] = SIMD8<Float>(repeating: 0.0)
+      }
+      for replica in replicas
+      {
+        for v in batch
+        {
+          var tx: SIMD8<Float> = (gx - positions.x[v]) - replica.x
+          var ty: SIMD8<Float> = (gy - positions.y[v]) - replica.y
+          var tz: SIMD8<Float> = (gz - positions.z[v]) - replica.z
+          
+          tx -= tx.rounded(.toNearestOrEven)
+          ty -= ty.rounded(.toNearestOrEven)
+          tz -= tz.rounded(.toNearestOrEven)
+          
+          let drx: SIMD8<Float> = cell[0].x * tx + cell[1].x * ty + cell[2].x * tz
+          let dry: SIMD8<Float> = cell[0].y * tx + cell[1].y * ty + cell[2].y * tz
+          let drz: SIMD8<Float> = cell[0].z * tx + cell[1].z * ty + cell[2].z * tz
+          
+          let rr: SIMD8<Float> = drx * drx + dry * dry + drz * drz
+          let outside: SIMDMask<SIMD8<Float.SIMDMaskScalar>> = .!(rr .< SKCPUFramework.cutoffSquared)
+          
+          for p in 0..<numberOfProbes
+          {
+            let temp: SIMD8<Float> = atoms[p].sigmaSquared[v] / rr
+            let rri3: SIMD8<Float> = temp * temp * temp
+            let energy: SIMD8<Float> = atoms[p].epsilon[v] * (rri3 * (rri3 - 1.0))
+            
+            values[p] += energy.replacing(with: 0.0, where: outside)
+          }
+        }
+      }
+      for p in 0..<numberOfProbes
+      {
+        output[p * stride] += min(values[p].sum(), SKCPUFramework.maximumEnergyValue)
+      }
+    }
+  }
+  
+  // returns the function that computes the energies of all probes at a fractional position within the first replica
+  func energiesFunction(probeParameters: [SIMD2<Double>]) -> (SIMD3<Float>, UnsafeMutablePointer<SIMD8<Float>>, UnsafeMutablePointer<Float>, Int) -> Void
+  {
+    let cell: float3x3 = float3x3(Double3x3: replicaCell)
+    
+    switch(method)
+    {
+    case .allPairs:
+      let atoms: [PackedAtoms] = probeParameters.map{packedAtoms(probeParameter: $0)}
+      let replicas: [SIMD3<Float>] = self.replicaVectors
+      return { gridPosition, values, output, stride in
+        SKCPUFramework.energies(gridPosition: gridPosition, atoms: atoms, replicas: replicas, cell: cell, values: values, output: output, stride: stride)
+      }
+    case .cellList:
+      let cellList: CellList = self.cellList(probeParameters: probeParameters)
+      
+      // the periodic images are explicitly included in the cell-list
+      let replicas: [SIMD3<Float>] = [SIMD3<Float>(0.0, 0.0, 0.0)]
+      return { gridPosition, values, output, stride in
+        SKCPUFramework.energies(gridPosition: gridPosition * cellList.scaling, atoms: cellList.atoms[cellList.cellIndex(gridPosition)], replicas: replicas, cell: cellList.cell, values: values, output: output, stride: stride)
+      }
+    }
+  }
+  
+  // Computes one energy grid per probe, the neighbour-traversal of the framework-atoms is shared by all probes.
+  public func ComputeEnergyGrids(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameters: [SIMD2<Double>], spaceGroup: SKSpacegroup = SKSpacegroup(HallNumber: 1)) -> [[Float]]
+  {
+    guard (totalNumberOfAtoms > 0), !probeParameters.isEmpty else { return [[Float]](repeating: [], count: probeParameters.count) }
+    
+    let symmetry: SKEnergyGridSymmetry = SKEnergyGridSymmetry(dimensions: SIMD3<Int>(sizeX, sizeY, sizeZ), spaceGroup: spaceGroup, unitCell: unitCell, positions: positions, potentialParameters: potentialParameters)
+    let uniqueGridPoints: [Int] = symmetry.uniqueGridPoints
+    let numberOfProbes: Int = probeParameters.count
+    
+    let energies: (SIMD3<Float>, UnsafeMutablePointer<SIMD8<Float>>, UnsafeMutablePointer<Float>, Int) -> Void = energiesFunction(probeParameters: probeParameters)
+    let gridCoordinates: (x: [Float], y: [Float], z: [Float]) = self.gridCoordinates(sizeX, sizeY: sizeY, sizeZ: sizeZ)
+    
+    // the values of probe 'p' are stored contiguously starting at 'p * uniqueGridPoints.count'
+    var values: [Float] = [Float](repeating: 0.0, count: numberOfProbes * uniqueGridPoints.count)
+    values.withUnsafeMutableBufferPointer { valuesPtr in
+      let output: UnsafeMutablePointer<Float> = valuesPtr.baseAddress!
+      
+      let sizeOfChunk: Int = 256
+      let numberOfChunks: Int = (uniqueGridPoints.count + sizeOfChunk - 1) / sizeOfChunk
+      DispatchQueue.concurrentPerform(iterations: numberOfChunks) { chunk in
+        var scratch: [SIMD8<Float>] = [SIMD8<Float>](repeating: SIMD8<Float>(repeating: 0.0), count: numberOfProbes)
+        scratch.withUnsafeMutableBufferPointer { scratchPtr in
+          for n in (chunk * sizeOfChunk)..<min((chunk + 1) * sizeOfChunk, uniqueGridPoints.count)
+          {
+            let index: Int = uniqueGridPoints[n]
+            let i: Int = index % sizeX
+            let j: Int = (index / sizeX) % sizeY
+            let k: Int = index / (sizeX * sizeY)
+            energies(SIMD3<Float>(gridCoordinates.x[i], gridCoordinates.y[j], gridCoordinates.z[k]), scratchPtr.baseAddress!, output + n, uniqueGridPoints.count)
+          }
+        }
+      }
+    }
+    
+    return (0..<numberOfProbes).map{p in symmetry.expand(Array(values[(p * uniqueGridPoints.count)..<((p + 1) * uniqueGridPoints.count)]))}
+  }
+  
+  // MARK: Tabulated potentials
+  // =====================================================================
+  
+  // Tabulated version of 'energy', all lanes are evaluated at once from the splines of their types (see 'SKPairPotentialTable.values').
+  @inline(__always)
+  static func energy(gridPosition: SIMD3<Float>, atoms: PackedAtoms, replicas: [SIMD3<Float>], cell: float3x3, potentialTable: SKPairPotentialTable) -> Float
+  {
+    let gx: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.x)
+    let gy: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.y)
+    let gz: SIMD8<Float> = SIMD8<Float>(repeating: gridPosition.z)
+    
+    var output: Float = 0.0
+    for batch in atoms.batches
+    {
+      var value: Float = 0.0
+      for replica in replicas
+      {
+        for v in batch
+        {
+          var tx: SIMD8<Float> = (gx - atoms.x[v]) - replica.x
+          var ty: SIMD8<Float> = (gy - atoms.y[v]) - replica.y
+          var tz: SIMD8<Float> = (gz - atoms.z[v]) - replica.z
+          
+          tx -= tx.rounded(.toNearestOrEven)
+          ty -= ty.rounded(.toNearestOrEven)
+          tz -= tz.rounded(.toNearestOrEven)
+          
+          let drx: SIMD8<Float> = cell[0].x * tx + cell[1].x * ty + cell[2].x * tz
+          let dry: SIMD8<Float> = cell[0].y * tx + cell[1].y * ty + cell[2].y * tz
+          let drz: SIMD8<Float> = cell[0].z * tx + cell[1].z * ty + cell[2].z * tz
+          
+          let rr: SIMD8<Float> = drx * drx + dry * dry + drz * drz
+          
+          // the padding lanes have NaN distances and fail the cutoff-test
+          let inside: SIMDMask<SIMD8<Float.SIMDMaskScalar>> = rr .< SKCPUFramework.cutoffSquared
+          if any(inside)
+          {
+            value += potentialTable.values(types: atoms.types[v], rr: rr, mask: inside).sum()
+          }
+        }
+      }
+      output += min(value, SKCPUFramework.maximumEnergyValue)
+    }
+    return output
+  }
+  
+  func energyFunction(potentialTable: SKPairPotentialTable) -> (SIMD3<Float>) -> Float
+  {
+    let cell: float3x3 = float3x3(Double3x3: replicaCell)
+    
+    // the mixed Lennard-Jones parameters are not used
+    let unused: [Float] = [Float](repeating: 0.0, count: totalNumberOfAtoms)
+    
+    switch(method)
+    {
+    case .allPairs:
+      let atoms: PackedAtoms = PackedAtoms(positions: scaledPositions, epsilon: unused, sigmaSquared: unused, types: potentialTable.atomTypes, sizeOfBatch: SKCPUFramework.sizeOfWorkBatch)
+      let replicas: [SIMD3<Float>] = self.replicaVectors
+      return { gridPosition in
+        SKCPUFramework.energy(gridPosition: gridPosition, atoms: atoms, replicas: replicas, cell: cell, potentialTable: potentialTable)
+      }
+    case .cellList:
+      let cellList: CellList = self.cellList(probeParameters: [SIMD2<Double>(0.0, 0.0)], atomTypes: potentialTable.atomTypes)
+      
+      // the periodic images are explicitly included in the cell-list
+      let replicas: [SIMD3<Float>] = [SIMD3<Float>(0.0, 0.0, 0.0)]
+      return { gridPosition in
+        SKCPUFramework.energy(gridPosition: gridPosition * cellList.scaling, atoms: cellList.atoms[cellList.cellIndex(gridPosition)][0], replicas: replicas, cell: cellList.cell, potentialTable: potentialTable)
+      }
+    }
+  }
+  
+  // Computes the energy grid from a tabulated potential (see 'SKPairPotentialTable'), the table must have been created for the atoms of the framework.
+  public func ComputeEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, potentialTable: SKPairPotentialTable) -> [Float]
+  {
+    guard (totalNumberOfAtoms > 0), potentialTable.atomTypes.count == totalNumberOfAtoms else { return [] }
+    
+    let energy: (SIMD3<Float>) -> Float = energyFunction(potentialTable: potentialTable)
+    let gridCoordinates: (x: [Float], y: [Float], z: [Float]) = self.gridCoordinates(sizeX, sizeY: sizeY, sizeZ: sizeZ)
+    let tailCorrection: Float = potentialTable.tailCorrection
+    
+    var outputData: [Float] = [Float](repeating: 0.0, count: sizeX * sizeY * sizeZ)
+    outputData.withUnsafeMutableBufferPointer { outputPtr in
+      let output: UnsafeMutablePointer<Float> = outputPtr.baseAddress!
+      
+      // each iteration computes a single grid-line along x
+      DispatchQueue.concurrentPerform(iterations: sizeY * sizeZ) { line in
+        let j: Int = line % sizeY
+        let k: Int = line / sizeY
+        for i in 0..<sizeX
+        {
+          output[i + line * sizeX] = energy(SIMD3<Float>(gridCoordinates.x[i], gridCoordinates.y[j], gridCoordinates.z[k])) + tailCorrection
+        }
+      }
+    }
+    
+    return outputData
+  }
+  
+  // MARK: Incremental updates
+  // =====================================================================
+  
+  // grid points with larger energies are recomputed instead of updated (the clamping is not additive, and the difference of two
+  // large contributions loses too much precision)
+  static let maximumIncrementalEnergyValue: Float = 100000.0
+  
+  // The grid points within the cutoff of the given fractional positions (of the unit cell), including all periodic images. The
+  // bounding box of the cutoff-sphere is used, so points slightly beyond the cutoff are included as well.
+  func gridPointsWithinCutoff(of positions: [SIMD3<Double>], sizeX: Int, sizeY: Int, sizeZ: Int) -> [Int]
+  {
+    let size: SIMD3<Int> = SIMD3<Int>(sizeX, sizeY, sizeZ)
+    let halfWidth: SIMD3<Double> = 12.0 / SKCell(unitCell: unitCell).perpendicularWidths
+    
+    // the grid spans the unit cell, grid point 'i' is at fractional position i/(size-1)
+    func indexRange(_ lower: Double, _ upper: Double, _ axis: Int) -> ClosedRange<Int>?
+    {
+      let last: Int = size[axis] - 1
+      let first: Int = max(0, Int((lower * Double(last)).rounded(.up)) - 1)
+      let end: Int = min(last, Int((upper * Double(last)).rounded(.down)) + 1)
+      return first <= end ? first...end : nil
+    }
+    
+    var mask: [Bool] = [Bool](repeating: false, count: sizeX * sizeY * sizeZ)
+    for position in positions
+    {
+      // all images that overlap with the unit cell
+      let lower: SIMD3<Double> = (-position - halfWidth).rounded(.down)
+      let upper: SIMD3<Double> = (1.0 - position + halfWidth).rounded(.up)
+      for mz in Int(lower.z)...Int(upper.z)
+      {
+        guard let rangeZ: ClosedRange<Int> = indexRange(position.z + Double(mz) - halfWidth.z, position.z + Double(mz) + halfWidth.z, 2) else { continue }
+        for my in Int(lower.y)...Int(upper.y)
+        {
+          guard let rangeY: ClosedRange<Int> = indexRange(position.y + Double(my) - halfWidth.y, position.y + Double(my) + halfWidth.y, 1) else { continue }
+          for mx in Int(lower.x)...Int(upper.x)
+          {
+            guard let rangeX: ClosedRange<Int> = indexRange(position.x + Double(mx) - halfWidth.x, position.x + Double(mx) + halfWidth.x, 0) else { continue }
+            for k in rangeZ
+            {
+              for j in rangeY
+              {
+                for i in rangeX
+                {
+                  mask[i + sizeX * (j + sizeY * k)] = true
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+    return mask.indices.filter{mask[$0]}
+  }
+  
+  // Updates a grid that was computed for the structure before an edit: the contributions of the removed atoms are subtracted and those of
+  // the added atoms are added, but only for the grid points within the cutoff of a changed atom. A moved atom is a removal plus an addition.
+  // The framework itself must describe the structure after the edit, it is used to recompute the points close to atoms (see
+  // 'maximumIncrementalEnergyValue'). Returns false when the grid does not have the given dimensions.
+  @discardableResult
+  public func UpdateEnergyGrid(_ grid: inout [Float], sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>,
+                               removed: (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>]),
+                               added: (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>])) -> Bool
+  {
+    guard grid.count == sizeX * sizeY * sizeZ else { return false }
+    guard !(removed.positions.isEmpty && added.positions.isEmpty) else { return true }
+    
+    let affectedGridPoints: [Int] = gridPointsWithinCutoff(of: removed.positions + added.positions, sizeX: sizeX, sizeY: sizeY, sizeZ: sizeZ)
+    
+    let correction: SIMD3<Double> = self.correction
+    func packedAtoms(_ positions: [SIMD3<Double>], _ potentialParameters: [SIMD2<Double>]) -> PackedAtoms
+    {
+      let scaledPositions: [SIMD3<Float>] = positions.map{(fractionalPosition: SIMD3<Double>) -> SIMD3<Float> in
+        let position: SIMD3<Double> = fractionalPosition * correction
+        return SIMD3<Float>(Float(position.x), Float(position.y), Float(position.z))
+      }
+      let parameters: (epsilon: [Float], sigmaSquared: [Float]) = SKCPUFramework.mixedParameters(potentialParameters, probeParameter: probeParameter)
+      return PackedAtoms(positions: scaledPositions, epsilon: parameters.epsilon, sigmaSquared: parameters.sigmaSquared, sizeOfBatch: max(1, positions.count))
+    }
+    let removedAtoms: PackedAtoms = packedAtoms(removed.positions, removed.potentialParameters)
+    let addedAtoms: PackedAtoms = packedAtoms(added.positions, added.potentialParameters)
+    
+    let cell: float3x3 = float3x3(Double3x3: replicaCell)
+    let replicas: [SIMD3<Float>] = self.replicaVectors
+    let gridCoordinates: (x: [Float], y: [Float], z: [Float]) = self.gridCoordinates(sizeX, sizeY: sizeY, sizeZ: sizeZ)
+    
+    func gridPosition(_ index: Int) -> SIMD3<Float>
+    {
+      return SIMD3<Float>(gridCoordinates.x[index % sizeX], gridCoordinates.y[(index / sizeX) % sizeY], gridCoordinates.z[index / (sizeX * sizeY)])
+    }
+    
+    var recompute: [Bool] = [Bool](repeating: false, count: affectedGridPoints.count)
+    let sizeOfChunk: Int = 256
+    let numberOfChunks: Int = (affectedGridPoints.count + sizeOfChunk - 1) / sizeOfChunk
+    
+    grid.withUnsafeMutableBufferPointer { gridPtr in
+      let output: UnsafeMutablePointer<Float> = gridPtr.baseAddress!
+      recompute.withUnsafeMutableBufferPointer { recomputePtr in
+        let flags: UnsafeMutablePointer<Bool> = recomputePtr.baseAddress!
+        DispatchQueue.concurrentPerform(iterations: numberOfChunks) { chunk in
+          for n in (chunk * sizeOfChunk)..<min((chunk + 1) * sizeOfChunk, affectedGridPoints.count)
+          {
+            let index: Int = affectedGridPoints[n]
+            let position: SIMD3<Float> = gridPosition(index)
+            let oldValue: Float = output[index]
+            let removedValue: Float = SKCPUFramework.energy(gridPosition: position, atoms: removedAtoms, replicas: replicas, cell: cell, maximumValue: Float.infinity)
+            let newValue: Float = oldValue - removedValue + SKCPUFramework.energy(gridPosition: position, atoms: addedAtoms, replicas: replicas, cell: cell, maximumValue: Float.infinity)
+            if !newValue.isFinite || max(oldValue, removedValue, newValue) >= SKCPUFramework.maximumIncrementalEnergyValue
+            {
+              flags[n] = true
+            }
+            else
+            {
+              output[index] = newValue
+            }
+          }
+        }
+      }
+    }
+    
+    let recomputedGridPoints: [Int] = recompute.indices.filter{recompute[$0]}.map{affectedGridPoints[$0]}
+    if !recomputedGridPoints.isEmpty
+    {
+      let energy: (SIMD3<Float>) -> Float = energyFunction(probeParameter: probeParameter)
+      grid.withUnsafeMutableBufferPointer { gridPtr in
+        let output: UnsafeMutablePointer<Float> = gridPtr.baseAddress!
+        let numberOfChunks: Int = (recomputedGridPoints.count + sizeOfChunk - 1) / sizeOfChunk
+        DispatchQueue.concurrentPerform(iterations: numberOfChunks) { chunk in
+          for n in (chunk * sizeOfChunk)..<min((chunk + 1) * sizeOfChunk, recomputedGridPoints.count)
+          {
+            let index: Int = recomputedGridPoints[n]
+            output[index] = energy(gridPosition(index))
+          }
+        }
+      }
+    }
+    return true
+  }
+  
+  // MARK: Cell-list
+  // =====================================================================
+  
+  // the cells are a third of the cutoff wide, so the neighbouring cells within the cutoff follow the cutoff-sphere closely
+  static let cellsPerCutoff: Int = 3
+  static let maximumNumberOfCells: Int = 16
+  
+  // The unit cell is divided in cells that are narrower than the cutoff. For every cell, the atoms of the periodic images of the unit cell
+  // that lie in the cells within the cutoff are gathered into one packed list (in the fractional frame of 'cell'). The frame is chosen
+  // large enough that the minimum-image convention of the kernels never changes a distance, so the explicit images are used as they are.
+  // One list of packed atoms per probe is stored for every cell, the lists of the different probes only differ in the mixed parameters.
+  struct CellList
+  {
+    var numberOfCells: SIMD3<Int>
+    var cell: float3x3
+    var scaling: SIMD3<Float>           // from the fractional position in the replica-cell to the frame of 'cell'
+    var gridScaling: SIMD3<Float>       // from the fractional position in the replica-cell to the fractional position in the unit cell
+    var atoms: [[PackedAtoms]]
+    
+    @inline(__always)
+    func cellIndex(_ gridPosition: SIMD3<Float>) -> Int
+    {
+      return SKCPUFramework.cellIndex(gridPosition * gridScaling, numberOfCells: numberOfCells)
+    }
+  }
+  
+  static func cellIndex(_ position: SIMD3<Float>, numberOfCells: SIMD3<Int>) -> Int
+  {
+    let cx: Int = min(max(Int(position.x * Float(numberOfCells.x)), 0), numberOfCells.x - 1)
+    let cy: Int = min(max(Int(position.y * Float(numberOfCells.y)), 0), numberOfCells.y - 1)
+    let cz: Int = min(max(Int(position.z * Float(numberOfCells.z)), 0), numberOfCells.z - 1)
+    return cx + numberOfCells.x * (cy + numberOfCells.y * cz)
+  }
+  
+  // The minimum distance between a point in a cell and a point in the cell at 'offset' (in cells), i.e. the minimum of |H t| with t
+  // within 'offset' +/- 1 and the columns of H the edges of a cell. The box-constrained quadratic is solved by trying every combination of
+  // free and bounded coordinates, the smallest feasible stationary point is the minimum.
+  static func minimumDistance(offset: SIMD3<Int>, cellEdges: double3x3) -> Double
+  {
+    let G: double3x3 = cellEdges.transpose * cellEdges
+    let center: SIMD3<Double> = SIMD3<Double>(Double(offset.x), Double(offset.y), Double(offset.z))
+    
+    var minimumDistanceSquared: Double = Double.greatestFiniteMagnitude
+    for state in 0..<27
+    {
+      var t: SIMD3<Double> = SIMD3<Double>(0.0, 0.0, 0.0)
+      var free: [Int] = []
+      var code: Int = state
+      for i in 0..<3
+      {
+        switch(code % 3)
+        {
+        case 0:
+          free.append(i)
+        case 1:
+          t[i] = center[i] - 1.0
+        default:
+          t[i] = center[i] + 1.0
+        }
+        code /= 3
+      }
+      
+      // the gradient with respect to the free coordinates vanishes: G_ff t_f = -G_fb t_b
+      let b: SIMD3<Double> = -(G * t)
+      switch(free.count)
+      {
+      case 1:
+        t[free[0]] = b[free[0]] / G[free[0]][free[0]]
+      case 2:
+        let m: double2x2 = double2x2([SIMD2<Double>(G[free[0]][free[0]], G[free[0]][free[1]]), SIMD2<Double>(G[free[1]][free[0]], G[free[1]][free[1]])])
+        let x: SIMD2<Double> = m.inverse * SIMD2<Double>(b[free[0]], b[free[1]])
+        t[free[0]] = x.x
+        t[free[1]] = x.y
+      case 3:
+        t = SIMD3<Double>(0.0, 0.0, 0.0)
+      default:
+        break
+      }
+      
+      if free.allSatisfy({abs(t[$0] - center[$0]) <= 1.0 + 1e-10})
+      {
+        minimumDistanceSquared = min(minimumDistanceSquared, length_squared(cellEdges * t))
+      }
+    }
+    return minimumDistanceSquared.squareRoot()
+  }
+  
+  func cellList(probeParameters: [SIMD2<Double>], atomTypes: [Int32] = []) -> CellList
+  {
+    let cutoff: Double = Double(SKCPUFramework.cutoffSquared).squareRoot()
+    let perpendicularWidths: SIMD3<Double> = SKCell(unitCell: unitCell).perpendicularWidths
+    let numberOfCells: SIMD3<Int> = SIMD3<Int>(min(SKCPUFramework.maximumNumberOfCells, max(1, Int(perpendicularWidths.x * Double(SKCPUFramework.cellsPerCutoff) / cutoff))),
+                                               min(SKCPUFramework.maximumNumberOfCells, max(1, Int(perpendicularWidths.y * Double(SKCPUFramework.cellsPerCutoff) / cutoff))),
+                                               min(SKCPUFramework.maximumNumberOfCells, max(1, Int(perpendicularWidths.z * Double(SKCPUFramework.cellsPerCutoff) / cutoff))))
+    
+    // the number of neighbouring cells that are needed to cover the cutoff
+    let reach: SIMD3<Int> = SIMD3<Int>(Int((cutoff * Double(numberOfCells.x) / perpendicularWidths.x).rounded(.up)),
+                                       Int((cutoff * Double(numberOfCells.y) / perpendicularWidths.y).rounded(.up)),
+                                       Int((cutoff * Double(numberOfCells.z) / perpendicularWidths.z).rounded(.up)))
+    
+    // only the neighbouring cells that can have atoms within the cutoff of a grid point in the central cell
+    let cellEdges: double3x3 = double3x3([unitCell[0] / Double(numberOfCells.x), unitCell[1] / Double(numberOfCells.y), unitCell[2] / Double(numberOfCells.z)])
+    var offsets: [SIMD3<Int>] = []
+    for dz in -reach.z...reach.z
+    {
+      for dy in -reach.y...reach.y
+      {
+        for dx in -reach.x...reach.x
+        {
+          if SKCPUFramework.minimumDistance(offset: SIMD3<Int>(dx, dy, dz), cellEdges: cellEdges) < cutoff
+          {
+            offsets.append(SIMD3<Int>(dx, dy, dz))
+          }
+        }
+      }
+    }
+    
+    // the fractional displacements of the gathered atoms are smaller than '(reach + 1) / numberOfCells', a frame that is more than
+    // twice as large keeps them below one half
+    let frame: SIMD3<Double> = SIMD3<Double>(2.0 * Double(reach.x + 1) / Double(numberOfCells.x) + 1.0,
+                                             2.0 * Double(reach.y + 1) / Double(numberOfCells.y) + 1.0,
+                                             2.0 * Double(reach.z + 1) / Double(numberOfCells.z) + 1.0)
+    let inverseFrame: SIMD3<Float> = SIMD3<Float>(Float(1.0 / frame.x), Float(1.0 / frame.y), Float(1.0 / frame.z))
+    let replicas: SIMD3<Double> = SIMD3<Double>(Double(numberOfReplicas.x), Double(numberOfReplicas.y), Double(numberOfReplicas.z))
+    
+    // the atoms of the unit cell, binned in cells
+    let parameters: [(epsilon: [Float], sigmaSquared: [Float])] = probeParameters.map{mixedParameters(probeParameter: $0)}
+    var cells: [[Int]] = [[Int]](repeating: [], count: numberOfCells.x * numberOfCells.y * numberOfCells.z)
+    var unitCellPositions: [SIMD3<Float>] = []
+    unitCellPositions.reserveCapacity(totalNumberOfAtoms)
+    for i in 0..<totalNumberOfAtoms
+    {
+      var position: SIMD3<Double> = positions[i]
+      position -= position.rounded(.down)
+      cells[SKCPUFramework.cellIndex(SIMD3<Float>(position), numberOfCells: numberOfCells)].append(i)
+      unitCellPositions.append(SIMD3<Float>(position))
+    }
+    
+    var atoms: [[PackedAtoms]] = [[PackedAtoms]](repeating: [], count: cells.count)
+    for cz in 0..<numberOfCells.z
+    {
+      for cy in 0..<numberOfCells.y
+      {
+        for cx in 0..<numberOfCells.x
+        {
+          var positions: [SIMD3<Float>] = []
+          var types: [Int32] = []
+          var epsilon: [[Float]] = [[Float]](repeating: [], count: probeParameters.count)
+          var sigmaSquared: [[Float]] = [[Float]](repeating: [], count: probeParameters.count)
+          for offset in offsets
+          {
+            // the neighbouring cell and the periodic image of the unit cell that it lies in
+            let neighbour: SIMD3<Int> = SIMD3<Int>(cx, cy, cz) &+ offset
+            let wrapped: SIMD3<Int> = SIMD3<Int>((neighbour.x % numberOfCells.x + numberOfCells.x) % numberOfCells.x,
+                                                 (neighbour.y % numberOfCells.y + numberOfCells.y) % numberOfCells.y,
+                                                 (neighbour.z % numberOfCells.z + numberOfCells.z) % numberOfCells.z)
+            let image: SIMD3<Float> = SIMD3<Float>(Float((neighbour.x - wrapped.x) / numberOfCells.x),
+                                                   Float((neighbour.y - wrapped.y) / numberOfCells.y),
+                                                   Float((neighbour.z - wrapped.z) / numberOfCells.z))
+            
+            for index in cells[wrapped.x + numberOfCells.x * (wrapped.y + numberOfCells.y * wrapped.z)]
+            {
+              positions.append((unitCellPositions[index] + image) * inverseFrame)
+              if !atomTypes.isEmpty
+              {
+                types.append(atomTypes[index])
+              }
+              for p in 0..<probeParameters.count
+              {
+                epsilon[p].append(parameters[p].epsilon[index])
+                sigmaSquared[p].append(parameters[p].sigmaSquared[index])
+              }
+            }
+          }
+          // a single batch: the clamp is applied to the total energy of the grid point
+          atoms[cx + numberOfCells.x * (cy + numberOfCells.y * cz)] = (0..<probeParameters.count).map{p in
+            PackedAtoms(positions: positions, epsilon: epsilon[p], sigmaSquared: sigmaSquared[p], types: types, sizeOfBatch: max(1, positions.count))
+          }
+        }
+      }
+    }
+    
+    return CellList(numberOfCells: numberOfCells,
+                    cell: float3x3(Double3x3: double3x3([frame.x * unitCell[0], frame.y * unitCell[1], frame.z * unitCell[2]])),
+                    scaling: SIMD3<Float>(Float(replicas.x / frame.x), Float(replicas.y / frame.y), Float(replicas.z / frame.z)),
+                    gridScaling: SIMD3<Float>(replicas),
+                    atoms: atoms)
+  }
+  
+  // The same void fraction as 'SKMetalFramework.computeVoidFractions', reduced per grid-line without storing the grid.
+  public static func computeVoidFractions(structures: [SKRenderAdsorptionSurfaceStructure]) -> [Double]
+  {
+    var voidFractions: [Double] = []
+    for structure in structures
+    {
+      let cell: SKCell = structure.cell
+      let probeParameters: SIMD2<Double> = SIMD2<Double>(10.9, 2.64)
+      
+      let numberOfReplicas: SIMD3<Int32> = cell.numberOfReplicas(forCutoff: 12.0)
+      let framework: SKCPUFramework = SKCPUFramework(positions: structure.atomUnitCellPositions, potentialParameters: structure.potentialParameters, unitCell: cell.unitCell, numberOfReplicas: numberOfReplicas)
+      
+      let reduction: SKEnergyGridReduction = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: probeParameters, reduction: SKEnergyGridReduction(temperature: 298.0))  // K_B  chosen as 1.0 (energy units are Kelvin)
+      
+      voidFractions.append(reduction.boltzmannSum/Double(128*128*128))
+    }
+    return voidFractions
+  }
+  
+  // The same nitrogen surface area as 'SKMetalFramework.computeNitrogenSurfaceArea', with the CPU-versions of the energy grid and marching cubes.
+  public static func computeNitrogenSurfaceArea(structures: [SKRenderAdsorptionSurfaceStructure], useSymmetry: Bool = false) -> ([Double], [Double])
+  {
+    var surfaceAreas: (gravimetric: [Double], volumetric: [Double]) = ([],[])
+    for structure in structures
+    {
+      let cell: SKCell = structure.cell
+      let probeParameters: SIMD2<Double> = SIMD2<Double>(36.0,3.31)
+      
+      let numberOfReplicas: SIMD3<Int32> = cell.numberOfReplicas(forCutoff: 12.0)
+      let framework: SKCPUFramework = SKCPUFramework(positions: structure.atomUnitCellPositions, potentialParameters: structure.potentialParameters, unitCell: cell.unitCell, numberOfReplicas: numberOfReplicas)
+      
+      // 121 points (120 periodic points) keep the centring-, screw- and glide-translations of the space group on the grid
+      let size: Int = useSymmetry ? SKEnergyGridSymmetry.symmetricGridSize(128) : 128
+      let data: [Float] = useSymmetry ?
+        framework.ComputeEnergyGrid(size, sizeY: size, sizeZ: size, probeParameter: probeParameters, spaceGroup: SKSpacegroup(HallNumber: structure.spaceGroupHallNumber ?? 1)) :
+        framework.ComputeEnergyGrid(size, sizeY: size, sizeZ: size, probeParameter: probeParameters)
+      
+      let marchingCubes: SKCPUMarchingCubes = SKCPUMarchingCubes(dimensions: SIMD3<Int32>(Int32(size),Int32(size),Int32(size)))
+      marchingCubes.isoValue = Float(0.0)
+      let totalArea: Double = marchingCubes.surfaceArea(data, unitCell: cell.unitCell)
+      
+      surfaceAreas.gravimetric.append(totalArea * SKConstant.AvogadroConstantPerAngstromSquared / structure.structureMass)
+      surfaceAreas.volumetric.append(totalArea * 1e4 / structure.cell.volume)
+    }
+    return surfaceAreas
+  }
+}
@@ -0,0 +1,473 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+
+// CPU-version of the histogram-pyramid marching cubes of 'MarchingCubes3D.metal' ('classifyCubes', 'constructHPLevel', 'traverseHP').
+// The output is identical to the vertex buffer of the GPU: 3 vertices per triangle, each a position (fractional, w = 1), a normal (w = 0) and
+// an unused texture coordinate, with the vertices of a triangle in reversed order.
+// The GPU emits the triangles in the traversal order of the pyramid, which is a Morton-order of the cubes of the (power-of-two) padded grid
+// with per level the x-bit, z-bit and y-bit (the order of 'cubeOffsets'). Contiguous ranges of that order are octree-blocks of the grid; these
+// blocks are classified in parallel, an exclusive prefix-sum over the triangle counts per block gives the offsets, and the blocks are then
+// triangulated in parallel directly into their part of the output.
+// The dimensions are arbitrary and the grid is periodic: the cubes of the last layer connect to the first, so the surfaces close seamlessly
+// across the cell boundaries. Only the block-ordering is done on the padded power-of-two cube, the data itself is never padded.
+public class SKCPUMarchingCubes
+{
+  public var isoValue: Float = 0.0
+  public var dimensions: SIMD3<Int> = SIMD3<Int>(0,0,0)
+  
+  public init(dimensions: SIMD3<Int32>)
+  {
+    self.dimensions = SIMD3<Int>(truncatingIfNeeded: dimensions)
+  }
+  
+  // the triangle soup, 3 * 3 float4 per triangle
+  public func isoSurface(_ voxels: [Float]) -> [SIMD4<Float>]
+  {
+    guard let blocks: Blocks = classify(voxels) else { return [] }
+    
+    var offsets: [Int] = [Int](repeating: 0, count: blocks.numberOfTriangles.count)
+    var numberOfTriangles: Int = 0
+    for (block, count) in blocks.numberOfTriangles.enumerated()
+    {
+      offsets[block] = numberOfTriangles
+      numberOfTriangles += count
+    }
+    guard numberOfTriangles > 0 else { return [] }
+    
+    var vertices: [SIMD4<Float>] = [SIMD4<Float>](repeating: SIMD4<Float>(0.0, 0.0, 0.0, 0.0), count: 3 * 3 * numberOfTriangles)
+    voxels.withUnsafeBufferPointer { voxelsPtr in
+      vertices.withUnsafeMutableBufferPointer { verticesPtr in
+        let output: UnsafeMutablePointer<SIMD4<Float>> = verticesPtr.baseAddress!
+        DispatchQueue.concurrentPerform(iterations: blocks.numberOfTriangles.count) { block in
+          var triangle: Int = offsets[block]
+          forEachCube(in: block, of: blocks) { cubePosition, cubeIndex in
+            for i in 0..<Int(SKCPUMarchingCubes.numberOfTriangles[cubeIndex])
+            {
+              for vertexNr in 0..<3
+              {
+                let (position, normal): (SIMD3<Float>, SIMD3<Float>) = triangleVertex(cubePosition, cubeIndex: cubeIndex, vertex: 3 * i + vertexNr, voxels: voxelsPtr)
+                output[triangle * 9 + (2 - vertexNr) * 3] = SIMD4<Float>(position / SIMD3<Float>(dimensions), 1.0)
+                output[triangle * 9 + (2 - vertexNr) * 3 + 1] = SIMD4<Float>(simd_normalize(normal), 0.0)
+              }
+              triangle += 1
+            }
+          }
+        }
+      }
+    }
+    return vertices
+  }
+  
+  // The area of the iso-surface in Cartesian space (using the cell matrix), with the same per-triangle filter as the GPU-version; the
+  // triangles are not stored. The blocks are summed in order, so the result does not depend on the number of threads.
+  public func surfaceArea(_ voxels: [Float], unitCell: double3x3) -> Double
+  {
+    guard let blocks: Blocks = classify(voxels) else { return 0.0 }
+    
+    var areas: [Double] = [Double](repeating: 0.0, count: blocks.numberOfTriangles.count)
+    voxels.withUnsafeBufferPointer { voxelsPtr in
+      areas.withUnsafeMutableBufferPointer { areasPtr in
+        let blockAreas: UnsafeMutablePointer<Double> = areasPtr.baseAddress!
+        DispatchQueue.concurrentPerform(iterations: blocks.numberOfTriangles.count) { block in
+          guard blocks.numberOfTriangles[block] > 0 else { return }
+          var area: Double = 0.0
+          forEachCube(in: block, of: blocks) { cubePosition, cubeIndex in
+            for i in 0..<Int(SKCPUMarchingCubes.numberOfTriangles[cubeIndex])
+            {
+              // only the positions are needed, the normals (12 extra lookups per vertex) are skipped
+              let v1: SIMD3<Double> = unitCell * SIMD3<Double>(trianglePosition(cubePosition, cubeIndex: cubeIndex, vertex: 3 * i, voxels: voxelsPtr) / SIMD3<Float>(dimensions))
+              let v2: SIMD3<Double> = unitCell * SIMD3<Double>(trianglePosition(cubePosition, cubeIndex: cubeIndex, vertex: 3 * i + 1, voxels: voxelsPtr) / SIMD3<Float>(dimensions))
+              let v3: SIMD3<Double> = unitCell * SIMD3<Double>(trianglePosition(cubePosition, cubeIndex: cubeIndex, vertex: 3 * i + 2, voxels: voxelsPtr) / SIMD3<Float>(dimensions))
+              let triangleArea: Double = 0.5 * simd_length(simd_cross(v2 - v1, v3 - v1))
+              if triangleArea.isFinite && fabs(triangleArea) < 1.0
+              {
+                area += triangleArea
+              }
+            }
+          }
+          blockAreas[block] = area
+        }
+      }
+    }
+    return areas.reduce(0.0, +)
+  }
+  
+  // MARK: Indexed meshes
+  // =====================================================================
+  
+  // The iso-surface as an indexed mesh. Each edge of the grid that crosses the iso-value gets a single vertex (an edge-indexed vertex cache),
+  // shared by all triangles of the surrounding cubes. An edge is identified by its lower corner (0...N along each axis, so that the edges on
+  // the periodic boundary are not welded to the opposite side) and its axis. The grid is split in slabs along z that own the edges of their
+  // corner-layers: per slab the crossed edges are collected in scan order (which is sorted by identifier) and the triangles counted; prefix sums
+  // give the vertex- and index-offset of each slab; then the vertices and the triangles are written in parallel, looking up the vertex of an
+  // edge by a binary search in the edges of the slab that owns it. The triangles have the same orientation as in the triangle soup.
+  public func indexedIsoSurface(_ voxels: [Float]) -> SKIsoSurfaceMesh
+  {
+    let n: SIMD3<Int> = dimensions
+    guard n.x > 0, n.y > 0, n.z > 0, voxels.count >= n.x * n.y * n.z else { return SKIsoSurfaceMesh() }
+    
+    let numberOfSlabs: Int = max(1, min(n.z, 2 * ProcessInfo.processInfo.activeProcessorCount))
+    let slabStart: [Int] = (0...numberOfSlabs).map{$0 * n.z / numberOfSlabs}
+    var slabOfLayer: [Int] = [Int](repeating: numberOfSlabs - 1, count: n.z + 1)
+    for slab in 0..<numberOfSlabs
+    {
+      for layer in slabStart[slab]..<slabStart[slab + 1]
+      {
+        slabOfLayer[layer] = slab
+      }
+    }
+    
+    func edgeIdentifier(_ corner: SIMD3<Int>, axis: Int) -> Int
+    {
+      return axis + 3 * (corner.x + (n.x + 1) * (corner.y + (n.y + 1) * corner.z))
+    }
+    
+    var slabEdges: [[Int]] = [[Int]](repeating: [], count: numberOfSlabs)
+    var slabTriangles: [Int] = [Int](repeating: 0, count: numberOfSlabs)
+    var vertexOffsets: [Int] = [Int](repeating: 0, count: numberOfSlabs)
+    var triangleOffsets: [Int] = [Int](repeating: 0, count: numberOfSlabs)
+    var meshVertices: [SIMD4<Float>] = []
+    var meshIndices: [UInt32] = []
+    
+    voxels.withUnsafeBufferPointer { voxelsPtr in
+      // the crossed edges and the number of triangles per slab
+      slabEdges.withUnsafeMutableBufferPointer { slabEdgesPtr in
+        slabTriangles.withUnsafeMutableBufferPointer { slabTrianglesPtr in
+          let edges: UnsafeMutablePointer<[Int]> = slabEdgesPtr.baseAddress!
+          let triangles: UnsafeMutablePointer<Int> = slabTrianglesPtr.baseAddress!
+          DispatchQueue.concurrentPerform(iterations: numberOfSlabs) { slab in
+            let lastLayer: Int = slab == numberOfSlabs - 1 ? n.z : slabStart[slab + 1] - 1
+            for z in stride(from: slabStart[slab], through: lastLayer, by: 1)
+            {
+              for y in 0...n.y
+              {
+                for x in 0...n.x
+                {
+                  let corner: SIMD3<Int> = SIMD3<Int>(x, y, z)
+                  let above: Bool = value(corner, voxels: voxelsPtr) > isoValue
+                  for axis in 0..<3 where corner[axis] < n[axis]
+                  {
+                    var neighbour: SIMD3<Int> = corner
+                    neighbour[axis] += 1
+                    if (value(neighbour, voxels: voxelsPtr) > isoValue) != above
+                    {
+                      edges[slab].append(edgeIdentifier(corner, axis: axis))
+                    }
+                  }
+                }
+              }
+            }
+            
+            var count: Int = 0
+            for z in slabStart[slab]..<slabStart[slab + 1]
+            {
+              for y in 0..<n.y
+              {
+                for x in 0..<n.x
+                {
+                  count += Int(SKCPUMarchingCubes.numberOfTriangles[Int(cubeIndex(SIMD3<Int>(x, y, z), voxels: voxelsPtr))])
+                }
+              }
+            }
+            triangles[slab] = count
+          }
+        }
+      }
+      
+      var numberOfVertices: Int = 0
+      var numberOfTriangles: Int = 0
+      for slab in 0..<numberOfSlabs
+      {
+        vertexOffsets[slab] = numberOfVertices
+        triangleOffsets[slab] = numberOfTriangles
+        numberOfVertices += slabEdges[slab].count
+        numberOfTriangles += slabTriangles[slab]
+      }
+      
+      meshVertices = [SIMD4<Float>](repeating: SIMD4<Float>(0.0, 0.0, 0.0, 0.0), count: 2 * numberOfVertices)
+      meshIndices = [UInt32](repeating: 0, count: 3 * numberOfTriangles)
+      meshVertices.withUnsafeMutableBufferPointer { verticesPtr in
+        meshIndices.withUnsafeMutableBufferPointer { indicesPtr in
+          let vertices: UnsafeMutablePointer<SIMD4<Float>> = verticesPtr.baseAddress!
+          let indices: UnsafeMutablePointer<UInt32> = indicesPtr.baseAddress!
+          
+          // one vertex per crossed edge, interpolated from the lower to the upper corner
+          DispatchQueue.concurrentPerform(iterations: numberOfSlabs) { slab in
+            for (local, identifier) in slabEdges[slab].enumerated()
+            {
+              let axis: Int = identifier % 3
+              let point: Int = identifier / 3
+              let point0: SIMD3<Int> = SIMD3<Int>(point % (n.x + 1), (point / (n.x + 1)) % (n.y + 1), point / ((n.x + 1) * (n.y + 1)))
+              var point1: SIMD3<Int> = point0
+              point1[axis] += 1
+              
+              let value0: Float = value(point0, voxels: voxelsPtr)
+              let diff: Float = (isoValue - value0) / (value(point1, voxels: voxelsPtr) - value0)
+              let normal0: SIMD3<Float> = centralDifference(point0, voxels: voxelsPtr)
+              let normal1: SIMD3<Float> = centralDifference(point1, voxels: voxelsPtr)
+              
+              var position: SIMD3<Float> = SIMD3<Float>(point0)
+              position[axis] += diff
+              let index: Int = vertexOffsets[slab] + local
+              vertices[2 * index] = SIMD4<Float>(position / SIMD3<Float>(n), 1.0)
+              vertices[2 * index + 1] = SIMD4<Float>(simd_normalize(normal0 + (normal1 - normal0) * diff), 0.0)
+            }
+          }
+          
+          // the triangles of the cubes of each slab
+          DispatchQueue.concurrentPerform(iterations: numberOfSlabs) { slab in
+            var triangle: Int = triangleOffsets[slab]
+            for z in slabStart[slab]..<slabStart[slab + 1]
+            {
+              for y in 0..<n.y
+              {
+                for x in 0..<n.x
+                {
+                  let cubePosition: SIMD3<Int> = SIMD3<Int>(x, y, z)
+                  let cubeIndex: Int = Int(self.cubeIndex(cubePosition, voxels: voxelsPtr))
+                  for i in 0..<(3 * Int(SKCPUMarchingCubes.numberOfTriangles[cubeIndex]))
+                  {
+                    let edge: Int = Int(SKCPUMarchingCubes.triTable[cubeIndex * 16 + i])
+                    let corner: SIMD3<Int> = cubePosition &+ simd_min(SKCPUMarchingCubes.edgeOffsets[edge].0, SKCPUMarchingCubes.edgeOffsets[edge].1)
+                    let difference: SIMD3<Int> = SKCPUMarchingCubes.edgeOffsets[edge].1 &- SKCPUMarchingCubes.edgeOffsets[edge].0
+                    let axis: Int = difference.x != 0 ? 0 : (difference.y != 0 ? 1 : 2)
+                    
+                    let owner: Int = slabOfLayer[corner.z]
+                    let local: Int = SKCPUMarchingCubes.lowerBound(slabEdges[owner], edgeIdentifier(corner, axis: axis))
+                    
+                    // reversed order within a triangle, as in the triangle soup
+                    indices[3 * triangle + 2 - i % 3] = UInt32(vertexOffsets[owner] + local)
+                    if i % 3 == 2
+                    {
+                      triangle += 1
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+    return SKIsoSurfaceMesh(vertices: meshVertices, indices: meshIndices)
+  }
+  
+  static func lowerBound(_ sortedValues: [Int], _ value: Int) -> Int
+  {
+    var low: Int = 0
+    var high: Int = sortedValues.count
+    while low < high
+    {
+      let middle: Int = (low + high) / 2
+      if sortedValues[middle] < value
+      {
+        low = middle + 1
+      }
+      else
+      {
+        high = middle
+      }
+    }
+    return low
+  }
+  
+  // MARK: Classification
+  // =====================================================================
+  
+  struct Blocks
+  {
+    // the number of levels of the padded grid, and the number of levels within a block
+    var levels: Int
+    var blockLevels: Int
+    
+    // the cube index of each cube of the (unpadded) grid, and the number of triangles per block
+    var cubeIndices: [UInt8]
+    var numberOfTriangles: [Int]
+  }
+  
+  func classify(_ voxels: [Float]) -> Blocks?
+  {
+    let n: SIMD3<Int> = dimensions
+    guard n.x > 0, n.y > 0, n.z > 0, voxels.count >= n.x * n.y * n.z else { return nil }
+    
+    // the padded size of the pyramid (at least 2, as on the GPU)
+    var levels: Int = 1
+    while (1 << levels) < n.max()
+    {
+      levels += 1
+    }
+    
+    // enough blocks to balance the load over the cores
+    let targetNumberOfBlocks: Int = 8 * ProcessInfo.processInfo.activeProcessorCount
+    var topLevels: Int = 0
+    while topLevels < levels && (1 << (3 * topLevels)) < targetNumberOfBlocks
+    {
+      topLevels += 1
+    }
+    
+    let blockLevels: Int = levels - topLevels
+    var cubeIndices: [UInt8] = [UInt8](repeating: 0, count: n.x * n.y * n.z)
+    var numberOfTriangles: [Int] = [Int](repeating: 0, count: 1 << (3 * topLevels))
+    voxels.withUnsafeBufferPointer { voxelsPtr in
+      cubeIndices.withUnsafeMutableBufferPointer { cubeIndicesPtr in
+        numberOfTriangles.withUnsafeMutableBufferPointer { numberOfTrianglesPtr in
+          let cubeIndices: UnsafeMutablePointer<UInt8> = cubeIndicesPtr.baseAddress!
+          let blockTriangles: UnsafeMutablePointer<Int> = numberOfTrianglesPtr.baseAddress!
+          DispatchQueue.concurrentPerform(iterations: 1 << (3 * topLevels)) { block in
+            var count: Int = 0
+            for local in 0..<(1 << (3 * blockLevels))
+            {
+              let cubePosition: SIMD3<Int> = SKCPUMarchingCubes.mortonDecode((block << (3 * blockLevels)) | local, levels: levels)
+              guard all(cubePosition .< n) else { continue }
+              
+              let cubeIndex: UInt8 = self.cubeIndex(cubePosition, voxels: voxelsPtr)
+              cubeIndices[cubePosition.x + n.x * (cubePosition.y + n.y * cubePosition.z)] = cubeIndex
+              count += Int(SKCPUMarchingCubes.numberOfTriangles[Int(cubeIndex)])
+            }
+            blockTriangles[block] = count
+          }
+        }
+      }
+    }
+    return Blocks(levels: levels, blockLevels: blockLevels, cubeIndices: cubeIndices, numberOfTriangles: numberOfTriangles)
+  }
+  
+  // the cubes of a block that produce triangles, in the traversal order of the histogram-pyramid
+  func forEachCube(in block: Int, of blocks: Blocks, _ body: (SIMD3<Int>, Int) -> Void)
+  {
+    let n: SIMD3<Int> = dimensions
+    for local in 0..<(1 << (3 * blocks.blockLevels))
+    {
+      let cubePosition: SIMD3<Int> = SKCPUMarchingCubes.mortonDecode((block << (3 * blocks.blockLevels)) | local, levels: blocks.levels)
+      guard all(cubePosition .< n) else { continue }
+      let cubeIndex: Int = Int(blocks.cubeIndices[cubePosition.x + n.x * (cubePosition.y + n.y * cubePosition.z)])
+      if SKCPUMarchingCubes.numberOfTriangles[cubeIndex] > 0
+      {
+        body(cubePosition, cubeIndex)
+      }
+    }
+  }
+  
+  // bit i is set when corner i (in the order of the triangle-table) is above the iso-value
+  func cubeIndex(_ cubePosition: SIMD3<Int>, voxels: UnsafeBufferPointer<Float>) -> UInt8
+  {
+    let n: SIMD3<Int> = dimensions
+    var values: SIMD8<Float> = SIMD8<Float>()
+    for corner in 0..<8
+    {
+      let position: SIMD3<Int> = (cubePosition &+ SKCPUMarchingCubes.cubeOffsets[corner]) % n
+      values[corner] = voxels[position.x + n.x * (position.y + n.y * position.z)]
+    }
+    
+    var cubeIndex: UInt8 = values[0] > isoValue ? 1 : 0
+    cubeIndex |= (values[1] > isoValue ? 1 : 0) << 1
+    cubeIndex |= (values[3] > isoValue ? 1 : 0) << 2
+    cubeIndex |= (values[2] > isoValue ? 1 : 0) << 3
+    cubeIndex |= (values[4] > isoValue ? 1 : 0) << 4
+    cubeIndex |= (values[5] > isoValue ? 1 : 0) << 5
+    cubeIndex |= (values[7] > isoValue ? 1 : 0) << 6
+    cubeIndex |= (values[6] > isoValue ? 1 : 0) << 7
+    return cubeIndex
+  }
+  
+  // per level three bits: x (lowest), z, y
+  static func mortonDecode(_ code: Int, levels: Int) -> SIMD3<Int>
+  {
+    var position: SIMD3<Int> = SIMD3<Int>(0, 0, 0)
+    for level in 0..<levels
+    {
+      let bits: Int = (code >> (3 * level)) & 7
+      position.x |= (bits & 1) << level
+      position.z |= ((bits >> 1) & 1) << level
+      position.y |= ((bits >> 2) & 1) << level
+    }
+    return position
+  }
+  
+  // MARK: Triangulation
+  // =====================================================================
+  
+  // The crossed edge of a vertex of the triangle-table (vertex 3 * triangle + 0...2 of the cube) and the interpolation factor along it,
+  // computed with the same arithmetic as 'traverseHP'.
+  @inline(__always)
+  func triangleEdge(_ cubePosition: SIMD3<Int>, cubeIndex: Int, vertex: Int, voxels: UnsafeBufferPointer<Float>) -> (point0: SIMD3<Int>, point1: SIMD3<Int>, diff: Float)
+  {
+    let edge: Int = Int(SKCPUMarchingCubes.triTable[cubeIndex * 16 + vertex])
+    let point0: SIMD3<Int> = cubePosition &+ SKCPUMarchingCubes.edgeOffsets[edge].0
+    let point1: SIMD3<Int> = cubePosition &+ SKCPUMarchingCubes.edgeOffsets[edge].1
+    
+    let value0: Float = value(point0, voxels: voxels)
+    let diff: Float = (isoValue - value0) / (value(point1, voxels: voxels) - value0)
+    return (point0, point1, diff)
+  }
+  
+  // the position (unscaled grid coordinates) of a vertex of the triangle-table
+  @inline(__always)
+  func trianglePosition(_ cubePosition: SIMD3<Int>, cubeIndex: Int, vertex: Int, voxels: UnsafeBufferPointer<Float>) -> SIMD3<Float>
+  {
+    let (point0, point1, diff): (SIMD3<Int>, SIMD3<Int>, Float) = triangleEdge(cubePosition, cubeIndex: cubeIndex, vertex: vertex, voxels: voxels)
+    let p0: SIMD3<Float> = SIMD3<Float>(point0)
+    let p1: SIMD3<Float> = SIMD3<Float>(point1)
+    return p0 + (p1 - p0) * diff
+  }
+  
+  // the position (unscaled grid coordinates) and the (unnormalized) normal of a vertex of the triangle-table, returned by value so that
+  // no storage is allocated per triangle
+  @inline(__always)
+  func triangleVertex(_ cubePosition: SIMD3<Int>, cubeIndex: Int, vertex: Int, voxels: UnsafeBufferPointer<Float>) -> (position: SIMD3<Float>, normal: SIMD3<Float>)
+  {
+    let (point0, point1, diff): (SIMD3<Int>, SIMD3<Int>, Float) = triangleEdge(cubePosition, cubeIndex: cubeIndex, vertex: vertex, voxels: voxels)
+    let p0: SIMD3<Float> = SIMD3<Float>(point0)
+    let p1: SIMD3<Float> = SIMD3<Float>(point1)
+    let normal0: SIMD3<Float> = centralDifference(point0, voxels: voxels)
+    let normal1: SIMD3<Float> = centralDifference(point1, voxels: voxels)
+    return (p0 + (p1 - p0) * diff, normal0 + (normal1 - normal0) * diff)
+  }
+  
+  // the value at a grid point, periodic in all directions (the coordinates are at least -1)
+  func value(_ p: SIMD3<Int>, voxels: UnsafeBufferPointer<Float>) -> Float
+  {
+    let n: SIMD3<Int> = dimensions
+    let position: SIMD3<Int> = (p &+ n) % n
+    return voxels[position.x + n.x * (position.y + n.y * position.z)]
+  }
+  
+  // the (unnormalized) normal at a grid point
+  func centralDifference(_ p: SIMD3<Int>, voxels: UnsafeBufferPointer<Float>) -> SIMD3<Float>
+  {
+    return SIMD3<Float>(-value(SIMD3<Int>(p.x + 1, p.y, p.z), voxels: voxels) + value(SIMD3<Int>(p.x - 1, p.y, p.z), voxels: voxels),
+                        -value(SIMD3<Int>(p.x, p.y + 1, p.z), voxels: voxels) + value(SIMD3<Int>(p.x, p.y - 1, p.z), voxels: voxels),
+                        -value(SIMD3<Int>(p.x, p.y, p.z + 1), voxels: voxels) + value(SIMD3<Int>(p.x, p.y, p.z - 1), voxels: voxels))
+  }
+}
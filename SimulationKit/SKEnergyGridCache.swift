@@ -0,0 +1,192 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import LogViewKit
+import CryptoKit
+import simd
+
+// Content-addressed on-disk cache of energy grids. The key is a SHA-256 hash of everything that determines the grid (cell, positions,
+// force-field parameters, probe and grid size), so a structure that is reopened (in a later session or by the command-line tool) finds
+// its grid without recomputation. Hits are read straight into the grid, and the least-recently used grids are evicted when the cache grows
+// beyond 'maximumSize'.
+public class SKEnergyGridCache
+{
+  public static let shared: SKEnergyGridCache = SKEnergyGridCache()
+  
+  // increase when the computation of the energy grids changes, so that previously stored grids are no longer used
+  static let version: Int = 1
+  
+  public var maximumSize: Int = 2 * 1024 * 1024 * 1024
+  
+  let directory: URL?
+  let queue: DispatchQueue = DispatchQueue(label: "SKEnergyGridCache")
+  
+  public init(directory: URL? = nil)
+  {
+    if let directory: URL = directory
+    {
+      self.directory = directory
+    }
+    else
+    {
+      let cachesDirectory: URL? = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first
+      self.directory = cachesDirectory?.appendingPathComponent(Bundle.main.bundleIdentifier ?? "iRASPA", isDirectory: true).appendingPathComponent("EnergyGrids", isDirectory: true)
+    }
+    
+    if let directory: URL = self.directory
+    {
+      try? FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true, attributes: nil)
+    }
+  }
+  
+  public static func key(unitCell: double3x3, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], probeParameters: SIMD2<Double>, dimensions: SIMD3<Int>) -> String
+  {
+    // hash the components explicitly (the padding of SIMD3 is undefined)
+    var values: [Double] = [Double(version), Double(dimensions.x), Double(dimensions.y), Double(dimensions.z), probeParameters.x, probeParameters.y]
+    values += [unitCell[0].x, unitCell[0].y, unitCell[0].z, unitCell[1].x, unitCell[1].y, unitCell[1].z, unitCell[2].x, unitCell[2].y, unitCell[2].z]
+    values.reserveCapacity(values.count + 3 * positions.count + 2 * potentialParameters.count)
+    for position in positions
+    {
+      values += [position.x, position.y, position.z]
+    }
+    for parameters in potentialParameters
+    {
+      values += [parameters.x, parameters.y]
+    }
+    
+    var hasher: SHA256 = SHA256()
+    values.withUnsafeBytes { hasher.update(bufferPointer: $0) }
+    return hasher.finalize().map{String(format: "%02x", $0)}.joined()
+  }
+  
+  // the cached grid is read from the file directly into the array (without an intermediate buffer), or nil when not present
+  public func grid(forKey key: String) -> [Float]?
+  {
+    guard let url: URL = directory?.appendingPathComponent(key),
+          let size: Int = ((try? FileManager.default.attributesOfItem(atPath: url.path))?[.size] as? NSNumber)?.intValue,
+          size > 0, size % MemoryLayout<Float>.stride == 0,
+          let file: UnsafeMutablePointer<FILE> = fopen(url.path, "rb") else { return nil }
+    defer { fclose(file) }
+    
+    var grid: [Float] = [Float](repeating: 0.0, count: size / MemoryLayout<Float>.stride)
+    let bytesRead: Int = grid.withUnsafeMutableBytes { fread($0.baseAddress, 1, size, file) }
+    guard bytesRead == size else { return nil }
+    
+    // mark as recently used for the eviction
+    try? FileManager.default.setAttributes([.modificationDate: Date()], ofItemAtPath: url.path)
+    
+    return grid
+  }
+  
+  // the grid is written in the background, entries are replaced atomically so that other processes never see partial grids
+  public func store(grid: [Float], forKey key: String)
+  {
+    guard !grid.isEmpty, let url: URL = directory?.appendingPathComponent(key) else { return }
+    
+    let data: Data = grid.withUnsafeBufferPointer{Data(buffer: $0)}
+    queue.async {
+      do
+      {
+        try data.write(to: url, options: .atomic)
+      }
+      catch
+      {
+        LogQueue.shared.error(destination: nil, message: "Error writing energy grid to cache: " + error.localizedDescription)
+        return
+      }
+      self.evictIfNeeded()
+    }
+  }
+  
+  // the analytic gradients of a grid are stored next to it (three floats per grid point), under the key of the grid
+  public func gradients(forKey key: String) -> [SIMD3<Float>]?
+  {
+    guard let values: [Float] = grid(forKey: key + "-gradients"), values.count % 3 == 0 else { return nil }
+    
+    var gradients: [SIMD3<Float>] = []
+    gradients.reserveCapacity(values.count / 3)
+    for index in stride(from: 0, to: values.count, by: 3)
+    {
+      gradients.append(SIMD3<Float>(values[index], values[index + 1], values[index + 2]))
+    }
+    return gradients
+  }
+  
+  public func store(gradients: [SIMD3<Float>], forKey key: String)
+  {
+    var values: [Float] = []
+    values.reserveCapacity(3 * gradients.count)
+    for gradient in gradients
+    {
+      values += [gradient.x, gradient.y, gradient.z]
+    }
+    store(grid: values, forKey: key + "-gradients")
+  }
+  
+  public func removeAll()
+  {
+    guard let directory: URL = directory else { return }
+    queue.sync {
+      let urls: [URL] = (try? FileManager.default.contentsOfDirectory(at: directory, includingPropertiesForKeys: nil, options: [.skipsHiddenFiles])) ?? []
+      for url in urls
+      {
+        try? FileManager.default.removeItem(at: url)
+      }
+    }
+  }
+  
+  // removes the least-recently used grids until the total size is below 'maximumSize'
+  func evictIfNeeded()
+  {
+    guard let directory: URL = directory else { return }
+    let keys: [URLResourceKey] = [.fileSizeKey, .contentModificationDateKey]
+    guard let urls: [URL] = try? FileManager.default.contentsOfDirectory(at: directory, includingPropertiesForKeys: keys, options: [.skipsHiddenFiles]) else { return }
+    
+    var entries: [(url: URL, size: Int, date: Date)] = urls.compactMap{url -> (url: URL, size: Int, date: Date)? in
+      guard let values: URLResourceValues = try? url.resourceValues(forKeys: Set(keys)) else { return nil }
+      return (url, values.fileSize ?? 0, values.contentModificationDate ?? Date.distantPast)
+    }
+    
+    var totalSize: Int = entries.reduce(0){$0 + $1.size}
+    guard totalSize > maximumSize else { return }
+    
+    entries.sort{$0.date < $1.date}
+    for entry in entries
+    {
+      guard totalSize > maximumSize else { break }
+      if (try? FileManager.default.removeItem(at: entry.url)) != nil
+      {
+        totalSize -= entry.size
+      }
+    }
+  }
+}
@@ -0,0 +1,164 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import Accelerate
+
+// Reductions of an energy grid that are computed while the grid is evaluated, so that the grid itself does not have to be stored: the minimum,
+// the sum of the Boltzmann factors exp(-E/T) (energy units are Kelvin), the number of values below a threshold, and a histogram. The values are
+// accumulated per grid-line (vectorized), and partial reductions of different threads are combined with 'merge' in a fixed order.
+public struct SKEnergyGridReduction
+{
+  public let temperature: Double?
+  public let threshold: Float?
+  public let histogramRange: ClosedRange<Float>?
+  
+  public private(set) var numberOfValues: Int = 0
+  public private(set) var minimum: Float = Float.greatestFiniteMagnitude
+  public private(set) var boltzmannSum: Double = 0.0
+  public private(set) var numberOfValuesBelowThreshold: Int = 0
+  
+  // the values outside the range are not counted
+  public private(set) var histogram: [Int]
+  
+  // scratch-space for the Boltzmann factors, reused by every call of 'accumulate' on this (partial) reduction
+  private var factors: [Float] = []
+  
+  public init(temperature: Double? = nil, threshold: Float? = nil, histogramRange: ClosedRange<Float>? = nil, numberOfHistogramBins: Int = 0)
+  {
+    self.temperature = temperature
+    self.threshold = threshold
+    self.histogramRange = histogramRange
+    self.histogram = [Int](repeating: 0, count: histogramRange == nil ? 0 : max(0, numberOfHistogramBins))
+  }
+  
+  // a reduction with the same operators, but without any values
+  public var empty: SKEnergyGridReduction
+  {
+    return SKEnergyGridReduction(temperature: temperature, threshold: threshold, histogramRange: histogramRange, numberOfHistogramBins: histogram.count)
+  }
+  
+  public var minimumValue: Float?
+  {
+    return numberOfValues > 0 ? minimum : nil
+  }
+  
+  // the void fraction when the temperature is 298 K and the probe is helium
+  public var boltzmannAverage: Double
+  {
+    return numberOfValues > 0 ? boltzmannSum / Double(numberOfValues) : 0.0
+  }
+  
+  public mutating func accumulate(_ values: UnsafeBufferPointer<Float>)
+  {
+    guard let base: UnsafePointer<Float> = values.baseAddress, values.count > 0 else { return }
+    let count: vDSP_Length = vDSP_Length(values.count)
+    
+    numberOfValues += values.count
+    
+    var currentMinimum: Float = 0.0
+    vDSP_minv(base, 1, &currentMinimum, count)
+    minimum = min(minimum, currentMinimum)
+    
+    if let temperature = temperature
+    {
+      var scaling: Float = Float(-1.0 / temperature)
+      var numberOfElements: Int32 = Int32(values.count)
+      var sum: Float = 0.0
+      if factors.count < values.count
+      {
+        factors = [Float](repeating: 0.0, count: values.count)
+      }
+      factors.withUnsafeMutableBufferPointer { factorsPtr in
+        let factor: UnsafeMutablePointer<Float> = factorsPtr.baseAddress!
+        vDSP_vsmul(base, 1, &scaling, factor, 1, count)
+        vvexpf(factor, factor, &numberOfElements)
+        vDSP_sve(factor, 1, &sum, count)
+      }
+      boltzmannSum += Double(sum)
+    }
+    
+    if let threshold = threshold
+    {
+      var below: Int = 0
+      for value in values where value < threshold
+      {
+        below += 1
+      }
+      numberOfValuesBelowThreshold += below
+    }
+    
+    if let histogramRange = histogramRange, !histogram.isEmpty
+    {
+      let numberOfBins: Int = histogram.count
+      let scale: Float = Float(numberOfBins) / max(histogramRange.upperBound - histogramRange.lowerBound, Float.leastNormalMagnitude)
+      histogram.withUnsafeMutableBufferPointer { bins in
+        for value in values where histogramRange.contains(value)
+        {
+          bins[min(Int((value - histogramRange.lowerBound) * scale), numberOfBins - 1)] += 1
+        }
+      }
+    }
+  }
+  
+  public mutating func merge(_ other: SKEnergyGridReduction)
+  {
+    numberOfValues += other.numberOfValues
+    minimum = min(minimum, other.minimum)
+    boltzmannSum += other.boltzmannSum
+    numberOfValuesBelowThreshold += other.numberOfValuesBelowThreshold
+    for i in 0..<min(histogram.count, other.histogram.count)
+    {
+      histogram[i] += other.histogram[i]
+    }
+  }
+  
+  // Splits 'count' items (e.g. grid-lines) in chunks that are reduced in parallel by 'body' into partial reductions. The partial reductions are
+  // merged in order, so the result does not depend on the scheduling.
+  public mutating func accumulate(count: Int, _ body: (Range<Int>, inout SKEnergyGridReduction) -> Void)
+  {
+    let numberOfChunks: Int = min(count, 4 * ProcessInfo.processInfo.activeProcessorCount)
+    guard numberOfChunks > 0 else { return }
+    
+    var partials: [SKEnergyGridReduction] = [SKEnergyGridReduction](repeating: self.empty, count: numberOfChunks)
+    partials.withUnsafeMutableBufferPointer { partialsPtr in
+      let partial: UnsafeMutablePointer<SKEnergyGridReduction> = partialsPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: numberOfChunks) { chunk in
+        body((chunk * count / numberOfChunks)..<((chunk + 1) * count / numberOfChunks), &partial[chunk])
+      }
+    }
+    
+    for partial in partials
+    {
+      merge(partial)
+    }
+  }
+}
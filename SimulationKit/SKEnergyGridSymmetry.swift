@@ -0,0 +1,289 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+import SymmetryKit
+
+// Maps the points of an energy grid onto the symmetry-unique points. The grid uses the convention of 'ComputeEnergyGrid': point i is located at
+// fractional position i/(size-1), so the last point in each direction is the periodic image of the first one. Only the symmetry operations that map
+// the grid onto itself can be used (the translation must be a multiple of the grid spacing, and axes can only be interchanged when they have the
+// same number of points). These operations form a subgroup of the space group.
+// With 128 points there are 127 periodic points (a prime), so every centring-, screw- or glide-translation is rejected and at most the point
+// group remains. Grids that use the symmetry should therefore have a multiple of 24 periodic points (see 'symmetricGridSize'), which is divisible
+// by all the denominators (2, 3, 4, 6 and 8) of the translations of the space groups.
+// The stored space group of a structure is not guaranteed to describe its atoms (positions that are not symmetrized, or a reduced cell that
+// still carries a centred Hall number), so every operation is also checked against the atoms: it is only used when it maps each atom onto an
+// atom with the same potential parameters within 'tolerance' Angstrom. The operations that pass both tests still form a group.
+public struct SKEnergyGridSymmetry
+{
+  // the largest number of points not exceeding 'size' for which the number of periodic points is a multiple of 24 (for example 121 for 128)
+  public static func symmetricGridSize(_ size: Int) -> Int
+  {
+    guard size > 24 else { return size }
+    return 24 * ((size - 1) / 24) + 1
+  }
+  
+  public let dimensions: SIMD3<Int>
+  
+  // the symmetry operations of the space group that map the grid onto itself
+  public let numberOfOperations: Int
+  
+  // the indices (in the full grid) of the symmetry-unique grid points
+  public let uniqueGridPoints: [Int]
+  
+  // for each point of the full grid the index into 'uniqueGridPoints'
+  public let map: [Int32]
+  
+  // positions: the fractional positions of the atoms in the unit cell, potentialParameters: the parameters of the atoms (atoms can only be
+  // mapped onto atoms with identical parameters)
+  public init(dimensions: SIMD3<Int>, spaceGroup: SKSpacegroup, unitCell: double3x3, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], tolerance: Double = 0.05)
+  {
+    self.dimensions = dimensions
+    
+    // the number of periodic points in each direction
+    let periodic: SIMD3<Int> = SIMD3<Int>(max(1, dimensions.x - 1), max(1, dimensions.y - 1), max(1, dimensions.z - 1))
+    
+    let atoms: AtomBins = AtomBins(unitCell: unitCell, positions: positions, potentialParameters: potentialParameters, tolerance: tolerance)
+    
+    var operations: [(rotation: SKRotationMatrix, translation: SIMD3<Int>)] = []
+    for seitzMatrix in spaceGroup.seitzMatrices
+    {
+      if let translation: SIMD3<Int> = SKEnergyGridSymmetry.gridTranslation(seitzMatrix, periodic: periodic),
+         atoms.isInvariant(under: seitzMatrix)
+      {
+        operations.append((seitzMatrix.rotation, translation))
+      }
+    }
+    self.numberOfOperations = operations.count
+    
+    let numberOfPeriodicPoints: Int = periodic.x * periodic.y * periodic.z
+    var representative: [Int32] = [Int32](repeating: -1, count: numberOfPeriodicPoints)
+    var uniqueGridPoints: [Int] = []
+    
+    for k in 0..<periodic.z
+    {
+      for j in 0..<periodic.y
+      {
+        for i in 0..<periodic.x
+        {
+          let index: Int = i + periodic.x * (j + periodic.y * k)
+          if representative[index] < 0
+          {
+            let uniqueIndex: Int32 = Int32(uniqueGridPoints.count)
+            uniqueGridPoints.append(i + dimensions.x * (j + dimensions.y * k))
+            
+            // the operations form a group, so applying all of them gives the complete orbit
+            for operation in operations
+            {
+              let image: SIMD3<Int> = SKEnergyGridSymmetry.apply(operation, to: SIMD3<Int>(i,j,k), periodic: periodic)
+              let imageIndex: Int = image.x + periodic.x * (image.y + periodic.y * image.z)
+              if representative[imageIndex] < 0
+              {
+                representative[imageIndex] = uniqueIndex
+              }
+            }
+            representative[index] = uniqueIndex
+          }
+        }
+      }
+    }
+    self.uniqueGridPoints = uniqueGridPoints
+    
+    var map: [Int32] = [Int32](repeating: 0, count: dimensions.x * dimensions.y * dimensions.z)
+    for k in 0..<dimensions.z
+    {
+      for j in 0..<dimensions.y
+      {
+        for i in 0..<dimensions.x
+        {
+          map[i + dimensions.x * (j + dimensions.y * k)] = representative[(i % periodic.x) + periodic.x * ((j % periodic.y) + periodic.y * (k % periodic.z))]
+        }
+      }
+    }
+    self.map = map
+  }
+  
+  // returns the translation in grid-units, or nil when the operation does not map the grid onto itself
+  static func gridTranslation(_ seitzMatrix: SKSeitzMatrix, periodic: SIMD3<Int>) -> SIMD3<Int>?
+  {
+    for column in 0..<3
+    {
+      for row in 0..<3 where column != row
+      {
+        if seitzMatrix.rotation[column, row] != 0 && periodic[column] != periodic[row]
+        {
+          return nil
+        }
+      }
+    }
+    
+    var translation: SIMD3<Int> = SIMD3<Int>(0,0,0)
+    for row in 0..<3
+    {
+      let value: Double = seitzMatrix.translation[row] * Double(periodic[row])
+      if fabs(value - rint(value)) > 1e-6
+      {
+        return nil
+      }
+      translation[row] = Int(rint(value))
+    }
+    return translation
+  }
+  
+  // The atoms binned on their fractional positions in bins at least 'tolerance' wide, to find the atom at the image of a position.
+  struct AtomBins
+  {
+    let unitCell: double3x3
+    let positions: [SIMD3<Double>]
+    let potentialParameters: [SIMD2<Double>]
+    let tolerance: Double
+    let numberOfBins: SIMD3<Int>
+    var bins: [Int: [Int]] = [:]
+    
+    init(unitCell: double3x3, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], tolerance: Double)
+    {
+      self.unitCell = unitCell
+      self.positions = positions.map{$0 - floor($0)}
+      self.potentialParameters = potentialParameters
+      self.tolerance = tolerance
+      
+      let perpendicularWidths: SIMD3<Double> = SKCell(unitCell: unitCell).perpendicularWidths
+      var numberOfBins: SIMD3<Int> = SIMD3<Int>(1, 1, 1)
+      for k in 0..<3 where perpendicularWidths[k].isFinite && perpendicularWidths[k] > tolerance
+      {
+        numberOfBins[k] = max(1, min(Int(perpendicularWidths[k] / tolerance), 256))
+      }
+      self.numberOfBins = numberOfBins
+      
+      for (index, position) in self.positions.enumerated()
+      {
+        bins[binIndex(bin(position)), default: []].append(index)
+      }
+    }
+    
+    func bin(_ position: SIMD3<Double>) -> SIMD3<Int>
+    {
+      var k: SIMD3<Int> = SIMD3<Int>(0, 0, 0)
+      for d in 0..<3 where position[d].isFinite
+      {
+        k[d] = min(max(Int(position[d] * Double(numberOfBins[d])), 0), numberOfBins[d] - 1)
+      }
+      return k
+    }
+    
+    func binIndex(_ k: SIMD3<Int>) -> Int
+    {
+      return k.x + numberOfBins.x * (k.y + numberOfBins.y * k.z)
+    }
+    
+    // whether there is an atom with the given parameters within the tolerance of the fractional position (minimum image)
+    func contains(_ position: SIMD3<Double>, potentialParameters parameters: SIMD2<Double>) -> Bool
+    {
+      let wrapped: SIMD3<Double> = position - floor(position)
+      let center: SIMD3<Int> = bin(wrapped)
+      
+      // with less than three bins in a direction all bins are visited
+      func offsets(_ n: Int) -> [Int]
+      {
+        return n >= 3 ? [-1, 0, 1] : Array(0..<n)
+      }
+      for k3 in offsets(numberOfBins.z)
+      {
+        for k2 in offsets(numberOfBins.y)
+        {
+          for k1 in offsets(numberOfBins.x)
+          {
+            var k: SIMD3<Int> = SIMD3<Int>(numberOfBins.x >= 3 ? center.x + k1 : k1,
+                                           numberOfBins.y >= 3 ? center.y + k2 : k2,
+                                           numberOfBins.z >= 3 ? center.z + k3 : k3)
+            k = (k &+ numberOfBins) % numberOfBins
+            for index in bins[binIndex(k)] ?? []
+            {
+              var ds: SIMD3<Double> = positions[index] - wrapped
+              ds -= ds.rounded(.toNearestOrEven)
+              if potentialParameters[index] == parameters && simd_length(unitCell * ds) < tolerance
+              {
+                return true
+              }
+            }
+          }
+        }
+      }
+      return false
+    }
+    
+    // whether the operation maps every atom onto an atom with the same parameters
+    func isInvariant(under seitzMatrix: SKSeitzMatrix) -> Bool
+    {
+      for (index, position) in positions.enumerated()
+      {
+        var image: SIMD3<Double> = seitzMatrix.translation
+        for column in 0..<3
+        {
+          for row in 0..<3
+          {
+            image[row] += Double(seitzMatrix.rotation[column, row]) * position[column]
+          }
+        }
+        if !contains(image, potentialParameters: potentialParameters[index])
+        {
+          return false
+        }
+      }
+      return true
+    }
+  }
+  
+  static func apply(_ operation: (rotation: SKRotationMatrix, translation: SIMD3<Int>), to point: SIMD3<Int>, periodic: SIMD3<Int>) -> SIMD3<Int>
+  {
+    var image: SIMD3<Int> = operation.translation
+    for column in 0..<3
+    {
+      for row in 0..<3
+      {
+        image[row] += Int(operation.rotation[column, row]) * point[column]
+      }
+    }
+    
+    // wrap back into the periodic grid
+    return SIMD3<Int>(((image.x % periodic.x) + periodic.x) % periodic.x,
+                      ((image.y % periodic.y) + periodic.y) % periodic.y,
+                      ((image.z % periodic.z) + periodic.z) % periodic.z)
+  }
+  
+  // fills the full grid from the values computed at the symmetry-unique grid points
+  public func expand(_ values: [Float]) -> [Float]
+  {
+    guard values.count == uniqueGridPoints.count else { return [] }
+    return map.map{values[Int($0)]}
+  }
+}
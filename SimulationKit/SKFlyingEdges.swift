@@ -0,0 +1,398 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+
+// Flying-edges extraction (Schroeder, Maynard and Geveci) of the iso-surfaces of several iso-values in one sweep over the voxels. The grid
+// rows along x are processed independently, and in every pass the rows around a row are loaded once into a window that all iso-values share:
+//  1. per row of grid points: the number of crossed x-, y- and z-edges that start in the row, and the trim (the first and last crossed
+//     x-edge); outside the trims of its four rows a row of cubes is empty, unless the rows differ in sign there,
+//  2. per row of cubes: the number of triangles within the trimmed range,
+//  3. prefix sums over the rows give the first vertex and the first triangle of each row,
+//  4. the vertices of each row and the triangles of each row of cubes are written in parallel; the vertex of a cube edge follows from running
+//     counters of the crossed edges along the four rows, so no vertex cache or search is needed.
+// The conventions of 'SKCPUMarchingCubes' are used (periodic grid of arbitrary dimensions, the same triangle-table and orientation), each
+// iso-value gives an indexed mesh in the layout of 'SKIsoSurfaceMesh'.
+public class SKFlyingEdges
+{
+  public var dimensions: SIMD3<Int> = SIMD3<Int>(0,0,0)
+  
+  public init(dimensions: SIMD3<Int32>)
+  {
+    self.dimensions = SIMD3<Int>(truncatingIfNeeded: dimensions)
+  }
+  
+  struct Row
+  {
+    var numberOfEdges: SIMD3<Int> = SIMD3<Int>(0, 0, 0)
+    var trim: (first: Int, last: Int) = (Int.max, -1)
+    var firstVertex: Int = 0
+  }
+  
+  struct CubeRow
+  {
+    var range: ClosedRange<Int>? = nil
+    var numberOfTriangles: Int = 0
+    var firstTriangle: Int = 0
+  }
+  
+  // The rows of grid points around the current row, loaded once and shared by all iso-values. The rows are offset by dy and dz (-1...2)
+  // and contain the periodic values at x = -1...N+1 (the value at x is stored at index x + 1).
+  struct RowWindow
+  {
+    let dimensions: SIMD3<Int>
+    let stride: Int
+    let values: UnsafeMutablePointer<Float>
+    
+    // the rows of the four corners of a row of cubes, and the rows needed for the central differences at the edges of a row of grid points
+    static let cubeRows: [SIMD2<Int>] = [SIMD2<Int>(0, 0), SIMD2<Int>(1, 0), SIMD2<Int>(0, 1), SIMD2<Int>(1, 1)]
+    static let edgeRows: [SIMD2<Int>] = [SIMD2<Int>(0, 0), SIMD2<Int>(-1, 0), SIMD2<Int>(1, 0), SIMD2<Int>(2, 0), SIMD2<Int>(0, -1),
+                                         SIMD2<Int>(1, -1), SIMD2<Int>(0, 1), SIMD2<Int>(-1, 1), SIMD2<Int>(1, 1), SIMD2<Int>(0, 2)]
+    
+    init(dimensions: SIMD3<Int>)
+    {
+      self.dimensions = dimensions
+      self.stride = dimensions.x + 3
+      self.values = UnsafeMutablePointer<Float>.allocate(capacity: 16 * stride)
+    }
+    
+    func deallocate()
+    {
+      values.deallocate()
+    }
+    
+    func load(_ offsets: [SIMD2<Int>], y: Int, z: Int, voxels: UnsafeBufferPointer<Float>)
+    {
+      let n: SIMD3<Int> = dimensions
+      for offset in offsets
+      {
+        let row: UnsafeMutablePointer<Float> = values + (offset.x + 1 + 4 * (offset.y + 1)) * stride
+        let start: Int = n.x * (((y + offset.x) % n.y + n.y) % n.y + n.y * (((z + offset.y) % n.z + n.z) % n.z))
+        for x in 0..<n.x
+        {
+          row[x + 1] = voxels[start + x]
+        }
+        row[0] = row[n.x]
+        row[n.x + 1] = row[1]
+        row[n.x + 2] = row[1 + 1 % n.x]
+      }
+    }
+    
+    @inline(__always)
+    func value(_ x: Int, _ dy: Int, _ dz: Int) -> Float
+    {
+      return values[(dy + 1 + 4 * (dz + 1)) * stride + x + 1]
+    }
+    
+    // the (unnormalized) normal, as in 'SKCPUMarchingCubes.centralDifference'
+    @inline(__always)
+    func centralDifference(_ x: Int, _ dy: Int, _ dz: Int) -> SIMD3<Float>
+    {
+      return SIMD3<Float>(-value(x + 1, dy, dz) + value(x - 1, dy, dz),
+                          -value(x, dy + 1, dz) + value(x, dy - 1, dz),
+                          -value(x, dy, dz + 1) + value(x, dy, dz - 1))
+    }
+    
+    // the cube-index of 'SKCPUMarchingCubes.cubeIndex' for the cube at x of the row of cubes
+    @inline(__always)
+    func cubeIndex(_ x: Int, isoValue: Float) -> Int
+    {
+      var cubeIndex: Int = value(x, 0, 0) > isoValue ? 1 : 0
+      cubeIndex |= (value(x + 1, 0, 0) > isoValue ? 1 : 0) << 1
+      cubeIndex |= (value(x + 1, 0, 1) > isoValue ? 1 : 0) << 2
+      cubeIndex |= (value(x, 0, 1) > isoValue ? 1 : 0) << 3
+      cubeIndex |= (value(x, 1, 0) > isoValue ? 1 : 0) << 4
+      cubeIndex |= (value(x + 1, 1, 0) > isoValue ? 1 : 0) << 5
+      cubeIndex |= (value(x + 1, 1, 1) > isoValue ? 1 : 0) << 6
+      cubeIndex |= (value(x, 1, 1) > isoValue ? 1 : 0) << 7
+      return cubeIndex
+    }
+    
+    // whether the edge along 'axis' that starts at x in the row (dy, dz) is crossed
+    @inline(__always)
+    func isCrossed(_ x: Int, _ dy: Int, _ dz: Int, axis: Int, isoValue: Float) -> Bool
+    {
+      let value1: Float = axis == 0 ? value(x + 1, dy, dz) : (axis == 1 ? value(x, dy + 1, dz) : value(x, dy, dz + 1))
+      return (value(x, dy, dz) > isoValue) != (value1 > isoValue)
+    }
+  }
+  
+  public func isoSurfaces(_ voxels: [Float], isoValues: [Float]) -> [SKIsoSurfaceMesh]
+  {
+    let n: SIMD3<Int> = dimensions
+    guard n.x > 0, n.y > 0, n.z > 0, voxels.count >= n.x * n.y * n.z, !isoValues.isEmpty else
+    {
+      return isoValues.map{_ in SKIsoSurfaceMesh()}
+    }
+    
+    // rows of grid points (0...N along y and z, the last is the periodic image of the first), rows of cubes (0..<N)
+    let numberOfIsoValues: Int = isoValues.count
+    let numberOfRows: Int = (n.y + 1) * (n.z + 1)
+    let numberOfCubeRows: Int = n.y * n.z
+    func row(_ y: Int, _ z: Int) -> Int
+    {
+      return y + (n.y + 1) * z
+    }
+    
+    var rows: [Row] = [Row](repeating: Row(), count: numberOfIsoValues * numberOfRows)
+    var cubeRows: [CubeRow] = [CubeRow](repeating: CubeRow(), count: numberOfIsoValues * numberOfCubeRows)
+    
+    // the meshes of all iso-values are written into one vertex- and index-array, starting at 'firstVertex[l]' and 'firstIndex[l]'
+    var vertices: [SIMD4<Float>] = []
+    var indices: [UInt32] = []
+    var firstVertex: [Int] = [Int](repeating: 0, count: numberOfIsoValues + 1)
+    var firstIndex: [Int] = [Int](repeating: 0, count: numberOfIsoValues + 1)
+    
+    voxels.withUnsafeBufferPointer { voxelsPtr in
+      // pass 1: the crossed edges per row and iso-value
+      rows.withUnsafeMutableBufferPointer { rowsPtr in
+        let rows: UnsafeMutablePointer<Row> = rowsPtr.baseAddress!
+        DispatchQueue.concurrentPerform(iterations: n.z + 1) { z in
+          let window: RowWindow = RowWindow(dimensions: n)
+          defer { window.deallocate() }
+          
+          for y in 0...n.y
+          {
+            window.load([SIMD2<Int>(0, 0), SIMD2<Int>(1, 0), SIMD2<Int>(0, 1)], y: y, z: z, voxels: voxelsPtr)
+            for (l, isoValue) in isoValues.enumerated()
+            {
+              var info: Row = Row()
+              for x in 0...n.x
+              {
+                let above: Bool = window.value(x, 0, 0) > isoValue
+                if x < n.x && (window.value(x + 1, 0, 0) > isoValue) != above
+                {
+                  info.numberOfEdges.x += 1
+                  info.trim = (min(info.trim.first, x), x)
+                }
+                if y < n.y && (window.value(x, 1, 0) > isoValue) != above
+                {
+                  info.numberOfEdges.y += 1
+                }
+                if z < n.z && (window.value(x, 0, 1) > isoValue) != above
+                {
+                  info.numberOfEdges.z += 1
+                }
+              }
+              rows[l * numberOfRows + row(y, z)] = info
+            }
+          }
+        }
+      }
+      
+      // pass 2: the range of cubes that can contain triangles and the number of triangles, per row of cubes and iso-value
+      cubeRows.withUnsafeMutableBufferPointer { cubeRowsPtr in
+        let cubeRows: UnsafeMutablePointer<CubeRow> = cubeRowsPtr.baseAddress!
+        DispatchQueue.concurrentPerform(iterations: n.z) { z in
+          let window: RowWindow = RowWindow(dimensions: n)
+          defer { window.deallocate() }
+          
+          for y in 0..<n.y
+          {
+            window.load(RowWindow.cubeRows, y: y, z: z, voxels: voxelsPtr)
+            for (l, isoValue) in isoValues.enumerated()
+            {
+              // outside the trims the rows are constant, the cubes there are only cut when the rows differ in sign
+              let signsAtStart: Int = RowWindow.cubeRows.reduce(0){$0 + (window.value(0, $1.x, $1.y) > isoValue ? 1 : 0)}
+              let signsAtEnd: Int = RowWindow.cubeRows.reduce(0){$0 + (window.value(n.x, $1.x, $1.y) > isoValue ? 1 : 0)}
+              var range: ClosedRange<Int>? = nil
+              if signsAtStart % 4 != 0 || signsAtEnd % 4 != 0
+              {
+                range = 0...(n.x - 1)
+              }
+              else
+              {
+                var first: Int = Int.max
+                var last: Int = -1
+                for offset in RowWindow.cubeRows
+                {
+                  let trim: (first: Int, last: Int) = rows[l * numberOfRows + row(y + offset.x, z + offset.y)].trim
+                  first = min(first, trim.first)
+                  last = max(last, trim.last)
+                }
+                if first <= last
+                {
+                  range = first...last
+                }
+              }
+              
+              var info: CubeRow = CubeRow(range: range, numberOfTriangles: 0, firstTriangle: 0)
+              if let range = range
+              {
+                for x in range
+                {
+                  info.numberOfTriangles += Int(SKCPUMarchingCubes.numberOfTriangles[window.cubeIndex(x, isoValue: isoValue)])
+                }
+              }
+              cubeRows[l * numberOfCubeRows + y + n.y * z] = info
+            }
+          }
+        }
+      }
+      
+      // pass 3: prefix sums
+      for l in 0..<numberOfIsoValues
+      {
+        var numberOfVertices: Int = 0
+        for index in (l * numberOfRows)..<((l + 1) * numberOfRows)
+        {
+          rows[index].firstVertex = numberOfVertices
+          numberOfVertices += rows[index].numberOfEdges.x + rows[index].numberOfEdges.y + rows[index].numberOfEdges.z
+        }
+        var numberOfTriangles: Int = 0
+        for index in (l * numberOfCubeRows)..<((l + 1) * numberOfCubeRows)
+        {
+          cubeRows[index].firstTriangle = numberOfTriangles
+          numberOfTriangles += cubeRows[index].numberOfTriangles
+        }
+        firstVertex[l + 1] = firstVertex[l] + 2 * numberOfVertices
+        firstIndex[l + 1] = firstIndex[l] + 3 * numberOfTriangles
+      }
+      
+      // pass 4: the vertices and triangles of all iso-values, per row
+      vertices = [SIMD4<Float>](repeating: SIMD4<Float>(0.0, 0.0, 0.0, 0.0), count: firstVertex[numberOfIsoValues])
+      vertices.withUnsafeMutableBufferPointer { verticesPtr in
+        let vertices: UnsafeMutablePointer<SIMD4<Float>> = verticesPtr.baseAddress!
+        DispatchQueue.concurrentPerform(iterations: n.z + 1) { z in
+          let window: RowWindow = RowWindow(dimensions: n)
+          defer { window.deallocate() }
+          
+          for y in 0...n.y
+          {
+            window.load(RowWindow.edgeRows, y: y, z: z, voxels: voxelsPtr)
+            for (l, isoValue) in isoValues.enumerated()
+            {
+              // the x-edges, y-edges and z-edges of the row, in the order in which they were counted
+              var index: Int = rows[l * numberOfRows + row(y, z)].firstVertex
+              for axis in 0..<3 where axis == 0 || (axis == 1 && y < n.y) || (axis == 2 && z < n.z)
+              {
+                let dy: Int = axis == 1 ? 1 : 0
+                let dz: Int = axis == 2 ? 1 : 0
+                let dx: Int = axis == 0 ? 1 : 0
+                for x in 0...n.x where axis > 0 || x < n.x
+                {
+                  let value0: Float = window.value(x, 0, 0)
+                  let value1: Float = window.value(x + dx, dy, dz)
+                  guard (value1 > isoValue) != (value0 > isoValue) else { continue }
+                  
+                  let diff: Float = (isoValue - value0) / (value1 - value0)
+                  let normal0: SIMD3<Float> = window.centralDifference(x, 0, 0)
+                  let normal1: SIMD3<Float> = window.centralDifference(x + dx, dy, dz)
+                  var position: SIMD3<Float> = SIMD3<Float>(Float(x), Float(y), Float(z))
+                  position[axis] += diff
+                  let vertex: UnsafeMutablePointer<SIMD4<Float>> = vertices + firstVertex[l] + 2 * index
+                  vertex[0] = SIMD4<Float>(position / SIMD3<Float>(n), 1.0)
+                  vertex[1] = SIMD4<Float>(simd_normalize(normal0 + (normal1 - normal0) * diff), 0.0)
+                  index += 1
+                }
+              }
+            }
+          }
+        }
+      }
+      
+      indices = [UInt32](repeating: 0, count: firstIndex[numberOfIsoValues])
+      indices.withUnsafeMutableBufferPointer { indicesPtr in
+        let indices: UnsafeMutablePointer<UInt32> = indicesPtr.baseAddress!
+        DispatchQueue.concurrentPerform(iterations: n.z) { z in
+          let window: RowWindow = RowWindow(dimensions: n)
+          defer { window.deallocate() }
+          
+          for y in 0..<n.y
+          {
+            window.load(RowWindow.cubeRows, y: y, z: z, voxels: voxelsPtr)
+            for (l, isoValue) in isoValues.enumerated()
+            {
+              let cubeRow: CubeRow = cubeRows[l * numberOfCubeRows + y + n.y * z]
+              guard let range = cubeRow.range, cubeRow.numberOfTriangles > 0 else { continue }
+              
+              // the four rows of grid points (indexed by dy + 2 dz), the first vertex of their x-, y- and z-edges
+              var firstEdge: [SIMD3<Int>] = [SIMD3<Int>](repeating: SIMD3<Int>(0, 0, 0), count: 4)
+              for neighbour in 0..<4
+              {
+                let info: Row = rows[l * numberOfRows + row(y + neighbour % 2, z + neighbour / 2)]
+                firstEdge[neighbour] = SIMD3<Int>(info.firstVertex, info.firstVertex + info.numberOfEdges.x, info.firstVertex + info.numberOfEdges.x + info.numberOfEdges.y)
+              }
+              
+              // the running counts of the crossed edges before the current cube (zero at the start of the range)
+              var counts: [SIMD3<Int>] = [SIMD3<Int>](repeating: SIMD3<Int>(0, 0, 0), count: 4)
+              
+              let output: UnsafeMutablePointer<UInt32> = indices + firstIndex[l]
+              var triangle: Int = cubeRow.firstTriangle
+              for x in range
+              {
+                let cubeIndex: Int = window.cubeIndex(x, isoValue: isoValue)
+                for i in 0..<(3 * Int(SKCPUMarchingCubes.numberOfTriangles[cubeIndex]))
+                {
+                  let edge: Int = Int(SKCPUMarchingCubes.triTable[cubeIndex * 16 + i])
+                  let lower: SIMD3<Int> = simd_min(SKCPUMarchingCubes.edgeOffsets[edge].0, SKCPUMarchingCubes.edgeOffsets[edge].1)
+                  let difference: SIMD3<Int> = SKCPUMarchingCubes.edgeOffsets[edge].1 &- SKCPUMarchingCubes.edgeOffsets[edge].0
+                  let axis: Int = difference.x != 0 ? 0 : (difference.y != 0 ? 1 : 2)
+                  let neighbour: Int = lower.y + 2 * lower.z
+                  
+                  // an edge at x + 1 comes after the edge at x, when that one is crossed
+                  var vertex: Int = firstEdge[neighbour][axis] + counts[neighbour][axis]
+                  if lower.x == 1 && window.isCrossed(x, lower.y, lower.z, axis: axis, isoValue: isoValue)
+                  {
+                    vertex += 1
+                  }
+                  
+                  // reversed order within a triangle, as in the triangle soup
+                  output[3 * triangle + 2 - i % 3] = UInt32(vertex)
+                  if i % 3 == 2
+                  {
+                    triangle += 1
+                  }
+                }
+                
+                for neighbour in 0..<4
+                {
+                  for axis in 0..<3 where (axis == 0) || (axis == 1 && neighbour % 2 == 0) || (axis == 2 && neighbour / 2 == 0)
+                  {
+                    if window.isCrossed(x, neighbour % 2, neighbour / 2, axis: axis, isoValue: isoValue)
+                    {
+                      counts[neighbour][axis] += 1
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+    
+    return (0..<numberOfIsoValues).map{l in
+      SKIsoSurfaceMesh(vertices: Array(vertices[firstVertex[l]..<firstVertex[l + 1]]), indices: Array(indices[firstIndex[l]..<firstIndex[l + 1]]))
+    }
+  }
+}
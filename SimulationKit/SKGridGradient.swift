@@ -0,0 +1,106 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+
+// Builds the value/gradient data of the 3D-textures used for volume rendering. The grids have x varying the fastest, and the result is stored
+// in a cube of size 'cubeSize' with the same layout (the part outside the grid is zero).
+public struct SKGridGradient
+{
+  // Central-difference gradients (per grid-spacing, periodic), the grid-lines along x are processed in parallel.
+  public static func valuesAndGradients(_ values: [Float], dimensions: SIMD3<Int32>, cubeSize: Int) -> [SIMD4<Float>]
+  {
+    let nx: Int = Int(dimensions.x)
+    let ny: Int = Int(dimensions.y)
+    let nz: Int = Int(dimensions.z)
+    
+    var output: [SIMD4<Float>] = [SIMD4<Float>](repeating: SIMD4<Float>(0.0,0.0,0.0,0.0), count: cubeSize * cubeSize * cubeSize)
+    guard nx > 0, ny > 0, nz > 0, nx <= cubeSize, ny <= cubeSize, nz <= cubeSize, values.count >= nx * ny * nz else { return output }
+    
+    values.withUnsafeBufferPointer { valuesPtr in
+      let v: UnsafePointer<Float> = valuesPtr.baseAddress!
+      output.withUnsafeMutableBufferPointer { outputPtr in
+        let out: UnsafeMutablePointer<SIMD4<Float>> = outputPtr.baseAddress!
+        
+        DispatchQueue.concurrentPerform(iterations: ny * nz) { line in
+          let y: Int = line % ny
+          let z: Int = line / ny
+          
+          let current: UnsafePointer<Float> = v + nx * (y + ny * z)
+          let previousY: UnsafePointer<Float> = v + nx * ((y - 1 + ny) % ny + ny * z)
+          let nextY: UnsafePointer<Float> = v + nx * ((y + 1) % ny + ny * z)
+          let previousZ: UnsafePointer<Float> = v + nx * (y + ny * ((z - 1 + nz) % nz))
+          let nextZ: UnsafePointer<Float> = v + nx * (y + ny * ((z + 1) % nz))
+          let destination: UnsafeMutablePointer<SIMD4<Float>> = out + cubeSize * (y + cubeSize * z)
+          
+          for x in 0..<nx
+          {
+            let previousX: Int = (x == 0) ? nx - 1 : x - 1
+            let nextX: Int = (x == nx - 1) ? 0 : x + 1
+            destination[x] = SIMD4<Float>(current[x],
+                                          0.5 * (current[nextX] - current[previousX]),
+                                          0.5 * (nextY[x] - previousY[x]),
+                                          0.5 * (nextZ[x] - previousZ[x]))
+          }
+        }
+      }
+    }
+    return output
+  }
+  
+  // places the values with given gradients (e.g. analytic gradients from the grid-engine) in the cube
+  public static func valuesAndGradients(_ values: [Float], gradients: [SIMD3<Float>], dimensions: SIMD3<Int32>, cubeSize: Int) -> [SIMD4<Float>]
+  {
+    let nx: Int = Int(dimensions.x)
+    let ny: Int = Int(dimensions.y)
+    let nz: Int = Int(dimensions.z)
+    
+    var output: [SIMD4<Float>] = [SIMD4<Float>](repeating: SIMD4<Float>(0.0,0.0,0.0,0.0), count: cubeSize * cubeSize * cubeSize)
+    guard nx > 0, ny > 0, nz > 0, nx <= cubeSize, ny <= cubeSize, nz <= cubeSize, values.count >= nx * ny * nz, gradients.count >= nx * ny * nz else { return output }
+    
+    output.withUnsafeMutableBufferPointer { outputPtr in
+      let out: UnsafeMutablePointer<SIMD4<Float>> = outputPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: ny * nz) { line in
+        let y: Int = line % ny
+        let z: Int = line / ny
+        let source: Int = nx * (y + ny * z)
+        let destination: UnsafeMutablePointer<SIMD4<Float>> = out + cubeSize * (y + cubeSize * z)
+        for x in 0..<nx
+        {
+          let gradient: SIMD3<Float> = gradients[source + x]
+          destination[x] = SIMD4<Float>(values[source + x], gradient.x, gradient.y, gradient.z)
+        }
+      }
+    }
+    return output
+  }
+}
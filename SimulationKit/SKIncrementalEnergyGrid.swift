@@ -0,0 +1,229 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+import Metal
+import SymmetryKit
+
+// Keeps the last computed energy grid of a structure, so that after a local edit (moving, adding or deleting a few atoms) only the grid
+// points within the cutoff of the changed atoms have to be updated (see 'SKCPUFramework.UpdateEnergyGrid'). The grids of all structures are
+// kept in one shared cache of bounded size, so the grids of structures that are not edited are discarded when memory is needed.
+public class SKIncrementalEnergyGrid
+{
+  // beyond this number of changed atoms a full recomputation of the grid is preferred
+  public var maximumNumberOfChanges: Int = 256
+  
+  // the total size in bytes of the stored grids of all structures
+  public static var totalCostLimit: Int = 512 * 1024 * 1024
+  {
+    didSet
+    {
+      cache.totalCostLimit = totalCostLimit
+    }
+  }
+  
+  static let cache: NSCache<SKIncrementalEnergyGrid, Entry> =
+  {
+    let cache: NSCache<SKIncrementalEnergyGrid, Entry> = NSCache<SKIncrementalEnergyGrid, Entry>()
+    cache.totalCostLimit = totalCostLimit
+    return cache
+  }()
+  
+  struct Atom: Hashable
+  {
+    var position: SIMD3<Double>
+    var potentialParameters: SIMD2<Double>
+  }
+  
+  final class Entry
+  {
+    let unitCell: double3x3
+    let probeParameter: SIMD2<Double>
+    let dimensions: SIMD3<Int>
+    let atoms: [Atom]
+    let grid: [Float]
+    
+    init(unitCell: double3x3, probeParameter: SIMD2<Double>, dimensions: SIMD3<Int>, atoms: [Atom], grid: [Float])
+    {
+      self.unitCell = unitCell
+      self.probeParameter = probeParameter
+      self.dimensions = dimensions
+      self.atoms = atoms
+      self.grid = grid
+    }
+    
+    var cost: Int
+    {
+      return grid.count * MemoryLayout<Float>.stride + atoms.count * MemoryLayout<Atom>.stride
+    }
+  }
+  
+  public init()
+  {
+  }
+  
+  deinit
+  {
+    SKIncrementalEnergyGrid.cache.removeObject(forKey: self)
+  }
+  
+  public func store(grid: [Float], unitCell: double3x3, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], probeParameter: SIMD2<Double>, dimensions: SIMD3<Int>)
+  {
+    let entry: Entry = Entry(unitCell: unitCell, probeParameter: probeParameter, dimensions: dimensions, atoms: zip(positions, potentialParameters).map{Atom(position: $0, potentialParameters: $1)}, grid: grid)
+    SKIncrementalEnergyGrid.cache.setObject(entry, forKey: self, cost: entry.cost)
+  }
+  
+  public func removeAll()
+  {
+    SKIncrementalEnergyGrid.cache.removeObject(forKey: self)
+  }
+  
+  // Returns the grid for the given structure by updating the stored grid, or nil when the cell, probe or grid size differ or when too many
+  // atoms have changed. The updated grid replaces the stored one.
+  public func update(unitCell: double3x3, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], probeParameter: SIMD2<Double>, dimensions: SIMD3<Int>, numberOfReplicas: SIMD3<Int32>) -> [Float]?
+  {
+    guard let entry: Entry = SKIncrementalEnergyGrid.cache.object(forKey: self),
+          !entry.grid.isEmpty,
+          unitCell == entry.unitCell,
+          probeParameter == entry.probeParameter,
+          dimensions == entry.dimensions,
+          abs(positions.count - entry.atoms.count) <= maximumNumberOfChanges else { return nil }
+    
+    // the difference of the old and new atoms as multisets (the order of the atoms may change by insertions and deletions)
+    var counts: [Atom: Int] = [:]
+    for atom in entry.atoms
+    {
+      counts[atom, default: 0] -= 1
+    }
+    for atom in zip(positions, potentialParameters).map({Atom(position: $0, potentialParameters: $1)})
+    {
+      counts[atom, default: 0] += 1
+    }
+    
+    var removed: (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>]) = ([], [])
+    var added: (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>]) = ([], [])
+    for (atom, count) in counts where count != 0
+    {
+      for _ in 0..<abs(count)
+      {
+        if count < 0
+        {
+          removed.positions.append(atom.position)
+          removed.potentialParameters.append(atom.potentialParameters)
+        }
+        else
+        {
+          added.positions.append(atom.position)
+          added.potentialParameters.append(atom.potentialParameters)
+        }
+      }
+    }
+    
+    guard removed.positions.count + added.positions.count <= maximumNumberOfChanges else { return nil }
+    
+    var updatedGrid: [Float] = entry.grid
+    let framework: SKCPUFramework = SKCPUFramework(positions: positions, potentialParameters: potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas)
+    guard framework.UpdateEnergyGrid(&updatedGrid, sizeX: dimensions.x, sizeY: dimensions.y, sizeZ: dimensions.z, probeParameter: probeParameter, removed: removed, added: added) else { return nil }
+    
+    store(grid: updatedGrid, unitCell: unitCell, positions: positions, potentialParameters: potentialParameters, probeParameter: probeParameter, dimensions: dimensions)
+    return updatedGrid
+  }
+  
+  // The energy grid (and optionally the analytic gradients) of a structure on a cubic grid of the given size: read from the on-disk cache,
+  // updated from the stored grid after a local edit, or computed (on the GPU when a Metal-device is available). Without gradients the
+  // symmetry of the space group is used.
+  public func energyGrid(unitCell: double3x3, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], probeParameter: SIMD2<Double>, size: Int, spaceGroup: SKSpacegroup, withGradient: Bool) -> (energies: [Float], gradients: [SIMD3<Float>]?)
+  {
+    let dimensions: SIMD3<Int> = SIMD3<Int>(size, size, size)
+    let numberOfReplicas: SIMD3<Int32> = SKCell(unitCell: unitCell).numberOfReplicas(forCutoff: 12.0)
+    
+    // grids computed before (in this or an earlier session) are read from the on-disk cache
+    let cacheKey: String = SKEnergyGridCache.key(unitCell: unitCell, positions: positions, potentialParameters: potentialParameters, probeParameters: probeParameter, dimensions: dimensions)
+    let cachedGradients: [SIMD3<Float>]? = withGradient ? SKEnergyGridCache.shared.gradients(forKey: cacheKey) : nil
+    if let data: [Float] = SKEnergyGridCache.shared.grid(forKey: cacheKey),
+       data.count == size * size * size,
+       !withGradient || cachedGradients?.count == data.count
+    {
+      store(grid: data, unitCell: unitCell, positions: positions, potentialParameters: potentialParameters, probeParameter: probeParameter, dimensions: dimensions)
+      return (data, cachedGradients)
+    }
+    
+    // after a local edit only the grid points near the changed atoms are updated
+    if !withGradient,
+       let data: [Float] = update(unitCell: unitCell, positions: positions, potentialParameters: potentialParameters, probeParameter: probeParameter, dimensions: dimensions, numberOfReplicas: numberOfReplicas)
+    {
+      SKEnergyGridCache.shared.store(grid: data, forKey: cacheKey)
+      return (data, nil)
+    }
+    
+    let data: [Float]
+    var gradients: [SIMD3<Float>]? = nil
+    if let device: MTLDevice = MTLCreateSystemDefaultDevice(),
+       let commandQueue: MTLCommandQueue = device.makeCommandQueue()
+    {
+      let framework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: positions, potentialParameters: potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas)
+      if withGradient
+      {
+        let dataWithGradients: [SIMD4<Float>] = framework.ComputeEnergyGridWithGradient(size, sizeY: size, sizeZ: size, probeParameter: probeParameter)
+        data = dataWithGradients.map{$0.x}
+        gradients = dataWithGradients.map{SIMD3<Float>($0.y, $0.z, $0.w)}
+      }
+      else
+      {
+        data = framework.ComputeEnergyGrid(size, sizeY: size, sizeZ: size, probeParameter: probeParameter, spaceGroup: spaceGroup)
+      }
+    }
+    else
+    {
+      // no Metal-device available: compute the energy grid on the CPU
+      let framework: SKCPUFramework = SKCPUFramework(positions: positions, potentialParameters: potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas)
+      if withGradient
+      {
+        let dataWithGradients: [SIMD4<Float>] = framework.ComputeEnergyGridWithGradient(size, sizeY: size, sizeZ: size, probeParameter: probeParameter)
+        data = dataWithGradients.map{$0.x}
+        gradients = dataWithGradients.map{SIMD3<Float>($0.y, $0.z, $0.w)}
+      }
+      else
+      {
+        data = framework.ComputeEnergyGrid(size, sizeY: size, sizeZ: size, probeParameter: probeParameter, spaceGroup: spaceGroup)
+      }
+    }
+    
+    SKEnergyGridCache.shared.store(grid: data, forKey: cacheKey)
+    if let gradients: [SIMD3<Float>] = gradients
+    {
+      SKEnergyGridCache.shared.store(gradients: gradients, forKey: cacheKey)
+    }
+    store(grid: data, unitCell: unitCell, positions: positions, potentialParameters: potentialParameters, probeParameter: probeParameter, dimensions: dimensions)
+    return (data, gradients)
+  }
+}
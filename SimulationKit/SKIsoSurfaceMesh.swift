@@ -0,0 +1,102 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+
+// An indexed iso-surface: every vertex is stored once (a position in fractional coordinates with w = 1, followed by the normal with w = 0) and
+// the triangles refer to the vertices by index, three indices per triangle. Compared to the triangle soup of the marching cubes (3 * 3 float4
+// per triangle) this takes roughly a third of the memory, because on average each vertex is shared by six triangles.
+public struct SKIsoSurfaceMesh
+{
+  public var vertices: [SIMD4<Float>] = []
+  public var indices: [UInt32] = []
+  
+  public init()
+  {
+  }
+  
+  public init(vertices: [SIMD4<Float>], indices: [UInt32])
+  {
+    self.vertices = vertices
+    self.indices = indices
+  }
+  
+  public var numberOfVertices: Int
+  {
+    return vertices.count / 2
+  }
+  
+  public var numberOfTriangles: Int
+  {
+    return indices.count / 3
+  }
+  
+  public func position(_ index: UInt32) -> SIMD3<Float>
+  {
+    let position: SIMD4<Float> = vertices[2 * Int(index)]
+    return SIMD3<Float>(position.x, position.y, position.z)
+  }
+  
+  public func normal(_ index: UInt32) -> SIMD3<Float>
+  {
+    let normal: SIMD4<Float> = vertices[2 * Int(index) + 1]
+    return SIMD3<Float>(normal.x, normal.y, normal.z)
+  }
+  
+  // the vertices in the layout of the output of the marching cubes (the texture coordinates are zero), to be drawn with the indices
+  public var renderVertices: [SIMD4<Float>]
+  {
+    var renderVertices: [SIMD4<Float>] = []
+    renderVertices.reserveCapacity(3 * numberOfVertices)
+    for index in 0..<numberOfVertices
+    {
+      renderVertices.append(vertices[2 * index])
+      renderVertices.append(vertices[2 * index + 1])
+      renderVertices.append(SIMD4<Float>(0.0, 0.0, 0.0, 0.0))
+    }
+    return renderVertices
+  }
+  
+  // the same layout as the output of the marching cubes (the texture coordinates are zero)
+  public var triangleSoup: [SIMD4<Float>]
+  {
+    var soup: [SIMD4<Float>] = []
+    soup.reserveCapacity(3 * indices.count)
+    for index in indices
+    {
+      soup.append(vertices[2 * Int(index)])
+      soup.append(vertices[2 * Int(index) + 1])
+      soup.append(SIMD4<Float>(0.0, 0.0, 0.0, 0.0))
+    }
+    return soup
+  }
+}
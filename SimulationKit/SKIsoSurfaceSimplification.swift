@@ -0,0 +1,270 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+
+// Quadric-error simplification of indexed iso-surfaces by vertex clustering (Lindstrom): the vertices are grouped in the cells of a regular
+// grid over the unit cell, every cluster is replaced by the position that minimizes the sum of the squared distances to the (area-weighted)
+// planes of the triangles of its vertices, and the triangles that collapse or become duplicates are removed. Unlike edge-collapse, all steps
+// are independent per vertex, triangle or cluster, so they run in parallel, and a level-of-detail chain is built with all levels in parallel
+// from the full-resolution mesh (halving the resolution per level).
+// The clusters are cells of the fractional grid, but the quadrics are computed in Cartesian coordinates (the positions transformed by the unit
+// cell), so that the distances and the area-weights are correct for non-orthogonal cells; the minimum is transformed back to fractional.
+extension SKIsoSurfaceMesh
+{
+  struct Quadric
+  {
+    var A: double3x3 = double3x3()
+    var b: SIMD3<Double> = SIMD3<Double>(0.0, 0.0, 0.0)
+    var c: Double = 0.0
+    
+    static func +(left: Quadric, right: Quadric) -> Quadric
+    {
+      return Quadric(A: left.A + right.A, b: left.b + right.b, c: left.c + right.c)
+    }
+  }
+  
+  // The simplified mesh with at most one vertex per cell of a grid with 'resolution' cells along the axes of the unit cell.
+  public func simplified(resolution: SIMD3<Int>, unitCell: double3x3) -> SKIsoSurfaceMesh
+  {
+    let inverseUnitCell: double3x3 = unitCell.inverse
+    let numberOfVertices: Int = self.numberOfVertices
+    let numberOfTriangles: Int = self.numberOfTriangles
+    guard numberOfTriangles > 0, resolution.min() > 0 else { return self }
+    
+    let numberOfChunks: Int = 4 * ProcessInfo.processInfo.activeProcessorCount
+    func chunk(_ index: Int, of count: Int) -> Range<Int>
+    {
+      return (index * count / numberOfChunks)..<((index + 1) * count / numberOfChunks)
+    }
+    
+    // the grid cell of each vertex, and the clusters (the occupied cells) in sorted order
+    var cells: [Int] = [Int](repeating: 0, count: numberOfVertices)
+    cells.withUnsafeMutableBufferPointer { cellsPtr in
+      let cells: UnsafeMutablePointer<Int> = cellsPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: numberOfChunks) { index in
+        for vertex in chunk(index, of: numberOfVertices)
+        {
+          let scaled: SIMD3<Double> = SIMD3<Double>(position(UInt32(vertex))) * SIMD3<Double>(resolution)
+          let cell: SIMD3<Int> = simd_clamp(SIMD3<Int>(Int(floor(scaled.x)), Int(floor(scaled.y)), Int(floor(scaled.z))), SIMD3<Int>(0, 0, 0), resolution &- 1)
+          cells[vertex] = cell.x + resolution.x * (cell.y + resolution.y * cell.z)
+        }
+      }
+    }
+    let clusters: [Int] = Array(Set(cells)).sorted()
+    let numberOfClusters: Int = clusters.count
+    var clusterOfVertex: [Int] = [Int](repeating: 0, count: numberOfVertices)
+    clusterOfVertex.withUnsafeMutableBufferPointer { clusterOfVertexPtr in
+      let clusterOfVertex: UnsafeMutablePointer<Int> = clusterOfVertexPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: numberOfChunks) { index in
+        for vertex in chunk(index, of: numberOfVertices)
+        {
+          clusterOfVertex[vertex] = SKCPUMarchingCubes.lowerBound(clusters, cells[vertex])
+        }
+      }
+    }
+    
+    // the area-weighted plane-quadric of each triangle
+    var triangleQuadrics: [Quadric] = [Quadric](repeating: Quadric(), count: numberOfTriangles)
+    triangleQuadrics.withUnsafeMutableBufferPointer { quadricsPtr in
+      let quadrics: UnsafeMutablePointer<Quadric> = quadricsPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: numberOfChunks) { index in
+        for triangle in chunk(index, of: numberOfTriangles)
+        {
+          let p0: SIMD3<Double> = unitCell * SIMD3<Double>(position(indices[3 * triangle]))
+          let p1: SIMD3<Double> = unitCell * SIMD3<Double>(position(indices[3 * triangle + 1]))
+          let p2: SIMD3<Double> = unitCell * SIMD3<Double>(position(indices[3 * triangle + 2]))
+          let areaNormal: SIMD3<Double> = simd_cross(p1 - p0, p2 - p0)
+          let length: Double = simd_length(areaNormal)
+          guard length > 0.0, length.isFinite else { continue }
+          
+          let normal: SIMD3<Double> = areaNormal / length
+          let d: Double = -simd_dot(normal, p0)
+          let weight: Double = 0.5 * length
+          quadrics[triangle] = Quadric(A: weight * double3x3(columns: (normal.x * normal, normal.y * normal, normal.z * normal)), b: weight * d * normal, c: weight * d * d)
+        }
+      }
+    }
+    
+    // the triangles of each cluster (compressed rows, a triangle is listed once for every distinct cluster of its vertices)
+    var clusterTriangleOffsets: [Int] = [Int](repeating: 0, count: numberOfClusters + 1)
+    func distinctClusters(_ triangle: Int) -> [Int]
+    {
+      let c0: Int = clusterOfVertex[Int(indices[3 * triangle])]
+      let c1: Int = clusterOfVertex[Int(indices[3 * triangle + 1])]
+      let c2: Int = clusterOfVertex[Int(indices[3 * triangle + 2])]
+      return c1 == c0 ? (c2 == c0 ? [c0] : [c0, c2]) : (c2 == c0 || c2 == c1 ? [c0, c1] : [c0, c1, c2])
+    }
+    for triangle in 0..<numberOfTriangles
+    {
+      for cluster in distinctClusters(triangle)
+      {
+        clusterTriangleOffsets[cluster + 1] += 1
+      }
+    }
+    for cluster in 0..<numberOfClusters
+    {
+      clusterTriangleOffsets[cluster + 1] += clusterTriangleOffsets[cluster]
+    }
+    var clusterTriangles: [Int] = [Int](repeating: 0, count: clusterTriangleOffsets[numberOfClusters])
+    var fill: [Int] = Array(clusterTriangleOffsets.dropLast())
+    for triangle in 0..<numberOfTriangles
+    {
+      for cluster in distinctClusters(triangle)
+      {
+        clusterTriangles[fill[cluster]] = triangle
+        fill[cluster] += 1
+      }
+    }
+    
+    // the vertices of each cluster (a counting sort)
+    var clusterVertexOffsets: [Int] = [Int](repeating: 0, count: numberOfClusters + 1)
+    for cluster in clusterOfVertex
+    {
+      clusterVertexOffsets[cluster + 1] += 1
+    }
+    for cluster in 0..<numberOfClusters
+    {
+      clusterVertexOffsets[cluster + 1] += clusterVertexOffsets[cluster]
+    }
+    var clusterVertices: [Int] = [Int](repeating: 0, count: numberOfVertices)
+    fill = Array(clusterVertexOffsets.dropLast())
+    for (vertex, cluster) in clusterOfVertex.enumerated()
+    {
+      clusterVertices[fill[cluster]] = vertex
+      fill[cluster] += 1
+    }
+    
+    // the representative vertex of each cluster: the minimum of the quadric when it is well-conditioned and within (a cell of) the cluster,
+    // the average position otherwise
+    var simplifiedVertices: [SIMD4<Float>] = [SIMD4<Float>](repeating: SIMD4<Float>(0.0, 0.0, 0.0, 0.0), count: 2 * numberOfClusters)
+    simplifiedVertices.withUnsafeMutableBufferPointer { verticesPtr in
+      let vertices: UnsafeMutablePointer<SIMD4<Float>> = verticesPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: numberOfChunks) { index in
+        for cluster in chunk(index, of: numberOfClusters)
+        {
+          var quadric: Quadric = Quadric()
+          for triangle in clusterTriangles[clusterTriangleOffsets[cluster]..<clusterTriangleOffsets[cluster + 1]]
+          {
+            quadric = quadric + triangleQuadrics[triangle]
+          }
+          
+          var averagePosition: SIMD3<Double> = SIMD3<Double>(0.0, 0.0, 0.0)
+          var averageNormal: SIMD3<Float> = SIMD3<Float>(0.0, 0.0, 0.0)
+          let members: ArraySlice<Int> = clusterVertices[clusterVertexOffsets[cluster]..<clusterVertexOffsets[cluster + 1]]
+          for vertex in members
+          {
+            averagePosition += SIMD3<Double>(position(UInt32(vertex)))
+            averageNormal += normal(UInt32(vertex))
+          }
+          averagePosition /= Double(members.count)
+          
+          var representative: SIMD3<Double> = averagePosition
+          let scale: Double = quadric.A[0][0] + quadric.A[1][1] + quadric.A[2][2]
+          let determinant: Double = quadric.A.determinant
+          if scale > 0.0 && abs(determinant) > 1e-6 * scale * scale * scale
+          {
+            let minimum: SIMD3<Double> = inverseUnitCell * (quadric.A.inverse * (-quadric.b))
+            let cell: Int = clusters[cluster]
+            let lower: SIMD3<Double> = SIMD3<Double>(Double(cell % resolution.x), Double((cell / resolution.x) % resolution.y), Double(cell / (resolution.x * resolution.y))) - 0.5
+            let scaled: SIMD3<Double> = minimum * SIMD3<Double>(resolution)
+            if minimum.x.isFinite && minimum.y.isFinite && minimum.z.isFinite && all(scaled .>= lower) && all(scaled .<= lower + 2.0)
+            {
+              representative = minimum
+            }
+          }
+          
+          vertices[2 * cluster] = SIMD4<Float>(SIMD3<Float>(representative), 1.0)
+          vertices[2 * cluster + 1] = SIMD4<Float>(simd_length(averageNormal) > 0.0 ? simd_normalize(averageNormal) : averageNormal, 0.0)
+        }
+      }
+    }
+    
+    // the triangles of distinct clusters, duplicates removed (the first one is kept, with its orientation)
+    var keys: [(key: SIMD3<Int32>, triangle: Int)] = []
+    keys.reserveCapacity(numberOfTriangles)
+    for triangle in 0..<numberOfTriangles
+    {
+      let c: SIMD3<Int32> = SIMD3<Int32>(Int32(clusterOfVertex[Int(indices[3 * triangle])]), Int32(clusterOfVertex[Int(indices[3 * triangle + 1])]), Int32(clusterOfVertex[Int(indices[3 * triangle + 2])]))
+      guard c.x != c.y && c.y != c.z && c.x != c.z else { continue }
+      let sorted: SIMD3<Int32> = SIMD3<Int32>(c.min(), c.x + c.y + c.z - c.min() - c.max(), c.max())
+      keys.append((sorted, triangle))
+    }
+    keys.sort{($0.key.x, $0.key.y, $0.key.z, $0.triangle) < ($1.key.x, $1.key.y, $1.key.z, $1.triangle)}
+    
+    var uniqueTriangles: [Int] = []
+    for (index, entry) in keys.enumerated() where index == 0 || keys[index - 1].key != entry.key
+    {
+      uniqueTriangles.append(entry.triangle)
+    }
+    uniqueTriangles.sort()
+    
+    var simplifiedIndices: [UInt32] = []
+    simplifiedIndices.reserveCapacity(3 * uniqueTriangles.count)
+    for triangle in uniqueTriangles
+    {
+      for corner in 0..<3
+      {
+        simplifiedIndices.append(UInt32(clusterOfVertex[Int(indices[3 * triangle + corner])]))
+      }
+    }
+    
+    return SKIsoSurfaceMesh(vertices: simplifiedVertices, indices: simplifiedIndices)
+  }
+  
+  // The level-of-detail chain: level 0 is the mesh itself, level i is simplified on a grid of 'resolution / 2^i' cells. The levels are
+  // independent and built in parallel.
+  public func levelsOfDetail(resolution: SIMD3<Int>, numberOfLevels: Int, unitCell: double3x3) -> [SKIsoSurfaceMesh]
+  {
+    guard numberOfLevels > 1 else { return [self] }
+    
+    var levels: [SKIsoSurfaceMesh] = [SKIsoSurfaceMesh](repeating: SKIsoSurfaceMesh(), count: numberOfLevels)
+    levels[0] = self
+    levels.withUnsafeMutableBufferPointer { levelsPtr in
+      let levels: UnsafeMutablePointer<SKIsoSurfaceMesh> = levelsPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: numberOfLevels - 1) { index in
+        let level: Int = index + 1
+        levels[level] = simplified(resolution: simd_max(resolution &>> SIMD3<Int>(repeating: level), SIMD3<Int>(1, 1, 1)), unitCell: unitCell)
+      }
+    }
+    return levels
+  }
+  
+  // The level to draw when the unit cell spans 'projectedSize' pixels on screen: the coarsest level that still has about one cluster per
+  // 'pixelsPerCluster' pixels.
+  public static func levelOfDetail(projectedSize: Double, resolution: SIMD3<Int>, numberOfLevels: Int, pixelsPerCluster: Double = 2.0) -> Int
+  {
+    let requiredResolution: Double = max(1.0, projectedSize / pixelsPerCluster)
+    let level: Int = Int(floor(log2(Double(resolution.max()) / requiredResolution)))
+    return min(max(level, 0), max(numberOfLevels - 1, 0))
+  }
+}
@@ -68,6 +68,10 @@ public class SKMetalFramework
   var totalNumberOfAtoms: Int = 0
   
   var pipelineState: MTLComputePipelineState? = nil
+  var multiProbePipelineState: MTLComputePipelineState? = nil
+  var tabulatedPipelineState: MTLComputePipelineState? = nil
+  var gradientPipelineState: MTLComputePipelineState? = nil
+  var slabPipelineState: MTLComputePipelineState? = nil
   var device: MTLDevice
   var commandQueue: MTLCommandQueue
   var defaultLibrary: MTLLibrary
@@ -110,147 +114,491 @@ public class SKMetalFramework
       }
     }
     
+    if let kernelFunction: MTLFunction = defaultLibrary.makeFunction(name: "ComputeEnergyGrids")
+    {
+      let computePipeLine: MTLComputePipelineDescriptor = MTLComputePipelineDescriptor()
+      computePipeLine.computeFunction = kernelFunction
+      computePipeLine.threadGroupSizeIsMultipleOfThreadExecutionWidth = true
+      
+      do
+      {
+        multiProbePipelineState = try device.makeComputePipelineState(descriptor: computePipeLine, options: [], reflection: nil)
+      }
+      catch
+      {
+        fatalError("Error occurred when creating compute pipeline state \(error)")
+      }
+    }
+    
+    if let kernelFunction: MTLFunction = defaultLibrary.makeFunction(name: "ComputeEnergyGridTabulated")
+    {
+      let computePipeLine: MTLComputePipelineDescriptor = MTLComputePipelineDescriptor()
+      computePipeLine.computeFunction = kernelFunction
+      computePipeLine.threadGroupSizeIsMultipleOfThreadExecutionWidth = true
+      
+      do
+      {
+        tabulatedPipelineState = try device.makeComputePipelineState(descriptor: computePipeLine, options: [], reflection: nil)
+      }
+      catch
+      {
+        fatalError("Error occurred when creating compute pipeline state \(error)")
+      }
+    }
+    
+    if let kernelFunction: MTLFunction = defaultLibrary.makeFunction(name: "ComputeEnergyGridWithGradient")
+    {
+      let computePipeLine: MTLComputePipelineDescriptor = MTLComputePipelineDescriptor()
+      computePipeLine.computeFunction = kernelFunction
+      computePipeLine.threadGroupSizeIsMultipleOfThreadExecutionWidth = true
+      
+      do
+      {
+        gradientPipelineState = try device.makeComputePipelineState(descriptor: computePipeLine, options: [], reflection: nil)
+      }
+      catch
+      {
+        fatalError("Error occurred when creating compute pipeline state \(error)")
+      }
+    }
+    
+    if let kernelFunction: MTLFunction = defaultLibrary.makeFunction(name: "ComputeEnergyGridSlab")
+    {
+      let computePipeLine: MTLComputePipelineDescriptor = MTLComputePipelineDescriptor()
+      computePipeLine.computeFunction = kernelFunction
+      computePipeLine.threadGroupSizeIsMultipleOfThreadExecutionWidth = true
+      
+      do
+      {
+        slabPipelineState = try device.makeComputePipelineState(descriptor: computePipeLine, options: [], reflection: nil)
+      }
+      catch
+      {
+        fatalError("Error occurred when creating compute pipeline state \(error)")
+      }
+    }
   }
   
   public func ComputeEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>) -> [Float]
   {
-    if let pipelineState = self.pipelineState
+    let correction: SIMD3<Double> = SIMD3<Double>(1.0/Double(numberOfReplicas.x), 1.0/Double(numberOfReplicas.y), 1.0/Double(numberOfReplicas.z))
+    
+    var gridPositions: [SIMD4<Float>] = []
+    gridPositions.reserveCapacity(sizeX * sizeY * sizeZ)
+    for k in 0..<sizeZ
     {
-      let threadGroupCount: Int = pipelineState.threadExecutionWidth
-      
-      //let NumberOfAtoms: Int = self.positions.count
-      let temp: Int = sizeX*sizeY*sizeZ
-      let NumberOfGridPoints: Int = temp + (threadGroupCount - (temp & (threadGroupCount-1)))
-      
-      var pos: [SIMD4<Float>] = [SIMD4<Float>](repeating: SIMD4<Float>(0,0,0,0), count: totalNumberOfAtoms)
-      var parameters: [SIMD2<Float>] = [SIMD2<Float>](repeating: SIMD2<Float>(0,0), count: totalNumberOfAtoms)
-      
-      var gridPos: [SIMD4<Float>] = [SIMD4<Float>](repeating: SIMD4<Float>(0,0,0,0), count: NumberOfGridPoints)
-      let output: [Float] = [Float](repeating: 0.0, count: NumberOfGridPoints)
+      for j in 0..<sizeY
+      {
+        // X various the fastest (contiguous in x)
+        for i in 0..<sizeX
+        {
+          let position: SIMD3<Double> = correction * SIMD3<Double>(Double(i)/Double(sizeX-1),Double(j)/Double(sizeY-1),Double(k)/Double(sizeZ-1))
+          gridPositions.append(SIMD4<Float>(Float(position.x), Float(position.y), Float(position.z), Float(0.0)))
+        }
+      }
+    }
+    
+    return computeEnergies(gridPositions: gridPositions, probeParameter: probeParameter)
+  }
+  
+  // Only the symmetry-unique grid points are computed, the rest of the grid is filled in by mapping (see 'SKEnergyGridSymmetry').
+  // Operations that do not map the atoms onto themselves are not used, so a space group that does not match the positions only costs
+  // speed. Use 'SKEnergyGridSymmetry.symmetricGridSize' for the sizes, otherwise most of the operations do not map the grid onto itself.
+  public func ComputeEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>, spaceGroup: SKSpacegroup) -> [Float]
+  {
+    let symmetry: SKEnergyGridSymmetry = SKEnergyGridSymmetry(dimensions: SIMD3<Int>(sizeX, sizeY, sizeZ), spaceGroup: spaceGroup, unitCell: unitCell, positions: positions, potentialParameters: potentialParameters)
+    let correction: SIMD3<Double> = SIMD3<Double>(1.0/Double(numberOfReplicas.x), 1.0/Double(numberOfReplicas.y), 1.0/Double(numberOfReplicas.z))
+    
+    let gridPositions: [SIMD4<Float>] = symmetry.uniqueGridPoints.map{index -> SIMD4<Float> in
+      let i: Int = index % sizeX
+      let j: Int = (index / sizeX) % sizeY
+      let k: Int = index / (sizeX * sizeY)
+      let position: SIMD3<Double> = correction * SIMD3<Double>(Double(i)/Double(sizeX-1),Double(j)/Double(sizeY-1),Double(k)/Double(sizeZ-1))
+      return SIMD4<Float>(Float(position.x), Float(position.y), Float(position.z), Float(0.0))
+    }
+    
+    let values: [Float] = computeEnergies(gridPositions: gridPositions, probeParameter: probeParameter)
+    guard values.count == gridPositions.count else { return [] }
+    
+    return symmetry.expand(values)
+  }
+  
+  // computes the energies at the given fractional positions within the first replica
+  func computeEnergies(gridPositions: [SIMD4<Float>], probeParameter: SIMD2<Double>) -> [Float]
+  {
+    guard let pipelineState = self.pipelineState, (totalNumberOfAtoms > 0) else { return [] }
+    
+    let grid: (buffer: MTLBuffer, numberOfGridPoints: Int) = makeGridPositionsBuffer(gridPositions, pipelineState: pipelineState)
+    let bufferAtomPositions: MTLBuffer = makeAtomPositionsBuffer()
+    let bufferParameters: MTLBuffer = makeParametersBuffer(probeParameter: probeParameter)
+    guard let bufferOutput: MTLBuffer = makeOutputBuffer(length: grid.numberOfGridPoints * MemoryLayout<Float>.stride) else { return [] }
+    
+    let success: Bool = dispatchWorkBatches(pipelineState, name: "ComputeEnergyGrid", numberOfThreads: grid.numberOfGridPoints, atomPositions: bufferAtomPositions, output: bufferOutput) { commandEncoder, firstAtom in
+      commandEncoder.setBuffer(grid.buffer, offset: 0, index: 2)
+      commandEncoder.setBuffer(bufferParameters, offset: firstAtom * MemoryLayout<SIMD2<Float>>.stride, index: 3)
+    }
+    guard success else { return [] }
+    
+    return Array(UnsafeBufferPointer(start: bufferOutput.contents().assumingMemoryBound(to: Float.self), count: gridPositions.count))
+  }
+  
+  // The grid is computed in slabs of 'slabSize' z-slices that are handed to 'consumer' (with the index of their first slice) in order. The grid
+  // positions are generated in the kernel, so the memory stays proportional to a slab instead of the full grid. The slab-buffer is reused, the
+  // consumer must copy what it needs to keep. Returns false when a Metal-error occurred.
+  @discardableResult
+  public func ComputeEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>, slabSize: Int, consumer: (_ firstSlice: Int, _ slab: UnsafeBufferPointer<Float>) -> Void) -> Bool
+  {
+    guard let pipelineState = self.slabPipelineState else { return false }
+    guard (totalNumberOfAtoms > 0), sizeX > 0, sizeY > 0, sizeZ > 0 else { return true }
+    
+    let threadGroupCount: Int = pipelineState.threadExecutionWidth
+    let numberOfSlices: Int = max(1, min(slabSize, sizeZ))
+    let temp: Int = sizeX * sizeY * numberOfSlices
+    let NumberOfGridPoints: Int = temp + (threadGroupCount - (temp & (threadGroupCount-1)))
+    
+    let correction: SIMD3<Double> = SIMD3<Double>(1.0/Double(numberOfReplicas.x), 1.0/Double(numberOfReplicas.y), 1.0/Double(numberOfReplicas.z))
+    var spacing: SIMD4<Float> = SIMD4<Float>(Float(correction.x / Double(max(1, sizeX - 1))), Float(correction.y / Double(max(1, sizeY - 1))), Float(correction.z / Double(max(1, sizeZ - 1))), 0.0)
+    
+    let bufferAtomPositions: MTLBuffer = makeAtomPositionsBuffer()
+    let bufferParameters: MTLBuffer = makeParametersBuffer(probeParameter: probeParameter)
+    
+    // a single slab-sized output buffer is reused for all slabs
+    guard let bufferOutput: MTLBuffer = makeOutputBuffer(length: NumberOfGridPoints * MemoryLayout<Float>.stride) else { return false }
+    
+    for firstSlice in stride(from: 0, to: sizeZ, by: numberOfSlices)
+    {
+      let slices: Int = min(numberOfSlices, sizeZ - firstSlice)
+      var gridDimensions: SIMD4<Int32> = SIMD4<Int32>(Int32(sizeX), Int32(sizeY), Int32(sizeZ), Int32(firstSlice))
+      var numberOfSlabGridPoints: Int32 = Int32(sizeX * sizeY * slices)
       
-      let correction: SIMD3<Double> = SIMD3<Double>(1.0/Double(numberOfReplicas.x), 1.0/Double(numberOfReplicas.y), 1.0/Double(numberOfReplicas.z))
+      memset(bufferOutput.contents(), 0, NumberOfGridPoints * MemoryLayout<Float>.stride)
       
-      guard (totalNumberOfAtoms > 0) else { return [] }
+      let success: Bool = dispatchWorkBatches(pipelineState, name: "ComputeEnergyGridSlab", numberOfThreads: NumberOfGridPoints, atomPositions: bufferAtomPositions, output: bufferOutput) { commandEncoder, firstAtom in
+        commandEncoder.setBytes(&gridDimensions, length: MemoryLayout<SIMD4<Int32>>.stride, index: 2)
+        commandEncoder.setBuffer(bufferParameters, offset: firstAtom * MemoryLayout<SIMD2<Float>>.stride, index: 3)
+        commandEncoder.setBytes(&spacing, length: MemoryLayout<SIMD4<Float>>.stride, index: 8)
+        commandEncoder.setBytes(&numberOfSlabGridPoints, length: MemoryLayout<Int32>.stride, index: 9)
+      }
+      guard success else { return false }
       
-      for i in 0..<totalNumberOfAtoms
+      consumer(firstSlice, UnsafeBufferPointer<Float>(start: bufferOutput.contents().assumingMemoryBound(to: Float.self), count: Int(numberOfSlabGridPoints)))
+    }
+    return true
+  }
+  
+  // The grid is streamed in slabs (see above) and each slab is reduced in parallel, the full grid is never stored. The energies of a grid point
+  // are only complete after all work-batches of atoms, so the reductions cannot be done inside the kernel.
+  public func ComputeEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>, reduction: SKEnergyGridReduction, slabSize: Int = 16) -> SKEnergyGridReduction
+  {
+    var result: SKEnergyGridReduction = reduction.empty
+    let success: Bool = ComputeEnergyGrid(sizeX, sizeY: sizeY, sizeZ: sizeZ, probeParameter: probeParameter, slabSize: slabSize) { _, slab in
+      result.accumulate(count: slab.count) { range, partial in
+        partial.accumulate(UnsafeBufferPointer(rebasing: slab[range]))
+      }
+    }
+    return success ? result : reduction.empty
+  }
+  
+  // Only the cells near the iso-value (or below 'refinementThreshold') are refined down to the grid spacing (see 'SKAdaptiveEnergyGrid').
+  // Each refinement level is computed in a single pass.
+  public func ComputeAdaptiveEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>, isoValue: Float, refinementThreshold: Float? = nil, coarseStride: Int = 8) -> SKAdaptiveEnergyGrid
+  {
+    let correction: SIMD3<Double> = SIMD3<Double>(1.0/Double(numberOfReplicas.x), 1.0/Double(numberOfReplicas.y), 1.0/Double(numberOfReplicas.z))
+    
+    return SKAdaptiveEnergyGrid(dimensions: SIMD3<Int>(sizeX, sizeY, sizeZ), coarseStride: coarseStride, isoValue: isoValue, refinementThreshold: refinementThreshold) { points in
+      let gridPositions: [SIMD4<Float>] = points.map{point -> SIMD4<Float> in
+        let position: SIMD3<Double> = correction * SIMD3<Double>(Double(point.x)/Double(sizeX-1),Double(point.y)/Double(sizeY-1),Double(point.z)/Double(sizeZ-1))
+        return SIMD4<Float>(Float(position.x), Float(position.y), Float(position.z), Float(0.0))
+      }
+      return computeEnergies(gridPositions: gridPositions, probeParameter: probeParameter)
+    }
+  }
+  
+  // must be identical to 'MAXIMUM_NUMBER_OF_PROBES' in the 'ComputeEnergyGrids' Metal-kernel
+  static let maximumNumberOfProbesPerPass: Int = 8
+  
+  // Computes one energy grid per probe, the framework-atoms are visited only once for all probes (up to 8 probes per pass).
+  public func ComputeEnergyGrids(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameters: [SIMD2<Double>], spaceGroup: SKSpacegroup = SKSpacegroup(HallNumber: 1)) -> [[Float]]
+  {
+    let symmetry: SKEnergyGridSymmetry = SKEnergyGridSymmetry(dimensions: SIMD3<Int>(sizeX, sizeY, sizeZ), spaceGroup: spaceGroup, unitCell: unitCell, positions: positions, potentialParameters: potentialParameters)
+    let correction: SIMD3<Double> = SIMD3<Double>(1.0/Double(numberOfReplicas.x), 1.0/Double(numberOfReplicas.y), 1.0/Double(numberOfReplicas.z))
+    
+    let gridPositions: [SIMD4<Float>] = symmetry.uniqueGridPoints.map{index -> SIMD4<Float> in
+      let i: Int = index % sizeX
+      let j: Int = (index / sizeX) % sizeY
+      let k: Int = index / (sizeX * sizeY)
+      let position: SIMD3<Double> = correction * SIMD3<Double>(Double(i)/Double(sizeX-1),Double(j)/Double(sizeY-1),Double(k)/Double(sizeZ-1))
+      return SIMD4<Float>(Float(position.x), Float(position.y), Float(position.z), Float(0.0))
+    }
+    
+    var grids: [[Float]] = []
+    for start in stride(from: 0, to: probeParameters.count, by: SKMetalFramework.maximumNumberOfProbesPerPass)
+    {
+      let probes: [SIMD2<Double>] = Array(probeParameters[start..<min(start + SKMetalFramework.maximumNumberOfProbesPerPass, probeParameters.count)])
+      let values: [[Float]] = computeEnergies(gridPositions: gridPositions, probeParameters: probes)
+      guard values.count == probes.count else { return [[Float]](repeating: [], count: probeParameters.count) }
+      grids += values.map{symmetry.expand($0)}
+    }
+    return grids
+  }
+  
+  // computes the energies at the given fractional positions within the first replica for at most 'maximumNumberOfProbesPerPass' probes
+  func computeEnergies(gridPositions: [SIMD4<Float>], probeParameters: [SIMD2<Double>]) -> [[Float]]
+  {
+    guard let pipelineState = self.multiProbePipelineState,
+          (totalNumberOfAtoms > 0), (1...SKMetalFramework.maximumNumberOfProbesPerPass).contains(probeParameters.count) else { return [] }
+    
+    let grid: (buffer: MTLBuffer, numberOfGridPoints: Int) = makeGridPositionsBuffer(gridPositions, pipelineState: pipelineState)
+    var NumberOfProbes: Int32 = Int32(probeParameters.count)
+    var NumberOfGridPointsBufferValue: Int32 = Int32(grid.numberOfGridPoints)
+    
+    // use 4 x epsilon for a probe epsilon of unity, the parameters of all probes are stored consecutively per atom
+    let parameters: [SIMD2<Float>] = potentialParameters.flatMap{currentPotentialParameters in
+      probeParameters.map{SIMD2<Float>(Float(4.0*sqrt(currentPotentialParameters.x * $0.x)), Float(0.5 * (currentPotentialParameters.y + $0.y)))}
+    }
+    
+    let bufferAtomPositions: MTLBuffer = makeAtomPositionsBuffer()
+    let bufferParameters: MTLBuffer = device.makeBuffer(bytes: parameters, length: parameters.count * MemoryLayout<SIMD2<Float>>.stride, options: .storageModeManaged)!
+    guard let bufferOutput: MTLBuffer = makeOutputBuffer(length: grid.numberOfGridPoints * probeParameters.count * MemoryLayout<Float>.stride) else { return [] }
+    
+    let success: Bool = dispatchWorkBatches(pipelineState, name: "ComputeEnergyGrids", numberOfThreads: grid.numberOfGridPoints, atomPositions: bufferAtomPositions, output: bufferOutput) { commandEncoder, firstAtom in
+      commandEncoder.setBuffer(grid.buffer, offset: 0, index: 2)
+      commandEncoder.setBuffer(bufferParameters, offset: firstAtom * probeParameters.count * MemoryLayout<SIMD2<Float>>.stride, index: 3)
+      commandEncoder.setBytes(&NumberOfProbes, length: MemoryLayout<Int32>.stride, index: 8)
+      commandEncoder.setBytes(&NumberOfGridPointsBufferValue, length: MemoryLayout<Int32>.stride, index: 9)
+    }
+    guard success else { return [] }
+    
+    let outputPtr: UnsafeMutablePointer<Float> = bufferOutput.contents().bindMemory(to: Float.self, capacity: grid.numberOfGridPoints * probeParameters.count)
+    return (0..<probeParameters.count).map{p in Array(UnsafeBufferPointer(start: outputPtr + p * grid.numberOfGridPoints, count: gridPositions.count))}
+  }
+  
+  // Computes the energy grid from a tabulated potential (see 'SKPairPotentialTable'), the table must have been created for the atoms of the framework.
+  public func ComputeEnergyGrid(_ sizeX: Int, sizeY: Int, sizeZ: Int, potentialTable: SKPairPotentialTable) -> [Float]
+  {
+    let correction: SIMD3<Double> = SIMD3<Double>(1.0/Double(numberOfReplicas.x), 1.0/Double(numberOfReplicas.y), 1.0/Double(numberOfReplicas.z))
+    
+    var gridPositions: [SIMD4<Float>] = []
+    gridPositions.reserveCapacity(sizeX * sizeY * sizeZ)
+    for k in 0..<sizeZ
+    {
+      for j in 0..<sizeY
       {
-        let position: SIMD3<Double> = positions[i] * correction
-        let currentPotentialParameters: SIMD2<Double> = self.potentialParameters[i]
-          
-        // fill in the Cartesian position
-        pos[i] = SIMD4<Float>(Float(position.x), Float(position.y), Float(position.z), 0.0)
-          
-        // use 4 x epsilon for a probe epsilon of unity
-        parameters[i] = SIMD2<Float>(Float(4.0*sqrt(currentPotentialParameters.x * probeParameter.x)),
-                                     Float(0.5 * (currentPotentialParameters.y + probeParameter.y)))
+        // X various the fastest (contiguous in x)
+        for i in 0..<sizeX
+        {
+          let position: SIMD3<Double> = correction * SIMD3<Double>(Double(i)/Double(sizeX-1),Double(j)/Double(sizeY-1),Double(k)/Double(sizeZ-1))
+          gridPositions.append(SIMD4<Float>(Float(position.x), Float(position.y), Float(position.z), Float(0.0)))
+        }
       }
-        
-      var loopindex: Int = 0
-      for k in 0..<sizeZ
+    }
+    
+    return computeEnergies(gridPositions: gridPositions, potentialTable: potentialTable).map{$0 + potentialTable.tailCorrection}
+  }
+  
+  // computes the energies at the given fractional positions within the first replica using the tabulated potential
+  func computeEnergies(gridPositions: [SIMD4<Float>], potentialTable: SKPairPotentialTable) -> [Float]
+  {
+    guard let pipelineState = self.tabulatedPipelineState,
+          (totalNumberOfAtoms > 0), potentialTable.atomTypes.count == totalNumberOfAtoms else { return [] }
+    
+    let grid: (buffer: MTLBuffer, numberOfGridPoints: Int) = makeGridPositionsBuffer(gridPositions, pipelineState: pipelineState)
+    var NumberOfIntervals: Int32 = Int32(SKPairPotentialTable.numberOfIntervals)
+    
+    // the type of the atom is stored in the w-component of the position
+    let bufferAtomPositions: MTLBuffer = makeAtomPositionsBuffer(types: potentialTable.atomTypes)
+    let bufferRangeParameters: MTLBuffer = device.makeBuffer(bytes: potentialTable.rangeParameters, length: potentialTable.rangeParameters.count * MemoryLayout<SIMD2<Float>>.stride, options: .storageModeManaged)!
+    let bufferCoefficients: MTLBuffer = device.makeBuffer(bytes: potentialTable.coefficients, length: potentialTable.coefficients.count * MemoryLayout<SIMD4<Float>>.stride, options: .storageModeManaged)!
+    guard let bufferOutput: MTLBuffer = makeOutputBuffer(length: grid.numberOfGridPoints * MemoryLayout<Float>.stride) else { return [] }
+    
+    let success: Bool = dispatchWorkBatches(pipelineState, name: "ComputeEnergyGridTabulated", numberOfThreads: grid.numberOfGridPoints, atomPositions: bufferAtomPositions, output: bufferOutput) { commandEncoder, firstAtom in
+      commandEncoder.setBuffer(grid.buffer, offset: 0, index: 2)
+      commandEncoder.setBuffer(bufferRangeParameters, offset: 0, index: 3)
+      commandEncoder.setBuffer(bufferCoefficients, offset: 0, index: 8)
+      commandEncoder.setBytes(&NumberOfIntervals, length: MemoryLayout<Int32>.stride, index: 9)
+    }
+    guard success else { return [] }
+    
+    return Array(UnsafeBufferPointer(start: bufferOutput.contents().assumingMemoryBound(to: Float.self), count: gridPositions.count))
+  }
+  
+  // The energies (x) and their analytic gradients with respect to the grid-index (yzw), i.e. per grid-spacing like the finite differences
+  // of 'SKGridGradient'. The gradients are not invariant under the symmetry-operations, so the full grid is computed.
+  public func ComputeEnergyGridWithGradient(_ sizeX: Int, sizeY: Int, sizeZ: Int, probeParameter: SIMD2<Double>) -> [SIMD4<Float>]
+  {
+    let correction: SIMD3<Double> = SIMD3<Double>(1.0/Double(numberOfReplicas.x), 1.0/Double(numberOfReplicas.y), 1.0/Double(numberOfReplicas.z))
+    
+    var gridPositions: [SIMD4<Float>] = []
+    gridPositions.reserveCapacity(sizeX * sizeY * sizeZ)
+    for k in 0..<sizeZ
+    {
+      for j in 0..<sizeY
       {
-        for j in 0..<sizeY
+        // X various the fastest (contiguous in x)
+        for i in 0..<sizeX
         {
-          // X various the fastest (contiguous in x)
-          for i in 0..<sizeX
-          {
-            let position: SIMD3<Double> = correction * SIMD3<Double>(Double(i)/Double(sizeX-1),Double(j)/Double(sizeY-1),Double(k)/Double(sizeZ-1))
-            gridPos[loopindex] = SIMD4<Float>(Float(position.x), Float(position.y), Float(position.z), Float(0.0))
-            loopindex += 1
-          }
+          let position: SIMD3<Double> = correction * SIMD3<Double>(Double(i)/Double(sizeX-1),Double(j)/Double(sizeY-1),Double(k)/Double(sizeZ-1))
+          gridPositions.append(SIMD4<Float>(Float(position.x), Float(position.y), Float(position.z), Float(0.0)))
         }
       }
-      
-      var replicasBufferValue: [SIMD4<Float>] = [SIMD4<Float>](repeating: SIMD4<Float>(0,0,0,0), count: totalNumberOfReplicas)
-      var index = 0
-      for i in 0..<numberOfReplicas.x
+    }
+    
+    // from the fractional position in the replica-cell to the grid-index
+    let scaling: SIMD4<Float> = SIMD4<Float>(1.0, Float(correction.x / Double(max(1, sizeX - 1))), Float(correction.y / Double(max(1, sizeY - 1))), Float(correction.z / Double(max(1, sizeZ - 1))))
+    
+    return computeEnergiesAndGradients(gridPositions: gridPositions, probeParameter: probeParameter).map{scaling * $0}
+  }
+  
+  // computes the energies and gradients at the given fractional positions within the first replica
+  func computeEnergiesAndGradients(gridPositions: [SIMD4<Float>], probeParameter: SIMD2<Double>) -> [SIMD4<Float>]
+  {
+    guard let pipelineState = self.gradientPipelineState, (totalNumberOfAtoms > 0) else { return [] }
+    
+    let grid: (buffer: MTLBuffer, numberOfGridPoints: Int) = makeGridPositionsBuffer(gridPositions, pipelineState: pipelineState)
+    let bufferAtomPositions: MTLBuffer = makeAtomPositionsBuffer()
+    let bufferParameters: MTLBuffer = makeParametersBuffer(probeParameter: probeParameter)
+    guard let bufferOutput: MTLBuffer = makeOutputBuffer(length: grid.numberOfGridPoints * MemoryLayout<SIMD4<Float>>.stride) else { return [] }
+    
+    let success: Bool = dispatchWorkBatches(pipelineState, name: "ComputeEnergyGridWithGradient", numberOfThreads: grid.numberOfGridPoints, atomPositions: bufferAtomPositions, output: bufferOutput) { commandEncoder, firstAtom in
+      commandEncoder.setBuffer(grid.buffer, offset: 0, index: 2)
+      commandEncoder.setBuffer(bufferParameters, offset: firstAtom * MemoryLayout<SIMD2<Float>>.stride, index: 3)
+    }
+    guard success else { return [] }
+    
+    return Array(UnsafeBufferPointer(start: bufferOutput.contents().assumingMemoryBound(to: SIMD4<Float>.self), count: gridPositions.count))
+  }
+  
+  // MARK: Dispatch
+  // =====================================================================
+  
+  // The buffers that are the same for all kernels: the replica-cell (index 4), the number of replicas (index 5) and the fractional
+  // translations of the replicas (index 6).
+  lazy var replicaBuffers: (cell: MTLBuffer, numberOfReplicas: MTLBuffer, replicas: MTLBuffer) = makeReplicaBuffers()
+  
+  func makeReplicaBuffers() -> (cell: MTLBuffer, numberOfReplicas: MTLBuffer, replicas: MTLBuffer)
+  {
+    var replicasBufferValue: [SIMD4<Float>] = [SIMD4<Float>](repeating: SIMD4<Float>(0,0,0,0), count: totalNumberOfReplicas)
+    var index = 0
+    for i in 0..<numberOfReplicas.x
+    {
+      for j in 0..<numberOfReplicas.y
       {
-        for j in 0..<numberOfReplicas.y
+        for k in 0..<numberOfReplicas.z
         {
-          for k in 0..<numberOfReplicas.z
-          {
-            replicasBufferValue[index] = SIMD4<Float>(Float(Double(i)/Double(numberOfReplicas.x)), Float(Double(j)/Double(numberOfReplicas.y)), Float(Double(k)/Double(numberOfReplicas.z)), Float(0.0))
-            index += 1
-          }
+          replicasBufferValue[index] = SIMD4<Float>(Float(Double(i)/Double(numberOfReplicas.x)), Float(Double(j)/Double(numberOfReplicas.y)), Float(Double(k)/Double(numberOfReplicas.z)), Float(0.0))
+          index += 1
         }
       }
+    }
+    
+    var NumberOfReplicasBufferValue: Int32 = Int32(totalNumberOfReplicas)
+    var cell3x3Float: float3x3 = float3x3(Double3x3: replicaCell)
+    
+    let bufferCell: MTLBuffer = device.makeBuffer(bytes: &cell3x3Float, length: MemoryLayout<float3x3>.stride, options: .storageModeManaged)!
+    let bufferNumberOfReplicas: MTLBuffer = device.makeBuffer(bytes: &NumberOfReplicasBufferValue, length: MemoryLayout<Int32>.stride, options: .storageModeManaged)!
+    let bufferReplicas: MTLBuffer = device.makeBuffer(bytes: &replicasBufferValue, length: totalNumberOfReplicas * MemoryLayout<SIMD4<Float>>.stride, options: .storageModeManaged)!
+    return (bufferCell, bufferNumberOfReplicas, bufferReplicas)
+  }
+  
+  // the fractional positions of the atoms within the first replica, with the type of the atom in the w-component when given
+  func makeAtomPositionsBuffer(types: [Int32]? = nil) -> MTLBuffer
+  {
+    let correction: SIMD3<Double> = SIMD3<Double>(1.0/Double(numberOfReplicas.x), 1.0/Double(numberOfReplicas.y), 1.0/Double(numberOfReplicas.z))
+    let pos: [SIMD4<Float>] = (0..<totalNumberOfAtoms).map{i -> SIMD4<Float> in
+      let position: SIMD3<Double> = positions[i] * correction
+      return SIMD4<Float>(Float(position.x), Float(position.y), Float(position.z), Float(types?[i] ?? 0))
+    }
+    return device.makeBuffer(bytes: pos, length: pos.count * MemoryLayout<SIMD4<Float>>.stride, options: .storageModeManaged)!
+  }
+  
+  // use 4 x epsilon for a probe epsilon of unity
+  func makeParametersBuffer(probeParameter: SIMD2<Double>) -> MTLBuffer
+  {
+    let parameters: [SIMD2<Float>] = potentialParameters.map{SIMD2<Float>(Float(4.0*sqrt($0.x * probeParameter.x)), Float(0.5 * ($0.y + probeParameter.y)))}
+    return device.makeBuffer(bytes: parameters, length: parameters.count * MemoryLayout<SIMD2<Float>>.stride, options: .storageModeManaged)!
+  }
+  
+  // the grid positions padded to a multiple of the thread-group size
+  func makeGridPositionsBuffer(_ gridPositions: [SIMD4<Float>], pipelineState: MTLComputePipelineState) -> (buffer: MTLBuffer, numberOfGridPoints: Int)
+  {
+    let threadGroupCount: Int = pipelineState.threadExecutionWidth
+    let temp: Int = gridPositions.count
+    let NumberOfGridPoints: Int = temp + (threadGroupCount - (temp & (threadGroupCount-1)))
+    
+    let gridPos: [SIMD4<Float>] = gridPositions + [SIMD4<Float>](repeating: SIMD4<Float>(0,0,0,0), count: NumberOfGridPoints - temp)
+    return (device.makeBuffer(bytes: gridPos, length: gridPos.count * MemoryLayout<SIMD4<Float>>.stride, options: .storageModeManaged)!, NumberOfGridPoints)
+  }
+  
+  // the kernels accumulate into the output, so it starts zeroed
+  func makeOutputBuffer(length: Int) -> MTLBuffer?
+  {
+    guard let buffer: MTLBuffer = device.makeBuffer(length: length, options: .storageModeShared) else { return nil }
+    memset(buffer.contents(), 0, length)
+    return buffer
+  }
+  
+  // Dispatches 'pipelineState' with one thread per grid point. Large work is split into smaller work-batches of 'sizeOfWorkBatch' atoms,
+  // the watchdog kills kernels that are running too long (and without error on High Sierra). The arguments common to all kernels are set
+  // here: the number of atoms of the batch (index 0), the atom positions of the batch (index 1), the replica buffers (indices 4-6) and the
+  // output (index 7); 'encode' sets the kernel-specific arguments for the batch that starts at 'firstAtom'. Returns false on a Metal-error,
+  // which is logged with 'name'.
+  func dispatchWorkBatches(_ pipelineState: MTLComputePipelineState, name: String, numberOfThreads: Int, atomPositions: MTLBuffer, output: MTLBuffer, encode: (_ commandEncoder: MTLComputeCommandEncoder, _ firstAtom: Int) -> Void) -> Bool
+  {
+    let replicaBuffers: (cell: MTLBuffer, numberOfReplicas: MTLBuffer, replicas: MTLBuffer) = self.replicaBuffers
+    
+    var unitsOfWorkDone: Int = 0
+    let sizeOfWorkBatch: Int = 8192
+    while(unitsOfWorkDone < totalNumberOfAtoms)
+    {
+      var numberOfAtomsPerThreadgroup: Int32 = Int32(min(sizeOfWorkBatch,totalNumberOfAtoms-unitsOfWorkDone))
       
-      var NumberOfReplicasBufferValue: Int32 = Int32(totalNumberOfReplicas)
-      
-      var cell3x3Float: float3x3 = float3x3(Double3x3: replicaCell)
-      let bufferAtomPositions: MTLBuffer = device.makeBuffer(bytes: pos, length: pos.count * MemoryLayout<SIMD4<Float>>.stride, options: .storageModeManaged)!
-      let bufferGridPositions: MTLBuffer = device.makeBuffer(bytes: gridPos, length: gridPos.count * MemoryLayout<SIMD4<Float>>.stride, options: .storageModeManaged)!
-      let bufferParameters: MTLBuffer = device.makeBuffer(bytes: parameters, length: parameters.count * MemoryLayout<SIMD2<Float>>.stride, options: .storageModeManaged)!
-      let bufferCell: MTLBuffer = device.makeBuffer(bytes: &cell3x3Float, length: MemoryLayout<float3x3>.stride, options: .storageModeManaged)!
-      
-      let bufferReplicas: MTLBuffer = device.makeBuffer(bytes: &replicasBufferValue, length: totalNumberOfReplicas * MemoryLayout<SIMD4<Float>>.stride, options: .storageModeManaged)!
-      let bufferNumberOfReplicas: MTLBuffer = device.makeBuffer(bytes: &NumberOfReplicasBufferValue, length: MemoryLayout<Int32>.stride, options: .storageModeManaged)!
-      let bufferOutput: MTLBuffer = device.makeBuffer(bytes: output, length: output.count * MemoryLayout<Float>.stride, options: .storageModeShared)!
-      
-      
-      // Split large work into smaller work-batches of size 'sizeOfWorkBatch'
-      // The watchdog kills kernels that are running too long (and without error on High Sierra)
-      
-      var unitsOfWorkDone: Int = 0
-      let sizeOfWorkBatch: Int = 8192
-      while(unitsOfWorkDone < totalNumberOfAtoms)
+      if let commandBuffer = commandQueue.makeCommandBuffer(),
+         let commandEncoder = commandBuffer.makeComputeCommandEncoder()
       {
-        var numberOfAtomsPerThreadgroup: Int = min(sizeOfWorkBatch,totalNumberOfAtoms-unitsOfWorkDone)
+        commandEncoder.setComputePipelineState(pipelineState)
         
-        if let commandBuffer = commandQueue.makeCommandBuffer(),
-           let commandEncoder = commandBuffer.makeComputeCommandEncoder()
-        {
-          commandEncoder.setComputePipelineState(pipelineState)
-        
-          commandEncoder.setBytes(&numberOfAtomsPerThreadgroup, length: MemoryLayout<Int32>.stride, index: 0)
-          commandEncoder.setBuffer(bufferAtomPositions, offset: unitsOfWorkDone * MemoryLayout<SIMD4<Float>>.stride, index: 1)
-          commandEncoder.setBuffer(bufferGridPositions, offset: 0, index: 2)
-          commandEncoder.setBuffer(bufferParameters, offset: unitsOfWorkDone * MemoryLayout<SIMD2<Float>>.stride, index: 3)
-          commandEncoder.setBuffer(bufferCell, offset: 0, index: 4)
-          commandEncoder.setBuffer(bufferNumberOfReplicas, offset: 0, index: 5)
-          commandEncoder.setBuffer(bufferReplicas, offset: 0, index: 6)
-          commandEncoder.setBuffer(bufferOutput, offset: 0, index: 7)
+        commandEncoder.setBytes(&numberOfAtomsPerThreadgroup, length: MemoryLayout<Int32>.stride, index: 0)
+        commandEncoder.setBuffer(atomPositions, offset: unitsOfWorkDone * MemoryLayout<SIMD4<Float>>.stride, index: 1)
+        commandEncoder.setBuffer(replicaBuffers.cell, offset: 0, index: 4)
+        commandEncoder.setBuffer(replicaBuffers.numberOfReplicas, offset: 0, index: 5)
+        commandEncoder.setBuffer(replicaBuffers.replicas, offset: 0, index: 6)
+        commandEncoder.setBuffer(output, offset: 0, index: 7)
+        encode(commandEncoder, unitsOfWorkDone)
         
-          let threadsPerGrid = MTLSize(width: Int(NumberOfGridPoints), height: 1, depth: 1)
-          let threadExecutionWidth: Int = pipelineState.threadExecutionWidth
-          let threadsPerThreadgroup: MTLSize = MTLSizeMake(threadExecutionWidth, 1, 1)
-          commandEncoder.dispatchThreads(threadsPerGrid, threadsPerThreadgroup: threadsPerThreadgroup)
+        let threadsPerGrid = MTLSize(width: numberOfThreads, height: 1, depth: 1)
+        let threadExecutionWidth: Int = pipelineState.threadExecutionWidth
+        let threadsPerThreadgroup: MTLSize = MTLSizeMake(threadExecutionWidth, 1, 1)
+        commandEncoder.dispatchThreads(threadsPerGrid, threadsPerThreadgroup: threadsPerThreadgroup)
         
-          commandEncoder.endEncoding()
+        commandEncoder.endEncoding()
         
-          commandBuffer.commit()
+        commandBuffer.commit()
         
-          commandBuffer.waitUntilCompleted()
+        commandBuffer.waitUntilCompleted()
         
-          unitsOfWorkDone += sizeOfWorkBatch
+        unitsOfWorkDone += sizeOfWorkBatch
         
-          if let error = commandBuffer.error
-          {
-            LogQueue.shared.error(destination: nil, message: "Metal error in ComputeEnergyGrid: " + error.localizedDescription)
-            return []
-          }
-        }
-        else
+        if let error = commandBuffer.error
         {
-          LogQueue.shared.error(destination: nil, message: "Metal error in ComputeEnergyGrid: Could not create command-buffers and -encoders.")
-          return []
+          LogQueue.shared.error(destination: nil, message: "Metal error in \(name): " + error.localizedDescription)
+          return false
         }
       }
-      
-      var outputData: [Float] = [Float](repeating: 0.0, count: sizeX * sizeY * sizeZ)
-      memcpy(&outputData, bufferOutput.contents(), outputData.count * MemoryLayout<Float>.stride)
-      
-      return outputData
+      else
+      {
+        LogQueue.shared.error(destination: nil, message: "Metal error in \(name): Could not create command-buffers and -encoders.")
+        return false
+      }
     }
-    return []
+    return true
   }
   
+  // The Boltzmann-sum is reduced while the grid is streamed, so the full grid is never stored (the symmetry of the space group is not used).
   public static func computeVoidFractions(device: MTLDevice, commandQueue: MTLCommandQueue, structures: [SKRenderAdsorptionSurfaceStructure]) -> [Double]
   {
     var voidFractions: [Double] = []
     for structure in structures
     {
-      var data: [Float] = []
-      
       let cell: SKCell = structure.cell
       let positions: [SIMD3<Double>] = structure.atomUnitCellPositions
       let potentialParameters: [SIMD2<Double>] = structure.potentialParameters
@@ -259,21 +607,16 @@ public class SKMetalFramework
       let numberOfReplicas: SIMD3<Int32> = cell.numberOfReplicas(forCutoff: 12.0)
       let framework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: positions, potentialParameters: potentialParameters, unitCell: cell.unitCell, numberOfReplicas: numberOfReplicas)
       
-      data = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: probeParameters)
+      let reduction: SKEnergyGridReduction = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: probeParameters, reduction: SKEnergyGridReduction(temperature: 298.0))  // K_B  chosen as 1.0 (energy units are Kelvin)
       
-      var numberOfLowEnergyValues: Double = 0.0
-      for value in data
-      {
-        numberOfLowEnergyValues += exp(-(1.0/298.0) * Double(value))  // K_B  chosen as 1.0 (energy units are Kelvin)
-      }
-      
-      let voidFraction = Double(numberOfLowEnergyValues)/Double(128*128*128)
+      let voidFraction = reduction.boltzmannSum/Double(128*128*128)
       voidFractions.append(voidFraction)
     }
     return voidFractions
   }
   
-  public static func computeNitrogenSurfaceArea(device: MTLDevice, commandQueue: MTLCommandQueue, structures: [SKRenderAdsorptionSurfaceStructure]) -> ([Double], [Double])
+  // useSymmetry: compute only the symmetry-unique points of a 121^3 grid (see 'SKEnergyGridSymmetry'), instead of the full 128^3 grid
+  public static func computeNitrogenSurfaceArea(device: MTLDevice, commandQueue: MTLCommandQueue, structures: [SKRenderAdsorptionSurfaceStructure], useSymmetry: Bool = false) -> ([Double], [Double])
   {
     var surfaceAreas: (gravimetric: [Double], volumetric: [Double]) = ([],[])
     
@@ -289,56 +632,33 @@ public class SKMetalFramework
       let numberOfReplicas: SIMD3<Int32> = cell.numberOfReplicas(forCutoff: 12.0)
       let framework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: positions, potentialParameters: potentialParameters, unitCell: cell.unitCell, numberOfReplicas: numberOfReplicas)
       
-      data = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: probeParameters)
+      // 121 points (120 periodic points) keep the centring-, screw- and glide-translations of the space group on the grid
+      let size: Int = useSymmetry ? SKEnergyGridSymmetry.symmetricGridSize(128) : 128
+      if useSymmetry
+      {
+        data = framework.ComputeEnergyGrid(size, sizeY: size, sizeZ: size, probeParameter: probeParameters, spaceGroup: SKSpacegroup(HallNumber: structure.spaceGroupHallNumber ?? 1))
+      }
+      else
+      {
+        data = framework.ComputeEnergyGrid(size, sizeY: size, sizeZ: size, probeParameter: probeParameters)
+      }
       
-      let marchingCubes = SKMetalMarchingCubes128(device: device, commandQueue: commandQueue, dimensions: SIMD3<Int32>(128,128,128))
+      let marchingCubes = SKMetalMarchingCubes128(device: device, commandQueue: commandQueue, dimensions: SIMD3<Int32>(Int32(size),Int32(size),Int32(size)))
       marchingCubes.isoValue = Float(0.0)   // modified from: -probeParameters.x (which cause artifacts)
       
-      var surfaceVertexBuffer: MTLBuffer? = nil
-      var numberOfTriangles: Int  = 0
-      
+      // the area is accumulated on the GPU, without generating the triangles
+      var totalArea: Double = 0.0
       do
       {
-        if let buffer = try marchingCubes.prepareHistoPyramids(data)
-        {
-          surfaceVertexBuffer = buffer
-          numberOfTriangles = buffer.length / (3 * 3 * MemoryLayout<SIMD4<Float>>.stride)
-        }
+        totalArea = try marchingCubes.surfaceArea(data, unitCell: cell.unitCell)
       }
       catch
       {
         LogQueue.shared.error(destination: nil, message: error.localizedDescription)
       }
       
-      if numberOfTriangles > 0,
-        let ptr: UnsafeMutableRawPointer = surfaceVertexBuffer?.contents()
-      {
-        let float4Ptr = ptr.bindMemory(to: SIMD4<Float>.self, capacity: Int(numberOfTriangles) * 3 * 3 )
-        
-        var totalArea: Double = 0.0
-        for i in stride(from: 0, through: (Int(numberOfTriangles) * 3 * 3 - 1), by: 9)
-        {
-          let unitCell: double3x3 = cell.unitCell
-          let v1 = unitCell * SIMD3<Double>(Double(float4Ptr[i].x),Double(float4Ptr[i].y),Double(float4Ptr[i].z))
-          let v2 = unitCell * SIMD3<Double>(Double(float4Ptr[i+3].x),Double(float4Ptr[i+3].y),Double(float4Ptr[i+3].z))
-          let v3 = unitCell * SIMD3<Double>(Double(float4Ptr[i+6].x),Double(float4Ptr[i+6].y),Double(float4Ptr[i+6].z))
-          
-          let v4: SIMD3<Double> = cross((v2-v1), (v3-v1))
-          let area: Double = 0.5 * simd.length(v4)
-          if area.isFinite && fabs(area) < 1.0
-          {
-            totalArea += area
-          }
-        }
-        
-        surfaceAreas.gravimetric.append(totalArea * SKConstant.AvogadroConstantPerAngstromSquared / structure.structureMass)
-        surfaceAreas.volumetric.append(totalArea * 1e4 / structure.cell.volume)
-      }
-      else
-      {
-        surfaceAreas.gravimetric.append(0.0)
-        surfaceAreas.volumetric.append(0.0)
-      }
+      surfaceAreas.gravimetric.append(totalArea * SKConstant.AvogadroConstantPerAngstromSquared / structure.structureMass)
+      surfaceAreas.volumetric.append(totalArea * 1e4 / structure.cell.volume)
     }
     return surfaceAreas
   }
@@ -54,6 +54,8 @@ public class SKMetalMarchingCubes128
   var constructHPLevelPipelineState: MTLComputePipelineState? = nil
   var classifyCubesPipelineState: MTLComputePipelineState? = nil
   var traverseHPPipelineState: MTLComputePipelineState? = nil
+  var surfaceAreaKernel: MTLFunction? = nil
+  var surfaceAreaPipelineState: MTLComputePipelineState? = nil
   
   public init(device: MTLDevice, commandQueue: MTLCommandQueue, dimensions: SIMD3<Int32>)
   {
@@ -105,6 +107,68 @@ public class SKMetalMarchingCubes128
         fatalError("Error occurred when creating compute pipeline state \(error)")
       }
     }
+    
+    surfaceAreaKernel = defaultLibrary.makeFunction(name: "computeSurfaceArea")
+    if let surfaceAreaKernel = surfaceAreaKernel
+    {
+      do
+      {
+        surfaceAreaPipelineState = try device.makeComputePipelineState(function: surfaceAreaKernel)
+      }
+      catch
+      {
+        fatalError("Error occurred when creating compute pipeline state \(error)")
+      }
+    }
+  }
+  
+  // The area of the iso-surface in Cartesian space (using the cell matrix), accumulated per line of cubes on the GPU without
+  // generating a vertex buffer. The memory use is independent of the number of triangles.
+  public func surfaceArea(_ voxels: [Float], unitCell: double3x3) throws -> Double
+  {
+    guard let surfaceAreaPipelineState = surfaceAreaPipelineState else { return 0.0 }
+    
+    let numberOfLines: Int = Int(dimensions.y) * Int(dimensions.z)
+    guard numberOfLines > 0, voxels.count >= Int(dimensions.x) * numberOfLines else { return 0.0 }
+    
+    guard let voxelBuffer: MTLBuffer = device.makeBuffer(bytes: voxels, length: MemoryLayout<Float>.stride * Int(dimensions.x) * numberOfLines, options: .storageModeShared),
+          let lineAreaBuffer: MTLBuffer = device.makeBuffer(length: MemoryLayout<Float>.stride * numberOfLines, options: .storageModeShared) else {
+      throw SimulationKitError.couldNotCreateBuffer
+    }
+    
+    var cellMatrix: float3x3 = float3x3(Double3x3: unitCell)
+    
+    guard let commandBuffer = commandQueue.makeCommandBuffer() else {
+      throw SimulationKitError.couldNotMakeCommandBuffer
+    }
+    
+    guard let commandEncoder = commandBuffer.makeComputeCommandEncoder() else {
+      throw SimulationKitError.couldNotMakeCommandEncoder
+    }
+    commandEncoder.setComputePipelineState(surfaceAreaPipelineState)
+    commandEncoder.setBuffer(voxelBuffer, offset: 0, index: 0)
+    commandEncoder.setBuffer(lineAreaBuffer, offset: 0, index: 1)
+    commandEncoder.setBytes(&isoValue, length: MemoryLayout<Float>.stride, index: 2)
+    commandEncoder.setBytes(&dimensions, length: MemoryLayout<SIMD3<UInt32>>.stride, index: 3)
+    commandEncoder.setBytes(&cellMatrix, length: MemoryLayout<float3x3>.stride, index: 4)
+    let threadsPerGrid = MTLSize(width: Int(dimensions.y), height: Int(dimensions.z), depth: 1)
+    let w: Int = surfaceAreaPipelineState.threadExecutionWidth
+    let h: Int = surfaceAreaPipelineState.maxTotalThreadsPerThreadgroup / w
+    let threadsPerThreadgroup: MTLSize = MTLSizeMake(w, h, 1)
+    commandEncoder.dispatchThreads(threadsPerGrid, threadsPerThreadgroup: threadsPerThreadgroup)
+    commandEncoder.endEncoding()
+    
+    commandBuffer.commit()
+    commandBuffer.waitUntilCompleted()
+    
+    if let error = commandBuffer.error
+    {
+      throw NSError(domain: SimulationKitError.domain, code: SimulationKitError.code.genericMetalError.rawValue, userInfo: [NSLocalizedDescriptionKey : error.localizedDescription])
+    }
+    
+    // the partial sums are added in double precision
+    let lineAreas: UnsafeBufferPointer<Float> = UnsafeBufferPointer(start: lineAreaBuffer.contents().bindMemory(to: Float.self, capacity: numberOfLines), count: numberOfLines)
+    return lineAreas.reduce(0.0){$0 + Double($1)}
   }
   
   
@@ -125,11 +189,12 @@ public class SKMetalMarchingCubes128
       let size: Int = bufferSize
       var images: [MTLTexture] = []
       
+      // the data is not padded: the kernels read the raw data modulo the dimensions (periodic), only the pyramid levels are power-of-two cubes
       let textureDescriptorRawData = MTLTextureDescriptor()
       textureDescriptorRawData.textureType = MTLTextureType.type3D
-      textureDescriptorRawData.height = bufferSize;
-      textureDescriptorRawData.width = bufferSize;
-      textureDescriptorRawData.depth = bufferSize;
+      textureDescriptorRawData.width = Int(dimensions.x);
+      textureDescriptorRawData.height = Int(dimensions.y);
+      textureDescriptorRawData.depth = Int(dimensions.z);
       textureDescriptorRawData.pixelFormat = MTLPixelFormat.r32Float;
       textureDescriptorRawData.mipmapLevelCount = 1
       textureDescriptorRawData.resourceOptions = .storageModeManaged
@@ -138,7 +203,10 @@ public class SKMetalMarchingCubes128
       guard let rawDataTexture: MTLTexture = device.makeTexture(descriptor: textureDescriptorRawData) else {
         throw SimulationKitError.couldNotCreateTexture }
       
-      let region: MTLRegion = MTLRegionMake3D(0, 0, 0, bufferSize, bufferSize, bufferSize)
+      guard voxels.count >= Int(dimensions.x) * Int(dimensions.y) * Int(dimensions.z) else {
+        throw SimulationKitError.couldNotCreateTexture }
+      
+      let region: MTLRegion = MTLRegionMake3D(0, 0, 0, Int(dimensions.x), Int(dimensions.y), Int(dimensions.z))
       rawDataTexture.replace(region: region, mipmapLevel: 0, slice: 0, withBytes: voxels, bytesPerRow: MemoryLayout<Float>.stride * region.size.width, bytesPerImage: MemoryLayout<Float>.stride * region.size.width * region.size.height)
       
       for i in 1..<powerOfTwo
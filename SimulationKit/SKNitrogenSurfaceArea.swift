@@ -12,17 +12,33 @@ import simd
 
 public class SKNitrogenSurfaceArea
 {
-  public static func compute(structures: [SKRenderAdsorptionSurfaceStructure]) -> ([Double], [Double])
+  // useSymmetry: opt-in, uses the symmetry of the space group for the energy grid (a 121^3 instead of a 128^3 grid, so the areas differ slightly)
+  public static func compute(structures: [SKRenderAdsorptionSurfaceStructure], useSymmetry: Bool = false) -> ([Double], [Double])
   {
     if let device = MTLCreateSystemDefaultDevice(),
       let commandQueue: MTLCommandQueue = device.makeCommandQueue()
     {
-      return SKMetalFramework.computeNitrogenSurfaceArea(device: device, commandQueue: commandQueue, structures: structures)
+      return SKMetalFramework.computeNitrogenSurfaceArea(device: device, commandQueue: commandQueue, structures: structures, useSymmetry: useSymmetry)
     }
-    return ([],[])
+    return SKCPUFramework.computeNitrogenSurfaceArea(structures: structures, useSymmetry: useSymmetry)
   }
   
-  public static func compute(structures: [(cell: SKCell, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], probeParameters: SIMD2<Double>)]) throws -> [Double]
+  // Geometric accessible surface area with a nitrogen probe (see 'SKAccessibleSurfaceArea'), an alternative to the iso-surface area.
+  // Returns the gravimetric (m^2/g) and volumetric (m^2/cm^3) surface areas.
+  public static func computeAccessibleSurfaceArea(structures: [SKRenderAdsorptionSurfaceStructure], probeDiameter: Double = 3.31) -> ([Double], [Double])
+  {
+    var surfaceAreas: (gravimetric: [Double], volumetric: [Double]) = ([],[])
+    for structure in structures
+    {
+      let surfaceArea: SKAccessibleSurfaceArea = SKAccessibleSurfaceArea(cell: structure.cell, positions: structure.atomUnitCellPositions, potentialParameters: structure.potentialParameters, structureMass: structure.structureMass)
+      let result: (area: Double, gravimetric: Double, volumetric: Double) = surfaceArea.compute(probeDiameter: probeDiameter)
+      surfaceAreas.gravimetric.append(result.gravimetric)
+      surfaceAreas.volumetric.append(result.volumetric)
+    }
+    return surfaceAreas
+  }
+  
+  public static func compute(structures: [(cell: SKCell, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], probeParameters: SIMD2<Double>)], blockInaccessiblePockets: Bool = false) throws -> [Double]
   {
     var results: [Double] = []
     if let device = MTLCreateSystemDefaultDevice(),
@@ -37,46 +53,17 @@ public class SKNitrogenSurfaceArea
         
         data = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: structure.probeParameters)
         
+        // the surfaces of the inaccessible pockets are removed by blocking them with the same iso-value as the marching cubes
+        if blockInaccessiblePockets
+        {
+          SKPoreConnectivity.blockPockets(&data, dimensions: SIMD3<Int>(128,128,128), threshold: 0.0)
+        }
+        
         let marchingCubes = SKMetalMarchingCubes128(device: device, commandQueue: commandQueue, dimensions: SIMD3<Int32>(128,128,128))
         marchingCubes.isoValue = Float(0.0)   // modified from: -probeParameters.x (which cause artifacts)
         
-        var surfaceVertexBuffer: MTLBuffer? = nil
-        var numberOfTriangles: Int  = 0
-        
-      
-        if let buffer = try marchingCubes.prepareHistoPyramids(data)
-        {
-          surfaceVertexBuffer = buffer
-          numberOfTriangles = buffer.length / (3 * 3 * MemoryLayout<SIMD4<Float>>.stride)
-        }      
-        
-        if numberOfTriangles > 0,
-          let ptr: UnsafeMutableRawPointer = surfaceVertexBuffer?.contents()
-        {
-          let float4Ptr = ptr.bindMemory(to: SIMD4<Float>.self, capacity: Int(numberOfTriangles) * 3 * 3 )
-          
-          var totalArea: Double = 0.0
-          for i in stride(from: 0, through: (Int(numberOfTriangles) * 3 * 3 - 1), by: 9)
-          {
-            let unitCell: double3x3 = structure.cell.unitCell
-            let v1 = unitCell * SIMD3<Double>(Double(float4Ptr[i].x),Double(float4Ptr[i].y),Double(float4Ptr[i].z))
-            let v2 = unitCell * SIMD3<Double>(Double(float4Ptr[i+3].x),Double(float4Ptr[i+3].y),Double(float4Ptr[i+3].z))
-            let v3 = unitCell * SIMD3<Double>(Double(float4Ptr[i+6].x),Double(float4Ptr[i+6].y),Double(float4Ptr[i+6].z))
-            
-            let v4: SIMD3<Double> = cross((v2-v1), (v3-v1))
-            let area: Double = 0.5 * simd.length(v4)
-            if area.isFinite && fabs(area) < 1.0
-            {
-              totalArea += area
-            }
-          }
-          debugPrint("total area \(totalArea)")
-          results.append(totalArea)
-        }
-        else
-        {
-          results.append(0.0)
-        }
+        let totalArea: Double = try marchingCubes.surfaceArea(data, unitCell: structure.cell.unitCell)
+        results.append(totalArea)
       }
     }
     return results
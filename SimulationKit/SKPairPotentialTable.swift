@@ -0,0 +1,213 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+import SymmetryKit
+
+// Tabulated pair-potentials for the energy grids. The framework atoms are collapsed into types (one type per unique set of parameters), and
+// the interaction of every type with the probe is stored as a cubic (Hermite) spline in r^2 on a uniform grid between the core-radius and the
+// cutoff. The kernels then only need a table-lookup per pair instead of the mixing-rules and powers, and any potential can be used.
+public struct SKPairPotentialTable
+{
+  public enum Truncation: Int
+  {
+    case truncated = 0          // the potential is zero beyond the cutoff
+    case cutAndShifted = 1      // the potential is shifted to be zero at the cutoff
+    case tailCorrected = 2      // truncated, the average contribution beyond the cutoff is added to every grid point
+  }
+  
+  public static let cutoff: Double = 12.0
+  public static let numberOfIntervals: Int = 2048
+  
+  // the type of each framework atom
+  public var atomTypes: [Int32] = []
+  
+  // per type: the square of the core-radius (below which the potential is constant) and the inverse of the spacing in r^2
+  public var rangeParameters: [SIMD2<Float>] = []
+  
+  // per type 'numberOfIntervals' polynomials a + b t + c t^2 + d t^3 with t in [0,1] the position within the interval
+  public var coefficients: [SIMD4<Float>] = []
+  
+  // the energy added to every grid point (zero unless tail-corrected)
+  public var tailCorrection: Float = 0.0
+  
+  public var numberOfTypes: Int
+  {
+    return rangeParameters.count
+  }
+  
+  // potentials: per type the energy (in Kelvin) as a function of r^2, coreRadii: per type the distance below which the potential is
+  // held constant (the energies there are very large anyway)
+  public init(atomTypes: [Int32], potentials: [(Double) -> Double], coreRadii: [Double], truncation: Truncation, unitCell: double3x3)
+  {
+    let numberOfIntervals: Int = SKPairPotentialTable.numberOfIntervals
+    let cutoffSquared: Double = SKPairPotentialTable.cutoff * SKPairPotentialTable.cutoff
+    
+    self.atomTypes = atomTypes
+    
+    for (type, potential) in potentials.enumerated()
+    {
+      let minimum: Double = min(coreRadii[type] * coreRadii[type], 0.5 * cutoffSquared)
+      let spacing: Double = (cutoffSquared - minimum) / Double(numberOfIntervals)
+      let shift: Double = (truncation == .cutAndShifted) ? potential(cutoffSquared) : 0.0
+      
+      let values: [Double] = (0...numberOfIntervals).map{potential(minimum + Double($0) * spacing) - shift}
+      
+      // the derivatives (times the spacing) by finite differences, one-sided at the ends
+      let derivatives: [Double] = (0...numberOfIntervals).map{i -> Double in
+        switch(i)
+        {
+        case 0:
+          return values[1] - values[0]
+        case numberOfIntervals:
+          return values[numberOfIntervals] - values[numberOfIntervals - 1]
+        default:
+          return 0.5 * (values[i + 1] - values[i - 1])
+        }
+      }
+      
+      for i in 0..<numberOfIntervals
+      {
+        let a: Double = values[i]
+        let b: Double = derivatives[i]
+        let c: Double = 3.0 * (values[i + 1] - values[i]) - 2.0 * derivatives[i] - derivatives[i + 1]
+        let d: Double = 2.0 * (values[i] - values[i + 1]) + derivatives[i] + derivatives[i + 1]
+        coefficients.append(SIMD4<Float>(Float(a), Float(b), Float(c), Float(d)))
+      }
+      rangeParameters.append(SIMD2<Float>(Float(minimum), Float(1.0 / spacing)))
+    }
+    
+    if truncation == .tailCorrected
+    {
+      // 4 pi / V \int_rc^\infty r^2 u(r) dr per atom, integrated with Simpson's rule up to 10 times the cutoff
+      let volume: Double = SKCell(unitCell: unitCell).volume
+      let numberOfSteps: Int = 4096
+      let lower: Double = SKPairPotentialTable.cutoff
+      let upper: Double = 10.0 * SKPairPotentialTable.cutoff
+      let h: Double = (upper - lower) / Double(numberOfSteps)
+      
+      let tails: [Double] = potentials.map{potential -> Double in
+        var sum: Double = 0.0
+        for i in 0...numberOfSteps
+        {
+          let r: Double = lower + Double(i) * h
+          let weight: Double = (i == 0 || i == numberOfSteps) ? 1.0 : ((i % 2 == 1) ? 4.0 : 2.0)
+          sum += weight * r * r * potential(r * r)
+        }
+        return 4.0 * Double.pi * sum * h / 3.0 / volume
+      }
+      tailCorrection = Float(atomTypes.reduce(0.0){$0 + tails[Int($1)]})
+    }
+  }
+  
+  // Lennard-Jones with Lorentz-Berthelot mixing with the probe (like the analytical kernels), atoms with the same parameters share a type.
+  public init(potentialParameters: [SIMD2<Double>], probeParameter: SIMD2<Double>, truncation: Truncation, unitCell: double3x3)
+  {
+    var typeParameters: [SIMD2<Double>] = []
+    var typeIndex: [SIMD2<Double>: Int32] = [:]
+    let atomTypes: [Int32] = potentialParameters.map{parameters -> Int32 in
+      if let type: Int32 = typeIndex[parameters]
+      {
+        return type
+      }
+      let type: Int32 = Int32(typeParameters.count)
+      typeIndex[parameters] = type
+      typeParameters.append(parameters)
+      return type
+    }
+    
+    let potentials: [(Double) -> Double] = typeParameters.map{parameters -> (Double) -> Double in
+      let epsilon: Double = 4.0 * sqrt(parameters.x * probeParameter.x)
+      let sigma: Double = 0.5 * (parameters.y + probeParameter.y)
+      return { rr in
+        let temp: Double = sigma * sigma / rr
+        let rri3: Double = temp * temp * temp
+        return epsilon * (rri3 * (rri3 - 1.0))
+      }
+    }
+    let coreRadii: [Double] = typeParameters.map{0.5 * (0.5 * ($0.y + probeParameter.y))}
+    
+    self.init(atomTypes: atomTypes, potentials: potentials, coreRadii: coreRadii, truncation: truncation, unitCell: unitCell)
+  }
+  
+  @inline(__always)
+  func value(type: Int, rr: Float) -> Float
+  {
+    let range: SIMD2<Float> = rangeParameters[type]
+    let x: Float = max(0.0, (rr - range.x) * range.y)
+    let index: Int = min(Int(x), SKPairPotentialTable.numberOfIntervals - 1)
+    let t: Float = x - Float(index)
+    let c: SIMD4<Float> = coefficients[type * SKPairPotentialTable.numberOfIntervals + index]
+    return c.x + t * (c.y + t * (c.z + t * c.w))
+  }
+  
+  // SIMD-version of 'value': the intervals of all lanes are located at once, the coefficients are gathered into one vector per power of t
+  // and the polynomials are evaluated for all lanes together. Lanes outside of the mask (which may have NaN or very large distances) are zero.
+  @inline(__always)
+  func values(types: SIMD8<Int32>, rr: SIMD8<Float>, mask: SIMDMask<SIMD8<Float.SIMDMaskScalar>>) -> SIMD8<Float>
+  {
+    let numberOfIntervals: Int32 = Int32(SKPairPotentialTable.numberOfIntervals)
+    
+    var minimum: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+    var scale: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+    for lane in 0..<8
+    {
+      let range: SIMD2<Float> = rangeParameters[Int(types[lane])]
+      minimum[lane] = range.x
+      scale[lane] = range.y
+    }
+    
+    // the comparison fails for NaN, so the conversion to integers below is always valid
+    var x: SIMD8<Float> = (rr - minimum) * scale
+    x.replace(with: 0.0, where: .!(x .> 0.0) .| .!mask)
+    x = pointwiseMin(x, SIMD8<Float>(repeating: Float(numberOfIntervals)))
+    let index: SIMD8<Int32> = pointwiseMin(SIMD8<Int32>(x, rounding: .towardZero), SIMD8<Int32>(repeating: numberOfIntervals - 1))
+    let t: SIMD8<Float> = x - SIMD8<Float>(index)
+    let offset: SIMD8<Int32> = types &* numberOfIntervals &+ index
+    
+    var a: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+    var b: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+    var c: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+    var d: SIMD8<Float> = SIMD8<Float>(repeating: 0.0)
+    for lane in 0..<8
+    {
+      let coefficient: SIMD4<Float> = coefficients[Int(offset[lane])]
+      a[lane] = coefficient.x
+      b[lane] = coefficient.y
+      c[lane] = coefficient.z
+      d[lane] = coefficient.w
+    }
+    
+    let value: SIMD8<Float> = a + t * (b + t * (c + t * d))
+    return value.replacing(with: 0.0, where: .!mask)
+  }
+}
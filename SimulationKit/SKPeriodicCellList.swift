@@ -0,0 +1,209 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+import SymmetryKit
+
+// Periodic cell list for overlap tests of points with atomic spheres. The atoms are replicated into a super cell with perpendicular widths of
+// at least twice the largest radius, so that the minimum image convention holds, and the cells are at least as wide as the largest radius.
+// The neighbouring cells of a cell are unique, also when there are less than three cells in a direction. All positions are fractional positions
+// of the super cell; the first atoms (with the same indices as in the unit cell) are the atoms of the unit cell.
+struct SKPeriodicCellList
+{
+  let superCell: double3x3
+  let inverseSuperCell: double3x3
+  
+  // the scaling from fractional positions of the unit cell to the super cell
+  let scaling: SIMD3<Double>
+  
+  let positions: [SIMD3<Double>]
+  let radii: [Double]
+  let maximumRadius: Double
+  
+  let numberOfCells: SIMD3<Int>
+  
+  // the smallest perpendicular width of a cell in Angstrom
+  let cellWidth: Double
+  let head: [Int]
+  let next: [Int]
+  let offsets: (x: [Int], y: [Int], z: [Int])
+  
+  init(cell: SKCell, positions unitCellPositions: [SIMD3<Double>], radii unitCellRadii: [Double])
+  {
+    let maximumRadius: Double = max(unitCellRadii.max() ?? 0.0, 1e-3)
+    
+    let numberOfReplicas: SIMD3<Int32> = cell.numberOfReplicas(forCutoff: maximumRadius)
+    let replicas: SIMD3<Int> = SIMD3<Int>(Int(max(1, numberOfReplicas.x)), Int(max(1, numberOfReplicas.y)), Int(max(1, numberOfReplicas.z)))
+    self.superCell = double3x3([Double(replicas.x) * cell.unitCell[0], Double(replicas.y) * cell.unitCell[1], Double(replicas.z) * cell.unitCell[2]])
+    self.inverseSuperCell = superCell.inverse
+    self.scaling = SIMD3<Double>(1.0 / Double(replicas.x), 1.0 / Double(replicas.y), 1.0 / Double(replicas.z))
+    
+    var positions: [SIMD3<Double>] = []
+    var radii: [Double] = []
+    positions.reserveCapacity(unitCellPositions.count * replicas.x * replicas.y * replicas.z)
+    radii.reserveCapacity(unitCellPositions.count * replicas.x * replicas.y * replicas.z)
+    for k in 0..<replicas.z
+    {
+      for j in 0..<replicas.y
+      {
+        for i in 0..<replicas.x
+        {
+          for atom in 0..<unitCellPositions.count
+          {
+            let position: SIMD3<Double> = unitCellPositions[atom] - floor(unitCellPositions[atom])
+            positions.append((position + SIMD3<Double>(Double(i), Double(j), Double(k))) * scaling)
+            radii.append(unitCellRadii[atom])
+          }
+        }
+      }
+    }
+    self.positions = positions
+    self.radii = radii
+    self.maximumRadius = maximumRadius
+    
+    let perpendicularWidths: SIMD3<Double> = SIMD3<Double>(Double(replicas.x), Double(replicas.y), Double(replicas.z)) * cell.perpendicularWidths
+    let numberOfCells: SIMD3<Int> = SIMD3<Int>(max(1, Int(perpendicularWidths.x / maximumRadius)), max(1, Int(perpendicularWidths.y / maximumRadius)), max(1, Int(perpendicularWidths.z / maximumRadius)))
+    self.numberOfCells = numberOfCells
+    self.cellWidth = (perpendicularWidths / SIMD3<Double>(numberOfCells)).min()
+    
+    var head: [Int] = [Int](repeating: -1, count: numberOfCells.x * numberOfCells.y * numberOfCells.z)
+    var next: [Int] = [Int](repeating: -1, count: positions.count)
+    for (index, position) in positions.enumerated()
+    {
+      let cellIndex: Int = SKPeriodicCellList.index(SKPeriodicCellList.cell(position, numberOfCells: numberOfCells), numberOfCells: numberOfCells)
+      next[index] = head[cellIndex]
+      head[cellIndex] = index
+    }
+    self.head = head
+    self.next = next
+    
+    func neighbourOffsets(_ n: Int) -> [Int]
+    {
+      return n >= 3 ? [-1, 0, 1] : Array(0..<n)
+    }
+    self.offsets = (neighbourOffsets(numberOfCells.x), neighbourOffsets(numberOfCells.y), neighbourOffsets(numberOfCells.z))
+  }
+  
+  static func cell(_ position: SIMD3<Double>, numberOfCells: SIMD3<Int>) -> SIMD3<Int>
+  {
+    let s: SIMD3<Double> = position - floor(position)
+    return SIMD3<Int>(min(Int(s.x * Double(numberOfCells.x)), numberOfCells.x - 1),
+                      min(Int(s.y * Double(numberOfCells.y)), numberOfCells.y - 1),
+                      min(Int(s.z * Double(numberOfCells.z)), numberOfCells.z - 1))
+  }
+  
+  static func index(_ cell: SIMD3<Int>, numberOfCells: SIMD3<Int>) -> Int
+  {
+    let c: SIMD3<Int> = SIMD3<Int>((cell.x % numberOfCells.x + numberOfCells.x) % numberOfCells.x,
+                                   (cell.y % numberOfCells.y + numberOfCells.y) % numberOfCells.y,
+                                   (cell.z % numberOfCells.z + numberOfCells.z) % numberOfCells.z)
+    return c.x + numberOfCells.x * (c.y + numberOfCells.y * c.z)
+  }
+  
+  // returns true when 'predicate' holds for any of the atoms in the cells neighbouring 'position' (stops at the first one)
+  func contains(_ position: SIMD3<Double>, where predicate: (Int) -> Bool) -> Bool
+  {
+    let center: SIMD3<Int> = SKPeriodicCellList.cell(position, numberOfCells: numberOfCells)
+    for dz in offsets.z
+    {
+      for dy in offsets.y
+      {
+        for dx in offsets.x
+        {
+          // with less than three cells in a direction all cells are visited (without the offset of the center)
+          let neighbour: SIMD3<Int> = SIMD3<Int>(numberOfCells.x >= 3 ? center.x + dx : dx,
+                                                 numberOfCells.y >= 3 ? center.y + dy : dy,
+                                                 numberOfCells.z >= 3 ? center.z + dz : dz)
+          var atom: Int = head[SKPeriodicCellList.index(neighbour, numberOfCells: numberOfCells)]
+          while atom >= 0
+          {
+            if predicate(atom)
+            {
+              return true
+            }
+            atom = next[atom]
+          }
+        }
+      }
+    }
+    return false
+  }
+  
+  // whether the point (fractional position of the super cell) lies inside any of the spheres (except the one of atom 'excluded')
+  func overlaps(_ point: SIMD3<Double>, excluding excluded: Int = -1) -> Bool
+  {
+    return contains(point) { atom in
+      guard atom != excluded else { return false }
+      var ds: SIMD3<Double> = point - positions[atom]
+      ds -= ds.rounded(.toNearestOrEven)
+      let dr: SIMD3<Double> = superCell * ds
+      return length_squared(dr) < radii[atom] * radii[atom]
+    }
+  }
+  
+  // The distance from the point (fractional position of the super cell) to the nearest sphere surface, zero inside a sphere. The cells are
+  // visited in shells of increasing distance, with the periodic images of the super cell beyond the neighbouring cells, until the atoms of
+  // the shells that are left (at least 'shell - 1' cell-widths away) can not be closer. The search stops at 'maximumDistance'.
+  func distanceToSurface(_ point: SIMD3<Double>, maximumDistance: Double = Double.infinity) -> Double
+  {
+    let p: SIMD3<Double> = point - floor(point)
+    let center: SIMD3<Int> = SKPeriodicCellList.cell(p, numberOfCells: numberOfCells)
+    
+    var nearest: Double = maximumDistance
+    var shell: Int = 0
+    while nearest > 0.0 && Double(shell - 1) * cellWidth - maximumRadius < nearest
+    {
+      for dz in -shell...shell
+      {
+        for dy in -shell...shell
+        {
+          // the inner part of the shell has been visited already, only its faces are left
+          let step: Int = (abs(dz) == shell || abs(dy) == shell) ? 1 : 2 * shell
+          for dx in stride(from: -shell, through: shell, by: step)
+          {
+            let neighbour: SIMD3<Int> = center &+ SIMD3<Int>(dx, dy, dz)
+            let image: SIMD3<Double> = floor(SIMD3<Double>(neighbour) / SIMD3<Double>(numberOfCells))
+            var atom: Int = head[SKPeriodicCellList.index(neighbour, numberOfCells: numberOfCells)]
+            while atom >= 0
+            {
+              let dr: SIMD3<Double> = superCell * (positions[atom] + image - p)
+              nearest = min(nearest, length(dr) - radii[atom])
+              atom = next[atom]
+            }
+          }
+        }
+      }
+      shell += 1
+    }
+    return max(nearest, 0.0)
+  }
+}
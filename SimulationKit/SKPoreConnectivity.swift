@@ -0,0 +1,365 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+import Metal
+import SymmetryKit
+
+// Periodic connected-component labelling of the accessible part (values below 'threshold') of an energy grid. The grid uses the convention of
+// 'ComputeEnergyGrid': the last point in each direction is the periodic image of the first one, so the labelling is done on the periodic points
+// and the labels of the images are copied. The grid is split in slabs along z that are labelled in parallel (union-find restricted to the slab),
+// after which the slabs are merged across their boundaries (including the periodic one). The union-find keeps the periodic image of each point
+// relative to its root: a connection between two points of the same component that winds around the cell is a channel, and the rank of the
+// winding vectors of a component is its dimensionality. Components without winding are inaccessible pockets.
+public struct SKPoreConnectivity
+{
+  public struct Component
+  {
+    public var numberOfPoints: Int
+    public var dimensionality: Int
+    
+    public var isChannel: Bool
+    {
+      return dimensionality > 0
+    }
+  }
+  
+  public let dimensions: SIMD3<Int>
+  
+  // the index of the component for each grid point, -1 for the points that are not accessible
+  public let labels: [Int32]
+  public let components: [Component]
+  
+  public var numberOfChannels: Int
+  {
+    return components.filter{$0.isChannel}.count
+  }
+  
+  public var numberOfPockets: Int
+  {
+    return components.filter{!$0.isChannel}.count
+  }
+  
+  public var dimensionality: Int
+  {
+    return components.map{$0.dimensionality}.max() ?? 0
+  }
+  
+  // true for the grid points in inaccessible pockets
+  public var pocketMask: [Bool]
+  {
+    let isPocket: [Bool] = components.map{!$0.isChannel}
+    return labels.map{$0 >= 0 && isPocket[Int($0)]}
+  }
+  
+  public init(values: [Float], dimensions: SIMD3<Int>, threshold: Float)
+  {
+    self.dimensions = dimensions
+    
+    let n: SIMD3<Int> = SIMD3<Int>(max(1, dimensions.x - 1), max(1, dimensions.y - 1), max(1, dimensions.z - 1))
+    let numberOfPoints: Int = n.x * n.y * n.z
+    guard dimensions.x > 0, dimensions.y > 0, dimensions.z > 0, values.count >= dimensions.x * dimensions.y * dimensions.z else
+    {
+      self.labels = [Int32](repeating: -1, count: values.count)
+      self.components = []
+      return
+    }
+    
+    // the periodic points, accessible or not
+    var accessible: [Bool] = [Bool](repeating: false, count: numberOfPoints)
+    for k in 0..<n.z
+    {
+      for j in 0..<n.y
+      {
+        for i in 0..<n.x
+        {
+          accessible[i + n.x * (j + n.y * k)] = values[i + dimensions.x * (j + dimensions.y * k)] < threshold
+        }
+      }
+    }
+    
+    var parent: [Int] = [Int](repeating: -1, count: numberOfPoints)
+    var image: [SIMD3<Int32>] = [SIMD3<Int32>](repeating: SIMD3<Int32>(0, 0, 0), count: numberOfPoints)
+    
+    let numberOfSlabs: Int = max(1, min(n.z, 2 * ProcessInfo.processInfo.activeProcessorCount))
+    var windings: [[(point: Int, winding: SIMD3<Int32>)]] = [[(point: Int, winding: SIMD3<Int32>)]](repeating: [], count: numberOfSlabs + 1)
+    
+    accessible.withUnsafeBufferPointer { accessiblePtr in
+      parent.withUnsafeMutableBufferPointer { parentPtr in
+        image.withUnsafeMutableBufferPointer { imagePtr in
+          windings.withUnsafeMutableBufferPointer { windingsPtr in
+            let unionFind: UnionFind = UnionFind(parent: parentPtr.baseAddress!, image: imagePtr.baseAddress!)
+            let isAccessible: UnsafePointer<Bool> = accessiblePtr.baseAddress!
+            let slabWindings: UnsafeMutablePointer<[(point: Int, winding: SIMD3<Int32>)]> = windingsPtr.baseAddress!
+            
+            // the slabs only touch their own points, so they can be labelled in parallel
+            DispatchQueue.concurrentPerform(iterations: numberOfSlabs) { slab in
+              let start: Int = slab * n.z / numberOfSlabs
+              let end: Int = (slab + 1) * n.z / numberOfSlabs
+              
+              for k in start..<end
+              {
+                for j in 0..<n.y
+                {
+                  for i in 0..<n.x
+                  {
+                    let point: Int = i + n.x * (j + n.y * k)
+                    if isAccessible[point] && unionFind.parent[point] < 0
+                    {
+                      unionFind.parent[point] = point
+                    }
+                  }
+                }
+              }
+              
+              for k in start..<end
+              {
+                for j in 0..<n.y
+                {
+                  for i in 0..<n.x
+                  {
+                    let point: Int = i + n.x * (j + n.y * k)
+                    guard isAccessible[point] else { continue }
+                    
+                    // the forward neighbours in x and y (periodic), and in z within the slab
+                    let x: (neighbour: Int, shift: Int32) = i + 1 < n.x ? (point + 1, 0) : (point + 1 - n.x, 1)
+                    let y: (neighbour: Int, shift: Int32) = j + 1 < n.y ? (point + n.x, 0) : (point + n.x - n.x * n.y, 1)
+                    if isAccessible[x.neighbour], let winding = unionFind.union(point, x.neighbour, shift: SIMD3<Int32>(x.shift, 0, 0))
+                    {
+                      slabWindings[slab].append((point, winding))
+                    }
+                    if isAccessible[y.neighbour], let winding = unionFind.union(point, y.neighbour, shift: SIMD3<Int32>(0, y.shift, 0))
+                    {
+                      slabWindings[slab].append((point, winding))
+                    }
+                    if k + 1 < end, isAccessible[point + n.x * n.y], let winding = unionFind.union(point, point + n.x * n.y, shift: SIMD3<Int32>(0, 0, 0))
+                    {
+                      slabWindings[slab].append((point, winding))
+                    }
+                  }
+                }
+              }
+            }
+            
+            // merge the slabs across their boundaries (the last boundary is the periodic one)
+            for slab in 0..<numberOfSlabs
+            {
+              let k: Int = (slab + 1) * n.z / numberOfSlabs - 1
+              let shift: Int32 = k + 1 < n.z ? 0 : 1
+              let next: Int = k + 1 < n.z ? k + 1 : 0
+              for j in 0..<n.y
+              {
+                for i in 0..<n.x
+                {
+                  let point: Int = i + n.x * (j + n.y * k)
+                  let neighbour: Int = i + n.x * (j + n.y * next)
+                  if isAccessible[point] && isAccessible[neighbour], let winding = unionFind.union(point, neighbour, shift: SIMD3<Int32>(0, 0, shift))
+                  {
+                    slabWindings[numberOfSlabs].append((point, winding))
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+    
+    // number the components in order of their first point, and determine the rank of their winding vectors
+    var roots: [Int] = [Int](repeating: -1, count: numberOfPoints)
+    var componentOfRoot: [Int: Int] = [:]
+    var components: [Component] = []
+    var basis: [[SIMD3<Int>]] = []
+    parent.withUnsafeMutableBufferPointer { parentPtr in
+      image.withUnsafeMutableBufferPointer { imagePtr in
+        let unionFind: UnionFind = UnionFind(parent: parentPtr.baseAddress!, image: imagePtr.baseAddress!)
+        for point in 0..<numberOfPoints where parentPtr[point] >= 0
+        {
+          let root: Int = unionFind.find(point).root
+          roots[point] = root
+          if let component = componentOfRoot[root]
+          {
+            components[component].numberOfPoints += 1
+          }
+          else
+          {
+            componentOfRoot[root] = components.count
+            components.append(Component(numberOfPoints: 1, dimensionality: 0))
+            basis.append([])
+          }
+        }
+      }
+    }
+    
+    for (point, winding) in windings.joined()
+    {
+      guard let component = componentOfRoot[roots[point]] else { continue }
+      let vector: SIMD3<Int> = SIMD3<Int>(truncatingIfNeeded: winding)
+      if SKPoreConnectivity.isIndependent(vector, of: basis[component])
+      {
+        basis[component].append(vector)
+        components[component].dimensionality = basis[component].count
+      }
+    }
+    self.components = components
+    
+    // the labels of the full grid, the periodic images get the label of their original
+    var labels: [Int32] = [Int32](repeating: -1, count: dimensions.x * dimensions.y * dimensions.z)
+    for k in 0..<dimensions.z
+    {
+      for j in 0..<dimensions.y
+      {
+        for i in 0..<dimensions.x
+        {
+          let point: Int = (i % n.x) + n.x * ((j % n.y) + n.y * (k % n.z))
+          if roots[point] >= 0, let component = componentOfRoot[roots[point]]
+          {
+            labels[i + dimensions.x * (j + dimensions.y * k)] = Int32(component)
+          }
+        }
+      }
+    }
+    self.labels = labels
+  }
+  
+  // The labelling of the 128x128x128 energy grid of each structure for its probe molecule, with the accessible part below zero as for the
+  // blocking of the pockets in the void fraction and the surface area.
+  public static func compute(structures: [(cell: SKCell, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], probeParameters: SIMD2<Double>)]) -> [SKPoreConnectivity]
+  {
+    // fall back to the CPU-implementation when no Metal-device is available
+    let device: MTLDevice? = MTLCreateSystemDefaultDevice()
+    let commandQueue: MTLCommandQueue? = device?.makeCommandQueue()
+    
+    return structures.map{structure -> SKPoreConnectivity in
+      let data: [Float]
+      let numberOfReplicas: SIMD3<Int32> = structure.cell.numberOfReplicas(forCutoff: 12.0)
+      if let device = device,
+         let commandQueue = commandQueue
+      {
+        let framework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
+        data = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: structure.probeParameters)
+      }
+      else
+      {
+        let framework: SKCPUFramework = SKCPUFramework(positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
+        data = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: structure.probeParameters)
+      }
+      return SKPoreConnectivity(values: data, dimensions: SIMD3<Int>(128,128,128), threshold: 0.0)
+    }
+  }
+  
+  // Sets the values in the inaccessible pockets to 'blockedValue' (the analogue of the blocking-pockets of RASPA), returns the labelling.
+  @discardableResult
+  public static func blockPockets(_ values: inout [Float], dimensions: SIMD3<Int>, threshold: Float, blockedValue: Float = 10000000.0) -> SKPoreConnectivity
+  {
+    let connectivity: SKPoreConnectivity = SKPoreConnectivity(values: values, dimensions: dimensions, threshold: threshold)
+    for (index, isPocket) in connectivity.pocketMask.enumerated() where isPocket
+    {
+      values[index] = blockedValue
+    }
+    return connectivity
+  }
+  
+  static func isIndependent(_ vector: SIMD3<Int>, of basis: [SIMD3<Int>]) -> Bool
+  {
+    switch(basis.count)
+    {
+    case 0:
+      return vector != SIMD3<Int>(0, 0, 0)
+    case 1:
+      let c: SIMD3<Int> = SIMD3<Int>(basis[0].y * vector.z - basis[0].z * vector.y, basis[0].z * vector.x - basis[0].x * vector.z, basis[0].x * vector.y - basis[0].y * vector.x)
+      return c != SIMD3<Int>(0, 0, 0)
+    case 2:
+      let c: SIMD3<Int> = SIMD3<Int>(basis[0].y * basis[1].z - basis[0].z * basis[1].y, basis[0].z * basis[1].x - basis[0].x * basis[1].z, basis[0].x * basis[1].y - basis[0].y * basis[1].x)
+      return (c &* vector).wrappedSum() != 0
+    default:
+      return false
+    }
+  }
+  
+  // Union-find on shared storage: the parent of each point and its periodic image relative to the parent.
+  struct UnionFind
+  {
+    let parent: UnsafeMutablePointer<Int>
+    let image: UnsafeMutablePointer<SIMD3<Int32>>
+    
+    // the root and the periodic image of the point relative to the root (with path compression)
+    func find(_ point: Int) -> (root: Int, image: SIMD3<Int32>)
+    {
+      var root: Int = point
+      var total: SIMD3<Int32> = SIMD3<Int32>(0, 0, 0)
+      while parent[root] != root
+      {
+        total &+= image[root]
+        root = parent[root]
+      }
+      var current: Int = point
+      var remaining: SIMD3<Int32> = total
+      while parent[current] != current
+      {
+        let next: Int = parent[current]
+        let step: SIMD3<Int32> = image[current]
+        parent[current] = root
+        image[current] = remaining
+        remaining &-= step
+        current = next
+      }
+      return (root, total)
+    }
+    
+    // Joins the point with its neighbour, which is located at the periodic image 'shift'. When both are already in the same component the
+    // winding vector of the loop is returned (if it is not zero).
+    func union(_ point: Int, _ neighbour: Int, shift: SIMD3<Int32>) -> SIMD3<Int32>?
+    {
+      let a: (root: Int, image: SIMD3<Int32>) = find(point)
+      let b: (root: Int, image: SIMD3<Int32>) = find(neighbour)
+      if a.root == b.root
+      {
+        let winding: SIMD3<Int32> = a.image &+ shift &- b.image
+        return winding == SIMD3<Int32>(0, 0, 0) ? nil : winding
+      }
+      
+      // the smallest index becomes the root (deterministic)
+      if a.root < b.root
+      {
+        parent[b.root] = a.root
+        image[b.root] = a.image &+ shift &- b.image
+      }
+      else
+      {
+        parent[a.root] = b.root
+        image[a.root] = b.image &- shift &- a.image
+      }
+      return nil
+    }
+  }
+}
@@ -0,0 +1,539 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+import SymmetryKit
+
+// Pore geometry from a periodic distance grid: for each voxel the exact distance from its center to the nearest atom surface is computed with
+// a periodic cell list (in parallel over the lines of voxels). The voxels follow the cell axes, so non-orthogonal cells are supported.
+// From the distance grid follow
+//  - the largest included sphere (Di): twice the largest distance,
+//  - the largest free sphere (Df) along each axis: the largest sphere that can percolate along that axis. The voxels are added in order of
+//    decreasing distance to a union-find structure that keeps track of the periodic image of each voxel relative to its root; the first time a
+//    connection closes a loop that winds around an axis, the pore percolates along that axis,
+//  - the largest included sphere along the free path (Dif): the largest sphere in the percolating pore,
+//  - the pore size distribution: for each void voxel the diameter of the largest sphere (centered at a local maximum of the distance) that
+//    contains it, as a histogram of the fraction of the pore volume.
+// The void voxels are sorted in parallel on a 64-bit key (distance and index), the union-find itself is inherently sequential (the order of the
+// unions defines the thresholds) and uses 32-bit storage to keep the memory at a fraction of the grid.
+public class SKPoreGeometry
+{
+  public struct Result
+  {
+    public var largestIncludedSphere: Double = 0.0
+    public var largestFreeSphere: Double = 0.0
+    public var largestIncludedSphereAlongFreePath: Double = 0.0
+    
+    // per axis, zero when the pore does not percolate along the axis
+    public var largestFreeSpheres: SIMD3<Double> = SIMD3<Double>(0.0, 0.0, 0.0)
+    public var largestIncludedSpheresAlongFreePath: SIMD3<Double> = SIMD3<Double>(0.0, 0.0, 0.0)
+    
+    // the fraction of the pore volume per bin of pore diameter (bin i covers [i, i+1) * binWidth)
+    public var poreSizeDistribution: [Double] = []
+    public var binWidth: Double = 0.1
+    
+    // fraction of the voxels that are not inside an atom
+    public var geometricVoidFraction: Double = 0.0
+  }
+  
+  // the maximum voxel-spacing in Angstrom
+  public var spacing: Double = 0.2
+  public var binWidth: Double = 0.1
+  
+  let cell: SKCell
+  let positions: [SIMD3<Double>]
+  let radii: [Double]
+  
+  // the positions are fractional positions in the unit cell
+  public init(cell: SKCell, positions: [SIMD3<Double>], radii: [Double])
+  {
+    self.cell = cell
+    self.positions = positions
+    self.radii = radii
+  }
+  
+  public func compute() -> Result
+  {
+    var result: Result = Result()
+    result.binWidth = binWidth
+    
+    // the voxels are indexed with 32-bit integers in the percolation
+    let lengths: (a: Double, b: Double, c: Double) = cell.lengths
+    let spacing: Double = max(self.spacing, cbrt(lengths.a * lengths.b * lengths.c / Double(Int32.max)) * 1.01)
+    let n: SIMD3<Int> = SIMD3<Int>(max(1, Int(ceil(lengths.a / spacing))), max(1, Int(ceil(lengths.b / spacing))), max(1, Int(ceil(lengths.c / spacing))))
+    let numberOfVoxels: Int = n.x * n.y * n.z
+    
+    // the distances: zero inside the atoms, infinite without atoms
+    var distances: [Double] = [Double](repeating: Double.infinity, count: numberOfVoxels)
+    if !positions.isEmpty
+    {
+      let cellList: SKPeriodicCellList = SKPeriodicCellList(cell: cell, positions: positions, radii: radii)
+      distances.withUnsafeMutableBufferPointer { distancesPtr in
+        let distance: UnsafeMutablePointer<Double> = distancesPtr.baseAddress!
+        DispatchQueue.concurrentPerform(iterations: n.y * n.z) { line in
+          let j: Int = line % n.y
+          let k: Int = line / n.y
+          for i in 0..<n.x
+          {
+            let position: SIMD3<Double> = SIMD3<Double>((Double(i) + 0.5) / Double(n.x), (Double(j) + 0.5) / Double(n.y), (Double(k) + 0.5) / Double(n.z))
+            distance[i + n.x * line] = cellList.distanceToSurface(position * cellList.scaling)
+          }
+        }
+      }
+    }
+    
+    let numberOfVoidVoxels: Int = distances.reduce(0){$0 + ($1 > 0.0 ? 1 : 0)}
+    guard numberOfVoidVoxels > 0 else { return result }
+    
+    // without atoms the distances are infinite, the cell itself limits the spheres
+    let largestDistance: Double = positions.isEmpty ? 0.5 * cell.perpendicularWidths.min() : (distances.max() ?? 0.0)
+    result.largestIncludedSphere = 2.0 * largestDistance
+    result.geometricVoidFraction = Double(numberOfVoidVoxels) / Double(numberOfVoxels)
+    
+    let percolation: (free: SIMD3<Double>, included: SIMD3<Double>) = SKPoreGeometry.percolation(distances, dimensions: n)
+    result.largestFreeSpheres = 2.0 * simd_min(percolation.free, SIMD3<Double>(repeating: largestDistance))
+    result.largestIncludedSpheresAlongFreePath = 2.0 * simd_min(percolation.included, SIMD3<Double>(repeating: largestDistance))
+    result.largestFreeSphere = result.largestFreeSpheres.max()
+    result.largestIncludedSphereAlongFreePath = (0..<3).filter{result.largestFreeSpheres[$0] == result.largestFreeSphere}.map{result.largestIncludedSpheresAlongFreePath[$0]}.max() ?? 0.0
+    
+    // without atoms every voxel is a local maximum, there is no meaningful distribution
+    guard !positions.isEmpty else { return result }
+    result.poreSizeDistribution = SKPoreGeometry.poreSizeDistribution(distances, dimensions: n, unitCell: cell.unitCell, maximumRadius: largestDistance, binWidth: binWidth)
+    
+    return result
+  }
+  
+  // The radii of the atoms are taken as half the Lennard-Jones size parameters of the force field.
+  public static func compute(structures: [SKRenderAdsorptionSurfaceStructure]) -> [Result]
+  {
+    return structures.map{structure -> Result in
+      let poreGeometry: SKPoreGeometry = SKPoreGeometry(cell: structure.cell, positions: structure.atomUnitCellPositions, radii: structure.potentialParameters.map{0.5 * $0.y})
+      return poreGeometry.compute()
+    }
+  }
+  
+  // MARK: Distance transform
+  // =====================================================================
+  
+  // In-place squared Euclidean distance transform of a periodic grid (x varying the fastest), one separable pass per axis with the linear-time
+  // algorithm of Felzenszwalb and Huttenlocher (in parallel over the lines). The axes are taken as orthogonal.
+  static func distanceTransform(_ grid: inout [Double], dimensions n: SIMD3<Int>, spacing h: SIMD3<Double>)
+  {
+    grid.withUnsafeMutableBufferPointer { gridPtr in
+      let data: UnsafeMutablePointer<Double> = gridPtr.baseAddress!
+      
+      // the lines along each axis: (number of lines, length, stride, start of a line)
+      let axes: [(lines: Int, length: Int, stride: Int, start: (Int) -> Int)] = [
+        (n.y * n.z, n.x, 1, {line in n.x * line}),
+        (n.x * n.z, n.y, n.x, {line in (line % n.x) + n.x * n.y * (line / n.x)}),
+        (n.x * n.y, n.z, n.x * n.y, {line in line})
+      ]
+      
+      for (axis, lines) in axes.enumerated()
+      {
+        let weight: Double = h[axis] * h[axis]
+        let length: Int = lines.length
+        DispatchQueue.concurrentPerform(iterations: lines.lines) { line in
+          let f: UnsafeMutablePointer<Double> = UnsafeMutablePointer<Double>.allocate(capacity: length)
+          let d: UnsafeMutablePointer<Double> = UnsafeMutablePointer<Double>.allocate(capacity: length)
+          let v: UnsafeMutablePointer<Int> = UnsafeMutablePointer<Int>.allocate(capacity: 3 * length)
+          let z: UnsafeMutablePointer<Double> = UnsafeMutablePointer<Double>.allocate(capacity: 3 * length + 1)
+          defer { f.deallocate(); d.deallocate(); v.deallocate(); z.deallocate() }
+          
+          let start: Int = lines.start(line)
+          for i in 0..<length
+          {
+            f[i] = data[start + i * lines.stride]
+          }
+          distanceTransform(f, d, length: length, weight: weight, v: v, z: z)
+          for i in 0..<length
+          {
+            data[start + i * lines.stride] = d[i]
+          }
+        }
+      }
+    }
+  }
+  
+  // One-dimensional squared distance transform d(q) = min_p (w (q-p)^2 + f(p)) of a periodic line: the lower envelope of the parabolas is
+  // computed for three periods and evaluated for the middle one (the periodic distance is at most half a period).
+  static func distanceTransform(_ f: UnsafePointer<Double>, _ d: UnsafeMutablePointer<Double>, length n: Int, weight w: Double, v: UnsafeMutablePointer<Int>, z: UnsafeMutablePointer<Double>)
+  {
+    var k: Int = -1
+    for q in 0..<(3 * n)
+    {
+      let fq: Double = f[q % n]
+      guard fq.isFinite else { continue }
+      
+      var s: Double = -Double.infinity
+      while k >= 0
+      {
+        let p: Int = v[k]
+        let fp: Double = f[p % n]
+        s = ((fq + w * Double(q * q)) - (fp + w * Double(p * p))) / (2.0 * w * Double(q - p))
+        if s > z[k]
+        {
+          break
+        }
+        k -= 1
+      }
+      k += 1
+      v[k] = q
+      z[k] = (k == 0) ? -Double.infinity : s
+      z[k + 1] = Double.infinity
+    }
+    
+    guard k >= 0 else
+    {
+      for q in 0..<n
+      {
+        d[q] = Double.infinity
+      }
+      return
+    }
+    
+    var j: Int = 0
+    for q in n..<(2 * n)
+    {
+      while z[j + 1] < Double(q)
+      {
+        j += 1
+      }
+      let p: Int = v[j]
+      d[q - n] = w * Double((q - p) * (q - p)) + f[p % n]
+    }
+  }
+  
+  // MARK: Percolation
+  // =====================================================================
+  
+  // Returns for each axis the largest distance for which the void space percolates along that axis, and the largest distance in that pore.
+  static func percolation(_ distances: [Double], dimensions n: SIMD3<Int>) -> (free: SIMD3<Double>, included: SIMD3<Double>)
+  {
+    var free: SIMD3<Double> = SIMD3<Double>(0.0, 0.0, 0.0)
+    var included: SIMD3<Double> = SIMD3<Double>(0.0, 0.0, 0.0)
+    var found: SIMD3<Int> = SIMD3<Int>(0, 0, 0)
+    
+    let numberOfVoxels: Int = distances.count
+    let order: [UInt64] = SKPoreGeometry.sortedVoidVoxels(distances, dimensions: n)
+    
+    // union-find: the parent, the periodic image of the voxel relative to its parent, the size and the largest distance of the root
+    let parent: UnsafeMutablePointer<Int32> = UnsafeMutablePointer<Int32>.allocate(capacity: numberOfVoxels)
+    let image: UnsafeMutablePointer<SIMD3<Int32>> = UnsafeMutablePointer<SIMD3<Int32>>.allocate(capacity: numberOfVoxels)
+    let size: UnsafeMutablePointer<Int32> = UnsafeMutablePointer<Int32>.allocate(capacity: numberOfVoxels)
+    let largest: UnsafeMutablePointer<Float> = UnsafeMutablePointer<Float>.allocate(capacity: numberOfVoxels)
+    defer { parent.deallocate(); image.deallocate(); size.deallocate(); largest.deallocate() }
+    parent.initialize(repeating: -1, count: numberOfVoxels)
+    image.initialize(repeating: SIMD3<Int32>(0, 0, 0), count: numberOfVoxels)
+    size.initialize(repeating: 0, count: numberOfVoxels)
+    largest.initialize(repeating: 0.0, count: numberOfVoxels)
+    
+    // returns the root and the image of the voxel relative to the root (with path compression)
+    func find(_ voxel: Int32) -> (root: Int32, image: SIMD3<Int32>)
+    {
+      var root: Int32 = voxel
+      var total: SIMD3<Int32> = SIMD3<Int32>(0, 0, 0)
+      while parent[Int(root)] != root
+      {
+        total &+= image[Int(root)]
+        root = parent[Int(root)]
+      }
+      var current: Int32 = voxel
+      var remaining: SIMD3<Int32> = total
+      while parent[Int(current)] != current
+      {
+        let next: Int32 = parent[Int(current)]
+        let step: SIMD3<Int32> = image[Int(current)]
+        parent[Int(current)] = root
+        image[Int(current)] = remaining
+        remaining &-= step
+        current = next
+      }
+      return (root, total)
+    }
+    
+    let strides: SIMD3<Int> = SIMD3<Int>(1, n.x, n.x * n.y)
+    for key in order
+    {
+      let voxel: Int = Int(truncatingIfNeeded: key & 0xffffffff)
+      parent[voxel] = Int32(voxel)
+      size[voxel] = 1
+      largest[voxel] = Float(distances[voxel])
+      
+      let position: SIMD3<Int> = SIMD3<Int>(voxel % n.x, (voxel / n.x) % n.y, voxel / (n.x * n.y))
+      for axis in 0..<3
+      {
+        for direction in [-1, 1]
+        {
+          var neighbourPosition: SIMD3<Int> = position
+          var shift: SIMD3<Int32> = SIMD3<Int32>(0, 0, 0)
+          neighbourPosition[axis] += direction
+          if neighbourPosition[axis] < 0 { neighbourPosition[axis] += n[axis]; shift[axis] = -1 }
+          if neighbourPosition[axis] >= n[axis] { neighbourPosition[axis] -= n[axis]; shift[axis] = 1 }
+          
+          let neighbour: Int = neighbourPosition.x * strides.x + neighbourPosition.y * strides.y + neighbourPosition.z * strides.z
+          guard parent[neighbour] >= 0 else { continue }
+          
+          let a: (root: Int32, image: SIMD3<Int32>) = find(Int32(voxel))
+          let b: (root: Int32, image: SIMD3<Int32>) = find(Int32(neighbour))
+          let rootA: Int = Int(a.root)
+          let rootB: Int = Int(b.root)
+          
+          if rootA == rootB
+          {
+            // the loop winds around the axes for which the images differ
+            let winding: SIMD3<Int32> = a.image &+ shift &- b.image
+            for percolatingAxis in 0..<3 where winding[percolatingAxis] != 0 && found[percolatingAxis] == 0
+            {
+              found[percolatingAxis] = 1
+              free[percolatingAxis] = distances[voxel]
+              included[percolatingAxis] = Double(largest[rootA])
+            }
+          }
+          else if size[rootA] >= size[rootB]
+          {
+            parent[rootB] = a.root
+            image[rootB] = a.image &+ shift &- b.image
+            size[rootA] += size[rootB]
+            largest[rootA] = max(largest[rootA], largest[rootB])
+          }
+          else
+          {
+            parent[rootA] = b.root
+            image[rootA] = b.image &- shift &- a.image
+            size[rootB] += size[rootA]
+            largest[rootB] = max(largest[rootA], largest[rootB])
+          }
+        }
+      }
+      
+      if found == SIMD3<Int>(1, 1, 1)
+      {
+        break
+      }
+    }
+    return (free, included)
+  }
+  
+  // The void voxels in order of decreasing distance (ties by increasing index), as keys with the inverted bits of the (positive) single
+  // precision distance in the upper half and the voxel index in the lower half. The keys are gathered per slice in parallel and sorted with
+  // a parallel merge sort.
+  static func sortedVoidVoxels(_ distances: [Double], dimensions n: SIMD3<Int>) -> [UInt64]
+  {
+    let sliceSize: Int = n.x * n.y
+    var counts: [Int] = [Int](repeating: 0, count: n.z + 1)
+    counts.withUnsafeMutableBufferPointer { countsPtr in
+      let count: UnsafeMutablePointer<Int> = countsPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: n.z) { k in
+        var voidVoxels: Int = 0
+        for index in (k * sliceSize)..<((k + 1) * sliceSize) where distances[index] > 0.0
+        {
+          voidVoxels += 1
+        }
+        count[k + 1] = voidVoxels
+      }
+    }
+    for k in 0..<n.z
+    {
+      counts[k + 1] += counts[k]
+    }
+    
+    var keys: [UInt64] = [UInt64](repeating: 0, count: counts[n.z])
+    keys.withUnsafeMutableBufferPointer { keysPtr in
+      let key: UnsafeMutablePointer<UInt64> = keysPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: n.z) { k in
+        var position: Int = counts[k]
+        for index in (k * sliceSize)..<((k + 1) * sliceSize) where distances[index] > 0.0
+        {
+          key[position] = (UInt64(~Float(distances[index]).bitPattern) << 32) | UInt64(index)
+          position += 1
+        }
+      }
+    }
+    
+    SKPoreGeometry.parallelSort(&keys)
+    return keys
+  }
+  
+  // ascending sort: the chunks are sorted concurrently and then merged pairwise, the merges of each round run concurrently
+  static func parallelSort(_ keys: inout [UInt64])
+  {
+    let count: Int = keys.count
+    guard count > 1 else { return }
+    let numberOfChunks: Int = max(1, min(ProcessInfo.processInfo.activeProcessorCount, count / 4096))
+    let chunkSize: Int = (count + numberOfChunks - 1) / numberOfChunks
+    
+    var scratch: [UInt64] = [UInt64](repeating: 0, count: count)
+    keys.withUnsafeMutableBufferPointer { keysPtr in
+      scratch.withUnsafeMutableBufferPointer { scratchPtr in
+        var source: UnsafeMutablePointer<UInt64> = keysPtr.baseAddress!
+        var destination: UnsafeMutablePointer<UInt64> = scratchPtr.baseAddress!
+        
+        let chunks: UnsafeMutablePointer<UInt64> = source
+        DispatchQueue.concurrentPerform(iterations: numberOfChunks) { chunk in
+          let start: Int = min(count, chunk * chunkSize)
+          let end: Int = min(count, start + chunkSize)
+          UnsafeMutableBufferPointer<UInt64>(start: chunks + start, count: end - start).sort()
+        }
+        
+        var width: Int = chunkSize
+        while width < count
+        {
+          let from: UnsafeMutablePointer<UInt64> = source
+          let to: UnsafeMutablePointer<UInt64> = destination
+          let mergeWidth: Int = width
+          DispatchQueue.concurrentPerform(iterations: (count + 2 * width - 1) / (2 * width)) { merge in
+            let start: Int = merge * 2 * mergeWidth
+            let middle: Int = min(count, start + mergeWidth)
+            let end: Int = min(count, start + 2 * mergeWidth)
+            var i: Int = start
+            var j: Int = middle
+            var k: Int = start
+            while i < middle && j < end
+            {
+              if from[i] <= from[j]
+              {
+                to[k] = from[i]
+                i += 1
+              }
+              else
+              {
+                to[k] = from[j]
+                j += 1
+              }
+              k += 1
+            }
+            while i < middle
+            {
+              to[k] = from[i]
+              i += 1
+              k += 1
+            }
+            while j < end
+            {
+              to[k] = from[j]
+              j += 1
+              k += 1
+            }
+          }
+          swap(&source, &destination)
+          width *= 2
+        }
+        
+        if source != keysPtr.baseAddress!
+        {
+          keysPtr.baseAddress!.assign(from: source, count: count)
+        }
+      }
+    }
+  }
+  
+  // MARK: Pore size distribution
+  // =====================================================================
+  
+  static func poreSizeDistribution(_ distances: [Double], dimensions n: SIMD3<Int>, unitCell: double3x3, maximumRadius: Double, binWidth: Double) -> [Double]
+  {
+    let numberOfVoxels: Int = distances.count
+    
+    // the Cartesian steps between neighbouring voxels, and the perpendicular widths of a voxel (bounding the voxels within a radius)
+    let steps: double3x3 = double3x3([unitCell[0] / Double(n.x), unitCell[1] / Double(n.y), unitCell[2] / Double(n.z)])
+    let widths: SIMD3<Double> = SKCell(unitCell: steps).perpendicularWidths
+    
+    // the sphere centers: local maxima of the distance (with respect to the six neighbours), largest first
+    func value(_ i: Int, _ j: Int, _ k: Int) -> Double
+    {
+      return distances[((i + n.x) % n.x) + n.x * (((j + n.y) % n.y) + n.y * ((k + n.z) % n.z))]
+    }
+    var centers: [(position: SIMD3<Int>, radius: Double)] = []
+    for k in 0..<n.z
+    {
+      for j in 0..<n.y
+      {
+        for i in 0..<n.x
+        {
+          let d: Double = value(i, j, k)
+          if d > 0.0 && d >= value(i - 1, j, k) && d >= value(i + 1, j, k) && d >= value(i, j - 1, k) && d >= value(i, j + 1, k) && d >= value(i, j, k - 1) && d >= value(i, j, k + 1)
+          {
+            centers.append((SIMD3<Int>(i, j, k), min(d, maximumRadius)))
+          }
+        }
+      }
+    }
+    centers.sort{$0.radius > $1.radius}
+    
+    // the largest sphere covering each voxel, the slices are processed in parallel (the centers are visited from large to small, so the first
+    // sphere that covers a voxel is the largest)
+    var covering: [Double] = [Double](repeating: 0.0, count: numberOfVoxels)
+    covering.withUnsafeMutableBufferPointer { coveringPtr in
+      let cover: UnsafeMutablePointer<Double> = coveringPtr.baseAddress!
+      DispatchQueue.concurrentPerform(iterations: n.z) { k in
+        let slice: UnsafeMutablePointer<Double> = cover + k * n.x * n.y
+        for center in centers
+        {
+          let r2: Double = center.radius * center.radius
+          let extent: SIMD3<Int> = SIMD3<Int>(min(n.x / 2, Int(center.radius / widths.x)), min(n.y / 2, Int(center.radius / widths.y)), min(n.z / 2, Int(center.radius / widths.z)))
+          
+          // the offsets along z that end up in this slice
+          for dk in -extent.z...extent.z where ((center.position.z + dk) % n.z + n.z) % n.z == k
+          {
+            for dj in -extent.y...extent.y
+            {
+              let j: Int = ((center.position.y + dj) % n.y + n.y) % n.y
+              for di in -extent.x...extent.x
+              {
+                let i: Int = ((center.position.x + di) % n.x + n.x) % n.x
+                let index: Int = i + n.x * j
+                let dr: SIMD3<Double> = steps * SIMD3<Double>(Double(di), Double(dj), Double(dk))
+                if slice[index] == 0.0 && distances[index + k * n.x * n.y] > 0.0 && simd_length_squared(dr) < r2
+                {
+                  slice[index] = center.radius
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+    
+    let numberOfBins: Int = max(1, Int(2.0 * maximumRadius / binWidth) + 1)
+    var histogram: [Double] = [Double](repeating: 0.0, count: numberOfBins)
+    var numberOfVoidVoxels: Int = 0
+    for index in 0..<numberOfVoxels where distances[index] > 0.0
+    {
+      // voxels not covered by any of the spheres use their own distance
+      let radius: Double = covering[index] > 0.0 ? covering[index] : min(distances[index], maximumRadius)
+      histogram[min(Int(2.0 * radius / binWidth), numberOfBins - 1)] += 1.0
+      numberOfVoidVoxels += 1
+    }
+    return histogram.map{$0 / Double(max(1, numberOfVoidVoxels))}
+  }
+}
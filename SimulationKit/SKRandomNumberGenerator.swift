@@ -0,0 +1,81 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+
+// Random number generator (xoshiro256**) with an explicit seed, so that each thread of a Monte Carlo simulation can use its own independent
+// and reproducible stream. The streams are seeded by SplitMix64 from the seed and the index of the stream.
+public struct SKRandomNumberGenerator: RandomNumberGenerator
+{
+  var state: (UInt64, UInt64, UInt64, UInt64)
+  
+  public init(seed: UInt64, stream: Int = 0)
+  {
+    var splitMix: UInt64 = seed ^ (0x9E3779B97F4A7C15 &* UInt64(truncatingIfNeeded: stream + 1))
+    func next() -> UInt64
+    {
+      splitMix = splitMix &+ 0x9E3779B97F4A7C15
+      var z: UInt64 = splitMix
+      z = (z ^ (z >> 30)) &* 0xBF58476D1CE4E5B9
+      z = (z ^ (z >> 27)) &* 0x94D049BB133111EB
+      return z ^ (z >> 31)
+    }
+    state = (next(), next(), next(), next())
+  }
+  
+  @inline(__always)
+  static func rotateLeft(_ x: UInt64, _ k: UInt64) -> UInt64
+  {
+    return (x << k) | (x >> (64 - k))
+  }
+  
+  public mutating func next() -> UInt64
+  {
+    let result: UInt64 = SKRandomNumberGenerator.rotateLeft(state.1 &* 5, 7) &* 9
+    let t: UInt64 = state.1 << 17
+    
+    state.2 ^= state.0
+    state.3 ^= state.1
+    state.1 ^= state.2
+    state.0 ^= state.3
+    state.2 ^= t
+    state.3 = SKRandomNumberGenerator.rotateLeft(state.3, 45)
+    
+    return result
+  }
+  
+  // uniform in [0,1)
+  @inline(__always)
+  public mutating func uniform() -> Double
+  {
+    return Double(next() >> 11) * 0x1.0p-53
+  }
+}
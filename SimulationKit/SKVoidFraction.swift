@@ -18,34 +18,110 @@ public class SKVoidFraction
     {
       return SKMetalFramework.computeVoidFractions(device: device, commandQueue: commandQueue, structures: structures)
     }
-    fatalError()
+    return SKCPUFramework.computeVoidFractions(structures: structures)
   }
   
-  public static func compute(structures: [(cell: SKCell, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>])], probeParameters: SIMD2<Double>) -> [(minimumEnergyValue: Double, voidFraction: Double)]
+  public static func compute(structures: [(cell: SKCell, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>])], probeParameters: SIMD2<Double>, blockInaccessiblePockets: Bool = false) -> [(minimumEnergyValue: Double, voidFraction: Double)]
   {
     var results: [(minimumEnergyValue: Double, voidFraction: Double)] = []
-    if let device = MTLCreateSystemDefaultDevice(),
-       let commandQueue: MTLCommandQueue = device.makeCommandQueue()
+    
+    // fall back to the CPU-implementation when no Metal-device is available
+    let device: MTLDevice? = MTLCreateSystemDefaultDevice()
+    let commandQueue: MTLCommandQueue? = device?.makeCommandQueue()
+    
+    for structure in structures
     {
-      for structure in structures
+      // the minimum and the Boltzmann-sum are reduced while the grid is computed, the grid itself is never stored
+      var reduction: SKEnergyGridReduction = SKEnergyGridReduction(temperature: 298.0)  // K_B  chosen as 1.0 (energy units are Kelvin)
+      
+      let numberOfReplicas: SIMD3<Int32> = structure.cell.numberOfReplicas(forCutoff: 12.0)
+      if blockInaccessiblePockets
       {
-        var data: [Float] = []
-        
-        let numberOfReplicas: SIMD3<Int32> = structure.cell.numberOfReplicas(forCutoff: 12.0)
-        let framework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
-        
-        data = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: probeParameters)
-                
-        var numberOfLowEnergyValues: Double = 0.0
-        for value in data
+        // the labelling needs the full grid; the pockets (not connected to a periodic channel) do not contribute to the void fraction
+        var data: [Float]
+        if let device = device,
+           let commandQueue = commandQueue
+        {
+          let framework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
+          data = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: probeParameters)
+        }
+        else
         {
-          numberOfLowEnergyValues += exp(-(1.0/298.0) * Double(value))  // K_B  chosen as 1.0 (energy units are Kelvin)
+          let framework: SKCPUFramework = SKCPUFramework(positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
+          data = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: probeParameters)
         }
-        let result = (Double(data.min() ?? 0.0), Double(numberOfLowEnergyValues)/Double(128*128*128))
-        results.append(result)
+        SKPoreConnectivity.blockPockets(&data, dimensions: SIMD3<Int>(128,128,128), threshold: 0.0)
+        data.withUnsafeBufferPointer { reduction.accumulate($0) }
+      }
+      else if let device = device,
+         let commandQueue = commandQueue
+      {
+        let framework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
+        reduction = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: probeParameters, reduction: reduction)
       }
+      else
+      {
+        let framework: SKCPUFramework = SKCPUFramework(positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
+        reduction = framework.ComputeEnergyGrid(128, sizeY: 128, sizeZ: 128, probeParameter: probeParameters, reduction: reduction)
+      }
+      
+      let result = (Double(reduction.minimumValue ?? 0.0), reduction.boltzmannSum/Double(128*128*128))
+      results.append(result)
     }
     return results
   }
   
+  // Screening of several probes per structure: the energy grids of all probes are computed in a single pass over the framework.
+  // The results are ordered per structure and then per probe.
+  public static func compute(structures: [(cell: SKCell, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>])], probeParameters: [SIMD2<Double>]) -> [[(minimumEnergyValue: Double, voidFraction: Double)]]
+  {
+    var results: [[(minimumEnergyValue: Double, voidFraction: Double)]] = []
+    
+    // fall back to the CPU-implementation when no Metal-device is available
+    let device: MTLDevice? = MTLCreateSystemDefaultDevice()
+    let commandQueue: MTLCommandQueue? = device?.makeCommandQueue()
+    
+    for structure in structures
+    {
+      var grids: [[Float]] = []
+      
+      let numberOfReplicas: SIMD3<Int32> = structure.cell.numberOfReplicas(forCutoff: 12.0)
+      if let device = device,
+         let commandQueue = commandQueue
+      {
+        let framework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
+        grids = framework.ComputeEnergyGrids(128, sizeY: 128, sizeZ: 128, probeParameters: probeParameters)
+      }
+      else
+      {
+        let framework: SKCPUFramework = SKCPUFramework(positions: structure.positions, potentialParameters: structure.potentialParameters, unitCell: structure.cell.unitCell, numberOfReplicas: numberOfReplicas)
+        grids = framework.ComputeEnergyGrids(128, sizeY: 128, sizeZ: 128, probeParameters: probeParameters)
+      }
+      
+      results.append(grids.map{data -> (minimumEnergyValue: Double, voidFraction: Double) in
+        var reduction: SKEnergyGridReduction = SKEnergyGridReduction(temperature: 298.0)  // K_B  chosen as 1.0 (energy units are Kelvin)
+        data.withUnsafeBufferPointer { dataPtr in
+          reduction.accumulate(count: data.count) { range, partial in
+            partial.accumulate(UnsafeBufferPointer(rebasing: dataPtr[range]))
+          }
+        }
+        return (Double(reduction.minimumValue ?? 0.0), reduction.boltzmannSum/Double(128*128*128))
+      })
+    }
+    return results
+  }
+  
+  // Monte Carlo alternative to the grid (see 'SKWidomInsertion'): the insertions stop as soon as the requested relative error is reached,
+  // which is much cheaper than a full grid for large frameworks with a low density.
+  public static func computeByInsertion(structures: [(cell: SKCell, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>])], probeParameters: SIMD2<Double>, targetRelativeError: Double = 0.01) -> [(voidFraction: Double, error: Double)]
+  {
+    return structures.map{structure -> (voidFraction: Double, error: Double) in
+      let widom: SKWidomInsertion = SKWidomInsertion(cell: structure.cell, positions: structure.positions, potentialParameters: structure.potentialParameters, structureMass: 0.0)
+      widom.temperature = 298.0
+      widom.targetRelativeError = targetRelativeError
+      let result: SKWidomInsertion.Result = widom.compute(probeParameter: probeParameters)
+      return (result.voidFraction, result.voidFractionError)
+    }
+  }
+  
 }
@@ -0,0 +1,208 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+
+// Widom test-particle insertion of a single probe in a rigid framework. The probe is inserted at random positions in the unit cell and the
+// Boltzmann factor W = exp(-U/T) is averaged (energy units are Kelvin). This gives
+//  - the Henry coefficient:      K_H = <W> V / (k_B T M)
+//  - the heat of adsorption:     Q = -(<U W>/<W> - T) at infinite dilution
+//  - the void fraction:          <W> (for a helium probe at 298 K)
+// The insertions are done by several threads, each with its own random number stream, in cycles of 'numberOfInsertionsPerCycle'. The cycles
+// are divided into 'numberOfBlocks' blocks to estimate the errors (standard error of the block averages). The standard error of only a few
+// blocks is itself noisy (with 5 blocks its relative spread is about 35%), so at least 10 blocks are used and the simulation stops
+// once the relative error of <W> has been below 'targetRelativeError' for 'numberOfConvergedRounds' consecutive rounds, or after
+// 'maximumNumberOfInsertions'.
+public class SKWidomInsertion
+{
+  public struct Result
+  {
+    public var numberOfInsertions: Int
+    
+    public var averageBoltzmannFactor: Double
+    public var averageBoltzmannFactorError: Double
+    
+    // mol/kg/Pa
+    public var henryCoefficient: Double
+    public var henryCoefficientError: Double
+    
+    // kJ/mol
+    public var heatOfAdsorption: Double
+    public var heatOfAdsorptionError: Double
+    
+    public var voidFraction: Double
+    {
+      return averageBoltzmannFactor
+    }
+    
+    public var voidFractionError: Double
+    {
+      return averageBoltzmannFactorError
+    }
+  }
+  
+  // the sums of a single cycle
+  struct Cycle
+  {
+    var numberOfInsertions: Int = 0
+    var boltzmannFactor: Double = 0.0
+    var energyTimesBoltzmannFactor: Double = 0.0
+  }
+  
+  public var temperature: Double = 298.0
+  public var numberOfBlocks: Int = 20
+  public var numberOfConvergedRounds: Int = 3
+  public var numberOfInsertionsPerCycle: Int = 1000
+  public var minimumNumberOfInsertions: Int = 50000
+  public var maximumNumberOfInsertions: Int = 10000000
+  public var targetRelativeError: Double = 0.01
+  public var numberOfStreams: Int = ProcessInfo.processInfo.activeProcessorCount
+  public var seed: UInt64 = 0x5DEECE66D
+  
+  let cell: SKCell
+  let positions: [SIMD3<Double>]
+  let potentialParameters: [SIMD2<Double>]
+  let structureMass: Double
+  
+  // the positions are fractional positions in the unit cell, the mass of the unit cell is in g/mol
+  public init(cell: SKCell, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], structureMass: Double)
+  {
+    self.cell = cell
+    self.positions = positions
+    self.potentialParameters = potentialParameters
+    self.structureMass = structureMass
+  }
+  
+  public func compute(probeParameter: SIMD2<Double>) -> Result
+  {
+    let numberOfReplicas: SIMD3<Int32> = cell.numberOfReplicas(forCutoff: 12.0)
+    let framework: SKCPUFramework = SKCPUFramework(positions: positions, potentialParameters: potentialParameters, unitCell: cell.unitCell, numberOfReplicas: numberOfReplicas)
+    
+    // the energy-function uses fractional positions in the replica-cell, the insertions are in the first replica (the unit cell)
+    let energy: (SIMD3<Float>) -> Float = framework.energyFunction(probeParameter: probeParameter)
+    let correction: SIMD3<Double> = framework.correction
+    let hasAtoms: Bool = !positions.isEmpty
+    
+    let temperature: Double = self.temperature
+    let numberOfInsertionsPerCycle: Int = max(1, self.numberOfInsertionsPerCycle)
+    let numberOfStreams: Int = max(1, self.numberOfStreams)
+    let numberOfBlocks: Int = max(10, self.numberOfBlocks)
+    let numberOfConvergedRounds: Int = max(1, self.numberOfConvergedRounds)
+    
+    var generators: [SKRandomNumberGenerator] = (0..<numberOfStreams).map{SKRandomNumberGenerator(seed: seed, stream: $0)}
+    var cycles: [Cycle] = []
+    var convergedRounds: Int = 0
+    
+    while true
+    {
+      // one cycle per stream, the cycles are stored in the order of the streams (independent of the scheduling)
+      var round: [Cycle] = [Cycle](repeating: Cycle(), count: numberOfStreams)
+      round.withUnsafeMutableBufferPointer { roundPtr in
+        let cycle: UnsafeMutablePointer<Cycle> = roundPtr.baseAddress!
+        generators.withUnsafeMutableBufferPointer { generatorsPtr in
+          let generator: UnsafeMutablePointer<SKRandomNumberGenerator> = generatorsPtr.baseAddress!
+          DispatchQueue.concurrentPerform(iterations: numberOfStreams) { stream in
+            var sums: Cycle = Cycle(numberOfInsertions: numberOfInsertionsPerCycle)
+            for _ in 0..<numberOfInsertionsPerCycle
+            {
+              let position: SIMD3<Double> = correction * SIMD3<Double>(generator[stream].uniform(), generator[stream].uniform(), generator[stream].uniform())
+              let value: Double = hasAtoms ? Double(energy(SIMD3<Float>(Float(position.x), Float(position.y), Float(position.z)))) : 0.0
+              let boltzmannFactor: Double = exp(-value / temperature)
+              sums.boltzmannFactor += boltzmannFactor
+              sums.energyTimesBoltzmannFactor += value * boltzmannFactor
+            }
+            cycle[stream] = sums
+          }
+        }
+      }
+      cycles.append(contentsOf: round)
+      
+      let result: Result = self.result(cycles: cycles, numberOfBlocks: numberOfBlocks)
+      
+      // the error is only trusted when every block contains at least one cycle
+      let converged: Bool = cycles.count >= numberOfBlocks && result.averageBoltzmannFactor > 0.0 &&
+                            result.averageBoltzmannFactorError < targetRelativeError * result.averageBoltzmannFactor
+      convergedRounds = converged ? convergedRounds + 1 : 0
+      
+      if result.numberOfInsertions >= maximumNumberOfInsertions ||
+        (result.numberOfInsertions >= minimumNumberOfInsertions && convergedRounds >= numberOfConvergedRounds)
+      {
+        return result
+      }
+    }
+  }
+  
+  func result(cycles: [Cycle], numberOfBlocks: Int) -> Result
+  {
+    // K_H = <W> V / (k_B T M), with V in Angstrom^3 and M in g/mol gives mol/kg/Pa with a factor 1e-27
+    let henryConversion: Double = structureMass > 0.0 ? 1.0e-27 * cell.volume / (SKConstant.BoltzmannConstant * temperature * structureMass) : 0.0
+    
+    // from Kelvin to kJ/mol
+    let energyConversion: Double = 1.0e-3 * SKConstant.BoltzmannConstant * SKConstant.AvogadroConstant
+    
+    func averages(_ cycles: ArraySlice<Cycle>) -> (boltzmannFactor: Double, heatOfAdsorption: Double)
+    {
+      let numberOfInsertions: Int = cycles.reduce(0){$0 + $1.numberOfInsertions}
+      let boltzmannFactor: Double = cycles.reduce(0.0){$0 + $1.boltzmannFactor}
+      let energyTimesBoltzmannFactor: Double = cycles.reduce(0.0){$0 + $1.energyTimesBoltzmannFactor}
+      guard numberOfInsertions > 0 else { return (0.0, 0.0) }
+      let heatOfAdsorption: Double = boltzmannFactor > 0.0 ? -(energyTimesBoltzmannFactor / boltzmannFactor - temperature) * energyConversion : 0.0
+      return (boltzmannFactor / Double(numberOfInsertions), heatOfAdsorption)
+    }
+    
+    func standardError(_ values: [Double]) -> Double
+    {
+      guard values.count > 1 else { return 0.0 }
+      let average: Double = values.reduce(0.0, +) / Double(values.count)
+      let variance: Double = values.reduce(0.0){$0 + ($1 - average) * ($1 - average)} / Double(values.count - 1)
+      return sqrt(variance / Double(values.count))
+    }
+    
+    let total: (boltzmannFactor: Double, heatOfAdsorption: Double) = averages(cycles[...])
+    
+    // the errors are estimated from blocks of consecutive cycles
+    let blocks: Int = min(numberOfBlocks, cycles.count)
+    let blockAverages: [(boltzmannFactor: Double, heatOfAdsorption: Double)] = (0..<blocks).map{block in
+      averages(cycles[(block * cycles.count / blocks)..<((block + 1) * cycles.count / blocks)])
+    }
+    let boltzmannFactorError: Double = standardError(blockAverages.map{$0.boltzmannFactor})
+    let heatOfAdsorptionError: Double = standardError(blockAverages.map{$0.heatOfAdsorption})
+    
+    return Result(numberOfInsertions: cycles.reduce(0){$0 + $1.numberOfInsertions},
+                  averageBoltzmannFactor: total.boltzmannFactor,
+                  averageBoltzmannFactorError: boltzmannFactorError,
+                  henryCoefficient: henryConversion * total.boltzmannFactor,
+                  henryCoefficientError: henryConversion * boltzmannFactorError,
+                  heatOfAdsorption: total.heatOfAdsorption,
+                  heatOfAdsorptionError: heatOfAdsorptionError)
+  }
+}
@@ -38,6 +38,7 @@ public protocol SKRenderAdsorptionSurfaceStructure
 {
   var structureMass: Double {get}
   var cell: SKCell {get set}
+  var spaceGroupHallNumber: Int? {get}
   var potentialParameters: [SIMD2<Double>] {get}
   
   var atomUnitCellPositions: [SIMD3<Double>] {get}
@@ -0,0 +1,119 @@
+//
+//  BlockingPocketsTests.swift
+//  SimulationKitTests
+//
+//  Created by David Dubbeldam on 17/10/2026.
+//  Copyright © 2026 David Dubbeldam. All rights reserved.
+//
+
+import XCTest
+@testable import SimulationKit
+import SymmetryKit
+import simd
+
+// A synthetic grid with a channel (a cylinder along x) and one spherical pocket: the blocking spheres must cover the pocket and stay
+// out of the channel.
+class BlockingPocketsTests: XCTestCase
+{
+  let size: Int = 41
+  let length: Double = 20.0
+  let channelAxis: SIMD2<Double> = SIMD2<Double>(5.0, 5.0)
+  let channelRadius: Double = 2.5
+  
+  // the distance in a cubic cell with the minimum-image convention
+  func distance(_ a: SIMD3<Double>, _ b: SIMD3<Double>) -> Double
+  {
+    let dr: SIMD3<Double> = a - b
+    return simd_length(dr - length * (dr / length).rounded(.toNearestOrEven))
+  }
+  
+  func position(_ index: Int) -> SIMD3<Double>
+  {
+    let i: Int = index % size
+    let j: Int = (index / size) % size
+    let k: Int = index / (size * size)
+    return length * SIMD3<Double>(Double(i), Double(j), Double(k)) / Double(size - 1)
+  }
+  
+  func isInChannel(_ position: SIMD3<Double>) -> Bool
+  {
+    return distance(SIMD3<Double>(0.0, position.y, position.z), SIMD3<Double>(0.0, channelAxis.x, channelAxis.y)) < channelRadius
+  }
+  
+  func grid(pocketCenter: SIMD3<Double>, pocketRadius: Double) -> [Float]
+  {
+    return (0..<(size * size * size)).map{index -> Float in
+      let position: SIMD3<Double> = self.position(index)
+      return (isInChannel(position) || distance(position, pocketCenter) < pocketRadius) ? -1.0 : 1.0
+    }
+  }
+  
+  func check(pocketCenter: SIMD3<Double>, pocketRadius: Double) -> SKBlockingPockets
+  {
+    let cell: SKCell = SKCell(a: length, b: length, c: length, alpha: 0.5 * Double.pi, beta: 0.5 * Double.pi, gamma: 0.5 * Double.pi)
+    let blockingPockets: SKBlockingPockets = SKBlockingPockets(values: grid(pocketCenter: pocketCenter, pocketRadius: pocketRadius), dimensions: SIMD3<Int>(size, size, size), cell: cell)
+    
+    XCTAssertEqual(blockingPockets.connectivity.numberOfChannels, 1)
+    XCTAssertEqual(blockingPockets.connectivity.numberOfPockets, 1)
+    XCTAssertFalse(blockingPockets.spheres.isEmpty)
+    
+    let spheres: [(position: SIMD3<Double>, radius: Double)] = blockingPockets.spheres.map{(length * $0.position, $0.radius)}
+    let pocketMask: [Bool] = blockingPockets.connectivity.pocketMask
+    var numberOfUncoveredPocketPoints: Int = 0
+    var numberOfBlockedChannelPoints: Int = 0
+    for index in 0..<(size * size * size)
+    {
+      let position: SIMD3<Double> = self.position(index)
+      let isBlocked: Bool = spheres.contains{distance(position, $0.position) <= $0.radius + 1e-8}
+      if pocketMask[index] && !isBlocked
+      {
+        numberOfUncoveredPocketPoints += 1
+      }
+      if isInChannel(position) && isBlocked
+      {
+        numberOfBlockedChannelPoints += 1
+      }
+    }
+    XCTAssertEqual(numberOfUncoveredPocketPoints, 0, "pocket points that are not blocked")
+    XCTAssertEqual(numberOfBlockedChannelPoints, 0, "channel points that are blocked")
+    
+    return blockingPockets
+  }
+  
+  // a pocket far from the channel: the spheres extend into the framework and a single sphere blocks the whole pocket
+  func testDistantPocket()
+  {
+    let blockingPockets: SKBlockingPockets = check(pocketCenter: SIMD3<Double>(10.0, 15.0, 15.0), pocketRadius: 3.0)
+    XCTAssertEqual(blockingPockets.spheres.count, 1)
+    XCTAssertGreaterThan(blockingPockets.spheres.map{$0.radius}.max() ?? 0.0, 3.0)
+  }
+  
+  // a pocket separated from the channel by about 1 Angstrom of framework
+  func testNearbyPocket()
+  {
+    let _: SKBlockingPockets = check(pocketCenter: SIMD3<Double>(10.0, 10.0, 5.0), pocketRadius: 1.5)
+  }
+  
+  func testWriteBlockFile() throws
+  {
+    let blockingPockets: SKBlockingPockets = check(pocketCenter: SIMD3<Double>(10.0, 15.0, 15.0), pocketRadius: 3.0)
+    
+    let url: URL = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString).appendingPathExtension("block")
+    defer { try? FileManager.default.removeItem(at: url) }
+    try blockingPockets.write(to: url)
+    
+    let lines: [String] = try String(contentsOf: url, encoding: String.Encoding.utf8).split(separator: "\n").map{String($0)}
+    XCTAssertEqual(lines.count, blockingPockets.spheres.count + 1)
+    XCTAssertEqual(Int(lines[0]), blockingPockets.spheres.count)
+    for (line, sphere) in zip(lines.dropFirst(), blockingPockets.spheres)
+    {
+      let values: [Double] = line.split(separator: " ").compactMap{Double($0)}
+      XCTAssertEqual(values.count, 4)
+      guard values.count == 4 else { continue }
+      XCTAssertEqual(values[0], sphere.position.x, accuracy: 1e-7)
+      XCTAssertEqual(values[1], sphere.position.y, accuracy: 1e-7)
+      XCTAssertEqual(values[2], sphere.position.z, accuracy: 1e-7)
+      XCTAssertEqual(values[3], sphere.radius, accuracy: 1e-7)
+    }
+  }
+}
@@ -0,0 +1,127 @@
+//
+//  EnergyGridCacheTests.swift
+//  SimulationKitTests
+//
+//  Created by David Dubbeldam on 17/10/2026.
+//  Copyright © 2026 David Dubbeldam. All rights reserved.
+//
+
+import XCTest
+@testable import SimulationKit
+import simd
+
+// The on-disk cache of energy grids ('SKEnergyGridCache'): the keys name the files, so they must be the same in every session and change
+// with any change of the input; grids and gradients must read back as stored, and the least-recently used grids are evicted first.
+class EnergyGridCacheTests: XCTestCase
+{
+  let unitCell: double3x3 = double3x3([10.0, 0.0, 0.0], [0.0, 11.0, 0.0], [0.0, 0.0, 12.0])
+  let positions: [SIMD3<Double>] = [SIMD3<Double>(0.1, 0.2, 0.3), SIMD3<Double>(0.5, 0.5, 0.5)]
+  let potentialParameters: [SIMD2<Double>] = [SIMD2<Double>(22.0, 2.3), SIMD2<Double>(53.0, 3.3)]
+  let probeParameters: SIMD2<Double> = SIMD2<Double>(36.0, 3.31)
+  let dimensions: SIMD3<Int> = SIMD3<Int>(16, 16, 16)
+  
+  func key(unitCell: double3x3? = nil, positions: [SIMD3<Double>]? = nil, potentialParameters: [SIMD2<Double>]? = nil, probeParameters: SIMD2<Double>? = nil, dimensions: SIMD3<Int>? = nil) -> String
+  {
+    return SKEnergyGridCache.key(unitCell: unitCell ?? self.unitCell, positions: positions ?? self.positions, potentialParameters: potentialParameters ?? self.potentialParameters, probeParameters: probeParameters ?? self.probeParameters, dimensions: dimensions ?? self.dimensions)
+  }
+  
+  // a cache in a new temporary directory that is removed after the test
+  func temporaryCache() -> SKEnergyGridCache
+  {
+    let directory: URL = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString, isDirectory: true)
+    addTeardownBlock {
+      try? FileManager.default.removeItem(at: directory)
+    }
+    return SKEnergyGridCache(directory: directory)
+  }
+  
+  func testKey()
+  {
+    // the SHA-256 of the version, dimensions, probe, cell, positions and parameters as little-endian doubles
+    XCTAssertEqual(key(), "d499d6994c62a110570e5a5e2a353c004972a284672136caf2390f279b3f1bd5")
+    XCTAssertEqual(key(), key())
+    
+    // a change of one ulp in any of the inputs gives a different key
+    var movedPositions: [SIMD3<Double>] = positions
+    movedPositions[1].z = movedPositions[1].z.nextUp
+    XCTAssertNotEqual(key(positions: movedPositions), key())
+    movedPositions = positions
+    movedPositions[0].x = movedPositions[0].x.nextDown
+    XCTAssertNotEqual(key(positions: movedPositions), key())
+    
+    var changedParameters: [SIMD2<Double>] = potentialParameters
+    changedParameters[0].y = changedParameters[0].y.nextUp
+    XCTAssertNotEqual(key(potentialParameters: changedParameters), key())
+    
+    var changedCell: double3x3 = unitCell
+    changedCell[1].x = changedCell[1].x.nextUp
+    XCTAssertNotEqual(key(unitCell: changedCell), key())
+    
+    XCTAssertNotEqual(key(probeParameters: SIMD2<Double>(probeParameters.x.nextUp, probeParameters.y)), key())
+    XCTAssertNotEqual(key(dimensions: SIMD3<Int>(16, 16, 17)), key())
+    
+    // the order of the atoms matters
+    XCTAssertNotEqual(key(positions: Array(positions.reversed()), potentialParameters: Array(potentialParameters.reversed())), key())
+  }
+  
+  func testRoundTrip()
+  {
+    let cache: SKEnergyGridCache = temporaryCache()
+    let grid: [Float] = (0..<(dimensions.x * dimensions.y * dimensions.z)).map{Float($0) * 0.25 - 100.0}
+    let gradients: [SIMD3<Float>] = (0..<grid.count).map{SIMD3<Float>(Float($0), -Float($0), 0.5 * Float($0))}
+    
+    XCTAssertNil(cache.grid(forKey: key()))
+    XCTAssertNil(cache.gradients(forKey: key()))
+    
+    cache.store(grid: grid, forKey: key())
+    cache.store(gradients: gradients, forKey: key())
+    cache.queue.sync {}
+    
+    XCTAssertEqual(cache.grid(forKey: key()), grid)
+    XCTAssertEqual(cache.gradients(forKey: key()), gradients)
+    XCTAssertNil(cache.grid(forKey: key(dimensions: SIMD3<Int>(16, 16, 17))))
+    
+    // a second cache on the same directory (another session) finds the grid
+    let otherCache: SKEnergyGridCache = SKEnergyGridCache(directory: cache.directory)
+    XCTAssertEqual(otherCache.grid(forKey: key()), grid)
+    
+    cache.removeAll()
+    XCTAssertNil(cache.grid(forKey: key()))
+    XCTAssertNil(cache.gradients(forKey: key()))
+  }
+  
+  func testEviction()
+  {
+    let cache: SKEnergyGridCache = temporaryCache()
+    let grid: [Float] = [Float](repeating: 1.0, count: 1024)
+    let sizeOfGrid: Int = grid.count * MemoryLayout<Float>.stride
+    let keys: [String] = (0..<4).map{key(dimensions: SIMD3<Int>(16, 16, 16 + $0))}
+    
+    for key in keys[0..<3]
+    {
+      cache.store(grid: grid, forKey: key)
+    }
+    cache.queue.sync {}
+    
+    // explicit times of use, the resolution of the modification dates of the file system is not known
+    let now: Date = Date()
+    for (index, key) in keys[0..<3].enumerated()
+    {
+      let url: URL = cache.directory!.appendingPathComponent(key)
+      try? FileManager.default.setAttributes([.modificationDate: now.addingTimeInterval(Double(index - 100))], ofItemAtPath: url.path)
+    }
+    
+    // reading the oldest grid makes it the most recently used
+    XCTAssertEqual(cache.grid(forKey: keys[0]), grid)
+    
+    // room for two and a half grids: the two least-recently used are evicted when the fourth is stored
+    cache.maximumSize = 5 * sizeOfGrid / 2
+    cache.store(grid: grid, forKey: keys[3])
+    cache.queue.sync {}
+    
+    XCTAssertNotNil(cache.grid(forKey: keys[0]))
+    XCTAssertNil(cache.grid(forKey: keys[1]))
+    XCTAssertNil(cache.grid(forKey: keys[2]))
+    XCTAssertNotNil(cache.grid(forKey: keys[3]))
+  }
+}
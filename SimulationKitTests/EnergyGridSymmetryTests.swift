@@ -0,0 +1,147 @@
+//
+//  EnergyGridSymmetryTests.swift
+//  SimulationKitTests
+//
+//  Created by David Dubbeldam on 17/10/2026.
+//  Copyright © 2026 David Dubbeldam. All rights reserved.
+//
+
+import XCTest
+@testable import SimulationKit
+import SymmetryKit
+import simd
+
+// The energy grid filled in by symmetry ('SKEnergyGridSymmetry.expand') must be identical to the full grid, also when the stored space group
+// does not describe the atoms.
+class EnergyGridSymmetryTests: XCTestCase
+{
+  let probeParameter: SIMD2<Double> = SIMD2<Double>(36.0, 3.31)
+  
+  // the unit cell, the fractional positions of all atoms in the unit cell, their Lennard-Jones parameters, and the Hall number of the CIF-file
+  func zeolite(_ fileName: String) -> (unitCell: double3x3, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], hallNumber: Int)?
+  {
+    let bundle: Bundle = Bundle(for: type(of: self))
+    guard let url: URL = bundle.url(forResource: fileName, withExtension: nil),
+          let contentString: String = try? String(contentsOf: url, encoding: String.Encoding.utf8) else { return nil }
+    
+    let parser: SKCIFParser = SKCIFParser(displayName: String(describing: url), string: contentString, windowController: nil)
+    try? parser.startParsing()
+    guard let frame: SKStructure = parser.scene.first?.first,
+          let unitCell: double3x3 = frame.cell?.unitCell,
+          let hallNumber: Int = frame.spaceGroupHallNumber else { return nil }
+    
+    let spaceGroup: SKSpacegroup = SKSpacegroup(HallNumber: hallNumber)
+    let atoms: [(fractionalPosition: SIMD3<Double>, type: Int)] = frame.atoms.map{($0.position, $0.elementIdentifier)}
+    let expandedAtoms: [(fractionalPosition: SIMD3<Double>, type: Int)] = spaceGroup.duplicatesRemoved(unitCell: unitCell, atoms2: spaceGroup.expand(atoms: atoms, unitCell: unitCell))
+    
+    // oxygen and silicon (TraPPE-zeo like), other elements get generic parameters
+    let potentialParameters: [SIMD2<Double>] = expandedAtoms.map{atom -> SIMD2<Double> in
+      switch(atom.type)
+      {
+      case 8:
+        return SIMD2<Double>(53.0, 3.3)
+      case 14:
+        return SIMD2<Double>(22.0, 2.3)
+      default:
+        return SIMD2<Double>(50.0, 3.0)
+      }
+    }
+    return (unitCell, expandedAtoms.map{$0.fractionalPosition}, potentialParameters, hallNumber)
+  }
+  
+  func compareWithFullGrid(unitCell: double3x3, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], hallNumber: Int, size: Int, _ message: String) -> SKEnergyGridSymmetry
+  {
+    let numberOfReplicas: SIMD3<Int32> = SKCell(unitCell: unitCell).numberOfReplicas(forCutoff: 12.0)
+    let framework: SKCPUFramework = SKCPUFramework(positions: positions, potentialParameters: potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas)
+    
+    let spaceGroup: SKSpacegroup = SKSpacegroup(HallNumber: hallNumber)
+    let symmetry: SKEnergyGridSymmetry = SKEnergyGridSymmetry(dimensions: SIMD3<Int>(size, size, size), spaceGroup: spaceGroup, unitCell: unitCell, positions: positions, potentialParameters: potentialParameters)
+    
+    let full: [Float] = framework.ComputeEnergyGrid(size, sizeY: size, sizeZ: size, probeParameter: probeParameter)
+    let symmetric: [Float] = framework.ComputeEnergyGrid(size, sizeY: size, sizeZ: size, probeParameter: probeParameter, spaceGroup: spaceGroup)
+    
+    XCTAssertEqual(full.count, size * size * size, message)
+    XCTAssertEqual(symmetric.count, full.count, message)
+    guard symmetric.count == full.count else { return symmetry }
+    
+    // the same energies, up to the rounding of the (symmetry-equivalent) grid positions and the order of the summation
+    var numberOfDifferences: Int = 0
+    for (index, value) in full.enumerated()
+    {
+      if fabs(symmetric[index] - value) > 0.1 + 1e-3 * fabs(value)
+      {
+        numberOfDifferences += 1
+      }
+    }
+    XCTAssertEqual(numberOfDifferences, 0, "grid points differ from the full grid (\(message))")
+    return symmetry
+  }
+  
+  func testCubicCentredZeolite()
+  {
+    guard let structure = zeolite("CIF_Files/Zeolites/A/ACO.cif") else
+    {
+      XCTFail("ACO.cif could not be read")
+      return
+    }
+    let size: Int = SKEnergyGridSymmetry.symmetricGridSize(25)
+    let symmetry: SKEnergyGridSymmetry = compareWithFullGrid(unitCell: structure.unitCell, positions: structure.positions, potentialParameters: structure.potentialParameters, hallNumber: structure.hallNumber, size: size, "ACO")
+    
+    // Im-3m: all 96 operations (including the body-centring) map the grid and the atoms onto themselves
+    XCTAssertEqual(symmetry.numberOfOperations, SKSpacegroup(HallNumber: structure.hallNumber).seitzMatrices.count)
+    XCTAssertLessThan(symmetry.uniqueGridPoints.count, size * size * size / 48)
+  }
+  
+  func testHexagonalZeolite()
+  {
+    guard let structure = zeolite("CIF_Files/Zeolites/A/AFI.cif") else
+    {
+      XCTFail("AFI.cif could not be read")
+      return
+    }
+    let size: Int = SKEnergyGridSymmetry.symmetricGridSize(25)
+    let symmetry: SKEnergyGridSymmetry = compareWithFullGrid(unitCell: structure.unitCell, positions: structure.positions, potentialParameters: structure.potentialParameters, hallNumber: structure.hallNumber, size: size, "AFI")
+    XCTAssertEqual(symmetry.numberOfOperations, SKSpacegroup(HallNumber: structure.hallNumber).seitzMatrices.count)
+  }
+  
+  // positions that are not symmetrized: the operations that no longer map the atoms onto themselves must be dropped
+  func testPerturbedAtom()
+  {
+    guard var structure = zeolite("CIF_Files/Zeolites/A/ACO.cif") else
+    {
+      XCTFail("ACO.cif could not be read")
+      return
+    }
+    structure.positions[0] += SIMD3<Double>(0.031, 0.017, 0.005)
+    let size: Int = SKEnergyGridSymmetry.symmetricGridSize(25)
+    let symmetry: SKEnergyGridSymmetry = compareWithFullGrid(unitCell: structure.unitCell, positions: structure.positions, potentialParameters: structure.potentialParameters, hallNumber: structure.hallNumber, size: size, "perturbed ACO")
+    XCTAssertLessThan(symmetry.numberOfOperations, SKSpacegroup(HallNumber: structure.hallNumber).seitzMatrices.count)
+  }
+  
+  // a (primitive) structure that carries a centred Hall number it does not have: only the operations of the atoms survive
+  func testWrongSpaceGroup()
+  {
+    guard let structure = zeolite("CIF_Files/Zeolites/A/ACO.cif") else
+    {
+      XCTFail("ACO.cif could not be read")
+      return
+    }
+    
+    // remove the atoms that are generated by the body-centring
+    var positions: [SIMD3<Double>] = []
+    var potentialParameters: [SIMD2<Double>] = []
+    for (index, position) in structure.positions.enumerated()
+    {
+      let centred: SIMD3<Double> = position + SIMD3<Double>(0.5, 0.5, 0.5)
+      if !positions.contains(where: {simd_length(structure.unitCell * (($0 - centred) - ($0 - centred).rounded(.toNearestOrEven))) < 1e-3})
+      {
+        positions.append(position)
+        potentialParameters.append(structure.potentialParameters[index])
+      }
+    }
+    
+    let size: Int = SKEnergyGridSymmetry.symmetricGridSize(25)
+    let symmetry: SKEnergyGridSymmetry = compareWithFullGrid(unitCell: structure.unitCell, positions: positions, potentialParameters: potentialParameters, hallNumber: structure.hallNumber, size: size, "ACO without centring")
+    XCTAssertLessThan(symmetry.numberOfOperations, SKSpacegroup(HallNumber: structure.hallNumber).seitzMatrices.count)
+  }
+}
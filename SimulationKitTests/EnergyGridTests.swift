@@ -0,0 +1,170 @@
+//
+//  EnergyGridTests.swift
+//  SimulationKitTests
+//
+//  Created by David Dubbeldam on 17/10/2026.
+//  Copyright © 2026 David Dubbeldam. All rights reserved.
+//
+
+import XCTest
+@testable import SimulationKit
+import SymmetryKit
+import Metal
+import simd
+
+// The energy grid of the CPU ('SKCPUFramework') must match a brute-force reference in double precision and the Metal-kernel
+// ('SKMetalFramework'), for triclinic cells, with replicas, and with more atoms than a work-batch (the clamp is applied per batch).
+class EnergyGridTests: XCTestCase
+{
+  let probeParameter: SIMD2<Double> = SIMD2<Double>(36.0, 3.31)
+  
+  // atoms on a jittered lattice of m x m x m points, so that they do not overlap, with alternating Lennard-Jones parameters
+  func jitteredLattice(_ m: Int, seed: UInt64) -> (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>])
+  {
+    var generator: SKRandomNumberGenerator = SKRandomNumberGenerator(seed: seed)
+    var positions: [SIMD3<Double>] = []
+    var potentialParameters: [SIMD2<Double>] = []
+    for k in 0..<m
+    {
+      for j in 0..<m
+      {
+        for i in 0..<m
+        {
+          let jitter: SIMD3<Double> = 0.3 * (SIMD3<Double>(generator.uniform(), generator.uniform(), generator.uniform()) - 0.5)
+          positions.append((SIMD3<Double>(Double(i), Double(j), Double(k)) + 0.5 + jitter) / Double(m))
+          potentialParameters.append((i + j + k) % 3 == 0 ? SIMD2<Double>(22.0, 2.3) : SIMD2<Double>(53.0, 3.3))
+        }
+      }
+    }
+    return (positions, potentialParameters)
+  }
+  
+  // The energy at a fractional position with the conventions of the kernel (minimum image in the replica-cell, 12 Angstrom cutoff, 4 x epsilon,
+  // the sum of each work-batch of 8192 atoms clamped), in double precision. The magnitude (the sum of the absolute values of the batches that
+  // are not clamped) sets the scale of the rounding errors of the single precision versions. 'totalClamped' is the energy when the total is
+  // clamped instead of each batch.
+  func referenceEnergy(_ gridPosition: SIMD3<Double>, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], unitCell: double3x3, numberOfReplicas: SIMD3<Int32>) -> (energy: Double, magnitude: Double, totalClamped: Double)
+  {
+    let replicas: SIMD3<Double> = SIMD3<Double>(numberOfReplicas)
+    let replicaCell: double3x3 = double3x3([replicas.x * unitCell[0], replicas.y * unitCell[1], replicas.z * unitCell[2]])
+    let maximumValue: Double = Double(SKCPUFramework.maximumEnergyValue)
+    
+    var energy: Double = 0.0
+    var magnitude: Double = 0.0
+    var unclampedEnergy: Double = 0.0
+    for start in stride(from: 0, to: positions.count, by: SKCPUFramework.sizeOfWorkBatch)
+    {
+      var batchEnergy: Double = 0.0
+      var batchMagnitude: Double = 0.0
+      for atom in start..<min(start + SKCPUFramework.sizeOfWorkBatch, positions.count)
+      {
+        let epsilon: Double = 4.0 * sqrt(potentialParameters[atom].x * probeParameter.x)
+        let size: Double = 0.5 * (potentialParameters[atom].y + probeParameter.y)
+        for i in 0..<Int(numberOfReplicas.x)
+        {
+          for j in 0..<Int(numberOfReplicas.y)
+          {
+            for k in 0..<Int(numberOfReplicas.z)
+            {
+              var ds: SIMD3<Double> = (gridPosition - positions[atom] - SIMD3<Double>(Double(i), Double(j), Double(k))) / replicas
+              ds -= ds.rounded(.toNearestOrEven)
+              let rr: Double = simd_length_squared(replicaCell * ds)
+              if rr < 144.0
+              {
+                let rri3: Double = pow(size * size / rr, 3)
+                batchEnergy += epsilon * rri3 * (rri3 - 1.0)
+                batchMagnitude += epsilon * rri3 * (rri3 + 1.0)
+              }
+            }
+          }
+        }
+      }
+      energy += min(batchEnergy, maximumValue)
+      magnitude += batchEnergy > maximumValue ? 0.0 : batchMagnitude
+      unclampedEnergy += batchEnergy
+    }
+    return (energy, magnitude, min(unclampedEnergy, maximumValue))
+  }
+  
+  // the grid compared to the reference, returns the number of grid points where clamping per work-batch differs from clamping the total
+  @discardableResult
+  func compareWithReference(_ grid: [Float], size: SIMD3<Int>, positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>], unitCell: double3x3, numberOfReplicas: SIMD3<Int32>, _ message: String) -> Int
+  {
+    XCTAssertEqual(grid.count, size.x * size.y * size.z, message)
+    guard grid.count == size.x * size.y * size.z else { return 0 }
+    
+    var numberOfDifferences: Int = 0
+    var numberOfPointsClampedPerBatch: Int = 0
+    for k in 0..<size.z
+    {
+      for j in 0..<size.y
+      {
+        for i in 0..<size.x
+        {
+          let gridPosition: SIMD3<Double> = SIMD3<Double>(Double(i), Double(j), Double(k)) / SIMD3<Double>(size &- 1)
+          let reference: (energy: Double, magnitude: Double, totalClamped: Double) = referenceEnergy(gridPosition, positions: positions, potentialParameters: potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas)
+          let value: Float = grid[i + size.x * (j + size.y * k)]
+          if !(fabs(Double(value) - reference.energy) <= 1e-2 + 1e-3 * reference.magnitude)
+          {
+            numberOfDifferences += 1
+          }
+          numberOfPointsClampedPerBatch += fabs(reference.energy - reference.totalClamped) > 1.0 ? 1 : 0
+        }
+      }
+    }
+    XCTAssertEqual(numberOfDifferences, 0, "grid points differ from the reference (\(message))")
+    return numberOfPointsClampedPerBatch
+  }
+  
+  // a small triclinic cell, so that the cutoff spans several replicas
+  func testTriclinicCellWithReplicas()
+  {
+    let unitCell: double3x3 = SKCell(a: 9.0, b: 10.0, c: 11.0, alpha: 80.0 * Double.pi / 180.0, beta: 100.0 * Double.pi / 180.0, gamma: 115.0 * Double.pi / 180.0).unitCell
+    let atoms: (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>]) = jitteredLattice(3, seed: 17)
+    let numberOfReplicas: SIMD3<Int32> = SKCell(unitCell: unitCell).numberOfReplicas(forCutoff: 12.0)
+    XCTAssertGreaterThan(numberOfReplicas.min(), 1)
+    let size: SIMD3<Int> = SIMD3<Int>(9, 10, 11)
+    
+    let framework: SKCPUFramework = SKCPUFramework(positions: atoms.positions, potentialParameters: atoms.potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas)
+    let grid: [Float] = framework.ComputeEnergyGrid(size.x, sizeY: size.y, sizeZ: size.z, probeParameter: probeParameter)
+    compareWithReference(grid, size: size, positions: atoms.positions, potentialParameters: atoms.potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas, "all pairs")
+    
+    // with a single work-batch the cell-list (which clamps the total) gives the same clamping
+    framework.method = .cellList
+    let cellListGrid: [Float] = framework.ComputeEnergyGrid(size.x, sizeY: size.y, sizeZ: size.z, probeParameter: probeParameter)
+    compareWithReference(cellListGrid, size: size, positions: atoms.positions, potentialParameters: atoms.potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas, "cell list")
+  }
+  
+  // 9261 atoms are two work-batches; a grid point that overlaps with an atom of one batch gets the clamped value plus the energy of the other
+  func testMoreAtomsThanWorkBatch()
+  {
+    let unitCell: double3x3 = SKCell(a: 58.0, b: 60.0, c: 62.0, alpha: 80.0 * Double.pi / 180.0, beta: 100.0 * Double.pi / 180.0, gamma: 115.0 * Double.pi / 180.0).unitCell
+    let atoms: (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>]) = jitteredLattice(21, seed: 42)
+    XCTAssertGreaterThan(atoms.positions.count, SKCPUFramework.sizeOfWorkBatch)
+    let numberOfReplicas: SIMD3<Int32> = SKCell(unitCell: unitCell).numberOfReplicas(forCutoff: 12.0)
+    let size: SIMD3<Int> = SIMD3<Int>(7, 8, 9)
+    
+    let framework: SKCPUFramework = SKCPUFramework(positions: atoms.positions, potentialParameters: atoms.potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas)
+    let grid: [Float] = framework.ComputeEnergyGrid(size.x, sizeY: size.y, sizeZ: size.z, probeParameter: probeParameter)
+    let numberOfPointsClampedPerBatch: Int = compareWithReference(grid, size: size, positions: atoms.positions, potentialParameters: atoms.potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas, "all pairs")
+    XCTAssertGreaterThan(numberOfPointsClampedPerBatch, 0, "no grid point with a clamped and an unclamped work-batch")
+  }
+  
+  func testMetalFramework() throws
+  {
+    guard let device: MTLDevice = MTLCreateSystemDefaultDevice(),
+          let commandQueue: MTLCommandQueue = device.makeCommandQueue() else
+    {
+      throw XCTSkip("no Metal device available")
+    }
+    
+    let unitCell: double3x3 = SKCell(a: 58.0, b: 60.0, c: 62.0, alpha: 80.0 * Double.pi / 180.0, beta: 100.0 * Double.pi / 180.0, gamma: 115.0 * Double.pi / 180.0).unitCell
+    let atoms: (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>]) = jitteredLattice(21, seed: 42)
+    let numberOfReplicas: SIMD3<Int32> = SKCell(unitCell: unitCell).numberOfReplicas(forCutoff: 12.0)
+    let size: SIMD3<Int> = SIMD3<Int>(7, 8, 9)
+    
+    let metalFramework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: atoms.positions, potentialParameters: atoms.potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas)
+    let grid: [Float] = metalFramework.ComputeEnergyGrid(size.x, sizeY: size.y, sizeZ: size.z, probeParameter: probeParameter)
+    compareWithReference(grid, size: size, positions: atoms.positions, potentialParameters: atoms.potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas, "Metal")
+  }
+}
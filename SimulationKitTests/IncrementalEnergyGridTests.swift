@@ -0,0 +1,139 @@
+//
+//  IncrementalEnergyGridTests.swift
+//  SimulationKitTests
+//
+//  Created by David Dubbeldam on 17/10/2026.
+//  Copyright © 2026 David Dubbeldam. All rights reserved.
+//
+
+import XCTest
+@testable import SimulationKit
+import SymmetryKit
+import simd
+
+// After moving, adding and deleting atoms the grid updated by 'SKIncrementalEnergyGrid' must match a full recomputation, also for the grid
+// points close to atoms that are recomputed instead of updated (see 'SKCPUFramework.maximumIncrementalEnergyValue').
+class IncrementalEnergyGridTests: XCTestCase
+{
+  let probeParameter: SIMD2<Double> = SIMD2<Double>(36.0, 3.31)
+  let unitCell: double3x3 = SKCell(a: 14.0, b: 15.0, c: 16.0, alpha: 80.0 * Double.pi / 180.0, beta: 100.0 * Double.pi / 180.0, gamma: 115.0 * Double.pi / 180.0).unitCell
+  let dimensions: SIMD3<Int> = SIMD3<Int>(16, 17, 18)
+  
+  // atoms on a jittered lattice of m x m x m points, so that they do not overlap, with alternating Lennard-Jones parameters
+  func jitteredLattice(_ m: Int, seed: UInt64) -> (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>])
+  {
+    var generator: SKRandomNumberGenerator = SKRandomNumberGenerator(seed: seed)
+    var positions: [SIMD3<Double>] = []
+    var potentialParameters: [SIMD2<Double>] = []
+    for k in 0..<m
+    {
+      for j in 0..<m
+      {
+        for i in 0..<m
+        {
+          let jitter: SIMD3<Double> = 0.3 * (SIMD3<Double>(generator.uniform(), generator.uniform(), generator.uniform()) - 0.5)
+          positions.append((SIMD3<Double>(Double(i), Double(j), Double(k)) + 0.5 + jitter) / Double(m))
+          potentialParameters.append((i + j + k) % 3 == 0 ? SIMD2<Double>(22.0, 2.3) : SIMD2<Double>(53.0, 3.3))
+        }
+      }
+    }
+    return (positions, potentialParameters)
+  }
+  
+  var numberOfReplicas: SIMD3<Int32>
+  {
+    return SKCell(unitCell: unitCell).numberOfReplicas(forCutoff: 12.0)
+  }
+  
+  func fullGrid(_ positions: [SIMD3<Double>], _ potentialParameters: [SIMD2<Double>]) -> [Float]
+  {
+    let framework: SKCPUFramework = SKCPUFramework(positions: positions, potentialParameters: potentialParameters, unitCell: unitCell, numberOfReplicas: numberOfReplicas)
+    return framework.ComputeEnergyGrid(dimensions.x, sizeY: dimensions.y, sizeZ: dimensions.z, probeParameter: probeParameter)
+  }
+  
+  // the fractional position of a grid point
+  func gridPoint(_ index: SIMD3<Int>) -> SIMD3<Double>
+  {
+    return SIMD3<Double>(index) / SIMD3<Double>(dimensions &- 1)
+  }
+  
+  func gridIndex(_ index: SIMD3<Int>) -> Int
+  {
+    return index.x + dimensions.x * (index.y + dimensions.y * index.z)
+  }
+  
+  func compare(_ grid: [Float]?, _ reference: [Float], _ message: String)
+  {
+    guard let grid: [Float] = grid else
+    {
+      XCTFail("no updated grid (\(message))")
+      return
+    }
+    XCTAssertEqual(grid.count, reference.count, message)
+    guard grid.count == reference.count else { return }
+    
+    var numberOfDifferences: Int = 0
+    for index in 0..<grid.count
+    {
+      if !(fabs(grid[index] - reference[index]) <= 0.1 + 1e-4 * fabs(reference[index]))
+      {
+        numberOfDifferences += 1
+      }
+    }
+    XCTAssertEqual(numberOfDifferences, 0, "grid points differ from the full recomputation (\(message))")
+  }
+  
+  func testMoveAddAndDelete()
+  {
+    var atoms: (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>]) = jitteredLattice(3, seed: 7)
+    XCTAssertGreaterThan(numberOfReplicas.min(), 1)
+    
+    let incrementalEnergyGrid: SKIncrementalEnergyGrid = SKIncrementalEnergyGrid()
+    incrementalEnergyGrid.store(grid: fullGrid(atoms.positions, atoms.potentialParameters), unitCell: unitCell, positions: atoms.positions, potentialParameters: atoms.potentialParameters, probeParameter: probeParameter, dimensions: dimensions)
+    
+    // an atom is moved next to a grid point, another atom is deleted (which changes the order of the atoms) and an atom is added next to a
+    // grid point, so the energies there are far beyond the threshold of the incremental update
+    let movedGridPoint: SIMD3<Int> = SIMD3<Int>(4, 5, 6)
+    let addedGridPoint: SIMD3<Int> = SIMD3<Int>(11, 12, 9)
+    atoms.positions[13] = gridPoint(movedGridPoint) + SIMD3<Double>(0.004, -0.003, 0.002)
+    atoms.positions.remove(at: 5)
+    atoms.potentialParameters.remove(at: 5)
+    atoms.positions.append(gridPoint(addedGridPoint) + SIMD3<Double>(-0.002, 0.003, 0.004))
+    atoms.potentialParameters.append(SIMD2<Double>(53.0, 3.3))
+    
+    let reference: [Float] = fullGrid(atoms.positions, atoms.potentialParameters)
+    XCTAssertGreaterThanOrEqual(reference[gridIndex(movedGridPoint)], SKCPUFramework.maximumIncrementalEnergyValue)
+    XCTAssertGreaterThanOrEqual(reference[gridIndex(addedGridPoint)], SKCPUFramework.maximumIncrementalEnergyValue)
+    
+    let grid: [Float]? = incrementalEnergyGrid.update(unitCell: unitCell, positions: atoms.positions, potentialParameters: atoms.potentialParameters, probeParameter: probeParameter, dimensions: dimensions, numberOfReplicas: numberOfReplicas)
+    compare(grid, reference, "first edit")
+    
+    // the updated grid is stored, so a second edit (moving the atom away from the grid point again) continues from it
+    atoms.positions[12] += SIMD3<Double>(0.031, -0.027, 0.024)
+    let secondReference: [Float] = fullGrid(atoms.positions, atoms.potentialParameters)
+    let secondGrid: [Float]? = incrementalEnergyGrid.update(unitCell: unitCell, positions: atoms.positions, potentialParameters: atoms.potentialParameters, probeParameter: probeParameter, dimensions: dimensions, numberOfReplicas: numberOfReplicas)
+    compare(secondGrid, secondReference, "second edit")
+  }
+  
+  // too many changes, or a different probe or grid size, require a full recomputation
+  func testFullRecomputationRequired()
+  {
+    var atoms: (positions: [SIMD3<Double>], potentialParameters: [SIMD2<Double>]) = jitteredLattice(3, seed: 11)
+    
+    let incrementalEnergyGrid: SKIncrementalEnergyGrid = SKIncrementalEnergyGrid()
+    incrementalEnergyGrid.maximumNumberOfChanges = 2
+    incrementalEnergyGrid.store(grid: fullGrid(atoms.positions, atoms.potentialParameters), unitCell: unitCell, positions: atoms.positions, potentialParameters: atoms.potentialParameters, probeParameter: probeParameter, dimensions: dimensions)
+    
+    XCTAssertNil(incrementalEnergyGrid.update(unitCell: unitCell, positions: atoms.positions, potentialParameters: atoms.potentialParameters, probeParameter: SIMD2<Double>(10.9, 2.64), dimensions: dimensions, numberOfReplicas: numberOfReplicas))
+    XCTAssertNil(incrementalEnergyGrid.update(unitCell: unitCell, positions: atoms.positions, potentialParameters: atoms.potentialParameters, probeParameter: probeParameter, dimensions: dimensions &+ 1, numberOfReplicas: numberOfReplicas))
+    
+    // moving two atoms is four changes (a removal and an addition each)
+    atoms.positions[0] += SIMD3<Double>(0.01, 0.0, 0.0)
+    atoms.positions[1] += SIMD3<Double>(0.0, 0.01, 0.0)
+    XCTAssertNil(incrementalEnergyGrid.update(unitCell: unitCell, positions: atoms.positions, potentialParameters: atoms.potentialParameters, probeParameter: probeParameter, dimensions: dimensions, numberOfReplicas: numberOfReplicas))
+    
+    incrementalEnergyGrid.maximumNumberOfChanges = 4
+    let grid: [Float]? = incrementalEnergyGrid.update(unitCell: unitCell, positions: atoms.positions, potentialParameters: atoms.potentialParameters, probeParameter: probeParameter, dimensions: dimensions, numberOfReplicas: numberOfReplicas)
+    compare(grid, fullGrid(atoms.positions, atoms.potentialParameters), "two moved atoms")
+  }
+}
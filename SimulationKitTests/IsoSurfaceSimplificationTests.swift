@@ -0,0 +1,121 @@
+//
+//  IsoSurfaceSimplificationTests.swift
+//  SimulationKitTests
+//
+//  Created by David Dubbeldam on 17/10/2026.
+//  Copyright © 2026 David Dubbeldam. All rights reserved.
+//
+
+import XCTest
+@testable import SimulationKit
+import simd
+
+// The simplified meshes of the level-of-detail chain must be valid (no collapsed or duplicate triangles) and keep the Cartesian surface area.
+class IsoSurfaceSimplificationTests: XCTestCase
+{
+  let unitCell: double3x3 = double3x3([20.0, 0.0, 0.0], [4.0, 22.0, 0.0], [-3.0, 2.0, 25.0])
+  
+  // a sphere in fractional coordinates (an ellipsoid in the non-orthogonal cell), from a subdivided icosahedron
+  func sphere(center: SIMD3<Double>, radius: Double, numberOfSubdivisions: Int) -> SKIsoSurfaceMesh
+  {
+    let t: Double = 0.5 * (1.0 + sqrt(5.0))
+    var points: [SIMD3<Double>] = [SIMD3<Double>(-1.0, t, 0.0), SIMD3<Double>(1.0, t, 0.0), SIMD3<Double>(-1.0, -t, 0.0), SIMD3<Double>(1.0, -t, 0.0),
+                                   SIMD3<Double>(0.0, -1.0, t), SIMD3<Double>(0.0, 1.0, t), SIMD3<Double>(0.0, -1.0, -t), SIMD3<Double>(0.0, 1.0, -t),
+                                   SIMD3<Double>(t, 0.0, -1.0), SIMD3<Double>(t, 0.0, 1.0), SIMD3<Double>(-t, 0.0, -1.0), SIMD3<Double>(-t, 0.0, 1.0)].map{simd_normalize($0)}
+    var triangles: [SIMD3<Int>] = [SIMD3<Int>(0, 11, 5), SIMD3<Int>(0, 5, 1), SIMD3<Int>(0, 1, 7), SIMD3<Int>(0, 7, 10), SIMD3<Int>(0, 10, 11),
+                                   SIMD3<Int>(1, 5, 9), SIMD3<Int>(5, 11, 4), SIMD3<Int>(11, 10, 2), SIMD3<Int>(10, 7, 6), SIMD3<Int>(7, 1, 8),
+                                   SIMD3<Int>(3, 9, 4), SIMD3<Int>(3, 4, 2), SIMD3<Int>(3, 2, 6), SIMD3<Int>(3, 6, 8), SIMD3<Int>(3, 8, 9),
+                                   SIMD3<Int>(4, 9, 5), SIMD3<Int>(2, 4, 11), SIMD3<Int>(6, 2, 10), SIMD3<Int>(8, 6, 7), SIMD3<Int>(9, 8, 1)]
+    
+    for _ in 0..<numberOfSubdivisions
+    {
+      var midpoints: [SIMD2<Int>: Int] = [:]
+      func midpoint(_ a: Int, _ b: Int) -> Int
+      {
+        let key: SIMD2<Int> = SIMD2<Int>(min(a, b), max(a, b))
+        if let index: Int = midpoints[key]
+        {
+          return index
+        }
+        points.append(simd_normalize(points[a] + points[b]))
+        midpoints[key] = points.count - 1
+        return points.count - 1
+      }
+      
+      var subdivided: [SIMD3<Int>] = []
+      for triangle in triangles
+      {
+        let ab: Int = midpoint(triangle.x, triangle.y)
+        let bc: Int = midpoint(triangle.y, triangle.z)
+        let ca: Int = midpoint(triangle.z, triangle.x)
+        subdivided += [SIMD3<Int>(triangle.x, ab, ca), SIMD3<Int>(triangle.y, bc, ab), SIMD3<Int>(triangle.z, ca, bc), SIMD3<Int>(ab, bc, ca)]
+      }
+      triangles = subdivided
+    }
+    
+    var vertices: [SIMD4<Float>] = []
+    for point in points
+    {
+      vertices.append(SIMD4<Float>(SIMD3<Float>(center + radius * point), 1.0))
+      vertices.append(SIMD4<Float>(SIMD3<Float>(point), 0.0))
+    }
+    let indices: [UInt32] = triangles.flatMap{[UInt32($0.x), UInt32($0.y), UInt32($0.z)]}
+    return SKIsoSurfaceMesh(vertices: vertices, indices: indices)
+  }
+  
+  func cartesianArea(_ mesh: SKIsoSurfaceMesh) -> Double
+  {
+    var area: Double = 0.0
+    for triangle in 0..<mesh.numberOfTriangles
+    {
+      let p0: SIMD3<Double> = unitCell * SIMD3<Double>(mesh.position(mesh.indices[3 * triangle]))
+      let p1: SIMD3<Double> = unitCell * SIMD3<Double>(mesh.position(mesh.indices[3 * triangle + 1]))
+      let p2: SIMD3<Double> = unitCell * SIMD3<Double>(mesh.position(mesh.indices[3 * triangle + 2]))
+      area += 0.5 * simd_length(simd_cross(p1 - p0, p2 - p0))
+    }
+    return area
+  }
+  
+  func testSimplifiedSphere()
+  {
+    let mesh: SKIsoSurfaceMesh = sphere(center: SIMD3<Double>(0.52, 0.47, 0.5), radius: 0.3, numberOfSubdivisions: 4)
+    let area: Double = cartesianArea(mesh)
+    
+    for resolution in [32, 16, 8]
+    {
+      let simplified: SKIsoSurfaceMesh = mesh.simplified(resolution: SIMD3<Int>(repeating: resolution), unitCell: unitCell)
+      XCTAssertGreaterThan(simplified.numberOfTriangles, 0, "no triangles left for resolution \(resolution)")
+      XCTAssertLessThan(simplified.numberOfTriangles, mesh.numberOfTriangles, "not simplified for resolution \(resolution)")
+      
+      var triangles: Set<SIMD3<UInt32>> = []
+      for triangle in 0..<simplified.numberOfTriangles
+      {
+        let corners: SIMD3<UInt32> = SIMD3<UInt32>(simplified.indices[3 * triangle], simplified.indices[3 * triangle + 1], simplified.indices[3 * triangle + 2])
+        XCTAssertTrue(corners.max() < UInt32(simplified.numberOfVertices), "index out of range for resolution \(resolution)")
+        XCTAssertTrue(corners.x != corners.y && corners.y != corners.z && corners.x != corners.z, "degenerate triangle \(triangle) for resolution \(resolution)")
+        
+        let sorted: SIMD3<UInt32> = SIMD3<UInt32>(corners.min(), corners.x &+ corners.y &+ corners.z &- corners.min() &- corners.max(), corners.max())
+        XCTAssertFalse(triangles.contains(sorted), "duplicate triangle \(triangle) for resolution \(resolution)")
+        triangles.insert(sorted)
+      }
+      
+      XCTAssertEqual(cartesianArea(simplified), area, accuracy: 0.02 * area, "different surface area for resolution \(resolution)")
+    }
+  }
+  
+  // the levels are built in parallel, but each must equal the mesh simplified on its own
+  func testLevelsOfDetail()
+  {
+    let mesh: SKIsoSurfaceMesh = sphere(center: SIMD3<Double>(0.52, 0.47, 0.5), radius: 0.3, numberOfSubdivisions: 4)
+    let levels: [SKIsoSurfaceMesh] = mesh.levelsOfDetail(resolution: SIMD3<Int>(repeating: 64), numberOfLevels: 4, unitCell: unitCell)
+    
+    XCTAssertEqual(levels.count, 4)
+    XCTAssertEqual(levels[0].indices, mesh.indices)
+    for level in 1..<levels.count
+    {
+      let simplified: SKIsoSurfaceMesh = mesh.simplified(resolution: SIMD3<Int>(repeating: 64 >> level), unitCell: unitCell)
+      XCTAssertEqual(levels[level].indices, simplified.indices, "different triangles for level \(level)")
+      XCTAssertEqual(levels[level].vertices, simplified.vertices, "different vertices for level \(level)")
+    }
+  }
+}
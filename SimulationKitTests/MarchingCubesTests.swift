@@ -0,0 +1,295 @@
+//
+//  MarchingCubesTests.swift
+//  SimulationKitTests
+//
+//  Created by David Dubbeldam on 17/10/2026.
+//  Copyright © 2026 David Dubbeldam. All rights reserved.
+//
+
+import XCTest
+@testable import SimulationKit
+import Metal
+import simd
+
+// The CPU marching cubes ('SKCPUMarchingCubes') must produce the same triangle soup, in the same order, as the GPU histogram-pyramid version
+// ('SKMetalMarchingCubes128'), and its indexed mesh the same triangles as its soup. The comparisons with the GPU are skipped without a Metal
+// device; the planes are checked on the CPU only.
+class MarchingCubesTests: XCTestCase
+{
+  let positionPrecision: Float = 1e-5
+  let normalPrecision: Float = 1e-4
+  
+  // a periodic Schwarz-P like surface, with a different period along each axis so that the triangles are not symmetric
+  func voxels(dimensions: SIMD3<Int>) -> [Float]
+  {
+    var data: [Float] = []
+    data.reserveCapacity(dimensions.x * dimensions.y * dimensions.z)
+    for k in 0..<dimensions.z
+    {
+      for j in 0..<dimensions.y
+      {
+        for i in 0..<dimensions.x
+        {
+          let x: Double = 2.0 * Double.pi * Double(i) / Double(dimensions.x)
+          let y: Double = 4.0 * Double.pi * Double(j) / Double(dimensions.y)
+          let z: Double = 2.0 * Double.pi * Double(k) / Double(dimensions.z)
+          data.append(Float(cos(x) + cos(y) + 0.5 * cos(z) + 0.25 * sin(x + z)))
+        }
+      }
+    }
+    return data
+  }
+  
+  func compare(dimensions: SIMD3<Int>, isoValue: Float) throws
+  {
+    guard let device: MTLDevice = MTLCreateSystemDefaultDevice(),
+          let commandQueue: MTLCommandQueue = device.makeCommandQueue() else
+    {
+      throw XCTSkip("no Metal device available")
+    }
+    
+    let data: [Float] = voxels(dimensions: dimensions)
+    let size: SIMD3<Int32> = SIMD3<Int32>(truncatingIfNeeded: dimensions)
+    
+    let cpu: SKCPUMarchingCubes = SKCPUMarchingCubes(dimensions: size)
+    cpu.isoValue = isoValue
+    let cpuVertices: [SIMD4<Float>] = cpu.isoSurface(data)
+    
+    let gpu: SKMetalMarchingCubes128 = SKMetalMarchingCubes128(device: device, commandQueue: commandQueue, dimensions: size)
+    gpu.isoValue = isoValue
+    
+    do
+    {
+      guard let buffer: MTLBuffer = try gpu.prepareHistoPyramids(data) else
+      {
+        XCTAssertTrue(cpuVertices.isEmpty, "GPU found no triangles, CPU found \(cpuVertices.count / 9) for \(dimensions)")
+        return
+      }
+      let numberOfVertices: Int = buffer.length / MemoryLayout<SIMD4<Float>>.stride
+      let gpuVertices: UnsafeBufferPointer<SIMD4<Float>> = UnsafeBufferPointer(start: buffer.contents().bindMemory(to: SIMD4<Float>.self, capacity: numberOfVertices), count: numberOfVertices)
+      
+      XCTAssertGreaterThan(cpuVertices.count, 0, "no triangles found for \(dimensions)")
+      XCTAssertEqual(cpuVertices.count, gpuVertices.count, "different number of triangles for \(dimensions)")
+      guard cpuVertices.count == gpuVertices.count else { return }
+      
+      // per vertex: position, normal and an unused texture coordinate
+      for vertex in stride(from: 0, to: cpuVertices.count, by: 3)
+      {
+        let positionDifference: Float = simd_length(cpuVertices[vertex] - gpuVertices[vertex])
+        let normalDifference: Float = simd_length(cpuVertices[vertex + 1] - gpuVertices[vertex + 1])
+        XCTAssertLessThan(positionDifference, positionPrecision, "different position for triangle \(vertex / 9) for \(dimensions)")
+        XCTAssertLessThan(normalDifference, normalPrecision, "different normal for triangle \(vertex / 9) for \(dimensions)")
+        if positionDifference >= positionPrecision || normalDifference >= normalPrecision
+        {
+          return
+        }
+      }
+      
+      let unitCell: double3x3 = double3x3([20.0, 0.0, 0.0], [4.0, 22.0, 0.0], [-3.0, 2.0, 25.0])
+      let cpuArea: Double = cpu.surfaceArea(data, unitCell: unitCell)
+      let gpuArea: Double = try gpu.surfaceArea(data, unitCell: unitCell)
+      XCTAssertEqual(cpuArea, gpuArea, accuracy: 1e-4 * gpuArea, "different surface area for \(dimensions)")
+    }
+    catch
+    {
+      XCTFail("GPU marching cubes failed: \(error.localizedDescription)")
+    }
+  }
+  
+  func testPowerOfTwoDimensions() throws
+  {
+    try compare(dimensions: SIMD3<Int>(32, 32, 32), isoValue: 0.3)
+  }
+  
+  func testArbitraryDimensions() throws
+  {
+    try compare(dimensions: SIMD3<Int>(21, 30, 17), isoValue: -0.2)
+  }
+  
+  func testSymmetricGridSize() throws
+  {
+    let size: Int = SKEnergyGridSymmetry.symmetricGridSize(128)
+    try compare(dimensions: SIMD3<Int>(size, size, size), isoValue: 0.0)
+  }
+  
+  // The number of triangles of 'soup' that have no equal triangle (with the same orientation and normals) in 'indexedSoup'. The order of the
+  // triangles may differ (slabs versus blocks), so each triangle is matched by its centroid.
+  func numberOfUnmatchedTriangles(_ soup: [SIMD4<Float>], _ indexedSoup: [SIMD4<Float>], dimensions: SIMD3<Int>) -> Int
+  {
+    let numberOfTriangles: Int = soup.count / 9
+    
+    // the centroid in units of a quarter of a grid cell
+    func bin(_ vertices: [SIMD4<Float>], _ triangle: Int) -> SIMD3<Int32>
+    {
+      let centroid: SIMD4<Float> = (vertices[9 * triangle] + vertices[9 * triangle + 3] + vertices[9 * triangle + 6]) / 3.0
+      return SIMD3<Int32>(simd_floor(4.0 * SIMD3<Float>(centroid.x, centroid.y, centroid.z) * SIMD3<Float>(dimensions)))
+    }
+    
+    // equal up to a cyclic permutation of the vertices, which keeps the orientation
+    func equal(_ triangle: Int, _ indexedTriangle: Int) -> Bool
+    {
+      for rotation in 0..<3
+      {
+        var same: Bool = true
+        for vertex in 0..<3
+        {
+          let a: Int = 9 * triangle + 3 * vertex
+          let b: Int = 9 * indexedTriangle + 3 * ((vertex + rotation) % 3)
+          if simd_length(soup[a] - indexedSoup[b]) >= positionPrecision || simd_length(soup[a + 1] - indexedSoup[b + 1]) >= normalPrecision
+          {
+            same = false
+            break
+          }
+        }
+        if same
+        {
+          return true
+        }
+      }
+      return false
+    }
+    
+    var bins: [SIMD3<Int32>: [Int]] = [:]
+    for triangle in 0..<(indexedSoup.count / 9)
+    {
+      bins[bin(indexedSoup, triangle), default: []].append(triangle)
+    }
+    
+    var matched: [Bool] = [Bool](repeating: false, count: indexedSoup.count / 9)
+    var numberOfUnmatchedTriangles: Int = 0
+    for triangle in 0..<numberOfTriangles
+    {
+      let center: SIMD3<Int32> = bin(soup, triangle)
+      var match: Int? = nil
+      search: for dz in -1...1
+      {
+        for dy in -1...1
+        {
+          for dx in -1...1
+          {
+            for candidate in bins[center &+ SIMD3<Int32>(Int32(dx), Int32(dy), Int32(dz))] ?? [] where !matched[candidate] && equal(triangle, candidate)
+            {
+              match = candidate
+              break search
+            }
+          }
+        }
+      }
+      if let match: Int = match
+      {
+        matched[match] = true
+      }
+      else
+      {
+        numberOfUnmatchedTriangles += 1
+      }
+    }
+    return numberOfUnmatchedTriangles
+  }
+  
+  // The indexed mesh must describe the same triangles as the triangle soup.
+  func compareIndexedMesh(dimensions: SIMD3<Int>, isoValue: Float)
+  {
+    let data: [Float] = voxels(dimensions: dimensions)
+    let cpu: SKCPUMarchingCubes = SKCPUMarchingCubes(dimensions: SIMD3<Int32>(truncatingIfNeeded: dimensions))
+    cpu.isoValue = isoValue
+    let soup: [SIMD4<Float>] = cpu.isoSurface(data)
+    let indexedSoup: [SIMD4<Float>] = cpu.indexedIsoSurface(data).triangleSoup
+    
+    XCTAssertGreaterThan(soup.count, 0, "no triangles found for \(dimensions)")
+    XCTAssertEqual(indexedSoup.count, soup.count, "different number of triangles for \(dimensions)")
+    guard indexedSoup.count == soup.count else { return }
+    XCTAssertEqual(numberOfUnmatchedTriangles(soup, indexedSoup, dimensions: dimensions), 0, "triangles of the soup missing from the indexed mesh for \(dimensions)")
+  }
+  
+  func testIndexedMeshPowerOfTwoDimensions()
+  {
+    compareIndexedMesh(dimensions: SIMD3<Int>(32, 32, 32), isoValue: 0.3)
+  }
+  
+  func testIndexedMeshArbitraryDimensions()
+  {
+    compareIndexedMesh(dimensions: SIMD3<Int>(21, 30, 17), isoValue: -0.2)
+  }
+  
+  // The flying edges ('SKFlyingEdges') extract all iso-values in one sweep; each mesh must have the vertices and triangles of the indexed
+  // mesh of the marching cubes for that iso-value.
+  func compareFlyingEdges(dimensions: SIMD3<Int>, isoValues: [Float])
+  {
+    let data: [Float] = voxels(dimensions: dimensions)
+    let flyingEdges: SKFlyingEdges = SKFlyingEdges(dimensions: SIMD3<Int32>(truncatingIfNeeded: dimensions))
+    let meshes: [SKIsoSurfaceMesh] = flyingEdges.isoSurfaces(data, isoValues: isoValues)
+    XCTAssertEqual(meshes.count, isoValues.count)
+    guard meshes.count == isoValues.count else { return }
+    
+    for (mesh, isoValue) in zip(meshes, isoValues)
+    {
+      let cpu: SKCPUMarchingCubes = SKCPUMarchingCubes(dimensions: SIMD3<Int32>(truncatingIfNeeded: dimensions))
+      cpu.isoValue = isoValue
+      let reference: SKIsoSurfaceMesh = cpu.indexedIsoSurface(data)
+      
+      XCTAssertGreaterThan(reference.numberOfTriangles, 0, "no triangles found for \(dimensions) and iso-value \(isoValue)")
+      XCTAssertEqual(mesh.numberOfVertices, reference.numberOfVertices, "different number of vertices for \(dimensions) and iso-value \(isoValue)")
+      XCTAssertEqual(mesh.numberOfTriangles, reference.numberOfTriangles, "different number of triangles for \(dimensions) and iso-value \(isoValue)")
+      XCTAssertTrue(mesh.indices.allSatisfy{Int($0) < mesh.numberOfVertices}, "index out of range for \(dimensions) and iso-value \(isoValue)")
+      guard mesh.numberOfTriangles == reference.numberOfTriangles, mesh.indices.allSatisfy({Int($0) < mesh.numberOfVertices}) else { continue }
+      XCTAssertEqual(numberOfUnmatchedTriangles(reference.triangleSoup, mesh.triangleSoup, dimensions: dimensions), 0, "triangles missing from the flying edges for \(dimensions) and iso-value \(isoValue)")
+    }
+  }
+  
+  func testFlyingEdgesPowerOfTwoDimensions()
+  {
+    compareFlyingEdges(dimensions: SIMD3<Int>(32, 32, 32), isoValues: [-0.5, 0.0, 0.3, 1.0])
+  }
+  
+  func testFlyingEdgesArbitraryDimensions()
+  {
+    compareFlyingEdges(dimensions: SIMD3<Int>(21, 30, 17), isoValues: [-1.2, -0.2, 0.7])
+  }
+  
+  // A ramp along one axis crosses the iso-value twice: between the layers around the iso-value, and between the last and the first layer
+  // (the grid is periodic). Both surfaces are planes of two triangles per cube, with an exactly known area.
+  func comparePlanes(dimensions: SIMD3<Int>, axis: Int, isoValue: Float)
+  {
+    var data: [Float] = []
+    data.reserveCapacity(dimensions.x * dimensions.y * dimensions.z)
+    for k in 0..<dimensions.z
+    {
+      for j in 0..<dimensions.y
+      {
+        for i in 0..<dimensions.x
+        {
+          data.append(Float(SIMD3<Int>(i, j, k)[axis]))
+        }
+      }
+    }
+    
+    let cpu: SKCPUMarchingCubes = SKCPUMarchingCubes(dimensions: SIMD3<Int32>(truncatingIfNeeded: dimensions))
+    cpu.isoValue = isoValue
+    let vertices: [SIMD4<Float>] = cpu.isoSurface(data)
+    
+    let numberOfCubesPerPlane: Int = dimensions.x * dimensions.y * dimensions.z / dimensions[axis]
+    XCTAssertEqual(vertices.count, 3 * 3 * 2 * 2 * numberOfCubesPerPlane, "wrong number of triangles for axis \(axis)")
+    
+    let n: Float = Float(dimensions[axis])
+    let planes: [Float] = [isoValue / n, (n - 1.0 + (isoValue - (n - 1.0)) / (0.0 - (n - 1.0))) / n]
+    for vertex in stride(from: 0, to: vertices.count, by: 3)
+    {
+      let position: Float = vertices[vertex][axis]
+      XCTAssertTrue(planes.contains{abs($0 - position) < positionPrecision}, "vertex \(vertex / 3) at \(position) is not on a plane for axis \(axis)")
+    }
+    
+    // the cell is chosen such that the triangles stay below the area-filter of 1 square Angstrom
+    let unitCell: double3x3 = double3x3([20.0, 0.0, 0.0], [4.0, 22.0, 0.0], [-3.0, 2.0, 25.0])
+    let planeArea: Double = simd_length(simd_cross(unitCell[(axis + 1) % 3], unitCell[(axis + 2) % 3]))
+    XCTAssertEqual(cpu.surfaceArea(data, unitCell: unitCell), 2.0 * planeArea, accuracy: 1e-5 * planeArea, "wrong surface area for axis \(axis)")
+  }
+  
+  func testPlanes()
+  {
+    for axis in 0..<3
+    {
+      comparePlanes(dimensions: SIMD3<Int>(21, 30, 17), axis: axis, isoValue: 3.5)
+    }
+  }
+}
@@ -0,0 +1,78 @@
+//
+//  PoreGeometryTests.swift
+//  SimulationKitTests
+//
+//  Created by David Dubbeldam on 17/10/2026.
+//  Copyright © 2026 David Dubbeldam. All rights reserved.
+//
+
+import XCTest
+@testable import SimulationKit
+import SymmetryKit
+import simd
+
+// The pore diameters of structures for which they are known analytically.
+class PoreGeometryTests: XCTestCase
+{
+  // A single atom at the corner of a cubic box: the largest included sphere is centered at the body center, the largest free sphere passes
+  // the face centers. With an odd number of voxels the body center is the center of a voxel.
+  func testSingleAtomInCubicBox()
+  {
+    let length: Double = 10.0
+    let radius: Double = 4.0
+    let poreGeometry: SKPoreGeometry = SKPoreGeometry(cell: SKCell(a: length, b: length, c: length, alpha: 0.5 * Double.pi, beta: 0.5 * Double.pi, gamma: 0.5 * Double.pi), positions: [SIMD3<Double>(0.0, 0.0, 0.0)], radii: [radius])
+    poreGeometry.spacing = 0.199
+    let result: SKPoreGeometry.Result = poreGeometry.compute()
+    
+    XCTAssertEqual(result.largestIncludedSphere, 2.0 * (0.5 * sqrt(3.0) * length - radius), accuracy: 1e-6)
+    XCTAssertEqual(result.largestFreeSphere, 2.0 * (0.5 * sqrt(2.0) * length - radius), accuracy: 1e-2)
+    for axis in 0..<3
+    {
+      XCTAssertEqual(result.largestFreeSpheres[axis], 2.0 * (0.5 * sqrt(2.0) * length - radius), accuracy: 1e-2)
+    }
+    XCTAssertEqual(result.largestIncludedSphereAlongFreePath, result.largestIncludedSphere, accuracy: 1e-6)
+    
+    // the fraction of the cell outside the (overlapping) eight octants of the atom
+    XCTAssertEqual(result.geometricVoidFraction, 1.0 - 4.0 / 3.0 * Double.pi * pow(radius, 3) / pow(length, 3), accuracy: 1e-2)
+  }
+  
+  // The same structure described by a non-orthogonal cell of the same lattice (gamma is 45 degrees).
+  func testSingleAtomInNonOrthogonalCell()
+  {
+    let length: Double = 10.0
+    let radius: Double = 4.0
+    let unitCell: double3x3 = double3x3([SIMD3<Double>(length, 0.0, 0.0), SIMD3<Double>(length, length, 0.0), SIMD3<Double>(0.0, 0.0, length)])
+    let poreGeometry: SKPoreGeometry = SKPoreGeometry(cell: SKCell(unitCell: unitCell), positions: [SIMD3<Double>(0.0, 0.0, 0.0)], radii: [radius])
+    let result: SKPoreGeometry.Result = poreGeometry.compute()
+    
+    // the voxel centers miss the body center by at most half a voxel diagonal
+    XCTAssertEqual(result.largestIncludedSphere, 2.0 * (0.5 * sqrt(3.0) * length - radius), accuracy: 0.5)
+    XCTAssertLessThanOrEqual(result.largestIncludedSphere, 2.0 * (0.5 * sqrt(3.0) * length - radius) + 1e-6)
+    XCTAssertEqual(result.largestFreeSphere, 2.0 * (0.5 * sqrt(2.0) * length - radius), accuracy: 0.1)
+    XCTAssertEqual(result.geometricVoidFraction, 1.0 - 4.0 / 3.0 * Double.pi * pow(radius, 3) / pow(length, 3), accuracy: 1e-2)
+  }
+  
+  // A cylindrical channel along z: a ring of atoms per cell with their centers at 'channelRadius + radius' from the axis. On the axis in the
+  // plane of the ring the distance to all atoms is 'channelRadius', and a sphere passing the ring can not do better.
+  func testCylindricalChannel()
+  {
+    let channelRadius: Double = 3.0
+    let radius: Double = 1.5
+    let numberOfAtoms: Int = 24
+    let a: Double = 2.0 * (channelRadius + 2.0 * radius)
+    let c: Double = radius
+    
+    let positions: [SIMD3<Double>] = (0..<numberOfAtoms).map{index -> SIMD3<Double> in
+      let angle: Double = 2.0 * Double.pi * Double(index) / Double(numberOfAtoms)
+      return SIMD3<Double>(0.5 + (channelRadius + radius) * cos(angle) / a, 0.5 + (channelRadius + radius) * sin(angle) / a, 0.0)
+    }
+    let poreGeometry: SKPoreGeometry = SKPoreGeometry(cell: SKCell(a: a, b: a, c: c, alpha: 0.5 * Double.pi, beta: 0.5 * Double.pi, gamma: 0.5 * Double.pi), positions: positions, radii: [Double](repeating: radius, count: numberOfAtoms))
+    poreGeometry.spacing = 0.199
+    let result: SKPoreGeometry.Result = poreGeometry.compute()
+    
+    // the voxels closest to the plane of the ring are half a voxel away from it
+    XCTAssertEqual(result.largestFreeSpheres.z, 2.0 * channelRadius, accuracy: 1e-2)
+    XCTAssertEqual(result.largestFreeSphere, 2.0 * channelRadius, accuracy: 1e-2)
+    XCTAssertGreaterThanOrEqual(result.largestIncludedSphere, result.largestFreeSphere)
+  }
+}
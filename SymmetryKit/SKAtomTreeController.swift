@@ -45,6 +45,9 @@ public class SKAtomTreeController: BinaryDecodable, BinaryEncodable
   
   public var filterPredicate: (SKAtomTreeNode) -> Bool = {_ in return true}
   
+  // incremented by 'tag' (which is called after every change of the atoms), caches of the atoms compare it to detect changes
+  public private(set) var version: Int = 0
+  
   
   public var rootNodes: [SKAtomTreeNode]
   {
@@ -279,6 +282,8 @@ public class SKAtomTreeController: BinaryDecodable, BinaryEncodable
   ///
   public func tag()
   {
+    version += 1
+    
     // probably can be done a lot faster by using the tree-structure and recursion
     let asymmetricAtomNodes: [SKAtomTreeNode] = self.flattenedNodes()
     for asymmetricAtomNode in asymmetricAtomNodes
@@ -0,0 +1,279 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+
+/// Cell list for bond detection in periodic (triclinic) cells and in non-periodic structures.
+///
+/// The atoms are binned on their fractional positions, with cells at least as wide (perpendicular) as the largest bond criterion.
+/// In directions with less than three cells all cells are searched, so thin cells still find the minimum image of every pair.
+/// A pair is bonded when its minimum-image distance is below the criterion, and the bond is external when the direct distance is not.
+/// Non-periodic structures are binned in their bounding box and all their bonds are internal.
+public struct SKBondCellList
+{
+  public struct Pair
+  {
+    public var index1: Int
+    public var index2: Int
+    public var bondLength: Double
+    public var isExternal: Bool
+  }
+  
+  // the number of atoms handled by a task, and the number of tasks between calls of the update- and cancel-handlers
+  static let blockSize: Int = 256
+  static let blocksPerRound: Int = 8 * max(1, ProcessInfo.processInfo.activeProcessorCount)
+  
+  let periodic: Bool
+  let unitCell: double3x3
+  let inverseUnitCell: double3x3
+  let origin: SIMD3<Double>
+  let positions: [SIMD3<Double>]
+  let bondDistanceCriteria: [Double]
+  let tolerance: Double
+  let numberOfCells: SIMD3<Int>
+  let atomCells: [SIMD3<Int>]
+  let cellStart: [Int]
+  let cellAtoms: [Int]
+  let neighbourOffsets: [SIMD3<Int>]
+  
+  /// Bins the atoms of a periodic structure.
+  ///
+  /// - parameter cell: The periodic cell of the structure.
+  /// - parameter positions: The Cartesian positions of the atoms.
+  /// - parameter bondDistanceCriteria: The bond-distance criterion of each atom; two atoms are bonded when their distance is below the sum of their criteria plus the tolerance.
+  /// - parameter tolerance: The distance added to the sum of the criteria.
+  public init(cell: SKCell, positions: [SIMD3<Double>], bondDistanceCriteria: [Double], tolerance: Double = 0.4)
+  {
+    self.init(periodic: true, unitCell: cell.unitCell, inverseUnitCell: cell.inverseUnitCell, origin: SIMD3<Double>(0.0, 0.0, 0.0), perpendicularWidths: cell.perpendicularWidths,
+              positions: positions, bondDistanceCriteria: bondDistanceCriteria, tolerance: tolerance)
+  }
+  
+  /// Bins the atoms of a non-periodic structure in their bounding box.
+  ///
+  /// - parameter positions: The Cartesian positions of the atoms.
+  /// - parameter bondDistanceCriteria: The bond-distance criterion of each atom; two atoms are bonded when their distance is below the sum of their criteria plus the tolerance.
+  /// - parameter tolerance: The distance added to the sum of the criteria.
+  public init(positions: [SIMD3<Double>], bondDistanceCriteria: [Double], tolerance: Double = 0.4)
+  {
+    let minimum: SIMD3<Double> = positions.reduce(SIMD3<Double>(repeating: Double.greatestFiniteMagnitude)){simd_min($0, $1)}
+    let maximum: SIMD3<Double> = positions.reduce(SIMD3<Double>(repeating: -Double.greatestFiniteMagnitude)){simd_max($0, $1)}
+    let widths: SIMD3<Double> = positions.isEmpty ? SIMD3<Double>(1.0, 1.0, 1.0) : simd_max(maximum - minimum, SIMD3<Double>(repeating: 1e-3))
+    
+    self.init(periodic: false, unitCell: double3x3(diagonal: widths), inverseUnitCell: double3x3(diagonal: 1.0 / widths), origin: positions.isEmpty ? SIMD3<Double>(0.0, 0.0, 0.0) : minimum, perpendicularWidths: widths,
+              positions: positions, bondDistanceCriteria: bondDistanceCriteria, tolerance: tolerance)
+  }
+  
+  init(periodic: Bool, unitCell: double3x3, inverseUnitCell: double3x3, origin: SIMD3<Double>, perpendicularWidths: SIMD3<Double>, positions: [SIMD3<Double>], bondDistanceCriteria: [Double], tolerance: Double)
+  {
+    self.periodic = periodic
+    self.unitCell = unitCell
+    self.inverseUnitCell = inverseUnitCell
+    self.origin = origin
+    self.positions = positions
+    self.bondDistanceCriteria = bondDistanceCriteria
+    self.tolerance = tolerance
+    
+    let cutoff: Double = 2.0 * (bondDistanceCriteria.max() ?? 0.0) + tolerance
+    var numberOfCells: SIMD3<Int> = SIMD3<Int>(1, 1, 1)
+    if cutoff > 0.0
+    {
+      for k in 0..<3 where perpendicularWidths[k].isFinite && perpendicularWidths[k] > cutoff
+      {
+        numberOfCells[k] = max(1, min(Int(perpendicularWidths[k] / cutoff), 1024))
+      }
+    }
+    self.numberOfCells = numberOfCells
+    
+    // counting sort of the atoms over the cells
+    let totalNumberOfCells: Int = numberOfCells.x * numberOfCells.y * numberOfCells.z
+    var atomCells: [SIMD3<Int>] = [SIMD3<Int>](repeating: SIMD3<Int>(0, 0, 0), count: positions.count)
+    var cellStart: [Int] = [Int](repeating: 0, count: totalNumberOfCells + 1)
+    for i in 0..<positions.count
+    {
+      var s: SIMD3<Double> = inverseUnitCell * (positions[i] - origin)
+      if periodic
+      {
+        s -= floor(s)
+      }
+      var k: SIMD3<Int> = SIMD3<Int>(0, 0, 0)
+      for d in 0..<3 where s[d].isFinite
+      {
+        k[d] = min(max(Int(s[d] * Double(numberOfCells[d])), 0), numberOfCells[d] - 1)
+      }
+      atomCells[i] = k
+      cellStart[k.x + k.y * numberOfCells.x + k.z * numberOfCells.x * numberOfCells.y + 1] += 1
+    }
+    for c in 0..<totalNumberOfCells
+    {
+      cellStart[c + 1] += cellStart[c]
+    }
+    var fill: [Int] = Array(cellStart[0..<totalNumberOfCells])
+    var cellAtoms: [Int] = [Int](repeating: 0, count: positions.count)
+    for i in 0..<positions.count
+    {
+      let k: SIMD3<Int> = atomCells[i]
+      let c: Int = k.x + k.y * numberOfCells.x + k.z * numberOfCells.x * numberOfCells.y
+      cellAtoms[fill[c]] = i
+      fill[c] += 1
+    }
+    self.atomCells = atomCells
+    self.cellStart = cellStart
+    self.cellAtoms = cellAtoms
+    
+    // with less than three cells in a direction all cells are visited (the offsets are then absolute cell-indices)
+    func offsets(_ n: Int) -> [Int]
+    {
+      return n >= 3 ? [-1, 0, 1] : Array(0..<n)
+    }
+    var neighbourOffsets: [SIMD3<Int>] = []
+    for k3 in offsets(numberOfCells.z)
+    {
+      for k2 in offsets(numberOfCells.y)
+      {
+        for k1 in offsets(numberOfCells.x)
+        {
+          neighbourOffsets.append(SIMD3<Int>(k1, k2, k3))
+        }
+      }
+    }
+    self.neighbourOffsets = neighbourOffsets
+  }
+  
+  public var count: Int
+  {
+    return positions.count
+  }
+  
+  /// Returns the bonded pairs (i,j) with i in the given range and j > i.
+  ///
+  /// The atoms are handled in blocks on all cores. Each block collects its own pairs and the blocks are merged in order, so the pairs are
+  /// always ordered on index1 and then on index2 (the order of the all-pairs loop), independent of the number of threads.
+  /// The update- and cancel-handlers are called on the calling thread between rounds of blocks.
+  ///
+  /// - returns: The pairs, or nil when cancelled.
+  public func pairs(for range: Range<Int>, cancelHandler: (()-> Bool) = {return false}, updateHandler: (() -> ()) = {}) -> [Pair]?
+  {
+    let blockSize: Int = SKBondCellList.blockSize
+    let numberOfBlocks: Int = (range.count + blockSize - 1) / blockSize
+    
+    var pairs: [Pair] = []
+    for firstBlock in stride(from: 0, to: numberOfBlocks, by: SKBondCellList.blocksPerRound)
+    {
+      let numberOfBlocksInRound: Int = min(SKBondCellList.blocksPerRound, numberOfBlocks - firstBlock)
+      var blockPairs: [[Pair]] = [[Pair]](repeating: [], count: numberOfBlocksInRound)
+      blockPairs.withUnsafeMutableBufferPointer { blockPairsPtr in
+        let blockPair: UnsafeMutablePointer<[Pair]> = blockPairsPtr.baseAddress!
+        DispatchQueue.concurrentPerform(iterations: numberOfBlocksInRound) { block in
+          let lowerBound: Int = range.lowerBound + (firstBlock + block) * blockSize
+          blockPair[block] = serialPairs(for: lowerBound..<min(lowerBound + blockSize, range.upperBound))
+        }
+      }
+      
+      for block in blockPairs
+      {
+        pairs.append(contentsOf: block)
+      }
+      
+      updateHandler()
+      
+      if cancelHandler()
+      {
+        return nil
+      }
+    }
+    
+    return pairs
+  }
+  
+  func serialPairs(for range: Range<Int>) -> [Pair]
+  {
+    var pairs: [Pair] = []
+    var neighbours: [Pair] = []
+    
+    for i in range
+    {
+      neighbours.removeAll(keepingCapacity: true)
+      
+      let posA: SIMD3<Double> = positions[i]
+      let criteriaA: Double = bondDistanceCriteria[i]
+      let cellA: SIMD3<Int> = atomCells[i]
+      
+      for offset in neighbourOffsets
+      {
+        var k: SIMD3<Int> = SIMD3<Int>(numberOfCells.x >= 3 ? cellA.x + offset.x : offset.x,
+                                       numberOfCells.y >= 3 ? cellA.y + offset.y : offset.y,
+                                       numberOfCells.z >= 3 ? cellA.z + offset.z : offset.z)
+        if periodic
+        {
+          k = (k &+ numberOfCells) % numberOfCells
+        }
+        else if any(k .< SIMD3<Int>(0, 0, 0)) || any(k .>= numberOfCells)
+        {
+          continue
+        }
+        let c: Int = k.x + k.y * numberOfCells.x + k.z * numberOfCells.x * numberOfCells.y
+        
+        for p in cellStart[c]..<cellStart[c + 1]
+        {
+          let j: Int = cellAtoms[p]
+          if j > i
+          {
+            let separationVector: SIMD3<Double> = posA - positions[j]
+            var periodicSeparationVector: SIMD3<Double> = separationVector
+            if periodic
+            {
+              // minimum image, identical to 'SKCell.applyUnitCellBoundaryCondition'
+              var s: SIMD3<Double> = inverseUnitCell * separationVector
+              s.x -= rint(s.x)
+              s.y -= rint(s.y)
+              s.z -= rint(s.z)
+              periodicSeparationVector = unitCell * s
+            }
+            
+            let bondCriteria: Double = (criteriaA + bondDistanceCriteria[j] + tolerance)
+            
+            let bondLength: Double = length(periodicSeparationVector)
+            if (bondLength < bondCriteria)
+            {
+              neighbours.append(Pair(index1: i, index2: j, bondLength: bondLength, isExternal: periodic && length(separationVector) > bondCriteria))
+            }
+          }
+        }
+      }
+      
+      neighbours.sort{$0.index2 < $1.index2}
+      pairs.append(contentsOf: neighbours)
+    }
+    
+    return pairs
+  }
+}
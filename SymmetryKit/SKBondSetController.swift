@@ -37,9 +37,25 @@ public class SKBondSetController: NSObject, BinaryDecodable, BinaryEncodable
   private static var classVersionNumber: Int = 3
   
   public var arrangedObjects: [ SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom> ] = []
+  {
+    didSet
+    {
+      if !isReplacingBondsInPlace
+      {
+        indexOfAsymmetricBond = nil
+        bondedAtomsOfAtoms = nil
+      }
+    }
+  }
   
   public var selectedObjects: IndexSet
   
+  // the index of each asymmetric bond and the atoms bonded to each asymmetric atom, not archived and rebuilt on demand after the bonds
+  // changed (except by 'replaceBonds(removed:added:)', which updates them)
+  private var indexOfAsymmetricBond: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>: Int]? = nil
+  private var bondedAtomsOfAtoms: [SKAsymmetricAtom: [SKAsymmetricAtom]]? = nil
+  private var isReplacingBondsInPlace: Bool = false
+  
   public override init()
   {
     arrangedObjects = []
@@ -75,30 +91,7 @@ public class SKBondSetController: NSObject, BinaryDecodable, BinaryEncodable
     {
       let asymmetricBonds: Set<SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>> = Set(newBonds.map{SKAsymmetricBond($0.atom1.asymmetricParentAtom, $0.atom2.asymmetricParentAtom)})
       
-      self.arrangedObjects = asymmetricBonds.sorted{
-          if $0.atom1.elementIdentifier == $1.atom1.elementIdentifier 
-          {
-            if $0.atom2.elementIdentifier == $1.atom2.elementIdentifier
-            {
-              if $0.atom1.tag == $1.atom1.tag
-              {
-                return $0.atom2.tag < $1.atom2.tag
-              }
-              else
-              {
-                return $0.atom1.tag < $1.atom1.tag
-              }
-            }
-            else
-            {
-              return $0.atom2.elementIdentifier > $1.atom2.elementIdentifier
-            }
-          }
-          else
-          {
-            return $0.atom1.elementIdentifier > $1.atom1.elementIdentifier
-          }
-      }
+      self.arrangedObjects = asymmetricBonds.sorted(by: SKBondSetController.isOrderedBefore)
       
       var indexInArrangedObjects: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>: Int] = [:]
       for (index, asymmetricBond) in self.arrangedObjects.enumerated()
@@ -118,6 +111,33 @@ public class SKBondSetController: NSObject, BinaryDecodable, BinaryEncodable
     }
   }
   
+  // the order of the arranged objects: by decreasing element of the first and of the second atom, then by increasing tags
+  private static func isOrderedBefore(_ lhs: SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>, _ rhs: SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>) -> Bool
+  {
+    if lhs.atom1.elementIdentifier == rhs.atom1.elementIdentifier
+    {
+      if lhs.atom2.elementIdentifier == rhs.atom2.elementIdentifier
+      {
+        if lhs.atom1.tag == rhs.atom1.tag
+        {
+          return lhs.atom2.tag < rhs.atom2.tag
+        }
+        else
+        {
+          return lhs.atom1.tag < rhs.atom1.tag
+        }
+      }
+      else
+      {
+        return lhs.atom2.elementIdentifier > rhs.atom2.elementIdentifier
+      }
+    }
+    else
+    {
+      return lhs.atom1.elementIdentifier > rhs.atom1.elementIdentifier
+    }
+  }
+  
   public func data() -> Data
   {
     //return NSArchiver.archivedData(withRootObject: arrangedObjects)
@@ -143,30 +163,7 @@ public class SKBondSetController: NSObject, BinaryDecodable, BinaryEncodable
     
     let totalBonds: Set<SKAsymmetricBond> = filteredBonds.union(newAsymmetricBonds)
     
-    let asymmetricBonds: [SKAsymmetricBond] = totalBonds.sorted{
-        if $0.atom1.elementIdentifier == $1.atom1.elementIdentifier
-        {
-          if $0.atom2.elementIdentifier == $1.atom2.elementIdentifier
-          {
-            if $0.atom1.tag == $1.atom1.tag
-            {
-              return $0.atom2.tag < $1.atom2.tag
-            }
-            else
-            {
-              return $0.atom1.tag < $1.atom1.tag
-            }
-          }
-          else
-          {
-            return $0.atom2.elementIdentifier > $1.atom2.elementIdentifier
-          }
-        }
-        else
-        {
-          return $0.atom1.elementIdentifier > $1.atom1.elementIdentifier
-        }
-    }
+    let asymmetricBonds: [SKAsymmetricBond] = totalBonds.sorted(by: SKBondSetController.isOrderedBefore)
     
     var indexInArrangedObjects: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>: Int] = [:]
     for (index, asymmetricBond) in asymmetricBonds.enumerated()
@@ -201,6 +198,47 @@ public class SKBondSetController: NSObject, BinaryDecodable, BinaryEncodable
     return indexSet
   }
   
+  /// Returns the asymmetric bonds that contain any of the atoms, in the order of the arranged objects.
+  ///
+  /// The bonds of each atom are looked up in tables that are built once after the bonds changed (and kept up to date by
+  /// 'replaceBonds(removed:added:)'), so repeated calls for small sets of atoms (like during a drag) do not scan all the bonds.
+  public func asymmetricBonds(of atoms: Set<SKAsymmetricAtom>) -> [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>]
+  {
+    buildLookupTables()
+    
+    var indices: Set<Int> = []
+    for atom in atoms
+    {
+      for bondedAtom in bondedAtomsOfAtoms?[atom] ?? []
+      {
+        if let index: Int = indexOfAsymmetricBond?[SKAsymmetricBond(atom, bondedAtom)]
+        {
+          indices.insert(index)
+        }
+      }
+    }
+    return indices.sorted().map{arrangedObjects[$0]}
+  }
+  
+  private func buildLookupTables()
+  {
+    guard indexOfAsymmetricBond == nil || bondedAtomsOfAtoms == nil else {return}
+    
+    var indexOfAsymmetricBond: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>: Int] = [:]
+    var bondedAtomsOfAtoms: [SKAsymmetricAtom: [SKAsymmetricAtom]] = [:]
+    for (index, asymmetricBond) in arrangedObjects.enumerated()
+    {
+      indexOfAsymmetricBond[asymmetricBond] = index
+      bondedAtomsOfAtoms[asymmetricBond.atom1, default: []].append(asymmetricBond.atom2)
+      if asymmetricBond.atom2 != asymmetricBond.atom1
+      {
+        bondedAtomsOfAtoms[asymmetricBond.atom2, default: []].append(asymmetricBond.atom1)
+      }
+    }
+    self.indexOfAsymmetricBond = indexOfAsymmetricBond
+    self.bondedAtomsOfAtoms = bondedAtomsOfAtoms
+  }
+  
   public func tag()
   {
     for (i, asymmetricBond) in arrangedObjects.enumerated()
@@ -214,11 +252,163 @@ public class SKBondSetController: NSObject, BinaryDecodable, BinaryEncodable
   
   public func replaceBonds(atoms: [SKAsymmetricAtom], bonds newbonds: [SKBondNode])
   {
-    let filteredBonds: [SKBondNode] = self.arrangedObjects.filter{!(atoms.contains($0.atom1) || atoms.contains($0.atom2))}.flatMap{$0.copies}
+    let replacedAtoms: Set<SKAsymmetricAtom> = Set(atoms)
+    let filteredBonds: [SKBondNode] = self.arrangedObjects.filter{!(replacedAtoms.contains($0.atom1) || replacedAtoms.contains($0.atom2))}.flatMap{$0.copies}
     
     self.bonds = filteredBonds + newbonds
   }
   
+  /// Applies a difference in bonds, as computed by an incremental bond update
+  ///
+  /// The copies are removed from and added to their asymmetric bonds in place, and the asymmetric bonds that lose all their copies or are
+  /// new are removed or inserted at their sorted position. Only the arranged objects from the first removed or inserted asymmetric bond
+  /// onwards are shifted, re-indexed and re-tagged, the selection of the remaining asymmetric bonds is kept.
+  ///
+  /// - parameter removed: the bonds to remove.
+  /// - parameter added: the bonds to add (after the removal, so a bond that changes its boundary type can be in both lists).
+  /// - returns: the indices of the inserted asymmetric bonds
+  @discardableResult
+  public func replaceBonds(removed: [SKBondNode], added: [SKBondNode]) -> IndexSet
+  {
+    guard !(removed.isEmpty && added.isEmpty) else {return []}
+    
+    buildLookupTables()
+    guard var indexOfAsymmetricBond: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>: Int] = self.indexOfAsymmetricBond,
+          var bondedAtomsOfAtoms: [SKAsymmetricAtom: [SKAsymmetricAtom]] = self.bondedAtomsOfAtoms else {return []}
+    
+    isReplacingBondsInPlace = true
+    defer
+    {
+      isReplacingBondsInPlace = false
+    }
+    
+    var emptiedIndices: [Int] = []
+    for bond in removed
+    {
+      if let index: Int = indexOfAsymmetricBond[SKAsymmetricBond(bond.atom1.asymmetricParentAtom, bond.atom2.asymmetricParentAtom)],
+         let copyIndex: Int = self.arrangedObjects[index].copies.firstIndex(of: bond)
+      {
+        self.arrangedObjects[index].copies.remove(at: copyIndex)
+        if self.arrangedObjects[index].copies.isEmpty
+        {
+          emptiedIndices.append(index)
+        }
+      }
+    }
+    
+    var insertedAsymmetricBonds: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>] = []
+    var indexOfInsertedAsymmetricBond: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>: Int] = [:]
+    for bond in added
+    {
+      var asymmetricBond: SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom> = SKAsymmetricBond(bond.atom1.asymmetricParentAtom, bond.atom2.asymmetricParentAtom)
+      if let index: Int = indexOfAsymmetricBond[asymmetricBond]
+      {
+        bond.asymmetricIndex = index
+        self.arrangedObjects[index].copies.append(bond)
+      }
+      else if let index: Int = indexOfInsertedAsymmetricBond[asymmetricBond]
+      {
+        insertedAsymmetricBonds[index].copies.append(bond)
+      }
+      else
+      {
+        indexOfInsertedAsymmetricBond[asymmetricBond] = insertedAsymmetricBonds.count
+        asymmetricBond.copies = [bond]
+        insertedAsymmetricBonds.append(asymmetricBond)
+      }
+    }
+    
+    // asymmetric bonds that lost all their copies, unless copies were added again
+    let removedIndices: IndexSet = IndexSet(emptiedIndices.filter{self.arrangedObjects[$0].copies.isEmpty})
+    
+    // most changes only move copies between existing asymmetric bonds, the order and the lookup tables are then unchanged
+    guard !(removedIndices.isEmpty && insertedAsymmetricBonds.isEmpty) else {return []}
+    
+    insertedAsymmetricBonds.sort(by: SKBondSetController.isOrderedBefore)
+    
+    let count: Int = self.arrangedObjects.count
+    var firstChangedIndex: Int = removedIndices.first ?? count
+    if let firstInsertedAsymmetricBond = insertedAsymmetricBonds.first
+    {
+      // binary search for the first arranged object that is not ordered before the first inserted bond
+      var lowerBound: Int = 0
+      var upperBound: Int = min(firstChangedIndex, count)
+      while lowerBound < upperBound
+      {
+        let middle: Int = (lowerBound + upperBound) / 2
+        if SKBondSetController.isOrderedBefore(self.arrangedObjects[middle], firstInsertedAsymmetricBond)
+        {
+          lowerBound = middle + 1
+        }
+        else
+        {
+          upperBound = middle
+        }
+      }
+      firstChangedIndex = lowerBound
+    }
+    
+    // merge the remaining and the inserted asymmetric bonds from the first change onwards
+    var tail: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>] = []
+    tail.reserveCapacity(count - firstChangedIndex - removedIndices.count + insertedAsymmetricBonds.count)
+    var selection: IndexSet = self.selectedObjects.filteredIndexSet{$0 < firstChangedIndex}
+    var insertedIndices: IndexSet = []
+    var insertedIndex: Int = 0
+    for index in firstChangedIndex..<count
+    {
+      let asymmetricBond: SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom> = self.arrangedObjects[index]
+      if removedIndices.contains(index)
+      {
+        indexOfAsymmetricBond[asymmetricBond] = nil
+        bondedAtomsOfAtoms[asymmetricBond.atom1]?.removeAll{$0 === asymmetricBond.atom2}
+        bondedAtomsOfAtoms[asymmetricBond.atom2]?.removeAll{$0 === asymmetricBond.atom1}
+        continue
+      }
+      while insertedIndex < insertedAsymmetricBonds.count && SKBondSetController.isOrderedBefore(insertedAsymmetricBonds[insertedIndex], asymmetricBond)
+      {
+        insertedIndices.insert(firstChangedIndex + tail.count)
+        tail.append(insertedAsymmetricBonds[insertedIndex])
+        insertedIndex += 1
+      }
+      if self.selectedObjects.contains(index)
+      {
+        selection.insert(firstChangedIndex + tail.count)
+      }
+      tail.append(asymmetricBond)
+    }
+    while insertedIndex < insertedAsymmetricBonds.count
+    {
+      insertedIndices.insert(firstChangedIndex + tail.count)
+      tail.append(insertedAsymmetricBonds[insertedIndex])
+      insertedIndex += 1
+    }
+    
+    for asymmetricBond in insertedAsymmetricBonds
+    {
+      bondedAtomsOfAtoms[asymmetricBond.atom1, default: []].append(asymmetricBond.atom2)
+      if asymmetricBond.atom2 != asymmetricBond.atom1
+      {
+        bondedAtomsOfAtoms[asymmetricBond.atom2, default: []].append(asymmetricBond.atom1)
+      }
+    }
+    
+    self.arrangedObjects.replaceSubrange(firstChangedIndex..<count, with: tail)
+    for (offset, asymmetricBond) in tail.enumerated()
+    {
+      indexOfAsymmetricBond[asymmetricBond] = firstChangedIndex + offset
+      for bond in asymmetricBond.copies
+      {
+        bond.asymmetricIndex = firstChangedIndex + offset
+      }
+    }
+    
+    self.indexOfAsymmetricBond = indexOfAsymmetricBond
+    self.bondedAtomsOfAtoms = bondedAtomsOfAtoms
+    self.selectedObjects = selection
+    
+    return insertedIndices
+  }
+  
   // MARK: -
   // MARK: Binary Encodable support
   
@@ -0,0 +1,212 @@
+/*************************************************************************************************************
+ The MIT License
+ 
+ Copyright (c) 2014-2022 David Dubbeldam, Sofia Calero, Thijs J.H. Vlugt.
+ 
+ D.Dubbeldam@uva.nl      http://www.uva.nl/profiel/d/u/d.dubbeldam/d.dubbeldam.html
+ S.Calero@tue.nl         https://www.tue.nl/en/research/researchers/sofia-calero/
+ t.j.h.vlugt@tudelft.nl  http://homepage.tudelft.nl/v9k6y
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ *************************************************************************************************************/
+
+import Foundation
+import simd
+
+/// Persistent spatial index of the atom copies of a structure, used to update bonds incrementally after atom edits.
+///
+/// Unlike 'SKBondCellList', which is rebuilt for every full bond computation, the index is kept between edits: moved, inserted and deleted
+/// atoms are updated in place, and the atoms that can bond to an edited subset are found by visiting only the cells around that subset.
+/// Periodic structures are binned on their fractional positions (wrapping around the unit cell), non-periodic structures on an unbounded grid.
+public final class SKBondSpatialIndex
+{
+  struct Entry
+  {
+    var cell: SIMD3<Int>
+    var serialNumber: Int
+  }
+  
+  let periodic: Bool
+  public let unitCell: double3x3
+  let inverseUnitCell: double3x3
+  let cutoff: Double
+  let numberOfCells: SIMD3<Int>
+  let neighbourOffsets: [SIMD3<Int>]
+  
+  /// The largest bond-distance criterion the index is valid for; atoms with a larger criterion require a new index.
+  public let maximumBondDistanceCriteria: Double
+  
+  var entries: [ObjectIdentifier: Entry] = [:]
+  var cells: [SIMD3<Int>: [SKAtomCopy]] = [:]
+  var serialNumber: Int = 0
+  
+  /// Creates an empty index.
+  ///
+  /// - parameter cell: The unit cell for periodic structures, nil for non-periodic structures.
+  /// - parameter maximumBondDistanceCriteria: The largest bond-distance criterion of the atoms.
+  /// - parameter tolerance: The distance added to the sum of the criteria of two atoms.
+  public init(cell: SKCell?, maximumBondDistanceCriteria: Double, tolerance: Double = 0.4)
+  {
+    self.periodic = cell != nil
+    self.unitCell = cell?.unitCell ?? double3x3(diagonal: SIMD3<Double>(1.0, 1.0, 1.0))
+    self.inverseUnitCell = cell?.inverseUnitCell ?? double3x3(diagonal: SIMD3<Double>(1.0, 1.0, 1.0))
+    self.maximumBondDistanceCriteria = maximumBondDistanceCriteria
+    self.cutoff = max(2.0 * maximumBondDistanceCriteria + tolerance, 1e-3)
+    
+    var numberOfCells: SIMD3<Int> = SIMD3<Int>(1, 1, 1)
+    if let perpendicularWidths: SIMD3<Double> = cell?.perpendicularWidths
+    {
+      for k in 0..<3 where perpendicularWidths[k].isFinite && perpendicularWidths[k] > cutoff
+      {
+        numberOfCells[k] = max(1, min(Int(perpendicularWidths[k] / cutoff), 1024))
+      }
+    }
+    self.numberOfCells = numberOfCells
+    
+    // periodic: with less than three cells in a direction all cells are visited (the offsets are then absolute cell-indices)
+    func offsets(_ n: Int) -> [Int]
+    {
+      return (cell == nil || n >= 3) ? [-1, 0, 1] : Array(0..<n)
+    }
+    var neighbourOffsets: [SIMD3<Int>] = []
+    for k3 in offsets(numberOfCells.z)
+    {
+      for k2 in offsets(numberOfCells.y)
+      {
+        for k1 in offsets(numberOfCells.x)
+        {
+          neighbourOffsets.append(SIMD3<Int>(k1, k2, k3))
+        }
+      }
+    }
+    self.neighbourOffsets = neighbourOffsets
+  }
+  
+  public var count: Int
+  {
+    return entries.count
+  }
+  
+  public func contains(_ atom: SKAtomCopy) -> Bool
+  {
+    return entries[ObjectIdentifier(atom)] != nil
+  }
+  
+  /// Inserts the atom at the given Cartesian position, or moves it there when it is already in the index.
+  public func insert(_ atom: SKAtomCopy, at position: SIMD3<Double>)
+  {
+    let newCell: SIMD3<Int> = cell(position)
+    
+    if let entry: Entry = entries[ObjectIdentifier(atom)]
+    {
+      if entry.cell == newCell
+      {
+        return
+      }
+      cells[entry.cell]?.removeAll{$0 === atom}
+      entries[ObjectIdentifier(atom)] = Entry(cell: newCell, serialNumber: entry.serialNumber)
+    }
+    else
+    {
+      entries[ObjectIdentifier(atom)] = Entry(cell: newCell, serialNumber: serialNumber)
+      serialNumber += 1
+    }
+    cells[newCell, default: []].append(atom)
+  }
+  
+  public func remove(_ atom: SKAtomCopy)
+  {
+    if let entry: Entry = entries.removeValue(forKey: ObjectIdentifier(atom))
+    {
+      cells[entry.cell]?.removeAll{$0 === atom}
+      if cells[entry.cell]?.isEmpty ?? false
+      {
+        cells[entry.cell] = nil
+      }
+    }
+  }
+  
+  /// Returns the atoms, not part of the given atoms, that lie in the cells around the given atoms.
+  ///
+  /// These are all the atoms that can form a bond with the given atoms. The result is ordered on insertion into the index,
+  /// so the same edits give the same order.
+  public func neighbourhood(of atoms: [SKAtomCopy]) -> [SKAtomCopy]
+  {
+    let excluded: Set<ObjectIdentifier> = Set(atoms.map{ObjectIdentifier($0)})
+    
+    var visitedCells: Set<SIMD3<Int>> = []
+    for atom in atoms
+    {
+      guard let center: SIMD3<Int> = entries[ObjectIdentifier(atom)]?.cell else {continue}
+      for offset in neighbourOffsets
+      {
+        visitedCells.insert(neighbour(center, offset))
+      }
+    }
+    
+    var neighbours: [(atom: SKAtomCopy, serialNumber: Int)] = []
+    for visitedCell in visitedCells
+    {
+      for atom in cells[visitedCell] ?? [] where !excluded.contains(ObjectIdentifier(atom))
+      {
+        neighbours.append((atom, entries[ObjectIdentifier(atom)]?.serialNumber ?? 0))
+      }
+    }
+    
+    return neighbours.sorted{$0.serialNumber < $1.serialNumber}.map{$0.atom}
+  }
+  
+  func cell(_ position: SIMD3<Double>) -> SIMD3<Int>
+  {
+    var k: SIMD3<Int> = SIMD3<Int>(0, 0, 0)
+    if periodic
+    {
+      var s: SIMD3<Double> = inverseUnitCell * position
+      s -= floor(s)
+      for d in 0..<3 where s[d].isFinite
+      {
+        k[d] = min(max(Int(s[d] * Double(numberOfCells[d])), 0), numberOfCells[d] - 1)
+      }
+    }
+    else
+    {
+      let s: SIMD3<Double> = floor(position / cutoff)
+      for d in 0..<3 where s[d].isFinite
+      {
+        k[d] = Int(max(min(s[d], Double(Int32.max)), Double(Int32.min)))
+      }
+    }
+    return k
+  }
+  
+  func neighbour(_ center: SIMD3<Int>, _ offset: SIMD3<Int>) -> SIMD3<Int>
+  {
+    if !periodic
+    {
+      return center &+ offset
+    }
+    let k: SIMD3<Int> = SIMD3<Int>(numberOfCells.x >= 3 ? center.x + offset.x : offset.x,
+                                   numberOfCells.y >= 3 ? center.y + offset.y : offset.y,
+                                   numberOfCells.z >= 3 ? center.z + offset.z : offset.z)
+    return (k &+ numberOfCells) % numberOfCells
+  }
+}
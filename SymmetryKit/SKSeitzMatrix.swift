@@ -11,8 +11,8 @@ import MathKit
 
 public struct SKSeitzMatrix
 {
-  var rotation: SKRotationMatrix
-  var translation: SIMD3<Double>
+  public var rotation: SKRotationMatrix
+  public var translation: SIMD3<Double>
   
   public init(rotation: SKRotationMatrix, translation: SIMD3<Int32>)
   {
@@ -307,6 +307,12 @@ public struct SKSpacegroup
     return []
   }
   
+  // all symmetry operations of the space group, including the lattice centring
+  public var seitzMatrices: [SKSeitzMatrix]
+  {
+    return self.spaceGroupSetting.fullSeitzMatrices.operations.map{SKSeitzMatrix(rotation: $0.rotation, translation: $0.translation)}
+  }
+  
   public func listOfSymmetricPositions(_ pos: SIMD3<Double>) -> [SIMD3<Double>]
   {
     let seitzMatrices = self.spaceGroupSetting.fullSeitzMatrices
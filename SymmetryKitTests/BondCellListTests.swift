@@ -0,0 +1,156 @@
+//
+//  BondCellListTests.swift
+//  SymmetryKitTests
+//
+//  Created by David Dubbeldam on 17/10/2026.
+//  Copyright © 2026 David Dubbeldam. All rights reserved.
+//
+
+import XCTest
+@testable import SymmetryKit
+import simd
+
+// The pairs of the cell list must be identical to those of the minimum-image all-pairs loop, in the same order and without duplicates.
+class BondCellListTests: XCTestCase
+{
+  // a reproducible pseudo-random generator (linear congruential), so that failures can be reproduced
+  struct Generator
+  {
+    var state: UInt64
+    
+    mutating func next() -> Double
+    {
+      state = state &* 6364136223846793005 &+ 1442695040888963407
+      return Double(state >> 11) / Double(1 << 53)
+    }
+  }
+  
+  func randomStructure(cell: SKCell, numberOfAtoms: Int, seed: UInt64) -> (positions: [SIMD3<Double>], bondDistanceCriteria: [Double])
+  {
+    var generator: Generator = Generator(state: seed)
+    var positions: [SIMD3<Double>] = []
+    var bondDistanceCriteria: [Double] = []
+    for _ in 0..<numberOfAtoms
+    {
+      // some positions slightly outside of the unit cell, these must be binned into their periodic image
+      let s: SIMD3<Double> = SIMD3<Double>(1.1 * generator.next() - 0.05, 1.1 * generator.next() - 0.05, 1.1 * generator.next() - 0.05)
+      positions.append(cell.unitCell * s)
+      bondDistanceCriteria.append(0.5 + 0.4 * generator.next())
+    }
+    return (positions, bondDistanceCriteria)
+  }
+  
+  // the reference: all pairs (i,j) with j > i, using the minimum image of the cell
+  func bruteForcePairs(cell: SKCell?, positions: [SIMD3<Double>], bondDistanceCriteria: [Double], tolerance: Double) -> [SKBondCellList.Pair]
+  {
+    var pairs: [SKBondCellList.Pair] = []
+    for i in 0..<positions.count
+    {
+      for j in (i + 1)..<max(i + 1, positions.count)
+      {
+        let separationVector: SIMD3<Double> = positions[i] - positions[j]
+        let periodicSeparationVector: SIMD3<Double> = cell?.applyUnitCellBoundaryCondition(separationVector) ?? separationVector
+        let bondCriteria: Double = bondDistanceCriteria[i] + bondDistanceCriteria[j] + tolerance
+        let bondLength: Double = length(periodicSeparationVector)
+        if bondLength < bondCriteria
+        {
+          pairs.append(SKBondCellList.Pair(index1: i, index2: j, bondLength: bondLength, isExternal: cell != nil && length(separationVector) > bondCriteria))
+        }
+      }
+    }
+    return pairs
+  }
+  
+  func compare(_ pairs: [SKBondCellList.Pair], _ reference: [SKBondCellList.Pair], _ message: String)
+  {
+    XCTAssertEqual(pairs.count, reference.count, "different number of bonds (\(message))")
+    guard pairs.count == reference.count else { return }
+    
+    for (pair, referencePair) in zip(pairs, reference)
+    {
+      XCTAssertEqual(pair.index1, referencePair.index1, "different bond (\(message))")
+      XCTAssertEqual(pair.index2, referencePair.index2, "different bond (\(message))")
+      XCTAssertEqual(pair.bondLength, referencePair.bondLength, "different bond length for \(pair.index1)-\(pair.index2) (\(message))")
+      XCTAssertEqual(pair.isExternal, referencePair.isExternal, "different external flag for \(pair.index1)-\(pair.index2) (\(message))")
+      if pair.index1 != referencePair.index1 || pair.index2 != referencePair.index2 || pair.isExternal != referencePair.isExternal
+      {
+        return
+      }
+    }
+  }
+  
+  func checkPeriodic(cell: SKCell, numberOfAtoms: Int, seed: UInt64, _ message: String)
+  {
+    let structure: (positions: [SIMD3<Double>], bondDistanceCriteria: [Double]) = randomStructure(cell: cell, numberOfAtoms: numberOfAtoms, seed: seed)
+    let cellList: SKBondCellList = SKBondCellList(cell: cell, positions: structure.positions, bondDistanceCriteria: structure.bondDistanceCriteria)
+    let reference: [SKBondCellList.Pair] = bruteForcePairs(cell: cell, positions: structure.positions, bondDistanceCriteria: structure.bondDistanceCriteria, tolerance: 0.4)
+    
+    XCTAssertFalse(reference.isEmpty, "no bonds in the test-structure (\(message))")
+    XCTAssertTrue(reference.contains{$0.isExternal}, "no external bonds in the test-structure (\(message))")
+    
+    guard let pairs: [SKBondCellList.Pair] = cellList.pairs(for: 0..<numberOfAtoms) else
+    {
+      XCTFail("pairs not computed (\(message))")
+      return
+    }
+    compare(pairs, reference, message)
+    
+    // no duplicates: the pairs are strictly ordered on index1 and then on index2
+    for (previous, next) in zip(pairs, pairs.dropFirst())
+    {
+      XCTAssertTrue(previous.index1 < next.index1 || (previous.index1 == next.index1 && previous.index2 < next.index2), "duplicate or unordered bond \(next.index1)-\(next.index2) (\(message))")
+    }
+    
+    // the order does not depend on the number of threads: a single serial pass, and the atoms split over separate calls,
+    // give the same pairs in the same order
+    compare(cellList.serialPairs(for: 0..<numberOfAtoms), reference, "serial, " + message)
+    let split: Int = numberOfAtoms / 3 + 7
+    let splitPairs: [SKBondCellList.Pair] = (cellList.pairs(for: 0..<split) ?? []) + (cellList.pairs(for: split..<numberOfAtoms) ?? [])
+    compare(splitPairs, reference, "split, " + message)
+  }
+  
+  func testTriclinicCell()
+  {
+    let cell: SKCell = SKCell(a: 9.0, b: 10.0, c: 11.0, alpha: 75.0 * Double.pi / 180.0, beta: 80.0 * Double.pi / 180.0, gamma: 105.0 * Double.pi / 180.0)
+    
+    // more atoms than a block, so that several blocks are computed concurrently
+    checkPeriodic(cell: cell, numberOfAtoms: 3 * SKBondCellList.blockSize + 17, seed: 1, "triclinic")
+  }
+  
+  func testStronglySkewedCell()
+  {
+    let cell: SKCell = SKCell(a: 12.0, b: 12.0, c: 14.0, alpha: 70.0 * Double.pi / 180.0, beta: 110.0 * Double.pi / 180.0, gamma: 60.0 * Double.pi / 180.0)
+    checkPeriodic(cell: cell, numberOfAtoms: 900, seed: 2, "skewed")
+  }
+  
+  func testThinCell()
+  {
+    // perpendicular widths below three times the largest bond criterion: one and two cells along the thin directions
+    let cell: SKCell = SKCell(a: 3.0, b: 5.5, c: 20.0, alpha: 95.0 * Double.pi / 180.0, beta: 90.0 * Double.pi / 180.0, gamma: 100.0 * Double.pi / 180.0)
+    checkPeriodic(cell: cell, numberOfAtoms: 400, seed: 3, "thin")
+  }
+  
+  func testNonPeriodic()
+  {
+    let cell: SKCell = SKCell(a: 15.0, b: 12.0, c: 10.0, alpha: 90.0 * Double.pi / 180.0, beta: 90.0 * Double.pi / 180.0, gamma: 90.0 * Double.pi / 180.0)
+    let structure: (positions: [SIMD3<Double>], bondDistanceCriteria: [Double]) = randomStructure(cell: cell, numberOfAtoms: 700, seed: 4)
+    let cellList: SKBondCellList = SKBondCellList(positions: structure.positions, bondDistanceCriteria: structure.bondDistanceCriteria)
+    let reference: [SKBondCellList.Pair] = bruteForcePairs(cell: nil, positions: structure.positions, bondDistanceCriteria: structure.bondDistanceCriteria, tolerance: 0.4)
+    
+    guard let pairs: [SKBondCellList.Pair] = cellList.pairs(for: 0..<structure.positions.count) else
+    {
+      XCTFail("pairs not computed (non-periodic)")
+      return
+    }
+    XCTAssertFalse(pairs.contains{$0.isExternal}, "external bonds in a non-periodic structure")
+    compare(pairs, reference, "non-periodic")
+  }
+  
+  func testCancel()
+  {
+    let cell: SKCell = SKCell(a: 9.0, b: 10.0, c: 11.0, alpha: 75.0 * Double.pi / 180.0, beta: 80.0 * Double.pi / 180.0, gamma: 105.0 * Double.pi / 180.0)
+    let structure: (positions: [SIMD3<Double>], bondDistanceCriteria: [Double]) = randomStructure(cell: cell, numberOfAtoms: 200, seed: 5)
+    let cellList: SKBondCellList = SKBondCellList(cell: cell, positions: structure.positions, bondDistanceCriteria: structure.bondDistanceCriteria)
+    XCTAssertNil(cellList.pairs(for: 0..<structure.positions.count, cancelHandler: {return true}))
+  }
+}
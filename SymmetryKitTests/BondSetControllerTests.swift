@@ -0,0 +1,114 @@
+//
+//  BondSetControllerTests.swift
+//  SymmetryKitTests
+//
+//  Created by David Dubbeldam on 17/10/2026.
+//  Copyright © 2026 David Dubbeldam. All rights reserved.
+//
+
+import XCTest
+import Cocoa
+@testable import SymmetryKit
+import simd
+
+// Applying a difference in place must give the same bond-set as rebuilding it from all the bonds.
+class BondSetControllerTests: XCTestCase
+{
+  // a reproducible pseudo-random generator (linear congruential), so that failures can be reproduced
+  struct Generator
+  {
+    var state: UInt64
+    
+    mutating func next(_ n: Int) -> Int
+    {
+      state = state &* 6364136223846793005 &+ 1442695040888963407
+      return Int((state >> 33) % UInt64(n))
+    }
+  }
+  
+  func testReplaceBondsInPlace()
+  {
+    var generator: Generator = Generator(state: 12345)
+    
+    // asymmetric atoms of a few elements, each with two copies
+    let asymmetricAtoms: [SKAsymmetricAtom] = (0..<40).map{index -> SKAsymmetricAtom in
+      let atom: SKAsymmetricAtom = SKAsymmetricAtom(displayName: "atom", elementId: [1, 6, 8][index % 3], uniqueForceFieldName: "atom", position: SIMD3<Double>(0,0,0), charge: 0.0, color: NSColor.white, drawRadius: 1.0, bondDistanceCriteria: 1.0, occupancy: 1.0)
+      atom.tag = index
+      atom.copies = [SKAtomCopy(asymmetricParentAtom: atom, position: SIMD3<Double>(0,0,0)), SKAtomCopy(asymmetricParentAtom: atom, position: SIMD3<Double>(0.5,0.5,0.5))]
+      return atom
+    }
+    let atomCopies: [SKAtomCopy] = asymmetricAtoms.flatMap{$0.copies}
+    
+    func randomBond() -> SKBondNode
+    {
+      let atom1: SKAtomCopy = atomCopies[generator.next(atomCopies.count)]
+      var atom2: SKAtomCopy = atomCopies[generator.next(atomCopies.count)]
+      while atom2 === atom1
+      {
+        atom2 = atomCopies[generator.next(atomCopies.count)]
+      }
+      return SKBondNode(atom1: atom1, atom2: atom2, boundaryType: generator.next(2) == 0 ? .internal : .external)
+    }
+    
+    var bonds: [SKBondNode] = []
+    while bonds.count < 120
+    {
+      let bond: SKBondNode = randomBond()
+      if !bonds.contains(bond)
+      {
+        bonds.append(bond)
+      }
+    }
+    
+    let bondSetController: SKBondSetController = SKBondSetController(arrangedObjects: bonds)
+    bondSetController.tag()
+    
+    for step in 0..<200
+    {
+      let currentBonds: [SKBondNode] = bondSetController.bonds
+      
+      // a random selection, and its asymmetric bonds
+      bondSetController.selectedObjects = IndexSet((0..<bondSetController.arrangedObjects.count).filter{_ in generator.next(4) == 0})
+      let selectedAsymmetricBonds: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>] = bondSetController.arrangedObjects[bondSetController.selectedObjects]
+      
+      // a random difference: removed bonds, new bonds, and bonds that change their boundary type (in both lists)
+      let removed: [SKBondNode] = currentBonds.filter{_ in generator.next(10) == 0}
+      var added: [SKBondNode] = removed.filter{_ in generator.next(3) == 0}.map{SKBondNode(atom1: $0.atom1, atom2: $0.atom2, boundaryType: $0.boundaryType == .internal ? .external : .internal)}
+      for _ in 0..<generator.next(12)
+      {
+        let bond: SKBondNode = randomBond()
+        if !currentBonds.contains(bond) && !added.contains(bond)
+        {
+          added.append(bond)
+        }
+      }
+      
+      let expectedBonds: [SKBondNode] = currentBonds.filter{bond in !removed.contains{$0 === bond}} + added
+      let reference: SKBondSetController = SKBondSetController(arrangedObjects: expectedBonds)
+      
+      let insertedIndices: IndexSet = bondSetController.replaceBonds(removed: removed, added: added)
+      
+      // the same asymmetric bonds in the same order, with the same copies
+      XCTAssertEqual(bondSetController.arrangedObjects.count, reference.arrangedObjects.count, "step \(step)")
+      guard bondSetController.arrangedObjects.count == reference.arrangedObjects.count else { return }
+      for (index, asymmetricBond) in bondSetController.arrangedObjects.enumerated()
+      {
+        let referenceAsymmetricBond: SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom> = reference.arrangedObjects[index]
+        XCTAssertTrue(asymmetricBond.atom1 === referenceAsymmetricBond.atom1 && asymmetricBond.atom2 === referenceAsymmetricBond.atom2, "step \(step), asymmetric bond \(index)")
+        XCTAssertEqual(Set(asymmetricBond.copies.map{ObjectIdentifier($0)}), Set(referenceAsymmetricBond.copies.map{ObjectIdentifier($0)}), "step \(step), asymmetric bond \(index)")
+        XCTAssertTrue(asymmetricBond.copies.allSatisfy{$0.asymmetricIndex == index}, "step \(step), asymmetric bond \(index)")
+      }
+      
+      // the selection of the remaining asymmetric bonds is kept, the inserted asymmetric bonds are new
+      XCTAssertEqual(bondSetController.selectedObjects, IndexSet(selectedAsymmetricBonds.compactMap{reference.arrangedObjects.firstIndex(of: $0)}), "step \(step)")
+      XCTAssertEqual(insertedIndices, IndexSet(reference.arrangedObjects.indices.filter{index in !currentBonds.contains{SKAsymmetricBond($0.atom1.asymmetricParentAtom, $0.atom2.asymmetricParentAtom) == reference.arrangedObjects[index]}}), "step \(step)")
+      
+      // the incrementally updated lookup of the bonds of atoms
+      let atoms: Set<SKAsymmetricAtom> = Set((0..<3).map{_ in asymmetricAtoms[generator.next(asymmetricAtoms.count)]})
+      let expectedAsymmetricBonds: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>] = reference.arrangedObjects.filter{atoms.contains($0.atom1) || atoms.contains($0.atom2)}
+      let asymmetricBonds: [SKAsymmetricBond<SKAsymmetricAtom, SKAsymmetricAtom>] = bondSetController.asymmetricBonds(of: atoms)
+      XCTAssertEqual(asymmetricBonds.count, expectedAsymmetricBonds.count, "step \(step)")
+      XCTAssertTrue(zip(asymmetricBonds, expectedAsymmetricBonds).allSatisfy{$0.0 == $0.1}, "step \(step)")
+    }
+  }
+}
@@ -98,6 +98,27 @@ class Project
     return SKNitrogenSurfaceArea.compute(structures: projectStructureNode.sceneList.allAdsorptionSurfaceStructures)
   }
   
+  // the pore geometries, connectivities and blocking pockets are computed for the same structures, in the same order
+  var structures: [Structure]
+  {
+    return projectStructureNode.sceneList.allObjects.compactMap({$0 as? Structure})
+  }
+  
+  public var poreGeometries: [SKPoreGeometry.Result]
+  {
+    return SKPoreGeometry.compute(structures: structures.map{$0 as SKRenderAdsorptionSurfaceStructure})
+  }
+  
+  public var poreConnectivities: [SKPoreConnectivity]
+  {
+    return SKPoreConnectivity.compute(structures: structures.map{($0.cell, $0.atomUnitCellPositions, $0.potentialParameters, probeParameters: $0.frameworkProbeParameters)})
+  }
+  
+  public var blockingPockets: [SKBlockingPockets]
+  {
+    return SKBlockingPockets.compute(structures: structures.map{($0.cell, $0.atomUnitCellPositions, $0.potentialParameters, probeParameters: $0.frameworkProbeParameters)})
+  }
+  
   var makePicture: Data
   {
     let camera: RKCamera = RKCamera()
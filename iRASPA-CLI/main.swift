@@ -30,6 +30,7 @@
  *************************************************************************************************************/
 
 import Foundation
+import SimulationKit
 
 let readPermissionDataKey: String = "nl.darkwing.iRASPA-CLI.readPermissionData"
 let writePermissionDataKey: String = "nl.darkwing.iRASPA-CLI.writePermissionData"
@@ -39,6 +40,8 @@ let transferWritePermissionDataKey: String = "group.nl.darkwing.iRASPA.transferW
 let helpOption = OptionType.bool(value: false, shortOption: "h", longOption: "help", description: "Prints a help message.")
 let surfaceAreaOption = OptionType.bool(value: false, shortOption: "s", longOption: "surfacearea", description: "Computes the surface area.")
 let voidFractionOption = OptionType.bool(value: false, shortOption: "v", longOption: "voidfraction", description: "Computes the void fraction.")
+let poreGeometryOption = OptionType.bool(value: false, shortOption: "g", longOption: "poregeometry", description: "Computes the pore diameters Di, Df and Dif and the channels and pockets.")
+let blockPocketsOption = OptionType.bool(value: false, shortOption: "b", longOption: "blockpockets", description: "Writes the blocking spheres of the inaccessible pockets as RASPA block-files.")
 let pictureOption = OptionType.bool(value: false, shortOption: "p", longOption: "picture", description: "Renders a picture.")
 
 
@@ -100,7 +103,7 @@ if let groupDefaults: UserDefaults = UserDefaults(suiteName: "24U2ZRZ6SC.nl.dark
   }
 }
 
-let options: [OptionType] = [surfaceAreaOption, voidFractionOption, pictureOption, helpOption]
+let options: [OptionType] = [surfaceAreaOption, voidFractionOption, poreGeometryOption, blockPocketsOption, pictureOption, helpOption]
 let console = Console(arguments: Swift.CommandLine.arguments, options: options)
 
 if Swift.CommandLine.arguments.count <= 1
@@ -147,6 +150,34 @@ else
                 {
                   print("\(fileName) Helium void-fraction: \(project.voidFractions) [-]")
                 }
+              case poreGeometryOption:
+                if case .bool(let value, _, _, _) = option, value
+                {
+                  for (poreGeometry, poreConnectivity) in zip(project.poreGeometries, project.poreConnectivities)
+                  {
+                    print("\(fileName) Largest included sphere Di: \(poreGeometry.largestIncludedSphere) [Å]")
+                    print("\(fileName) Largest free sphere Df: \(poreGeometry.largestFreeSphere) [Å]")
+                    print("\(fileName) Largest included sphere along free path Dif: \(poreGeometry.largestIncludedSphereAlongFreePath) [Å]")
+                    print("\(fileName) Channels: \(poreConnectivity.numberOfChannels), pockets: \(poreConnectivity.numberOfPockets), dimensionality: \(poreConnectivity.dimensionality)")
+                  }
+                }
+              case blockPocketsOption:
+                if case .bool(let value, _, _, _) = option, value
+                {
+                  let blockingPockets: [SKBlockingPockets] = project.blockingPockets
+                  let paths = FileManager.default.urls(for: .downloadsDirectory, in: .userDomainMask)
+                  for (index, pockets) in blockingPockets.enumerated()
+                  {
+                    let name: String = url.deletingPathExtension().lastPathComponent + (blockingPockets.count > 1 ? "_\(index)" : "")
+                    let filename = paths.first!.appendingPathComponent(name).appendingPathExtension("block")
+                    do {
+                      try pockets.write(to: filename)
+                      print("\(fileName) Blocked pockets: \(pockets.connectivity.numberOfPockets), spheres: \(pockets.spheres.count), written to \(filename.path)")
+                    } catch let error {
+                      print("error \(error.localizedDescription)")
+                    }
+                  }
+                }
               case pictureOption:
                 if case .bool(let value, _, _, _) = option, value
                 {
@@ -70,6 +70,9 @@ class RenderTabViewController: NSTabViewController, NSMenuItemValidation, Window
   var startPoint: NSPoint? = NSPoint()
   var pickedDepth: Float? = 1.0
   
+  // the bonds of the selected atoms at the start of dragging a selection, restored before the final translation is registered with the undo-manager
+  var bondsBeforeShiftSelection: [(structure: Structure, bonds: [SKBondNode], selection: IndexSet)] = []
+  
   public enum WindowAspectRatio: Int
   {
     case aspect_ratio_off = 0
@@ -1866,6 +1869,8 @@ class RenderTabViewController: NSTabViewController, NSMenuItemValidation, Window
       {
         tracking = .translateSelection
         pickedDepth = pickDepth(startPoint!)
+        bondsBeforeShiftSelection = (self.renderDataSource?.renderStructures ?? []).compactMap{$0 as? Structure}.map{
+          ($0, $0.bondSetController.asymmetricBonds(of: Set($0.atomTreeController.selectedTreeNodes.map{$0.representedObject})).flatMap{$0.copies}, $0.bondSetController.selectedObjects)}
       }
       else if event.modifierFlags.contains(NSEvent.ModifierFlags.option) &&
             !event.modifierFlags.contains(NSEvent.ModifierFlags.command)
@@ -2115,6 +2120,7 @@ class RenderTabViewController: NSTabViewController, NSMenuItemValidation, Window
         let proxyProject: ProjectTreeNode = self.proxyProject, proxyProject.isEnabled,
         let camera = (self.proxyProject?.representedObject.project as? ProjectStructureNode)?.renderCamera
      {
+       var bondsChanged: Bool = false
        for i in 0..<crystalProjectData.renderStructures.count
        {
          if let structure: Structure = crystalProjectData.renderStructures[i] as? Structure
@@ -2124,9 +2130,22 @@ class RenderTabViewController: NSTabViewController, NSMenuItemValidation, Window
            let shift: SIMD3<Double> = camera.myGluUnProject(SIMD3<Double>(x: to.x, y: to.y, z: depth), modelMatrix: modelMatrix,  inViewPort: self.view.bounds) - camera.myGluUnProject(SIMD3<Double>(x: origin.x, y: origin.y, z: depth), modelMatrix: modelMatrix, inViewPort: self.view.bounds)
            
            structure.translateSelection(by: shift)
+           
+           let asymmetricAtoms: [SKAsymmetricAtom] = structure.atomTreeController.selectedTreeNodes.map{$0.representedObject}
+           if !asymmetricAtoms.isEmpty
+           {
+             bondsChanged = updateBondsOfShiftedSelection(structure: structure, atoms: asymmetricAtoms, by: shift) || bondsChanged
+           }
          }
          
        }
+       
+       // the bond-buffers are only rebuilt when the bonds changed
+       if bondsChanged
+       {
+         self.reloadRenderData()
+         self.redraw()
+       }
        self.reloadRenderDataSelectedAtoms()
      }
    }
@@ -2146,10 +2165,53 @@ class RenderTabViewController: NSTabViewController, NSMenuItemValidation, Window
            let shift: SIMD3<Double> = camera.myGluUnProject(SIMD3<Double>(x: to.x, y: to.y, z: depth), modelMatrix: modelMatrix, inViewPort: self.view.bounds) - camera.myGluUnProject(SIMD3<Double>(x: origin.x, y: origin.y, z: depth), modelMatrix: modelMatrix, inViewPort: self.view.bounds)
            
            let asymmetricAtoms: [SKAsymmetricAtom] = structure.atomTreeController.selectedTreeNodes.map{$0.representedObject}
+           
+           // undo the bond changes of the drag-steps, so that the undo-manager registers the difference of the whole drag
+           if let stored = bondsBeforeShiftSelection.first(where: {$0.structure === structure})
+           {
+             let currentBonds: [SKBondNode] = structure.bondSetController.asymmetricBonds(of: Set(asymmetricAtoms)).flatMap{$0.copies}
+             let storedBoundaryTypes: [SKBondNode: SKBondNode.BoundaryType] = Dictionary(stored.bonds.map{($0, $0.boundaryType)}, uniquingKeysWith: {first, _ in first})
+             let currentBoundaryTypes: [SKBondNode: SKBondNode.BoundaryType] = Dictionary(currentBonds.map{($0, $0.boundaryType)}, uniquingKeysWith: {first, _ in first})
+             structure.bondSetController.replaceBonds(removed: currentBonds.filter{storedBoundaryTypes[$0] != $0.boundaryType}, added: stored.bonds.filter{currentBoundaryTypes[$0] != $0.boundaryType})
+             structure.bondSetController.selectedObjects = stored.selection
+           }
+           
            self.setTranslatedPositions(structure: structure, atoms: asymmetricAtoms, by: shift)
          }
        }
      }
+     bondsBeforeShiftSelection = []
+   }
+   
+   // Re-derives the bonds of the dragged atoms in their neighbourhood and applies only the difference to the bond-set (not undoable).
+   // Returns whether any bond was added or removed.
+   func updateBondsOfShiftedSelection(structure: Structure, atoms: [SKAsymmetricAtom], by shift: SIMD3<Double>) -> Bool
+   {
+     let oldpositions: [SIMD3<Double>] = atoms.map{$0.position}
+     let newpositions: [SIMD3<Double>] = structure.translatedPositionsSelectionCartesian(atoms: atoms, by: shift)
+     
+     // side-effect: temporarily set the positions to compute the bonds, the displacement is kept for rendering
+     for i in 0..<atoms.count
+     {
+       atoms[i].position = newpositions[i]
+       structure.expandSymmetry(asymmetricAtom: atoms[i])
+     }
+     
+     let difference: (added: [SKBondNode], removed: [SKBondNode]) = structure.bondDifference(subset: atoms)
+     
+     for i in 0..<atoms.count
+     {
+       atoms[i].position = oldpositions[i]
+       structure.expandSymmetry(asymmetricAtom: atoms[i])
+     }
+     structure.updateBondSpatialIndex(atoms: atoms)
+     
+     // most drag-steps do not change the bonds, the bond-set (and its lookup of the bonds of the atoms) is then left untouched
+     guard !(difference.added.isEmpty && difference.removed.isEmpty) else { return false }
+     
+     structure.bondSetController.replaceBonds(removed: difference.removed, added: difference.added)
+     
+     return true
    }
    
   
@@ -2172,6 +2234,7 @@ class RenderTabViewController: NSTabViewController, NSMenuItemValidation, Window
         structure.expandSymmetry(asymmetricAtom: atoms[i])
       }
       structure.atomTreeController.tag()
+      structure.updateBondSpatialIndex(atoms: atoms)
       
       structure.bondSetController.replaceBonds(atoms: atoms, bonds: newbonds)
       structure.bondSetController.selectedObjects = newBondSelection
@@ -2192,9 +2255,46 @@ class RenderTabViewController: NSTabViewController, NSMenuItemValidation, Window
     }
   }
   
+  // Like 'updatePositions(structure:atoms:newpositions:oldpositions:newbonds:newBondSelection:oldbonds:oldBondSelection:)', but the bonds
+  // are changed (and undone) by applying the difference in place. Without a new selection, the selection is kept and the new bonds are added to it.
+  func updatePositions(structure: Structure, atoms: [SKAsymmetricAtom], newpositions: [SIMD3<Double>], oldpositions: [SIMD3<Double>], addedBonds: [SKBondNode], removedBonds: [SKBondNode], newBondSelection: IndexSet?, oldBondSelection: IndexSet)
+  {
+    if let project: ProjectStructureNode = self.proxyProject?.representedObject.loadedProjectStructureNode
+    {
+      for i in 0..<atoms.count
+      {
+        atoms[i].position = newpositions[i]
+        atoms[i].displacement =  SIMD3<Double>(0.0,0.0,0.0)
+        structure.expandSymmetry(asymmetricAtom: atoms[i])
+      }
+      structure.updateBondSpatialIndex(atoms: atoms)
+      
+      let insertedBonds: IndexSet = structure.bondSetController.replaceBonds(removed: removedBonds, added: addedBonds)
+      let bondSelection: IndexSet = newBondSelection ?? structure.bondSetController.selectedObjects.union(insertedBonds)
+      structure.bondSetController.selectedObjects = bondSelection
+      
+      project.undoManager.registerUndo(withTarget: self, handler: {
+        $0.updatePositions(structure: structure, atoms: atoms, newpositions: oldpositions, oldpositions: newpositions, addedBonds: removedBonds, removedBonds: addedBonds, newBondSelection: oldBondSelection, oldBondSelection: bondSelection)
+      })
+      project.undoManager.setActionName(NSLocalizedString("Change Positions", comment: ""))
+      
+      structure.reComputeBoundingBox()
+      
+      self.invalidateIsosurface(cachedIsosurfaces: [structure])
+      self.invalidateCachedAmbientOcclusionTexture(cachedAmbientOcclusionTextures: [])
+      
+      self.reloadData()
+      self.redraw()
+      
+      NotificationCenter.default.post(name: Notification.Name(NotificationStrings.AtomsShouldReloadNotification), object: structure)
+      NotificationCenter.default.post(name: Notification.Name(NotificationStrings.BondsShouldReloadNotification), object: structure)
+      
+      NotificationCenter.default.post(name: Notification.Name(NotificationStrings.SpaceGroupShouldReloadNotification), object: self.windowController)
+    }
+  }
+  
   func setTranslatedPositions(structure: Structure, atoms: [SKAsymmetricAtom], by translation: SIMD3<Double>)
   {
-    let oldbonds: [SKBondNode] = structure.bondSetController.bonds.filter{(atoms.contains($0.atom1.asymmetricParentAtom) || atoms.contains($0.atom2.asymmetricParentAtom))}
     let oldBondSelection: IndexSet = structure.bondSetController.selectedObjects
     let oldpositions: [SIMD3<Double>] = atoms.map{$0.position}
     
@@ -2208,11 +2308,9 @@ class RenderTabViewController: NSTabViewController, NSMenuItemValidation, Window
       structure.expandSymmetry(asymmetricAtom: atoms[i])
     }
     
-    let newbonds: [SKBondNode] = structure.bonds(subset: atoms)
-    
-    let newBondSelection: IndexSet = structure.bondSetController.selectedAsymmetricBonds(atoms: atoms, bonds: newbonds)
+    let difference: (added: [SKBondNode], removed: [SKBondNode]) = structure.bondDifference(subset: atoms)
         
-    self.updatePositions(structure: structure, atoms: atoms, newpositions: newpositions, oldpositions: oldpositions, newbonds: newbonds, newBondSelection: newBondSelection, oldbonds: oldbonds, oldBondSelection: oldBondSelection)
+    self.updatePositions(structure: structure, atoms: atoms, newpositions: newpositions, oldpositions: oldpositions, addedBonds: difference.added, removedBonds: difference.removed, newBondSelection: nil, oldBondSelection: oldBondSelection)
   }
   
   
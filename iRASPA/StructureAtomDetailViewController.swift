@@ -1388,6 +1388,8 @@ class StructureAtomDetailViewController: NSViewController, NSMenuItemValidation,
         bondViewer.bondSetController.tag()
       }
       
+      (object as? Structure)?.removeFromBondSpatialIndex(atoms: atoms.flatMap{$0.flattenedLeafNodes()}.map{$0.representedObject})
+      
       let observeNotificationsStored: Bool = self.observeNotifications
       self.observeNotifications = false
       
@@ -1514,6 +1516,7 @@ class StructureAtomDetailViewController: NSViewController, NSMenuItemValidation,
       }
       atomViewer.atomTreeController.tag()
       object.reComputeBoundingBox()
+      (object as? Structure)?.updateBondSpatialIndex(atoms: atoms.flatMap{$0.flattenedLeafNodes()}.map{$0.representedObject})
       
       if let column: Int = (self.atomOutlineView?.column(withIdentifier: NSUserInterfaceItemIdentifier(rawValue: "atomFixedColumn"))),
         let numberOfRows: Int = self.atomOutlineView?.numberOfRows,
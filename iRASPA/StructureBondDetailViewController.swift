@@ -350,6 +350,7 @@ class StructureBondDetailViewController: NSViewController, NSMenuItemValidation,
         atomViewer.expandSymmetry(asymmetricAtom: atoms[i])
       }
       atomViewer.atomTreeController.tag()
+      (object as? Structure)?.updateBondSpatialIndex(atoms: atoms)
       
       if let bondViewer: BondEditor = object as? BondEditor
       {
@@ -1395,6 +1395,15 @@ class StructureCellDetailViewController: NSViewController, NSOutlineViewDelegate
           }
         }
       }
+      
+      if let buttonComputePoreGeometry: NSButton = view.viewWithTag(10) as? NSButton
+      {
+        buttonComputePoreGeometry.isEnabled = false
+        if !iRASPAObjects.filter({$0.object is StructuralPropertyEditor & VolumetricDataViewer}).isEmpty
+        {
+          buttonComputePoreGeometry.isEnabled = enabled
+        }
+      }
     default:
       break
     }
@@ -3372,6 +3381,7 @@ class StructureCellDetailViewController: NSViewController, NSOutlineViewDelegate
         {
           structures[i].structureNitrogenSurfaceArea = result
         }
+        self.recomputePoreConnectivity(structures: structures)
       }
       catch let error
       {
@@ -3382,7 +3392,19 @@ class StructureCellDetailViewController: NSViewController, NSOutlineViewDelegate
       self.windowController?.document?.updateChangeCount(.changeDone)
       self.proxyProject?.representedObject.isEdited = true
       
-      self.updateOutlineView(identifiers: [self.structuralProbeCell])
+      self.updateOutlineView(identifiers: [self.structuralProbeCell, self.structuralChannelCell])
+    }
+  }
+  
+  // the channels, pockets and dimensionality of the pore system depend on the probe molecule of the structure
+  func recomputePoreConnectivity(structures: [Structure])
+  {
+    let results: [SKPoreConnectivity] = SKPoreConnectivity.compute(structures: structures.map{($0.cell, $0.atomUnitCellPositions, $0.potentialParameters, probeParameters: $0.frameworkProbeParameters)})
+    for (i, result) in results.enumerated()
+    {
+      structures[i].structureNumberOfChannelSystems = result.numberOfChannels
+      structures[i].structureNumberOfInaccessiblePockets = result.numberOfPockets
+      structures[i].structureDimensionalityOfPoreSystem = result.dimensionality
     }
   }
   
@@ -3398,6 +3420,7 @@ class StructureCellDetailViewController: NSViewController, NSOutlineViewDelegate
         {
           structures[i].structureNitrogenSurfaceArea = result
         }
+        self.recomputePoreConnectivity(structures: structures)
       }
       catch let error
       {
@@ -3408,7 +3431,7 @@ class StructureCellDetailViewController: NSViewController, NSOutlineViewDelegate
       self.windowController?.document?.updateChangeCount(.changeDone)
       self.proxyProject?.representedObject.isEdited = true
       
-      self.updateOutlineView(identifiers: [self.structuralProbeCell])
+      self.updateOutlineView(identifiers: [self.structuralProbeCell, self.structuralChannelCell])
     }
   }
   
@@ -3491,6 +3514,28 @@ class StructureCellDetailViewController: NSViewController, NSOutlineViewDelegate
     }
   }
   
+  @IBAction func recomputePoreGeometry(_ sender: NSButton)
+  {
+    if let ProjectTreeNode: ProjectTreeNode = self.proxyProject, ProjectTreeNode.isEnabled
+    {
+      let structures: [Structure & StructuralPropertyEditor & VolumetricDataViewer] = self.iRASPAObjects.compactMap({$0.object as? Structure & StructuralPropertyEditor & VolumetricDataViewer})
+      let results: [SKPoreGeometry.Result] = SKPoreGeometry.compute(structures: structures)
+      
+      for (i, result) in results.enumerated()
+      {
+        structures[i].structureLargestCavityDiameter = result.largestIncludedSphere
+        structures[i].structureRestrictingPoreLimitingDiameter = result.largestFreeSphere
+        structures[i].structureLargestCavityDiameterAlongAViablePath = result.largestIncludedSphereAlongFreePath
+      }
+      self.recomputePoreConnectivity(structures: structures)
+      
+      self.windowController?.document?.updateChangeCount(.changeDone)
+      self.proxyProject?.representedObject.isEdited = true
+      
+      self.updateOutlineView(identifiers: [self.structuralProbeCell, self.structuralChannelCell])
+    }
+  }
+  
   
   // MARK: Spacegroup
   // =====================================================================
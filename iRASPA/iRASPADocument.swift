@@ -77,6 +77,16 @@ class iRASPADocument: NSDocument, ForceFieldViewer, NSSharingServicePickerDelega
     }
   }
   
+  override func close()
+  {
+    // the energy grids that are kept for incremental updates are not needed anymore
+    for projectTreeNode: ProjectTreeNode in self.documentData.projectLocalRootNode.flattenedNodes()
+    {
+      projectTreeNode.representedObject.loadedProjectStructureNode?.allObjects.compactMap({$0 as? Structure}).forEach{$0.releaseIncrementalEnergyGrid()}
+    }
+    super.close()
+  }
+  
   
   // MARK: Saving data
   // =====================================================================
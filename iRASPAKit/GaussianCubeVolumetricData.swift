@@ -137,28 +137,12 @@ public class GaussianCubeVolumetricData: Structure, UnitCellViewer, VolumetricDa
     return true
   }
   
+  // the marching cubes handle arbitrary dimensions (periodically), the grid is not padded to an encompassing power-of-two cube
   public var gridData: [Float]
   {
     var copiedData = [Float](repeating: Float(0.0), count: data.count / MemoryLayout<Float>.stride)
     let _ = copiedData.withUnsafeMutableBytes { data.copyBytes(to: $0, from: 0..<data.count) }
-    
-    let encompassingCubicGridSize: Int32 = Int32(pow(2.0, Double(self.encompassingPowerOfTwoCubicGridSize)))
-    let numberOfValues: Int32 = encompassingCubicGridSize * encompassingCubicGridSize * encompassingCubicGridSize
-    var newdata = Array<Float>(repeating: 0.0, count: Int(numberOfValues))
-    
-    for x: Int32 in 0..<dimensions.x
-    {
-      for y: Int32 in 0..<dimensions.y
-      {
-        for z: Int32 in 0..<dimensions.z
-        {
-          let index: Int = Int(x+encompassingCubicGridSize*y+z*encompassingCubicGridSize*encompassingCubicGridSize)
-          newdata[index] = copiedData[Int(x + dimensions.x*y + z*dimensions.x*dimensions.y)]
-        }
-      }
-    }
-
-    return newdata
+    return copiedData
   }
   
   public var gridValueAndGradientData: [SIMD4<Float>]
@@ -172,45 +156,9 @@ public class GaussianCubeVolumetricData: Structure, UnitCellViewer, VolumetricDa
       copiedData[i] = Float((Double(value) - range.0) / (range.1 - range.0))
     }
     
-    let encompassingCubicGridSize: Int32 = Int32(pow(2.0, Double(self.encompassingPowerOfTwoCubicGridSize)))
-    let numberOfValues: Int32 = encompassingCubicGridSize * encompassingCubicGridSize * encompassingCubicGridSize
-    var newdata = Array<SIMD4<Float>>(repeating: SIMD4<Float>(0.0,0.0,0.0,0.0), count: Int(numberOfValues))
-    
-    for x: Int32 in 0..<dimensions.x
-    {
-      for y: Int32 in 0..<dimensions.y
-      {
-        for z: Int32 in 0..<dimensions.z
-        {
-          let value = copiedData[Int(x + dimensions.x*y + z*dimensions.x*dimensions.y)]
-          
-          let xi: Int32 = Int32(Float(x) + 0.5)
-          let xf: Float = Float(x) + 0.5 - Float(xi)
-          let xd0: Float = copiedData[Int(((xi-1 + dimensions.x) % dimensions.x)+y*dimensions.x+z*dimensions.x*dimensions.y)]
-          let xd1: Float = copiedData[Int((xi)+y*dimensions.x+z*dimensions.x*dimensions.y)]
-          let xd2: Float = copiedData[Int(((xi+1 + dimensions.x) % dimensions.x)+y*dimensions.x+z*dimensions.x*dimensions.y)]
-          let gx: Float = (xd1 - xd0) * (1.0 - xf) + (xd2 - xd1) * xf
-
-          let yi: Int32 = Int32(Float(y) + 0.5)
-          let yf: Float = Float(y) + 0.5 - Float(yi)
-          let yd0: Float = copiedData[Int(x + ((yi-1+dimensions.y) % dimensions.y)*dimensions.x+z*dimensions.x*dimensions.y)]
-          let yd1: Float = copiedData[Int(x + (yi)*dimensions.x+z*dimensions.x*dimensions.y)]
-          let yd2: Float = copiedData[Int(x + ((yi+1+dimensions.y) % dimensions.y)*dimensions.x+z*dimensions.x*dimensions.y)]
-          let gy: Float = (yd1 - yd0) * (1.0 - yf) + (yd2 - yd1) * yf
-
-          let zi: Int32 = Int32(Float(z) + 0.5)
-          let zf: Float = Float(z) + 0.5 - Float(zi)
-          let zd0: Float =  copiedData[Int(x+y*dimensions.x+((zi-1+dimensions.z) % dimensions.z)*dimensions.x*dimensions.y)]
-          let zd1: Float =  copiedData[Int(x+y*dimensions.x+(zi)*dimensions.x*dimensions.y)]
-          let zd2: Float =  copiedData[Int(x+y*dimensions.x+((zi+1+dimensions.z) % dimensions.z)*dimensions.x*dimensions.y)]
-          let gz: Float =  (zd1 - zd0) * (1.0 - zf) + (zd2 - zd1) * zf
-          
-          let index: Int = Int(x+encompassingCubicGridSize*y+z*encompassingCubicGridSize*encompassingCubicGridSize)
-          newdata[index] = SIMD4<Float>(value,gx,gy,gz)
-        }
-      }
-    }
-    return newdata
+    // central differences (periodic), computed in parallel
+    let encompassingCubicGridSize: Int = Int(pow(2.0, Double(self.encompassingPowerOfTwoCubicGridSize)))
+    return SKGridGradient.valuesAndGradients(copiedData, dimensions: dimensions, cubeSize: encompassingCubicGridSize)
   }
   
   // MARK: -
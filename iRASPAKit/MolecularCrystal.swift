@@ -126,6 +126,11 @@ public final class MolecularCrystal: Structure, AtomEditor, BondEditor, UnitCell
     return false
   }
   
+  public override var hasPeriodicBonds: Bool
+  {
+    return true
+  }
+  
   // MARK: Rendering
   // =====================================================================
   
@@ -1190,86 +1195,36 @@ public final class MolecularCrystal: Structure, AtomEditor, BondEditor, UnitCell
      
     let subsetAtoms: [SKAtomCopy] = subset.flatMap{$0.copies}
      
-    let asymmetricAtoms: Set<SKAsymmetricAtom> = Set(self.atomTreeController.flattenedLeafNodes().compactMap{$0.representedObject})
-       
-    let subSetAsymmetricAtoms: Set<SKAsymmetricAtom> = Set(asymmetricAtoms).subtracting(subset)
-    let atomList: [SKAtomCopy] = subSetAsymmetricAtoms.flatMap{$0.copies}
-     
-    for i in 0..<subsetAtoms.count
+    // only the atoms in the neighbourhood of the subset can bond to it
+    let atomList: [SKAtomCopy] = self.bondNeighbourhood(subset: subset)
+    
+    subsetAtoms.forEach{$0.type = .copy}
+    
+    // the atoms of the subset come first, so the pairs of the subset are all pairs (i,j) with i in the subset and j > i
+    let atoms: [SKAtomCopy] = subsetAtoms + atomList
+    let positions: [SIMD3<Double>] = atoms.map{$0.position}
+    let cellList: SKBondCellList = SKBondCellList(cell: cell, positions: positions, bondDistanceCriteria: atoms.map{$0.asymmetricParentAtom.bondDistanceCriteria})
+    
+    for pair in cellList.pairs(for: 0..<subsetAtoms.count) ?? []
     {
-      subsetAtoms[i].type = .copy
-       
-      let posA: SIMD3<Double> = subsetAtoms[i].position
-       
-      for j in i+1..<subsetAtoms.count
+      let i: Int = pair.index1
+      let j: Int = pair.index2
+      
+      // Type atom as 'Double'
+      if (pair.bondLength < 0.1)
       {
-        let posB: SIMD3<Double> = subsetAtoms[j].position
-         
-        let separationVector: SIMD3<Double> = posA - posB
-        let periodicSeparationVector: SIMD3<Double> = cell.applyUnitCellBoundaryCondition(separationVector)
-         
-        let bondCriteria: Double = (subsetAtoms[i].asymmetricParentAtom.bondDistanceCriteria + subsetAtoms[j].asymmetricParentAtom.bondDistanceCriteria + 0.4)
-         
-        let bondLength: Double = length(periodicSeparationVector)
-        if (bondLength < bondCriteria)
-        {
-          // Type atom as 'Double'
-          if (bondLength < 0.1)
-          {
-            subsetAtoms[i].type = .duplicate
-          }
-          else if (bondLength < 0.8)
-          {
-            // discard as being a bond
-          }
-          else if (length(separationVector) > bondCriteria )
-          {
-            let bond: SKBondNode = SKBondNode(atom1: subsetAtoms[i], atom2: subsetAtoms[j], boundaryType: .external)
-            computedBonds.append(bond)
-          }
-          else
-          {
-            let bond: SKBondNode = SKBondNode(atom1: subsetAtoms[i], atom2: subsetAtoms[j], boundaryType: .internal)
-            computedBonds.append(bond)
-          }
-        }
+        subsetAtoms[i].type = .duplicate
       }
-       
-      for j in 0..<atomList.count
+      else if (pair.bondLength < 0.8)
       {
-        let posB: SIMD3<Double> = atomList[j].position
-         
-        let separationVector: SIMD3<Double> = posA - posB
-        let periodicSeparationVector: SIMD3<Double> = cell.applyUnitCellBoundaryCondition(separationVector)
-         
-        let bondCriteria: Double = (subsetAtoms[i].asymmetricParentAtom.bondDistanceCriteria + atomList[j].asymmetricParentAtom.bondDistanceCriteria + 0.4)
-         
-        let bondLength: Double = length(periodicSeparationVector)
-        if (bondLength < bondCriteria)
-        {
-          // Type atom as 'Double'
-          if (bondLength < 0.1)
-          {
-            subsetAtoms[i].type = .duplicate
-          }
-          else if (bondLength < 0.8)
-          {
-            // discard as being a bond
-          }
-          else if (length(separationVector) > bondCriteria )
-          {
-            let bond: SKBondNode = SKBondNode(atom1: subsetAtoms[i], atom2: atomList[j], boundaryType: .external)
-            computedBonds.append(bond)
-          }
-          else
-          {
-            let bond: SKBondNode = SKBondNode(atom1: subsetAtoms[i], atom2: atomList[j], boundaryType: .internal)
-            computedBonds.append(bond)
-          }
-        }
+        // discard as being a bond
+      }
+      else
+      {
+        computedBonds.append(SKBondNode(atom1: atoms[i], atom2: atoms[j], boundaryType: pair.isExternal ? .external : .internal))
       }
     }
-     
+    
     return computedBonds.filter{$0.atom1.type == .copy && $0.atom2.type == .copy}
   }
   
@@ -1756,12 +1711,18 @@ public final class MolecularCrystal: Structure, AtomEditor, BondEditor, UnitCell
   
   public override func reComputeBonds()
   {
+    self.invalidateBondSpatialIndex()
+    self.releaseIncrementalEnergyGrid()
+    
     let atomList: [SKAtomCopy] = self.atomTreeController.flattenedLeafNodes().compactMap{$0.representedObject}.flatMap{$0.copies}
     self.bondSetController.bonds = self.computeBonds(cell: self.cell, atomList: atomList, cancelHandler: {return false}, updateHandler: {})
   }
   
   public override func reComputeBonds(_ node: ProjectTreeNode, cancelHandler: (()-> Bool), updateHandler: (() -> ()))
   {
+    self.invalidateBondSpatialIndex()
+    self.releaseIncrementalEnergyGrid()
+    
     let atomList: [SKAtomCopy] = self.atomTreeController.flattenedLeafNodes().compactMap{$0.representedObject}.flatMap{$0.copies}
     self.bondSetController.bonds = self.computeBonds(cell: self.cell, atomList: atomList, cancelHandler: cancelHandler, updateHandler: updateHandler)
   }
@@ -1774,186 +1735,37 @@ public final class MolecularCrystal: Structure, AtomEditor, BondEditor, UnitCell
   
   public override func computeBonds(cell structureCell: SKCell, atomList atoms: [SKAtomCopy], cancelHandler: (()-> Bool) = {return false}, updateHandler: (() -> ()) = {}) -> [SKBondNode]
   {
-    let cutoff: Double = 3.0
-    let offsets: [[Int]] = [[0,0,0],[1,0,0],[1,1,0],[0,1,0],[-1,1,0],[0,0,1],[1,0,1],[1,1,1],[0,1,1],[-1,1,1],[-1,0,1],[-1,-1,1],[0,-1,1],[1,-1,1]]
-    var totalCount: Int
-    
     var computedBonds: [SKBondNode] = []
     
-    let perpendicularWidths: SIMD3<Double> = structureCell.boundingBox.widths + SIMD3<Double>(x: 0.1, y: 0.1, z: 0.1)
-    guard perpendicularWidths.x > 0.0001 && perpendicularWidths.x > 0.0001 && perpendicularWidths.x > 0.0001 else {return []}
+    let perpendicularWidths: SIMD3<Double> = structureCell.perpendicularWidths
+    guard perpendicularWidths.x > 0.0001 && perpendicularWidths.y > 0.0001 && perpendicularWidths.z > 0.0001 else {return []}
+    
+    let positions: [SIMD3<Double>] = atoms.map{$0.position}
+    let bondDistanceCriteria: [Double] = atoms.map{$0.asymmetricParentAtom.bondDistanceCriteria}
+    let cellList: SKBondCellList = SKBondCellList(cell: structureCell, positions: positions, bondDistanceCriteria: bondDistanceCriteria)
     
-    let numberOfCells: [Int] = [Int(perpendicularWidths.x/cutoff),Int(perpendicularWidths.y/cutoff),Int(perpendicularWidths.z/cutoff)]
-    let totalNumberOfCells: Int = numberOfCells[0] * numberOfCells[1] * numberOfCells[2]
-    let cutoffVector: SIMD3<Double> = SIMD3<Double>(x: perpendicularWidths.x/Double(numberOfCells[0]), y: perpendicularWidths.y/Double(numberOfCells[1]), z: perpendicularWidths.z/Double(numberOfCells[2]))
+    guard let pairs: [SKBondCellList.Pair] = cellList.pairs(for: 0..<atoms.count, cancelHandler: cancelHandler, updateHandler: updateHandler) else {return []}
     
-    if ((numberOfCells[0]>=3) &&  (numberOfCells[1]>=3) && (numberOfCells[2]>=3))
+    for pair in pairs
     {
-      
-      var head: [Int] = [Int](repeating: -1, count: totalNumberOfCells)
-      var list: [Int] = [Int](repeating: -1, count: atoms.count)
-      
-      // create cell-list based on the bond-cutoff
-      for i in 0..<atoms.count
+      // Type atom as 'Double'
+      if (pair.bondLength < 0.1)
       {
-        //get the position in the unit cell
-        let position: SIMD3<Double> = structureCell.unitCell * fract(structureCell.inverseUnitCell * atoms[i].position)
-        
-        let icell: Int = Int((position.x) / cutoffVector.x) +
-                         Int((position.y) / cutoffVector.y) * numberOfCells[0] +
-                         Int((position.z) / cutoffVector.z) * numberOfCells[1] * numberOfCells[0]
-                
-        list[i] = head[icell]
-        head[icell] = i
+        atoms[pair.index1].type = .duplicate
       }
-      
-      
-      totalCount = numberOfCells[0] * numberOfCells[1] * numberOfCells[2]
-      
-      
-      let bondProgress: Progress = Progress(totalUnitCount: Int64(totalCount))
-      bondProgress.completedUnitCount = 0
-      
-      for k1 in 0..<numberOfCells[0]
+      else if (pair.bondLength < 0.8)
       {
-        for k2 in 0..<numberOfCells[1]
-        {
-          for k3 in 0..<numberOfCells[2]
-          {
-            let icell_i: Int = k1 + k2 * numberOfCells[0] + k3 * numberOfCells[1] * numberOfCells[0]
-            
-            var i: Int = head[icell_i]
-            while(i >= 0)
-            {
-              let posA: SIMD3<Double> = atoms[i].position
-              
-              // loop over neighboring cells
-              for offset in offsets
-              {
-                let off: [Int] = [(k1 + offset[0]+numberOfCells[0]) % numberOfCells[0],
-                                  (k2 + offset[1]+numberOfCells[1]) % numberOfCells[1],
-                                  (k3 + offset[2]+numberOfCells[2]) % numberOfCells[2]]
-                let icell_j: Int = off[0] + off[1] * numberOfCells[0] + off[2] * numberOfCells[1] * numberOfCells[0]
-                
-                var j: Int = head[icell_j]
-                while(j >= 0)
-                {
-                  if((i < j) || (icell_i != icell_j))
-                  {
-                    let posB: SIMD3<Double> = atoms[j].position
-                    let separationVector: SIMD3<Double> = posA - posB
-                    let periodicSeparationVector: SIMD3<Double> = structureCell.applyUnitCellBoundaryCondition(posA - posB)
-                    
-                    let bondCriteria: Double = (atoms[i].asymmetricParentAtom.bondDistanceCriteria + atoms[j].asymmetricParentAtom.bondDistanceCriteria + 0.4)
-                    
-                    let bondLength: Double = length(periodicSeparationVector)
-                    if (bondLength < bondCriteria)
-                    {
-                      // Type atom as 'Double'
-                      if (bondLength < 0.1)
-                      {
-                        atoms[i].type = .duplicate
-                      }
-                      else if (bondLength < 0.8)
-                      {
-                        // discard as being a bond
-                      }
-                      else if (length(separationVector) > bondCriteria)
-                      {
-                        let bond: SKBondNode = SKBondNode(atom1: atoms[i], atom2: atoms[j], boundaryType: .external)
-                        computedBonds.append(bond)
-                      }
-                      else
-                      {
-                        let bond: SKBondNode = SKBondNode(atom1: atoms[i], atom2: atoms[j], boundaryType: .internal)
-                        computedBonds.append(bond)
-                      }
-                    }
-                  }
-                  j=list[j]
-                }
-              }
-              i=list[i]
-            }
-            
-            bondProgress.completedUnitCount = bondProgress.completedUnitCount + 1
-            
-            if (bondProgress.completedUnitCount % 100 == 0)
-            {
-              updateHandler()
-            }
-            
-            if cancelHandler()
-            {
-              return []
-            }
-          }
-        }
+        // discard as being a bond
       }
-    }
-    else
-    {
-      let bondProgress: Progress = Progress(totalUnitCount: Int64(atoms.count))
-      bondProgress.completedUnitCount = 0
-      
-      for i in 0..<atoms.count
+      else
       {
-        let posA: SIMD3<Double> = atoms[i].position
-        
-        for j in i+1..<atoms.count
-        {
-          let posB: SIMD3<Double> = atoms[j].position
-          
-          let separationVector: SIMD3<Double> = posA - posB
-          let periodicSeparationVector: SIMD3<Double> = structureCell.applyUnitCellBoundaryCondition(posA - posB)
-          
-          let bondCriteria: Double = (atoms[i].asymmetricParentAtom.bondDistanceCriteria + atoms[j].asymmetricParentAtom.bondDistanceCriteria + 0.4)
-          
-          
-          
-          let bondLength: Double = length(periodicSeparationVector)
-          if (bondLength < bondCriteria)
-          {
-            // Type atom as 'Double'
-            if (bondLength < 0.1)
-            {
-              atoms[i].type = .duplicate
-            }
-            else if (bondLength < 0.8)
-            {
-              // discard as being a bond
-            }
-            else if (length(separationVector) > bondCriteria)
-            {
-              let bond: SKBondNode = SKBondNode(atom1: atoms[i], atom2: atoms[j], boundaryType: .external)
-              computedBonds.append(bond)
-            }
-            else
-            {
-              let bond: SKBondNode = SKBondNode(atom1: atoms[i], atom2: atoms[j], boundaryType: .internal)
-              computedBonds.append(bond)
-            }
-          }
-        }
-        
-        bondProgress.completedUnitCount = bondProgress.completedUnitCount + 1
-        
-        if (bondProgress.completedUnitCount % 100 == 0)
-        {
-          updateHandler()
-        }
-        
-        if cancelHandler()
-        {
-          return []
-        }
+        computedBonds.append(SKBondNode(atom1: atoms[pair.index1], atom2: atoms[pair.index2], boundaryType: pair.isExternal ? .external : .internal))
       }
     }
     
     return computedBonds.filter{$0.atom1.type == .copy && $0.atom2.type == .copy}
   }
   
-  
   public override func computeBondsOperation(structure: Structure, windowController: NSWindowController?) -> FKOperation?
   {
     return MolecularCrystal.RecomputeBondsOperation(structure: structure, windowController: windowController)
@@ -2029,6 +1841,14 @@ public final class MolecularCrystal: Structure, AtomEditor, BondEditor, UnitCell
   
   public var range: (Double, Double) = (0.0,0.0)
   
+  // the last computed energy grid, used to update the grid incrementally after local edits
+  let incrementalEnergyGrid: SKIncrementalEnergyGrid = SKIncrementalEnergyGrid()
+  
+  public override func releaseIncrementalEnergyGrid()
+  {
+    incrementalEnergyGrid.removeAll()
+  }
+  
   public var spacing: SIMD3<Double> = SIMD3<Double>(0.1,0.1,0.1)
   
   public var data: Data = Data()
@@ -2044,33 +1864,32 @@ public final class MolecularCrystal: Structure, AtomEditor, BondEditor, UnitCell
   
   public var gridData: [Float]
   {
-    let cell: SKCell = self.cell
-    let positions: [SIMD3<Double>] = self.atomUnitCellPositions
-    let potentialParameters: [SIMD2<Double>] = self.potentialParameters
-    let probeParameters: SIMD2<Double> = self.adsorptionSurfaceProbeParameters
+    return energyGrid(withGradient: false).energies
+  }
+  
+  // The gradients (per grid-spacing) are computed analytically for the full grid (they are not invariant under the symmetry-operations) and
+  // cached next to the energies. After a local edit the energies alone are updated incrementally, the grid with gradients is recomputed.
+  func energyGrid(withGradient: Bool) -> (energies: [Float], gradients: [SIMD3<Float>]?)
+  {
     let size: Int = self.encompassingPowerOfTwoCubicGridSize
     
-    let numberOfReplicas: SIMD3<Int32> = cell.numberOfReplicas(forCutoff: 12.0)
+    let grid: (energies: [Float], gradients: [SIMD3<Float>]?) = incrementalEnergyGrid.energyGrid(unitCell: self.cell.unitCell, positions: self.atomUnitCellPositions, potentialParameters: self.potentialParameters, probeParameter: self.adsorptionSurfaceProbeParameters, size: size, spaceGroup: self.spaceGroup, withGradient: withGradient)
     
-    if let device: MTLDevice = MTLCreateSystemDefaultDevice(),
-       let commandQueue: MTLCommandQueue = device.makeCommandQueue()
-    {
-      let framework: SKMetalFramework = SKMetalFramework(device: device, commandQueue: commandQueue, positions: positions, potentialParameters: potentialParameters, unitCell:   cell.unitCell, numberOfReplicas: numberOfReplicas)
-      
-      let data: [Float] = framework.ComputeEnergyGrid(size, sizeY: size, sizeZ: size, probeParameter: probeParameters)
-                  
-      self.minimumGridEnergyValue = data.min()
-      
-      self.adsorptionVolumeStepLength = 0.25 / Double(size)
-   
-      return data
-    }
-    return []
+    self.minimumGridEnergyValue = grid.energies.min()
+    
+    self.adsorptionVolumeStepLength = 0.25 / Double(size)
+    
+    return grid
   }
   
   public var gridValueAndGradientData: [SIMD4<Float>]
   {
-    var copiedData: [Float] = gridData
+    let grid: (energies: [Float], gradients: [SIMD3<Float>]?) = energyGrid(withGradient: true)
+    
+    // the gradients are transformed with the same (linear) scaling as the values, and are zero where the values are clipped
+    let scaling: Float = 1000.0*(1.0/300.0)/65535.0
+    var copiedData: [Float] = grid.energies
+    var clipped: [Bool] = [Bool](repeating: false, count: copiedData.count)
     
     for i in 0..<copiedData.count
     {
@@ -2079,6 +1898,7 @@ public final class MolecularCrystal: Structure, AtomEditor, BondEditor, UnitCell
       if(temp>54000)
       {
         value = 1.0;
+        clipped[i] = true
       }
       else
       {
@@ -2087,45 +1907,16 @@ public final class MolecularCrystal: Structure, AtomEditor, BondEditor, UnitCell
       copiedData[i] = value
     }
     
-    let encompassingCubicGridSize: Int32 = Int32(pow(2.0, Double(self.encompassingPowerOfTwoCubicGridSize)))
-    let numberOfValues: Int32 = encompassingCubicGridSize * encompassingCubicGridSize * encompassingCubicGridSize
-    var newdata = Array<SIMD4<Float>>(repeating: SIMD4<Float>(0.0,0.0,0.0,0.0), count: Int(numberOfValues))
-        
-    for x: Int32 in 0..<dimensions.x
+    let encompassingCubicGridSize: Int = Int(pow(2.0, Double(self.encompassingPowerOfTwoCubicGridSize)))
+    if let gradients: [SIMD3<Float>] = grid.gradients,
+       gradients.count == copiedData.count
     {
-      for y: Int32 in 0..<dimensions.y
-      {
-        for z: Int32 in 0..<dimensions.z
-        {
-          let index: Int = Int(x+encompassingCubicGridSize*y+z*encompassingCubicGridSize*encompassingCubicGridSize)
-          let value = copiedData[Int(x + dimensions.x*y + z*dimensions.x*dimensions.y)]
-          
-          let xi: Int32 = Int32(Float(x) + 0.5)
-          let xf: Float = Float(x) + 0.5 - Float(xi)
-          let xd0: Float = copiedData[Int(((xi-1 + dimensions.x) % dimensions.x)+y*dimensions.x+z*dimensions.x*dimensions.y)]
-          let xd1: Float = copiedData[Int((xi)+y*dimensions.x+z*dimensions.x*dimensions.y)]
-          let xd2: Float = copiedData[Int(((xi+1 + dimensions.x) % dimensions.x)+y*dimensions.x+z*dimensions.x*dimensions.y)]
-          let gx: Float = (xd1 - xd0) * (1.0 - xf) + (xd2 - xd1) * xf
-
-          let yi: Int32 = Int32(Float(y) + 0.5)
-          let yf: Float = Float(y) + 0.5 - Float(yi)
-          let yd0: Float = copiedData[Int(x + ((yi-1+dimensions.y) % dimensions.y)*dimensions.x+z*dimensions.x*dimensions.y)]
-          let yd1: Float = copiedData[Int(x + (yi)*dimensions.x+z*dimensions.x*dimensions.y)]
-          let yd2: Float = copiedData[Int(x + ((yi+1+dimensions.y) % dimensions.y)*dimensions.x+z*dimensions.x*dimensions.y)]
-          let gy: Float = (yd1 - yd0) * (1.0 - yf) + (yd2 - yd1) * yf
-
-          let zi: Int32 = Int32(Float(z) + 0.5)
-          let zf: Float = Float(z) + 0.5 - Float(zi)
-          let zd0: Float =  copiedData[Int(x+y*dimensions.x+((zi-1+dimensions.z) % dimensions.z)*dimensions.x*dimensions.y)]
-          let zd1: Float =  copiedData[Int(x+y*dimensions.x+(zi)*dimensions.x*dimensions.y)]
-          let zd2: Float =  copiedData[Int(x+y*dimensions.x+((zi+1+dimensions.z) % dimensions.z)*dimensions.x*dimensions.y)]
-          let gz: Float =  (zd1 - zd0) * (1.0 - zf) + (zd2 - zd1) * zf
-          
-          newdata[index] = SIMD4<Float>(value,gx,gy,gz)
-        }
-      }
+      let scaledGradients: [SIMD3<Float>] = gradients.indices.map{clipped[$0] ? SIMD3<Float>(0.0,0.0,0.0) : scaling * gradients[$0]}
+      return SKGridGradient.valuesAndGradients(copiedData, gradients: scaledGradients, dimensions: dimensions, cubeSize: encompassingCubicGridSize)
     }
-    return newdata
+    
+    // central differences (periodic), computed in parallel
+    return SKGridGradient.valuesAndGradients(copiedData, dimensions: dimensions, cubeSize: encompassingCubicGridSize)
   }
   
   // MARK: -
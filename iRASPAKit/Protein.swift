@@ -459,74 +459,32 @@ public final class Protein: Structure, AtomEditor, BondEditor, RKRenderAtomSourc
      
     let subsetAtoms: [SKAtomCopy] = subset.flatMap{$0.copies}
      
-    let asymmetricAtoms: Set<SKAsymmetricAtom> = Set(self.atomTreeController.flattenedLeafNodes().compactMap{$0.representedObject})
-       
-    let subSetAsymmetricAtoms: Set<SKAsymmetricAtom> = Set(asymmetricAtoms).subtracting(subset)
-    let atomList: [SKAtomCopy] = subSetAsymmetricAtoms.flatMap{$0.copies}
-     
-    for i in 0..<subsetAtoms.count
+    // only the atoms in the neighbourhood of the subset can bond to it
+    let atomList: [SKAtomCopy] = self.bondNeighbourhood(subset: subset)
+    
+    subsetAtoms.forEach{$0.type = .copy}
+    
+    // the atoms of the subset come first, so the pairs of the subset are all pairs (i,j) with i in the subset and j > i
+    let atoms: [SKAtomCopy] = subsetAtoms + atomList
+    let cellList: SKBondCellList = SKBondCellList(positions: atoms.map{$0.position}, bondDistanceCriteria: atoms.map{$0.asymmetricParentAtom.bondDistanceCriteria})
+    
+    for pair in cellList.pairs(for: 0..<subsetAtoms.count) ?? []
     {
-      subsetAtoms[i].type = .copy
-       
-      let posA: SIMD3<Double> = subsetAtoms[i].position
-       
-      for j in i+1..<subsetAtoms.count
+      // Type atom as 'Double'
+      if (pair.bondLength < 0.1)
       {
-        let posB: SIMD3<Double> = subsetAtoms[j].position
-         
-        let separationVector: SIMD3<Double> = posA - posB
-         
-        let bondCriteria: Double = (subsetAtoms[i].asymmetricParentAtom.bondDistanceCriteria + subsetAtoms[j].asymmetricParentAtom.bondDistanceCriteria + 0.4)
-         
-        let bondLength: Double = length(separationVector)
-        if (bondLength < bondCriteria)
-        {
-          // Type atom as 'Double'
-          if (bondLength < 0.1)
-          {
-            subsetAtoms[i].type = .duplicate
-          }
-          else if (bondLength < 0.8)
-          {
-            // discard as being a bond
-          }
-          else
-          {
-            let bond: SKBondNode = SKBondNode(atom1: subsetAtoms[i], atom2: subsetAtoms[j], boundaryType: .internal)
-            computedBonds.append(bond)
-          }
-        }
+        subsetAtoms[pair.index1].type = .duplicate
       }
-       
-      for j in 0..<atomList.count
+      else if (pair.bondLength < 0.8)
       {
-        let posB: SIMD3<Double> = atomList[j].position
-         
-        let separationVector: SIMD3<Double> = posA - posB
-         
-        let bondCriteria: Double = (subsetAtoms[i].asymmetricParentAtom.bondDistanceCriteria + atomList[j].asymmetricParentAtom.bondDistanceCriteria + 0.4)
-         
-        let bondLength: Double = length(separationVector)
-        if (bondLength < bondCriteria)
-        {
-          // Type atom as 'Double'
-          if (bondLength < 0.1)
-          {
-            subsetAtoms[i].type = .duplicate
-          }
-          else if (bondLength < 0.8)
-          {
-            // discard as being a bond
-          }
-          else
-          {
-            let bond: SKBondNode = SKBondNode(atom1: subsetAtoms[i], atom2: atomList[j], boundaryType: .internal)
-            computedBonds.append(bond)
-          }
-        }
+        // discard as being a bond
+      }
+      else
+      {
+        computedBonds.append(SKBondNode(atom1: atoms[pair.index1], atom2: atoms[pair.index2], boundaryType: .internal))
       }
     }
-     
+    
     return computedBonds.filter{$0.atom1.type == .copy && $0.atom2.type == .copy}
   }
   
@@ -899,12 +857,16 @@ public final class Protein: Structure, AtomEditor, BondEditor, RKRenderAtomSourc
 
   public override func reComputeBonds()
   {
+    self.invalidateBondSpatialIndex()
+    
     let atomList: [SKAtomCopy] = self.atomTreeController.flattenedLeafNodes().compactMap{$0.representedObject}.flatMap{$0.copies}
     self.bondSetController.bonds = self.computeBonds(cell: self.cell, atomList: atomList, cancelHandler: {return false}, updateHandler: {})
   }
   
   public override func reComputeBonds(_ node: ProjectTreeNode, cancelHandler: (()-> Bool), updateHandler: (() -> ()))
   {
+    self.invalidateBondSpatialIndex()
+    
     let atomList: [SKAtomCopy] = self.atomTreeController.flattenedLeafNodes().compactMap{$0.representedObject}.flatMap{$0.copies}
     self.bondSetController.bonds = self.computeBonds(cell: self.cell, atomList: atomList, cancelHandler: cancelHandler, updateHandler: updateHandler)
   }
@@ -917,152 +879,27 @@ public final class Protein: Structure, AtomEditor, BondEditor, RKRenderAtomSourc
   
   public override func computeBonds(cell structureCell: SKCell, atomList atoms: [SKAtomCopy], cancelHandler: (()-> Bool) = {return false}, updateHandler: (() -> ()) = {}) -> [SKBondNode]
   {
-    let cutoff: Double = 3.0
-    let offsets: [[Int]] = [[0,0,0],[1,0,0],[1,1,0],[0,1,0],[-1,1,0],[0,0,1],[1,0,1],[1,1,1],[0,1,1],[-1,1,1],[-1,0,1],[-1,-1,1],[0,-1,1],[1,-1,1]]
-    
     var computedBonds: [SKBondNode] = []
-    var totalCount: Int
     
-    //atoms.forEach{ $0.bonds.removeAll()}
-
-    let perpendicularWidths: SIMD3<Double> = structureCell.boundingBox.widths + SIMD3<Double>(x: 0.1, y: 0.1, z: 0.1)
-    let numberOfCells: [Int] = [Int(perpendicularWidths.x/cutoff),Int(perpendicularWidths.y/cutoff),Int(perpendicularWidths.z/cutoff)]
-    let totalNumberOfCells: Int = numberOfCells[0] * numberOfCells[1] * numberOfCells[2]
-    let cutoffVector: SIMD3<Double> = SIMD3<Double>(x: perpendicularWidths.x/Double(numberOfCells[0]), y: perpendicularWidths.y/Double(numberOfCells[1]), z: perpendicularWidths.z/Double(numberOfCells[2]))
+    let cellList: SKBondCellList = SKBondCellList(positions: atoms.map{$0.position}, bondDistanceCriteria: atoms.map{$0.asymmetricParentAtom.bondDistanceCriteria})
+    
+    guard let pairs: [SKBondCellList.Pair] = cellList.pairs(for: 0..<atoms.count, cancelHandler: cancelHandler, updateHandler: updateHandler) else {return []}
     
-    if ((numberOfCells[0]>=3) &&  (numberOfCells[1]>=3) && (numberOfCells[2]>=3))
+    for pair in pairs
     {
-      
-      var head: [Int] = [Int](repeating: -1, count: totalNumberOfCells)
-      var list: [Int] = [Int](repeating: -1, count: atoms.count)
-      
-      // create cell-list based on the bond-cutoff
-      for i in 0..<atoms.count
+      if (pair.bondLength < 0.8)
       {
-        let position: SIMD3<Double> = atoms[i].position - structureCell.boundingBox.minimum
-        
-        let icell: Int = Int((position.x) / cutoffVector.x) +
-          Int((position.y) / cutoffVector.y) * numberOfCells[0] +
-          Int((position.z) / cutoffVector.z) * numberOfCells[1] * numberOfCells[0]
-        
-        
-        list[i] = head[icell]
-        head[icell] = i
+        // discard as being a bond
       }
-      
-      totalCount = numberOfCells[0] * numberOfCells[1] * numberOfCells[2]
-      let bondProgress: Progress = Progress(totalUnitCount: Int64(totalCount))
-      bondProgress.completedUnitCount = 0
-      
-      for k1 in 0..<numberOfCells[0]
+      else
       {
-        for k2 in 0..<numberOfCells[1]
-        {
-          for k3 in 0..<numberOfCells[2]
-          {
-            let icell_i: Int = k1 + k2 * numberOfCells[0] + k3 * numberOfCells[1] * numberOfCells[0]
-            
-            var i: Int = head[icell_i]
-            while(i >= 0)
-            {
-              let posA: SIMD3<Double> = atoms[i].position
-              
-              // loop over neighboring cells
-              for offset in offsets
-              {
-                let off: [Int] = [(k1 + offset[0]+numberOfCells[0]) % numberOfCells[0],
-                                  (k2 + offset[1]+numberOfCells[1]) % numberOfCells[1],
-                                  (k3 + offset[2]+numberOfCells[2]) % numberOfCells[2]]
-                let icell_j: Int = off[0] + off[1] * numberOfCells[0] + off[2] * numberOfCells[1] * numberOfCells[0]
-                
-                var j: Int = head[icell_j]
-                while(j >= 0)
-                {
-                  if((i < j) || (icell_i != icell_j))
-                  {
-                    let posB: SIMD3<Double> = atoms[j].position
-                    let separationVector: SIMD3<Double> = posA - posB
-                    
-                    let bondCriteria: Double = (atoms[i].asymmetricParentAtom.bondDistanceCriteria + atoms[j].asymmetricParentAtom.bondDistanceCriteria + 0.4)
-                    
-                    let bondLength: Double = length(separationVector)
-                    if (bondLength < 0.8)
-                    {
-                      // discard as being a bond
-                    }
-                    else if (bondLength < bondCriteria)
-                    {
-                      computedBonds.append(SKBondNode(atom1: atoms[i], atom2: atoms[j], boundaryType: .internal))
-                    }
-                  }
-                  j=list[j]
-                }
-              }
-              i=list[i]
-            }
-            
-            
-            bondProgress.completedUnitCount = bondProgress.completedUnitCount + 1
-            
-            if (bondProgress.completedUnitCount % 100 == 0)
-            {
-              updateHandler()
-            }
-            
-            if cancelHandler()
-            {
-              return []
-            }
-          }
-        }
-      }
-    }
-    else
-    {
-      let bondProgress: Progress = Progress(totalUnitCount: Int64(atoms.count))
-      bondProgress.completedUnitCount = 0
-      
-      for i in 0..<atoms.count
-      {
-        let posA: SIMD3<Double> = atoms[i].position
-        
-        for j in i+1..<atoms.count
-        {
-          let posB: SIMD3<Double> = atoms[j].position
-          
-          let separationVector: SIMD3<Double> = posA - posB
-          
-          let bondCriteria: Double = (atoms[i].asymmetricParentAtom.bondDistanceCriteria + atoms[j].asymmetricParentAtom.bondDistanceCriteria + 0.4)
-          
-          let bondLength: Double = length(separationVector)
-          if (bondLength < 0.8)
-          {
-            // discard as being a bond
-          }
-          else if (bondLength < bondCriteria )
-          {
-            computedBonds.append(SKBondNode(atom1: atoms[i], atom2: atoms[j], boundaryType: .internal))
-          }
-        }
-        
-        bondProgress.completedUnitCount = bondProgress.completedUnitCount + 1
-        
-        if (bondProgress.completedUnitCount % 100 == 0)
-        {
-          updateHandler()
-        }
-        
-        if cancelHandler()
-        {
-          return []
-        }
-        
+        computedBonds.append(SKBondNode(atom1: atoms[pair.index1], atom2: atoms[pair.index2], boundaryType: .internal))
       }
     }
     
     return computedBonds
   }
-
+  
   public override func computeBondsOperation(structure: Structure, windowController: NSWindowController?) -> FKOperation?
   {
     return Protein.RecomputeBondsOperation(structure: structure, windowController: windowController)
@@ -54,6 +54,13 @@ public class Structure: Object, AtomViewer, BondViewer, SKRenderAdsorptionSurfac
   public var atomTreeController: SKAtomTreeController = SKAtomTreeController()
   public var bondSetController: SKBondSetController = SKBondSetController()
   
+  // not archived, rebuilt on demand for incremental bond updates
+  public var bondSpatialIndex: SKBondSpatialIndex? = nil
+  
+  // the atom tree (and its version) the spatial index was built for, the index is rebuilt after the atoms have been re-tagged
+  weak var bondSpatialIndexAtomTreeController: SKAtomTreeController? = nil
+  var bondSpatialIndexAtomTreeVersion: Int = 0
+  
   // MARK: protocol RKRenderAtomSource implementation
   // =====================================================================
   
@@ -382,6 +389,11 @@ public class Structure: Object, AtomViewer, BondViewer, SKRenderAdsorptionSurfac
     return false
   }
   
+  public var hasPeriodicBonds: Bool
+  {
+    return false
+  }
+  
   public var legacySpaceGroup: SKSpacegroup = SKSpacegroup(HallNumber: 1)
   
   public override var materialType: Object.ObjectType
@@ -2933,6 +2945,87 @@ public class Structure: Object, AtomViewer, BondViewer, SKRenderAdsorptionSurfac
     return []
   }
   
+  // MARK: -
+  // MARK: Incremental bonds
+  
+  public func bondPosition(_ atom: SKAtomCopy) -> SIMD3<Double>
+  {
+    return self.isFractional ? self.cell.convertToCartesian(atom.position) : atom.position
+  }
+  
+  public func invalidateBondSpatialIndex()
+  {
+    self.bondSpatialIndex = nil
+  }
+  
+  /// Releases the energy grid that is kept for incremental updates after local edits (only crystals keep one)
+  public func releaseIncrementalEnergyGrid()
+  {
+  }
+  
+  /// Moves the copies of the atoms to their current positions in the spatial index (when there is one)
+  public func updateBondSpatialIndex(atoms: [SKAsymmetricAtom])
+  {
+    if let index: SKBondSpatialIndex = self.bondSpatialIndex
+    {
+      atoms.flatMap{$0.copies}.forEach{index.insert($0, at: bondPosition($0))}
+    }
+  }
+  
+  public func removeFromBondSpatialIndex(atoms: [SKAsymmetricAtom])
+  {
+    if let index: SKBondSpatialIndex = self.bondSpatialIndex
+    {
+      atoms.flatMap{$0.copies}.forEach{index.remove($0)}
+    }
+  }
+  
+  /// Returns the atom copies outside the subset that can form bonds with the subset.
+  ///
+  /// The copies of the subset are first inserted or moved to their current positions in the spatial index. The index is rebuilt when it
+  /// does not exist yet, when the unit cell changed, when the atoms have been re-tagged since it was built (atoms were inserted, deleted or
+  /// their copies regenerated), or when an atom has a larger bond criterion than the index supports. Otherwise only the subset is touched,
+  /// so the cost per call does not depend on the number of atoms of the structure.
+  public func bondNeighbourhood(subset: [SKAsymmetricAtom]) -> [SKAtomCopy]
+  {
+    let subsetAtoms: [SKAtomCopy] = subset.flatMap{$0.copies}
+    let maximumBondDistanceCriteria: Double = subsetAtoms.map{$0.asymmetricParentAtom.bondDistanceCriteria}.max() ?? 0.0
+    
+    if let index: SKBondSpatialIndex = self.bondSpatialIndex,
+       index.unitCell == self.cell.unitCell,
+       maximumBondDistanceCriteria <= index.maximumBondDistanceCriteria,
+       self.bondSpatialIndexAtomTreeController === self.atomTreeController,
+       self.bondSpatialIndexAtomTreeVersion == self.atomTreeController.version
+    {
+      subsetAtoms.forEach{index.insert($0, at: bondPosition($0))}
+    }
+    else
+    {
+      let atoms: [SKAtomCopy] = self.atomTreeController.flattenedLeafNodes().compactMap{$0.representedObject}.flatMap{$0.copies}
+      let index: SKBondSpatialIndex = SKBondSpatialIndex(cell: self.hasPeriodicBonds ? self.cell : nil, maximumBondDistanceCriteria: atoms.map{$0.asymmetricParentAtom.bondDistanceCriteria}.max() ?? 0.0)
+      atoms.forEach{index.insert($0, at: bondPosition($0))}
+      self.bondSpatialIndex = index
+      self.bondSpatialIndexAtomTreeController = self.atomTreeController
+      self.bondSpatialIndexAtomTreeVersion = self.atomTreeController.version
+    }
+    
+    return self.bondSpatialIndex?.neighbourhood(of: subsetAtoms) ?? []
+  }
+  
+  /// Re-derives the bonds of the subset in its neighbourhood and returns the difference with the current bonds.
+  ///
+  /// Bonds that are unchanged (same atoms and same boundary type) are in neither list.
+  public func bondDifference(subset: [SKAsymmetricAtom]) -> (added: [SKBondNode], removed: [SKBondNode])
+  {
+    let oldBonds: [SKBondNode] = self.bondSetController.asymmetricBonds(of: Set(subset)).flatMap{$0.copies}
+    let newBonds: [SKBondNode] = self.bonds(subset: subset)
+    
+    let oldBoundaryTypes: [SKBondNode: SKBondNode.BoundaryType] = Dictionary(oldBonds.map{($0, $0.boundaryType)}, uniquingKeysWith: {first, _ in first})
+    let newBoundaryTypes: [SKBondNode: SKBondNode.BoundaryType] = Dictionary(newBonds.map{($0, $0.boundaryType)}, uniquingKeysWith: {first, _ in first})
+    
+    return (newBonds.filter{oldBoundaryTypes[$0] != $0.boundaryType}, oldBonds.filter{newBoundaryTypes[$0] != $0.boundaryType})
+  }
+  
   public func translatedPositionsSelectionCartesian(atoms: [SKAsymmetricAtom], by translation: SIMD3<Double>) -> [SIMD3<Double>]
   {
     return []